@@ -27,6 +27,7 @@ extern "C" {
 
 #include "artik_error.h"
 #include "artik_types.h"
+#include "artik_module.h"
 
 	/*! \file artik_log.h
 	 *
@@ -122,6 +123,59 @@ extern "C" {
 					   const char *prefix, const char *msg,
 					   void *user_data);
 
+	/*!
+	 * \brief     Number of log level thresholds
+	 *
+	 * One threshold per module ID from artik_module.h, the last one
+	 * is used by the code outside of the SDK modules.
+	 */
+#define ARTIK_LOG_MAX_MODULES	32
+
+	/*!
+	 * \brief     Threshold used by the code outside of the SDK modules
+	 */
+#define ARTIK_LOG_MODULE_APP	(ARTIK_LOG_MAX_MODULES - 1)
+
+	/*!
+	 * \brief     Pass to set_level() to change all the thresholds
+	 */
+#define ARTIK_LOG_MODULE_ALL	(-1)
+
+	/*!
+	 * \brief     Threshold checked by the logging macros
+	 *
+	 * Defined by the build system for the SDK modules.
+	 */
+#ifndef ARTIK_LOG_MODULE
+#define ARTIK_LOG_MODULE	ARTIK_LOG_MODULE_APP
+#endif
+
+	/*!
+	 * \brief     Rate limiting state of a logging call site
+	 *
+	 * Used by the *_ratelimited() macros to log at most
+	 * ARTIK_LOG_RATELIMIT_BURST messages every
+	 * ARTIK_LOG_RATELIMIT_INTERVAL milliseconds.
+	 */
+	typedef struct {
+		long long begin;
+		int printed;
+		int missed;
+	} artik_log_ratelimit_state;
+
+#define ARTIK_LOG_RATELIMIT_INTERVAL	5000
+#define ARTIK_LOG_RATELIMIT_BURST	10
+#define ARTIK_LOG_RATELIMIT_INIT	{ 0, 0, 0 }
+
+	/*!
+	 * \brief     Log levels filtered out, per module
+	 *
+	 * Stored as the distance to LOG_LEVEL_DEBUG so that a zeroed
+	 * entry lets all the messages through. Only meant to be read
+	 * by the logging macros, use set_level() to change it.
+	 */
+	extern int artik_log_filter[ARTIK_LOG_MAX_MODULES];
+
 	/*! \struct artik_log_module
 	 *
 	 *  \brief Logging module operations
@@ -181,6 +235,58 @@ extern "C" {
 			       const char *funcname, int line,
 			       const char *format, ...);
 
+		/*!
+		 * \brief     Enable or disable asynchronous logging
+		 *
+		 * When enabled, the logging calls only store the message
+		 * arguments in a per-thread buffer, the formatting and the
+		 * output are done by a background thread. Messages logged
+		 * while a buffer is full are dropped and counted. Disabling
+		 * flushes all the pending messages.
+		 *
+		 * \param[in] enable true to enable, false to disable
+		 *
+		 * \return S_OK on success, error code otherwise
+		 */
+		artik_error(*set_async)(bool enable);
+
+		/*!
+		 * \brief     Set the log level threshold of a module
+		 *
+		 * Messages of a lower priority than the threshold are
+		 * discarded by the logging macros without evaluating
+		 * their arguments.
+		 *
+		 * \param[in] module ID from artik_module_id_t,
+		 *            ARTIK_LOG_MODULE_APP or ARTIK_LOG_MODULE_ALL
+		 * \param[in] level Lowest priority level to log
+		 *
+		 * \return S_OK on success, error code otherwise
+		 */
+		artik_error(*set_level)(int module, enum artik_log_level level);
+
+		/*!
+		 * \brief     Get the log level threshold of a module
+		 *
+		 * \param[in] module ID from artik_module_id_t or
+		 *            ARTIK_LOG_MODULE_APP
+		 *
+		 * \return The lowest priority level logged
+		 */
+		enum artik_log_level (*get_level)(int module);
+
+		/*!
+		 * \brief     Check the rate limit of a logging call site
+		 *
+		 * Use the *_ratelimited() macros instead.
+		 *
+		 * \param[in] state Call site state
+		 *
+		 * \return -1 if the message must be dropped, the number of
+		 *         messages dropped since the previous one otherwise
+		 */
+		int (*ratelimit)(artik_log_ratelimit_state *state);
+
 	} artik_log_module;
 
 	extern const artik_log_module log_module;
@@ -194,20 +300,53 @@ extern "C" {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wvariadic-macros"
 
-#define artik_log(level, ...) (log_module.print(level, __FILE__, \
-				__func__, __LINE__, __VA_ARGS__))
+#define artik_log_enabled(level) ((int)(level) + \
+		__atomic_load_n(&artik_log_filter[ARTIK_LOG_MODULE], \
+		__ATOMIC_RELAXED) <= LOG_LEVEL_DEBUG)
 
-#ifdef CONFIG_RELEASE
+#define artik_log(level, ...) (artik_log_enabled(level) ? \
+				log_module.print(level, __FILE__, \
+				__func__, __LINE__, __VA_ARGS__) : (void)0)
+
+#define artik_log_ratelimited(level, ...) do { \
+		static artik_log_ratelimit_state __rl = \
+					ARTIK_LOG_RATELIMIT_INIT; \
+		int __missed; \
+		if (!artik_log_enabled(level)) \
+			break; \
+		__missed = log_module.ratelimit(&__rl); \
+		if (__missed > 0) \
+			artik_log(level, "%d messages suppressed", __missed); \
+		if (__missed >= 0) \
+			artik_log(level, __VA_ARGS__); \
+	} while (0)
+
+#if defined(CONFIG_RELEASE) || defined(CONFIG_LOG_NO_DEBUG)
 #define log_dbg(...)
+#define log_dbg_ratelimited(...)
+#else
+#define log_dbg(...) artik_log(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define log_dbg_ratelimited(...) \
+		artik_log_ratelimited(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#endif
+
+#ifdef CONFIG_RELEASE
 #define log_info(...)
 #define log_warn(...)
+#define log_info_ratelimited(...)
+#define log_warn_ratelimited(...)
 #else
-#define log_dbg(...) artik_log(LOG_LEVEL_DEBUG, __VA_ARGS__)
 #define log_info(...) artik_log(LOG_LEVEL_INFO,  __VA_ARGS__)
 #define log_warn(...) artik_log(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define log_info_ratelimited(...) \
+		artik_log_ratelimited(LOG_LEVEL_INFO, __VA_ARGS__)
+#define log_warn_ratelimited(...) \
+		artik_log_ratelimited(LOG_LEVEL_WARNING, __VA_ARGS__)
 #endif
 
 #define log_err(...) artik_log(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define log_err_ratelimited(...) \
+		artik_log_ratelimited(LOG_LEVEL_ERROR, __VA_ARGS__)
 
 #pragma GCC diagnostic pop
 #ifdef __cplusplus
@@ -77,6 +77,30 @@ typedef int(*idle_callback)(void *user_data);
 
 typedef int(*watch_callback)(int fd, enum watch_io io, void *user_data);
 typedef int(*signal_callback)(void *user_data);
+/*!
+ * \brief     Callback prototype for functions posted to a loop
+ * \param[in] user_data The user data passed from the \ref post function
+ */
+typedef void(*post_callback)(void *user_data);
+/*!
+ * \brief     Function run on a worker thread by \ref submit_work
+ * \param[in] user_data The user data passed to \ref submit_work
+ */
+typedef void(*work_callback)(void *user_data);
+/*!
+ * \brief     Called on the main loop once a submitted work has completed
+ * \param[in] user_data The user data passed to \ref submit_work
+ */
+typedef void(*work_done_callback)(void *user_data);
+
+/*!
+ * \brief Loop handle type
+ *
+ * Handle type used to carry a loop instance created by
+ * \ref create_loop. A NULL handle refers to the main loop
+ * run by \ref run.
+ */
+typedef void *artik_loop_handle;
 
 /*! \struct artik_loop_module
  *
@@ -208,6 +232,159 @@ typedef struct {
 	 * \return    S_OK on success, error code otherwise
 	 */
 	artik_error(*remove_idle_callback)(int idle_id);
+	/*!
+	 * \brief     Create a new loop running in its own thread
+	 *
+	 * The loop owns a separate context, so watches and timers
+	 * attached to it are dispatched independently from the main
+	 * loop and from other loop instances.
+	 *
+	 * \param[out] handle Handle tied to the created loop
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*create_loop)(artik_loop_handle *handle);
+	/*!
+	 * \brief     Stop a loop, join its thread and release it
+	 *
+	 * Pending posted functions are dropped. Must not be called
+	 * from the thread of the loop being destroyed. Calls on the
+	 * loop from other threads may run concurrently, they then
+	 * fail with E_BAD_ARGS or have no effect.
+	 *
+	 * \param[in] handle Handle returned by \ref create_loop
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*destroy_loop)(artik_loop_handle handle);
+	/*!
+	 * \brief     Run a function on the thread of a loop
+	 *
+	 * Can be called from any thread. Functions posted to the
+	 * same loop are called in order.
+	 *
+	 * \param[in] handle Target loop, NULL for the main loop
+	 * \param[in] func The function to call from the loop
+	 * \param[in] user_data The user data to be passed to the
+	 *            function
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*post)(artik_loop_handle handle, post_callback func,
+			void *user_data);
+	/*!
+	 * \brief     Same as \ref add_timeout_callback on a given loop
+	 *
+	 * \param[in] handle Target loop, NULL for the main loop
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*add_timeout_callback_to_loop)(artik_loop_handle handle,
+			int *timeout_id, unsigned int msec,
+			timeout_callback func, void *user_data);
+	/*!
+	 * \brief     Same as \ref remove_timeout_callback on a given loop
+	 *
+	 * \param[in] handle Loop the timeout was added to
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*remove_timeout_callback_from_loop)(
+			artik_loop_handle handle, int timeout_id);
+	/*!
+	 * \brief     Same as \ref add_periodic_callback on a given loop
+	 *
+	 * \param[in] handle Target loop, NULL for the main loop
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*add_periodic_callback_to_loop)(artik_loop_handle handle,
+			int *periodic_id, unsigned int msec,
+			periodic_callback func, void *user_data);
+	/*!
+	 * \brief     Same as \ref remove_periodic_callback on a given loop
+	 *
+	 * \param[in] handle Loop the periodic was added to
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*remove_periodic_callback_from_loop)(
+			artik_loop_handle handle, int periodic_id);
+	/*!
+	 * \brief     Same as \ref add_fd_watch on a given loop
+	 *
+	 * \param[in] handle Target loop, NULL for the main loop
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*add_fd_watch_to_loop)(artik_loop_handle handle, int fd,
+			enum watch_io io, watch_callback func, void *user_data,
+			int *watch_id);
+	/*!
+	 * \brief     Same as \ref remove_fd_watch on a given loop
+	 *
+	 * \param[in] handle Loop the watch was added to
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*remove_fd_watch_from_loop)(artik_loop_handle handle,
+			int watch_id);
+	/*!
+	 * \brief     Same as \ref add_idle_callback on a given loop
+	 *
+	 * \param[in] handle Target loop, NULL for the main loop
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*add_idle_callback_to_loop)(artik_loop_handle handle,
+			int *idle_id, idle_callback func, void *user_data);
+	/*!
+	 * \brief     Same as \ref remove_idle_callback on a given loop
+	 *
+	 * \param[in] handle Loop the idle was added to
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*remove_idle_callback_from_loop)(artik_loop_handle handle,
+			int idle_id);
+	/*!
+	 * \brief     Run a blocking function on the worker pool
+	 *
+	 * The function is run on one of a fixed set of worker threads,
+	 * then \ref work_done_callback is called from the main loop.
+	 * Works are started in submission order but may complete in
+	 * any order.
+	 *
+	 * \param[in] work_func Function to run on a worker thread
+	 * \param[in] done_func Function called on the main loop after
+	 *            work_func returned, can be NULL
+	 * \param[in] user_data The user data passed to both functions
+	 *
+	 * \return    S_OK on success, E_BUSY if the work queue is full,
+	 *            error code otherwise
+	 */
+	artik_error(*submit_work)(work_callback work_func,
+			work_done_callback done_func, void *user_data);
+	/*!
+	 * \brief     Same as \ref add_timeout_callback with a tolerance
+	 *
+	 * The callback may be delayed by up to slack_msec milliseconds
+	 * so that it can be run together with other timers expiring
+	 * around the same time, reducing the number of wakeups.
+	 *
+	 * \param[out] timeout_id ID returned by the function for later
+	 *             reference of the timer
+	 * \param[in] msec Timeout in milliseconds
+	 * \param[in] slack_msec Maximum delay allowed after msec
+	 * \param[in] func The callback function to register
+	 * \param[in] user_data The user data to be passed to the callback
+	 *            function
+	 *
+	 * \return    S_OK on success, error code otherwise
+	 */
+	artik_error(*add_timeout_with_slack)(int *timeout_id,
+			unsigned int msec, unsigned int slack_msec,
+			timeout_callback func, void *user_data);
 } artik_loop_module;
 
 extern const artik_loop_module loop_module;
@@ -116,6 +116,35 @@ extern "C" {
 	 */
 	typedef unsigned int long artik_msecond;
 
+	/*!
+	 *  \brief Time nanosecond type
+	 *
+	 *  Value of a monotonic clock, or a duration, in nanoseconds.
+	 */
+	typedef unsigned long long artik_nsecond;
+
+	/*!
+	 *  \brief Monotonic clock type
+	 *
+	 *  Define the clocks usable for measuring durations. None of
+	 *  them jumps when the system time is changed.
+	 */
+	typedef enum {
+		/*!
+		 *  \brief Slewed by NTP, best for latency measurements
+		 */
+		ARTIK_CLOCK_MONOTONIC = 0,
+		/*!
+		 *  \brief Hardware based, never adjusted by NTP
+		 */
+		ARTIK_CLOCK_MONOTONIC_RAW,
+		/*!
+		 *  \brief Same as ARTIK_CLOCK_MONOTONIC with a resolution
+		 *         of a scheduler tick, cheaper to read
+		 */
+		ARTIK_CLOCK_MONOTONIC_COARSE
+	} artik_clock_id;
+
 	/*!
 	 *  \brief Time zone type
 	 *
@@ -144,6 +173,91 @@ extern "C" {
 	 */
 	typedef void(*alarm_callback)(void *user_data);
 
+	/*!
+	 *  \brief NTP client handle type
+	 *
+	 *  Handle type used to carry instance specific
+	 *  information for an asynchronous NTP client.
+	 */
+	typedef void *artik_ntp_handle;
+
+	/*!
+	 *  \brief NTP client configuration
+	 */
+	typedef struct {
+		/*!
+		 *  \brief Host names or addresses of the NTP servers
+		 */
+		const char * const *servers;
+		/*!
+		 *  \brief Number of entries in servers
+		 */
+		int num_servers;
+		/*!
+		 *  \brief UDP port of the servers, 0 for the NTP port
+		 */
+		unsigned short port;
+		/*!
+		 *  \brief Time to wait for the answers in milliseconds,
+		 *         0 for the default (2 s)
+		 */
+		artik_msecond timeout;
+		/*!
+		 *  \brief Time between two synchronizations in milliseconds,
+		 *         0 to synchronize only once
+		 */
+		artik_msecond period;
+		/*!
+		 *  \brief Offset above which the clock is stepped instead of
+		 *         slewed in milliseconds, 0 for the default (128 ms)
+		 */
+		artik_msecond step_threshold;
+		/*!
+		 *  \brief false to only measure the offset without changing
+		 *         the system clock
+		 */
+		bool adjust_clock;
+	} artik_ntp_config;
+
+	/*!
+	 *  \brief Result of a synchronization
+	 */
+	typedef struct {
+		/*!
+		 *  \brief Offset of the local clock, positive when it is
+		 *         behind the servers, in microseconds
+		 */
+		long long offset_usec;
+		/*!
+		 *  \brief Round trip delay to the selected server in
+		 *         microseconds
+		 */
+		unsigned long long delay_usec;
+		/*!
+		 *  \brief Estimated frequency error of the local clock in
+		 *         parts per billion, 0 until two synchronizations
+		 *         succeeded
+		 */
+		long long drift_ppb;
+		/*!
+		 *  \brief Number of server answers kept after filtering
+		 */
+		int num_samples;
+		/*!
+		 *  \brief true if the clock was stepped instead of slewed
+		 */
+		bool stepped;
+	} artik_ntp_result;
+
+	/*!
+	 * \brief     Called after each synchronization attempt
+	 * \param[in] result S_OK on success, error code otherwise
+	 * \param[in] info Synchronization details, NULL on error
+	 * \param[in] user_data The user data passed to start_ntp_sync
+	 */
+	typedef void(*ntp_callback)(artik_error result,
+			const artik_ntp_result *info, void *user_data);
+
 	/*! \struct artik_time_module
 	 *
 	 *  \brief Time module operations
@@ -278,6 +392,97 @@ extern "C" {
 		 *         -2 if the parameters are invalid
 		 */
 		 int (*compare_dates)(const artik_time *date1, const artik_time *date2);
+		/*!
+		 *  \brief Read a monotonic clock
+		 *
+		 *  Prefer this function over \ref get_tick for measuring
+		 *  durations, it is not affected by changes of the system
+		 *  time.
+		 *
+		 *  \param[in] clock Clock to read
+		 *
+		 *  \return Clock value in nanoseconds, 0 on error
+		 */
+		 artik_nsecond (*get_monotonic)(artik_clock_id clock);
+		/*!
+		 *  \brief Get the time elapsed since a point in time
+		 *
+		 *  \param[in] start Value previously returned by
+		 *             \ref get_monotonic for ARTIK_CLOCK_MONOTONIC
+		 *
+		 *  \return Elapsed time in nanoseconds
+		 */
+		 artik_nsecond (*get_elapsed)(artik_nsecond start);
+		/*!
+		 *  \brief Get a deadline for a timeout starting now
+		 *
+		 *  \param[in] timeout Timeout in milliseconds
+		 *
+		 *  \return Deadline on the ARTIK_CLOCK_MONOTONIC clock
+		 */
+		 artik_nsecond (*get_deadline)(artik_msecond timeout);
+		/*!
+		 *  \brief Get the time remaining before a deadline
+		 *
+		 *  \param[in] deadline Value returned by \ref get_deadline
+		 *
+		 *  \return Remaining milliseconds, rounded up, 0 if the
+		 *          deadline has passed
+		 */
+		 artik_msecond (*get_remaining)(artik_nsecond deadline);
+		/*!
+		 *  \brief Synchronize the system clock from the main loop
+		 *
+		 *  Queries all the servers in parallel without blocking,
+		 *  discards the outliers and corrects the clock from the
+		 *  answer with the shortest round trip. Small offsets are
+		 *  slewed, so that the time never jumps.
+		 *
+		 *  \param[out] handle Handle referencing the client
+		 *  \param[in] config Client configuration, copied
+		 *  \param[in] func Called after each synchronization
+		 *  \param[in] user_data The user data passed to func
+		 *
+		 *  \return S_OK on success, E_BUSY if the loop work queue is
+		 *          full, error code otherwise
+		 */
+		 artik_error (*start_ntp_sync)(artik_ntp_handle *handle,
+				const artik_ntp_config *config,
+				ntp_callback func, void *user_data);
+		/*!
+		 *  \brief Stop an NTP client and release its resources
+		 *
+		 *  \param[in] handle Handle returned by start_ntp_sync
+		 *
+		 *  \return S_OK on success, error code otherwise
+		 */
+		 artik_error (*stop_ntp_sync)(artik_ntp_handle handle);
+		/*!
+		 *  \brief Create an alarm set off repeatedly according to
+		 *         a cron-like schedule
+		 *
+		 *  \param[in] gmt Local time zone in GMT format.
+		 *  \param[in] spec Schedule made of the five standard cron
+		 *             fields "minute hour day-of-month month
+		 *             day-of-week". Each field accepts '*', values,
+		 *             ranges and steps separated by commas, e.g.
+		 *             "0,30 8-18 * * 1-5".
+		 *  \param[out] handle Handle referencing the alarm for
+		 *              later use.
+		 *  \param[in] func The callback function which will be
+		 *             called each time the alarm is triggered
+		 *             (mandatory).
+		 *  \param[in] user_data The user data passed from the register
+		 *             callback function.
+		 *
+		 *  \return S_OK on success, E_BAD_ARGS if 'spec' is invalid
+		 *          or never matches, error code otherwise
+		 */
+		 artik_error (*create_alarm_cron)(artik_time_zone gmt,
+						const char *spec,
+						artik_alarm_handle *handle,
+						alarm_callback func,
+						void *user_data);
 
 	} artik_time_module;
 
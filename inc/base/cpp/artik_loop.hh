@@ -61,6 +61,32 @@ class Loop {
   artik_error add_idle_callback(int *idle_id, idle_callback func,
       void *user_data);
   artik_error remove_idle_callback(int idle_id);
+  artik_error create_loop(artik_loop_handle *handle);
+  artik_error destroy_loop(artik_loop_handle handle);
+  artik_error post(artik_loop_handle handle, post_callback func,
+      void *user_data);
+  artik_error add_timeout_callback_to_loop(artik_loop_handle handle,
+      int *timeout_id, unsigned int msec, timeout_callback func,
+      void *user_data);
+  artik_error remove_timeout_callback_from_loop(artik_loop_handle handle,
+      int timeout_id);
+  artik_error add_periodic_callback_to_loop(artik_loop_handle handle,
+      int *periodic_id, unsigned int msec, periodic_callback func,
+      void *user_data);
+  artik_error remove_periodic_callback_from_loop(artik_loop_handle handle,
+      int periodic_id);
+  artik_error add_fd_watch_to_loop(artik_loop_handle handle, int fd,
+      enum watch_io io, watch_callback func, void *user_data, int *watch_id);
+  artik_error remove_fd_watch_from_loop(artik_loop_handle handle,
+      int watch_id);
+  artik_error add_idle_callback_to_loop(artik_loop_handle handle,
+      int *idle_id, idle_callback func, void *user_data);
+  artik_error remove_idle_callback_from_loop(artik_loop_handle handle,
+      int idle_id);
+  artik_error submit_work(work_callback work_func,
+      work_done_callback done_func, void *user_data);
+  artik_error add_timeout_with_slack(int *timeout_id, unsigned int msec,
+      unsigned int slack_msec, timeout_callback func, void *user_data);
 };
 
 }  // namespace artik
@@ -0,0 +1,54 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef BASE_CPP_ARTIK_STEADY_CLOCK_HH_
+#define BASE_CPP_ARTIK_STEADY_CLOCK_HH_
+
+#include <chrono>
+
+#include <artik_time.h>
+
+/*! \file artik_steady_clock.hh
+ *  \brief C++ steady clock based on the Time module
+ *
+ *  Kept apart from artik_time.hh so that the time wrapper
+ *  does not pull in the standard time headers.
+ */
+
+namespace artik {
+/*!
+ *  \brief Steady clock C++ Class
+ *
+ *  Clock following the std::chrono clock requirements, reading
+ *  ARTIK_CLOCK_MONOTONIC through the Time module. Can be used with
+ *  the std::chrono durations and std::this_thread::sleep_until().
+ */
+class SteadyClock {
+ public:
+  typedef std::chrono::nanoseconds duration;
+  typedef duration::rep rep;
+  typedef duration::period period;
+  typedef std::chrono::time_point<SteadyClock> time_point;
+  static const bool is_steady = true;
+
+  static time_point now();
+};
+
+}  // namespace artik
+
+#endif  // BASE_CPP_ARTIK_STEADY_CLOCK_HH_
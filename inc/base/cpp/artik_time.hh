@@ -48,6 +48,8 @@ class Alarm {
       artik_time_module *);
   Alarm(artik_time_zone, artik_msecond, alarm_callback, void *,
       artik_time_module *);
+  Alarm(artik_time_zone, const char *, alarm_callback, void *,
+      artik_time_module *);
 
   Alarm();
   ~Alarm();
@@ -80,7 +82,16 @@ class Time {
   Alarm *create_alarm_second(artik_time_zone, artik_msecond, alarm_callback,
       void *);
   Alarm *create_alarm_date(artik_time_zone, artik_time, alarm_callback, void *);
+  Alarm *create_alarm_cron(artik_time_zone, const char *, alarm_callback,
+      void *);
   int compare_dates(const artik_time *date1, const artik_time *date2);
+  artik_nsecond get_monotonic(artik_clock_id) const;
+  artik_nsecond get_elapsed(artik_nsecond) const;
+  artik_nsecond get_deadline(artik_msecond) const;
+  artik_msecond get_remaining(artik_nsecond) const;
+  artik_error start_ntp_sync(artik_ntp_handle*, const artik_ntp_config*,
+      ntp_callback, void*);
+  artik_error stop_ntp_sync(artik_ntp_handle);
 };
 
 }  // namespace artik
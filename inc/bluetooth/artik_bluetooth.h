@@ -19,6 +19,8 @@
 #ifndef __ARTIK_BLUETOOTH_H
 #define __ARTIK_BLUETOOTH_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -51,6 +53,7 @@ extern "C" {
 #define MAX_BT_NAME_LEN		128
 #define MAX_BT_ADDR_LEN		128
 #define MAX_BT_UUID_LEN		128
+#define BT_UUID_STR_LEN		37
 
 #define BT_ADV_TYPE_BROADCAST "broadcast"
 #define BT_ADV_TYPE_PERIPHERAL "peripheral"
@@ -79,6 +82,7 @@ extern "C" {
 		BT_EVENT_FTP, /*<! This event is raised to monitor a FTP transfer. */
 		BT_EVENT_GATT_PROPERTY, /*<! This event is raised when a gatt property changed. */
 		BT_EVENT_PF_CUSTOM, /*<! This event is raised when custom gatt data is received. */
+		BT_EVENT_SCAN_REPORT, /*<! This event is raised periodically with the devices updated by the scan. */
 		BT_EVENT_END
 	} artik_bt_event;
 
@@ -97,11 +101,28 @@ extern "C" {
 	 *                 BT_EVENT_FTP           | \ref artik_bt_ftp_property
 	 *                 BT_EVENT_GATT_PROPERTY | not used
 	 *                 BT_EVENT_PF_CUSTOM     | \ref artik_bt_gatt_data
+	 *                 BT_EVENT_SCAN_REPORT   | \ref artik_bt_scan_report
 	 * \param[in] user_data The user data passed from the \ref set_callback.
 	 */
 	typedef void (*artik_bt_callback) (artik_bt_event event, void *data,
 			void *user_data);
 
+	/*!
+	 * \brief Callback returning the result of an asynchronous operation
+	 *
+	 * \param[in] result S_OK on success, E_TIMEOUT if the remote did not
+	 *                   answer in time, E_INTERRUPTED if the module was
+	 *                   released meanwhile, error code otherwise.
+	 * \param[in] bytes Value returned by the operation, NULL when it
+	 *                  returns none. Only valid during the callback.
+	 *                  Holds a NUL terminated string for
+	 *                  get_device_property_async.
+	 * \param[in] len Size of bytes
+	 * \param[in] user_data The user data passed to the operation.
+	 */
+	typedef void (*artik_bt_async_callback) (artik_error result,
+			const unsigned char *bytes, int len, void *user_data);
+
 	/*!
 	 * \brief Enumerations of major device class.
 	 */
@@ -341,6 +362,16 @@ extern "C" {
 		char *uuid_name; /*<! The friendly name of the profile */
 	} artik_bt_uuid;
 
+	/*!
+	 *  \brief Binary Bluetooth UUID
+	 *
+	 *  The 16 bytes of a 128-bit UUID, in the order they are
+	 *  written in its string form.
+	 */
+	typedef struct {
+		unsigned char bytes[16]; /*<! UUID bytes, most significant first */
+	} artik_bt_uuid128;
+
 	/*!
 	 * \brief Characteristic property
 	 */
@@ -614,6 +645,34 @@ extern "C" {
 		artik_bt_scan_type type; /*!< Type of scan */
 	} artik_bt_scan_filter;
 
+	/*!
+	 *  \brief Scan report configuration
+	 *
+	 *  Discovered devices are gathered in a table merging the updates
+	 *  of each device, and the devices which changed and pass the
+	 *  filters are reported every \ref interval milliseconds.
+	 */
+	typedef struct {
+		unsigned int interval; /*!< Milliseconds between two reports */
+		int16_t rssi; /*!< Devices received below this RSSI are not reported, 0 for no threshold */
+		unsigned int rssi_hysteresis; /*!< RSSI variations smaller than this do not count as a change */
+		const char **address_list; /*!< Reported addresses, all if empty */
+		unsigned int address_length; /*!< Size of \ref address_list */
+		artik_bt_uuid *uuid_list; /*!< Only report devices advertising one of these UUIDs, all if empty */
+		unsigned int uuid_length; /*!< Size of \ref uuid_list */
+	} artik_bt_scan_report_config;
+
+	/*!
+	 *  \brief Devices which changed since the previous scan report
+	 *
+	 *  The devices are owned by the module and only valid during the
+	 *  callback.
+	 */
+	typedef struct {
+		artik_bt_device *devices; /*!< Changed devices */
+		int num_devices; /*!< Size of \ref devices */
+	} artik_bt_scan_report;
+
 	/*!
 	 *  \brief Bluetooth AD2P source definition
 	 *
@@ -797,6 +856,68 @@ extern "C" {
 		long features;/*!< Profile features */
 	} artik_bt_spp_profile_option;
 
+	/*!
+	 * \brief Handle of a managed SPP stream
+	 */
+	typedef void *artik_bt_spp_stream_handle;
+
+	/*!
+	 * \brief Callback prototype for data received on an SPP stream
+	 *
+	 * All the data read since the previous call is passed at once. When
+	 * it wraps around the receive buffer it comes in two calls. After a
+	 * call consuming part of the data the rest is passed again at once,
+	 * and data wrapping around is passed again in one piece when a call
+	 * consumes none of it. Data the callback still does not consume is
+	 * kept and passed again with the next data received.
+	 *
+	 * \param [in] handle The stream
+	 * \param [in] data Received data
+	 * \param [in] len Length of \ref data
+	 * \param [in] user_data The user data of the stream configuration
+	 *
+	 * \return The number of bytes consumed
+	 */
+	typedef unsigned int (*artik_bt_spp_stream_read_callback)(
+			artik_bt_spp_stream_handle handle,
+			const unsigned char *data, unsigned int len,
+			void *user_data);
+
+	/*!
+	 * \brief Callback prototype for SPP stream events
+	 *
+	 * \param [in] handle The stream
+	 * \param [in] user_data The user data of the stream configuration
+	 */
+	typedef void (*artik_bt_spp_stream_callback)(
+			artik_bt_spp_stream_handle handle, void *user_data);
+
+	/*!
+	 * \brief Configuration of a managed SPP stream
+	 */
+	typedef struct {
+		unsigned int rx_buffer_size; /*!< Receive ring buffer size, 64 KiB if 0 */
+		unsigned int tx_queue_limit; /*!< Bytes queued before writes are refused with E_BUSY, 1 MiB if 0 */
+		artik_bt_spp_stream_read_callback read_func; /*!< Data received */
+		artik_bt_spp_stream_callback drain_func; /*!< Writes are accepted again after E_BUSY */
+		artik_bt_spp_stream_callback close_func; /*!< The remote device closed the connection or an error occurred */
+		void *user_data; /*!< Passed to the callbacks */
+	} artik_bt_spp_stream_config;
+
+	/*!
+	 * \brief Statistics of a managed SPP stream
+	 */
+	typedef struct {
+		uint64_t rx_bytes; /*!< Bytes received */
+		uint64_t tx_bytes; /*!< Bytes sent */
+		unsigned int rx_reads; /*!< Read system calls */
+		unsigned int rx_batches; /*!< Calls to the read callback */
+		unsigned int tx_writes; /*!< Write system calls */
+		unsigned int tx_queued; /*!< Bytes waiting to be sent */
+		unsigned int tx_queue_peak; /*!< Highest value of \ref tx_queued */
+		unsigned int tx_busy; /*!< Writes refused with E_BUSY */
+	} artik_bt_spp_stream_stats;
+
 	typedef unsigned char * (*select_config_callback)(
 		unsigned char *capabilities, int *len);
 	typedef void (*set_config_callback)(
@@ -1479,7 +1600,8 @@ extern "C" {
 		 * \param[in] byte The characteristic's value
 		 * \param[in] byte_len Size of byte
 		 *
-		 * \return S_OK on success, otherwise a negative error value.
+		 * \return S_OK on success, E_BUSY if too many values are still
+		 *         waiting to be sent, otherwise a negative error value.
 		 */
 		artik_error(*gatt_char_write_value) (const char *addr, const char *srv_uuid,
 				const char *char_uuid, const unsigned char byte[], int byte_len);
@@ -1585,7 +1707,8 @@ extern "C" {
 		 * \param[in] byte The new value of the characteristic
 		 * \param[in] len Size of \ref bytes
 		 *
-		 * \return S_OK on success, otherwise a negative error value.
+		 * \return S_OK on success, E_BUSY if too many values are still
+		 *         waiting to be sent, otherwise a negative error value.
 		 */
 		artik_error(*gatt_notify) (int svc_id, int char_id, unsigned char *byte,
 				int len);
@@ -2028,6 +2151,239 @@ extern "C" {
 		 * \return S_OK on success, otherwise a negative error value.
 		 */
 		artik_error(*agent_send_empty_response)(artik_bt_agent_request_handle handle);
+		/*!
+		 * \brief Set the timeout of the asynchronous operations
+		 *
+		 * Operations still waiting for an answer after this delay
+		 * complete with E_TIMEOUT. Defaults to 10 seconds.
+		 *
+		 * \param[in] timeout_ms Timeout in milliseconds
+		 *
+		 * \return S_OK on success, otherwise a negative error value.
+		 */
+		artik_error(*set_async_timeout)(unsigned int timeout_ms);
+		/*!
+		 * \brief Same as \ref connect, without waiting for the remote
+		 *        device.
+		 *
+		 * Unlike \ref connect, several devices can be connecting at the
+		 * same time.
+		 *
+		 * \param[in] addr The address of the remote Bluetooth device
+		 * \param[in] callback Completion callback (mandatory)
+		 * \param[in] user_data The user data passed to the callback
+		 *
+		 * \return S_OK if the operation was started, otherwise a
+		 *         negative error value and the callback is not called.
+		 */
+		artik_error(*connect_async)(const char *addr,
+				artik_bt_async_callback callback, void *user_data);
+		/*!
+		 * \brief Same as \ref disconnect, without waiting for the
+		 *        remote device.
+		 *
+		 * \param[in] addr The address of the remote Bluetooth device
+		 * \param[in] callback Completion callback (mandatory)
+		 * \param[in] user_data The user data passed to the callback
+		 *
+		 * \return S_OK if the operation was started, otherwise a
+		 *         negative error value and the callback is not called.
+		 */
+		artik_error(*disconnect_async)(const char *addr,
+				artik_bt_async_callback callback, void *user_data);
+		/*!
+		 * \brief Same as \ref get_device_property, the value is passed
+		 *        to the callback as a string.
+		 *
+		 * Non string properties are formatted in the GVariant text
+		 * format, e.g. "true" or "-56".
+		 *
+		 * \param[in] addr The bluetooth address of the remote device
+		 * \param[in] property The property to get
+		 * \param[in] callback Completion callback (mandatory)
+		 * \param[in] user_data The user data passed to the callback
+		 *
+		 * \return S_OK if the operation was started, otherwise a
+		 *         negative error value and the callback is not called.
+		 */
+		artik_error(*get_device_property_async)(const char *addr,
+				const char *property, artik_bt_async_callback callback,
+				void *user_data);
+		/*!
+		 * \brief Same as \ref gatt_char_read_value, the value is passed
+		 *        to the callback.
+		 *
+		 * \param[in] addr The bluetooth address of the remote device
+		 * \param[in] srv_uuid UUID of the remote GATT service
+		 * \param[in] char_uuid UUID of the remote GATT characteristic
+		 * \param[in] callback Completion callback (mandatory)
+		 * \param[in] user_data The user data passed to the callback
+		 *
+		 * \return S_OK if the operation was started, otherwise a
+		 *         negative error value and the callback is not called.
+		 */
+		artik_error(*gatt_char_read_value_async)(const char *addr,
+				const char *srv_uuid, const char *char_uuid,
+				artik_bt_async_callback callback, void *user_data);
+		/*!
+		 * \brief Same as \ref gatt_char_write_value, without waiting
+		 *        for the remote device.
+		 *
+		 * The value is copied before the function returns.
+		 *
+		 * \param[in] addr The bluetooth address of the remote device
+		 * \param[in] srv_uuid UUID of the remote GATT service
+		 * \param[in] char_uuid UUID of the remote GATT characteristic
+		 * \param[in] byte The characteristic's value
+		 * \param[in] byte_len Size of byte
+		 * \param[in] callback Completion callback (mandatory)
+		 * \param[in] user_data The user data passed to the callback
+		 *
+		 * \return S_OK if the operation was started, otherwise a
+		 *         negative error value and the callback is not called.
+		 */
+		artik_error(*gatt_char_write_value_async)(const char *addr,
+				const char *srv_uuid, const char *char_uuid,
+				const unsigned char byte[], int byte_len,
+				artik_bt_async_callback callback, void *user_data);
+		/*!
+		 * \brief Same as \ref gatt_start_notify, without waiting for
+		 *        the remote device.
+		 *
+		 * \param[in] addr The bluetooth address of the remote device
+		 * \param[in] srv_uuid UUID of the remote GATT service
+		 * \param[in] char_uuid UUID of the remote GATT characteristic
+		 * \param[in] callback Completion callback (mandatory)
+		 * \param[in] user_data The user data passed to the callback
+		 *
+		 * \return S_OK if the operation was started, otherwise a
+		 *         negative error value and the callback is not called.
+		 */
+		artik_error(*gatt_start_notify_async)(const char *addr,
+				const char *srv_uuid, const char *char_uuid,
+				artik_bt_async_callback callback, void *user_data);
+		/*!
+		 * \brief Same as \ref gatt_stop_notify, without waiting for
+		 *        the remote device.
+		 *
+		 * \param[in] addr The bluetooth address of the remote device
+		 * \param[in] srv_uuid UUID of the remote GATT service
+		 * \param[in] char_uuid UUID of the remote GATT characteristic
+		 * \param[in] callback Completion callback (mandatory)
+		 * \param[in] user_data The user data passed to the callback
+		 *
+		 * \return S_OK if the operation was started, otherwise a
+		 *         negative error value and the callback is not called.
+		 */
+		artik_error(*gatt_stop_notify_async)(const char *addr,
+				const char *srv_uuid, const char *char_uuid,
+				artik_bt_async_callback callback, void *user_data);
+		/*!
+		 * \brief Report discovered devices in periodic batches
+		 *
+		 * Once set, discovered devices are raised as
+		 * BT_EVENT_SCAN_REPORT events instead of one BT_EVENT_SCAN
+		 * event per device. Each report only holds the devices which
+		 * changed since the previous one and pass the filters of
+		 * 'config'.
+		 *
+		 * \param[in] config The report configuration, NULL to go back
+		 *                   to BT_EVENT_SCAN events.
+		 *
+		 * \return S_OK on success, otherwise a negative error value.
+		 */
+		artik_error(*set_scan_report)(
+				const artik_bt_scan_report_config *config);
+		/*!
+		 * \brief Parse a UUID string
+		 *
+		 * \param[in] str 16-bit ("180f"), 32-bit ("0000180f") or
+		 *                128-bit UUID string, in either case. Short
+		 *                forms are expanded with the Bluetooth base UUID.
+		 * \param[out] uuid The parsed UUID.
+		 *
+		 * \return S_OK on success, E_BAD_ARGS if 'str' is not a UUID.
+		 */
+		artik_error(*uuid_parse)(const char *str, artik_bt_uuid128 *uuid);
+		/*!
+		 * \brief Format a UUID as a 128-bit lowercase string
+		 *
+		 * \param[in] uuid The UUID to format.
+		 * \param[out] str Buffer receiving the string.
+		 * \param[in] len Size of 'str', at least BT_UUID_STR_LEN.
+		 *
+		 * \return S_OK on success, otherwise a negative error value.
+		 */
+		artik_error(*uuid_format)(const artik_bt_uuid128 *uuid, char *str,
+				unsigned int len);
+		/*!
+		 * \brief Get the name assigned to a UUID
+		 *
+		 * \param[in] uuid UUID string in any form accepted by
+		 *                 \ref uuid_parse.
+		 * \param[out] name The assigned name, "Unknown" or
+		 *                  "Vendor specific". It must not be freed.
+		 *
+		 * \return S_OK on success, E_BAD_ARGS if 'uuid' is not a UUID.
+		 */
+		artik_error(*uuid_get_name)(const char *uuid, const char **name);
+		/*!
+		 * \brief Manage the I/O of an SPP connection
+		 *
+		 * Watches 'fd', as received by the new connection callback,
+		 * on the main loop. Received data is read into a ring buffer
+		 * and passed to the read callback, written data is queued and
+		 * sent as the socket accepts it.
+		 *
+		 * \param[in] fd The connection socket, owned by the stream
+		 *               from now on.
+		 * \param[in] config The stream configuration.
+		 * \param[out] handle The stream.
+		 *
+		 * \return S_OK on success, otherwise a negative error value.
+		 */
+		artik_error(*spp_stream_open)(int fd,
+				const artik_bt_spp_stream_config *config,
+				artik_bt_spp_stream_handle *handle);
+		/*!
+		 * \brief Queue data to send on an SPP stream
+		 *
+		 * Never blocks. Data is sent right away when nothing is
+		 * queued and the socket accepts it, queued otherwise.
+		 *
+		 * \param[in] handle The stream.
+		 * \param[in] data The data to send, copied by the stream.
+		 * \param[in] len Length of 'data'.
+		 *
+		 * \return S_OK on success, E_BUSY if the queue would exceed
+		 *         its limit, in which case nothing is queued and the
+		 *         drain callback is called once half of the queue is
+		 *         sent. Other negative values on errors.
+		 */
+		artik_error(*spp_stream_write)(artik_bt_spp_stream_handle handle,
+				const unsigned char *data, unsigned int len);
+		/*!
+		 * \brief Get the statistics of an SPP stream
+		 *
+		 * \param[in] handle The stream.
+		 * \param[out] stats The statistics.
+		 *
+		 * \return S_OK on success, otherwise a negative error value.
+		 */
+		artik_error(*spp_stream_get_stats)(
+				artik_bt_spp_stream_handle handle,
+				artik_bt_spp_stream_stats *stats);
+		/*!
+		 * \brief Close an SPP stream
+		 *
+		 * Closes the socket and drops the data still queued. It can
+		 * be called from the stream callbacks.
+		 *
+		 * \param[in] handle The stream.
+		 *
+		 * \return S_OK on success, otherwise a negative error value.
+		 */
+		artik_error(*spp_stream_close)(artik_bt_spp_stream_handle handle);
 	} artik_bluetooth_module;
 
 	extern const artik_bluetooth_module bluetooth_module;
@@ -226,6 +226,10 @@ typedef struct {
 	/*!
 	 *  \brief Start the DHCP client service
 	 *
+	 *  The lease is acquired and renewed in the background from the
+	 *  main loop, the interface is configured each time the server
+	 *  acknowledges it. A client can run on each interface at once.
+	 *
 	 *  \param[out] handle Handle returned by the API for later
 	 *              reference to the service
 	 *  \param[in] interface The network interface onto which
@@ -279,6 +283,11 @@ typedef struct {
 	/*!
 	 *  \brief Get network online status
 	 *
+	 *  While an online status watch is registered, the status tracked
+	 *  by the watch is returned right away. Otherwise a recent result
+	 *  is reused, or the reachability is probed with a bounded delay,
+	 *  see \ref set_online_status_probe.
+	 *
 	 *  \param[out] online_status  Pointer to an integer filled up
 	 *               by the function with the current online status
 	 *
@@ -314,6 +323,25 @@ typedef struct {
 	artik_error(*remove_watch_online_status)(
 				watch_online_status_handle handle
 				);
+
+	/*!
+	 *  \brief Set the address probed to check the online status
+	 *
+	 *  The device is considered online when a running interface has
+	 *  a default route and a TCP connection to the probe address
+	 *  succeeds or is refused within the timeout. Public DNS servers
+	 *  are probed by default.
+	 *
+	 *  \param[in] address Numeric IPv4 address to probe, NULL to
+	 *             restore the default probes
+	 *  \param[in] port TCP port to probe
+	 *  \param[in] timeout_ms Delay after which a probe is considered
+	 *             failed, 0 for the default value
+	 *
+	 *  \return S_OK on success, error code otherwise
+	 */
+	artik_error(*set_online_status_probe)(const char *address, int port,
+				unsigned int timeout_ms);
 } artik_network_module;
 
 extern const artik_network_module network_module;
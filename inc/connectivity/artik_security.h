@@ -57,6 +57,51 @@ extern "C" {
  */
 typedef void *artik_security_handle;
 
+/*!
+ *  \brief Digest algorithms of the hashing functions
+ *
+ *  Values can be combined to compute several digests in a single pass
+ *  over the data.
+ */
+typedef enum {
+	ARTIK_HASH_SHA1 = 1 << 0,
+	ARTIK_HASH_SHA256 = 1 << 1,
+	ARTIK_HASH_SHA512 = 1 << 2,
+	ARTIK_HASH_CRC32 = 1 << 3
+} artik_hash_type;
+
+/*!
+ *  \brief Digests computed by the hashing functions
+ *
+ *  Only the digests requested in 'types' are filled.
+ */
+typedef struct {
+	unsigned int types;
+	unsigned char sha1[20];
+	unsigned char sha256[32];
+	unsigned char sha512[64];
+	unsigned int crc32;
+} artik_hash_result;
+
+/*!
+ * \brief     Callback reporting the progress of a file signature
+ *            verification
+ * \param[in] done Number of bytes of the file verified so far
+ * \param[in] total Size of the file in bytes
+ * \param[in] user_data The user data passed to the verification function
+ */
+typedef void (*verify_progress_callback)(unsigned long long done,
+		unsigned long long total, void *user_data);
+
+/*!
+ * \brief     Callback returning the result of an asynchronous file
+ *            signature verification
+ * \param[in] result S_OK if the signature matches, error code otherwise
+ * \param[in] user_data The user data passed to
+ *            \ref verify_signature_file_async
+ */
+typedef void (*verify_done_callback)(artik_error result, void *user_data);
+
 /*! \struct artik_security_module
  *
  *  \brief Security module operations
@@ -237,6 +282,136 @@ typedef struct {
 	 */
 	artik_error(*verify_signature_final) (artik_security_handle handle);
 
+	/*!
+	 *  \brief Verify a PKCS7 signature against a signed file.
+	 *
+	 *  The file is mapped in memory and hashed without being copied, which
+	 *  is faster and uses less memory than feeding it through
+	 *  \ref verify_signature_update. The root CA is parsed once and kept
+	 *  for the next verifications against the same one.
+	 *
+	 *  \param[in] path Path of the signed file.
+	 *  \param[in] signature_pem PKCS7 signature in a PEM encoded string.
+	 *  \param[in] root_ca X509 certificate of the root CA in a PEM encoded
+	 *                     string.
+	 *  \param[in] signing_time_in See \ref verify_signature_init.
+	 *  \param[out] signing_time_out See \ref verify_signature_init.
+	 *  \param[in] progress If provided, called after each hashed chunk
+	 *                      of the file.
+	 *  \param[in] user_data The user data passed to the callback.
+	 *
+	 *  \return S_OK on signature verification success, error code
+	 *          otherwise, see \ref verify_signature_final
+	 */
+	artik_error(*verify_signature_file) (const char *path,
+			const char *signature_pem, const char *root_ca,
+			const artik_time * signing_time_in,
+			artik_time * signing_time_out,
+			verify_progress_callback progress, void *user_data);
+
+	/*!
+	 *  \brief Same as \ref verify_signature_file, hashing the file on a
+	 *         worker thread of the loop module.
+	 *
+	 *  The signature and the certificates are checked before the function
+	 *  returns, 'signing_time_out' is filled at that time. The progress
+	 *  callback is called from the worker thread, the done callback from
+	 *  the main loop.
+	 *
+	 *  \param[in] done Callback returning the verification result
+	 *                  (mandatory).
+	 *
+	 *  \return S_OK if the verification was started, error code otherwise
+	 */
+	artik_error(*verify_signature_file_async) (const char *path,
+			const char *signature_pem, const char *root_ca,
+			const artik_time * signing_time_in,
+			artik_time * signing_time_out,
+			verify_progress_callback progress,
+			verify_done_callback done, void *user_data);
+
+	/*!
+	 *  \brief Compute several digests of a buffer in a single pass
+	 *
+	 *  Digests are computed with the OpenSSL EVP implementations, which
+	 *  use the CPU cryptographic extensions when they are available.
+	 *
+	 *  \param[in] types Combination of \ref artik_hash_type values.
+	 *  \param[in] data Data to hash.
+	 *  \param[in] len Length of the data in bytes.
+	 *  \param[out] result Digests of the data.
+	 *
+	 *  \return S_OK on success, error code otherwise
+	 */
+	artik_error(*hash_buffer) (unsigned int types,
+			const unsigned char *data, unsigned long long len,
+			artik_hash_result * result);
+
+	/*!
+	 *  \brief Same as \ref hash_buffer on the content of a file
+	 *         descriptor, read until its end.
+	 *
+	 *  Regular files are mapped in memory instead of being read.
+	 *
+	 *  \param[in] types Combination of \ref artik_hash_type values.
+	 *  \param[in] fd File descriptor to hash.
+	 *  \param[out] result Digests of the data.
+	 *
+	 *  \return S_OK on success, error code otherwise
+	 */
+	artik_error(*hash_fd) (unsigned int types, int fd,
+			artik_hash_result * result);
+
+	/*!
+	 *  \brief Same as \ref hash_fd on a file given by its path.
+	 *
+	 *  \param[in] types Combination of \ref artik_hash_type values.
+	 *  \param[in] path Path of the file to hash.
+	 *  \param[out] result Digests of the file.
+	 *
+	 *  \return S_OK on success, error code otherwise
+	 */
+	artik_error(*hash_file) (unsigned int types, const char *path,
+			artik_hash_result * result);
+
+	/*!
+	 *  \brief Hash several files concurrently.
+	 *
+	 *  The files are spread over a pool of threads. The function returns
+	 *  once all of them are hashed.
+	 *
+	 *  \param[in] types Combination of \ref artik_hash_type values.
+	 *  \param[in] paths Paths of the files to hash.
+	 *  \param[in] count Number of files.
+	 *  \param[in] num_threads Number of threads hashing the files, the
+	 *                         number of online CPUs when 0.
+	 *  \param[out] results Array of 'count' digests.
+	 *  \param[out] errors If provided, array of 'count' entries filled
+	 *                     with the result of each file.
+	 *
+	 *  \return S_OK if all the files were hashed, the first error
+	 *          otherwise
+	 */
+	artik_error(*hash_files) (unsigned int types,
+			const char * const *paths, int count, int num_threads,
+			artik_hash_result * results, artik_error * errors);
+
+	/*!
+	 *  \brief Forget the certificate material read from the SE
+	 *
+	 *  The certificate, the key derived from it and its serial number
+	 *  are read from the SE once, then served from memory, even across
+	 *  security instances, until this function is called, e.g. after
+	 *  the SE content was changed. The cache is also dropped when the
+	 *  SE fails to load or to answer, e.g. while it is being reset.
+	 *
+	 *  \param[in] handle Handle tied to a requested security
+	 *             instance.
+	 *
+	 *  \return S_OK on success, error code otherwise
+	 */
+	artik_error(*clear_cache) (artik_security_handle handle);
+
 } artik_security_module;
 
 extern const artik_security_module security_module;
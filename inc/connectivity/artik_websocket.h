@@ -26,6 +26,7 @@ extern "C" {
 #include "artik_error.h"
 #include "artik_types.h"
 #include "artik_ssl.h"
+#include "artik_loop.h"
 
 /*! \file artik_websocket.h
  *
@@ -78,6 +79,10 @@ typedef struct {
  *  \brief Pointer to data for internal use by the API.
  */
 void *private_data;
+/*!
+ *  \brief Loop the stream is serviced from, NULL for the main loop
+ */
+artik_loop_handle loop;
 } artik_websocket_config;
 
 /*!
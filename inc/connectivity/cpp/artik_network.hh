@@ -61,6 +61,8 @@ class Network {
                                       watch_online_status_callback app_callback,
                                       void *user_data);
   artik_error remove_watch_online_status(watch_online_status_handle handle);
+  artik_error set_online_status_probe(const char *address, int port,
+                                      unsigned int timeout_ms);
 };
 
 }  // namespace artik
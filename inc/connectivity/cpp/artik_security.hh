@@ -47,6 +47,24 @@ class Security {
   artik_error get_key_from_cert(const char *, char **);
   artik_error get_random_bytes(unsigned char*, int);
   artik_error get_certificate_sn(unsigned char*, unsigned int *);
+  artik_error verify_signature_file(const char *path,
+      const char *signature_pem, const char *root_ca,
+      const artik_time *signing_time_in, artik_time *signing_time_out,
+      verify_progress_callback progress = NULL, void *user_data = NULL);
+  artik_error verify_signature_file_async(const char *path,
+      const char *signature_pem, const char *root_ca,
+      const artik_time *signing_time_in, artik_time *signing_time_out,
+      verify_progress_callback progress, verify_done_callback done,
+      void *user_data);
+  artik_error hash_buffer(unsigned int types, const unsigned char *data,
+      unsigned long long len, artik_hash_result *result);
+  artik_error hash_fd(unsigned int types, int fd, artik_hash_result *result);
+  artik_error hash_file(unsigned int types, const char *path,
+      artik_hash_result *result);
+  artik_error hash_files(unsigned int types, const char * const *paths,
+      int count, int num_threads, artik_hash_result *results,
+      artik_error *errors = NULL);
+  artik_error clear_cache();
 };
 
 }  // namespace artik
@@ -111,6 +111,7 @@ typedef enum {
 	ARTIK_LWM2M_EVENT_ERROR = 0,
 	ARTIK_LWM2M_EVENT_RESOURCE_EXECUTE,
 	ARTIK_LWM2M_EVENT_RESOURCE_CHANGED,
+	ARTIK_LWM2M_EVENT_RESOURCES_CHANGED,
 	ARTIK_LWM2M_EVENT_COUNT
 } artik_lwm2m_event_t;
 
@@ -133,6 +134,19 @@ typedef struct {
 	int length;
 } artik_lwm2m_resource_t;
 
+/*!
+ *	\brief Resources passed to the ARTIK_LWM2M_EVENT_RESOURCES_CHANGED
+ *	callback
+ *
+ *	All the resources changed since the previous event are reported at
+ *	once, each URI appears only once. The buffer of the resources is NULL
+ *	when the new value is not provided by the platform.
+ */
+typedef struct {
+	artik_lwm2m_resource_t *resources;
+	int count;
+} artik_lwm2m_resources_t;
+
 /*!
  * \brief LWM2M Handle type
  *
@@ -437,6 +451,40 @@ typedef struct {
 	artik_error(*serialize_tlv_string)(char **data, int size,
 					unsigned char **buffer, int *lenbuffer);
 
+	/*!
+	 * \brief Write the values of several LWM2M resources
+	 *
+	 * The notifications of the observed resources are sent together
+	 * once all the values have been written.
+	 *
+	 * \param[in] handle client-specific handle returned by \ref
+	 *            client_connect
+	 * \param[in] resources array of resources to write, with the URI,
+	 *            the data buffer and its length for each of them
+	 * \param[in] count number of resources in the array
+	 *
+	 * \return S_OK on success, error code of the first failed write
+	 *         otherwise. The remaining resources are written anyway.
+	 */
+	artik_error(*client_write_resources)(artik_lwm2m_handle handle,
+			artik_lwm2m_resource_t *resources, int count);
+	/*!
+	 * \brief Read the values of several LWM2M resources
+	 *
+	 * \param[in] handle client-specific handle returned by \ref
+	 *            client_connect
+	 * \param[inout] resources array of resources to read. For each of them
+	 *               buffer must point to a preallocated buffer of length
+	 *               bytes. Upon return, length is the size of the data
+	 *               copied into the buffer, or 0 if the read failed.
+	 * \param[in] count number of resources in the array
+	 *
+	 * \return S_OK on success, error code of the first failed read
+	 *         otherwise. E_NO_MEM is returned if a buffer is too small.
+	 */
+	artik_error(*client_read_resources)(artik_lwm2m_handle handle,
+			artik_lwm2m_resource_t *resources, int count);
+
 } artik_lwm2m_module;
 
 extern const artik_lwm2m_module lwm2m_module;
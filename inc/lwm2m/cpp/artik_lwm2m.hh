@@ -51,6 +51,10 @@ class Lwm2m {
       int length);
   artik_error client_read_resource(const char *uri, unsigned char *buffer,
       int* length);
+  artik_error client_write_resources(artik_lwm2m_resource_t *resources,
+      int count);
+  artik_error client_read_resources(artik_lwm2m_resource_t *resources,
+      int count);
   artik_error set_callback(artik_lwm2m_event_t event,
       artik_lwm2m_callback user_callback, void *user_data);
   artik_error unset_callback(artik_lwm2m_event_t event);
@@ -26,6 +26,7 @@ extern "C" {
 #include "artik_error.h"
 #include "artik_types.h"
 #include "artik_ssl.h"
+#include "artik_loop.h"
 
 /*! \file artik_mqtt.h
  *
@@ -92,6 +93,8 @@ typedef struct {
 	artik_mqtt_psk_param *psk;
 	/**< PSK parameter, PSK should be mutually exclusive with TLS */
 	artik_mqtt_handle handle; /**< user defined data */
+	artik_loop_handle loop;
+	/**< loop the client socket is watched from, NULL for the main loop */
 } artik_mqtt_config;
 
 /*!
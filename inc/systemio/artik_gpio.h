@@ -25,6 +25,7 @@ extern "C" {
 
 #include "artik_error.h"
 #include "artik_types.h"
+#include "artik_loop.h"
 
 /*! \file artik_gpio.h
  *
@@ -126,6 +127,11 @@ typedef struct {
 	 *  \brief pointer to data for internal use by the API.
 	 */
 	void *user_data;
+	/*!
+	 *  \brief loop the change callback is called from,
+	 *  NULL for the main loop.
+	 */
+	artik_loop_handle loop;
 } artik_gpio_config;
 
 /*! \struct artik_gpio_module
@@ -25,6 +25,7 @@ extern "C" {
 
 #include "artik_error.h"
 #include "artik_types.h"
+#include "artik_loop.h"
 
 /*! \file artik_serial.h
  *
@@ -163,6 +164,11 @@ typedef struct {
 	 *  \brief Pointer to data for internal use by the API.
 	 */
 	void *data_user;
+	/*!
+	 *  \brief Loop the received callback is called from,
+	 *  NULL for the main loop.
+	 */
+	artik_loop_handle loop;
 
 } artik_serial_config;
 
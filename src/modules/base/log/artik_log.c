@@ -26,6 +26,10 @@ static void artik_log_set_prefix_fields(enum artik_log_prefix field_set);
 static enum artik_log_prefix artik_log_get_prefix_fields(void);
 static void artik_log_print(enum artik_log_level level, const char *filename,
 		const char *funcname, int line, const char *format, ...);
+static artik_error artik_log_set_async(bool enable);
+static artik_error artik_log_set_level(int module, enum artik_log_level level);
+static enum artik_log_level artik_log_get_level(int module);
+static int artik_log_ratelimit(artik_log_ratelimit_state *state);
 
 EXPORT_API const artik_log_module log_module = {
 		artik_log_set_system,
@@ -33,6 +37,10 @@ EXPORT_API const artik_log_module log_module = {
 		artik_log_set_prefix_fields,
 		artik_log_get_prefix_fields,
 		artik_log_print,
+		artik_log_set_async,
+		artik_log_set_level,
+		artik_log_get_level,
+		artik_log_ratelimit,
 };
 
 artik_error artik_log_set_system(enum artik_log_system system)
@@ -64,3 +72,23 @@ void artik_log_print(enum artik_log_level level, const char *filename,
 	os_log_print(level, filename, funcname, line, format, arg);
 	va_end(arg);
 }
+
+artik_error artik_log_set_async(bool enable)
+{
+	return os_log_set_async(enable);
+}
+
+artik_error artik_log_set_level(int module, enum artik_log_level level)
+{
+	return os_log_set_level(module, level);
+}
+
+enum artik_log_level artik_log_get_level(int module)
+{
+	return os_log_get_level(module);
+}
+
+int artik_log_ratelimit(artik_log_ratelimit_state *state)
+{
+	return os_log_ratelimit(state);
+}
@@ -17,8 +17,14 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include <sys/syscall.h>
 #include <glib.h>
 
@@ -33,12 +39,106 @@
 #define MAX_FIELDSIZE_FILENAME 30
 #define MAX_FIELDSIZE_FUNCNAME 30
 
+/*
+ * Asynchronous backend: each logging thread owns a single producer ring
+ * where it stores a binary record (level, timestamp, format and raw
+ * arguments). A background thread merges the rings by timestamp, formats
+ * the records and writes them in batches. The strings are copied in the
+ * record, the module they come from may be unloaded before it is written.
+ */
+#define LOG_RING_SIZE		(64 * 1024)
+#define LOG_RING_MASK		(LOG_RING_SIZE - 1)
+#define LOG_RECORD_MAX		1024
+#define LOG_STRING_MAX		256
+#define LOG_NAME_MAX		128
+#define LOG_SPEC_MAX		32
+#define LOG_BATCH_SIZE		8192
+#define LOG_IDLE_MSEC		100
+#define LOG_ALIGN(x)		(((x) + 7) & ~7U)
+
+enum log_arg_type {
+	LOG_ARG_NONE,
+	LOG_ARG_INT,
+	LOG_ARG_LONG,
+	LOG_ARG_LLONG,
+	LOG_ARG_INTMAX,
+	LOG_ARG_SIZE,
+	LOG_ARG_PTRDIFF,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_LDOUBLE,
+	LOG_ARG_POINTER,
+	LOG_ARG_STRING,
+	LOG_ARG_ERRNO,
+	LOG_ARG_INVALID
+};
+
+struct _log_spec {
+	int len;
+	int stars;
+	enum log_arg_type type;
+};
+
+#define LOG_RECORD_PADDING	(1 << 0)
+
+struct _log_record {
+	uint32_t size;
+	uint32_t flags;
+	enum artik_log_level level;
+	int line;
+	struct timespec ts;
+	/* Followed by the file name, function name, format and arguments */
+};
+
+#define LOG_NULL_STRING		UINT16_MAX
+
+struct _log_ring {
+	struct _log_ring *next;
+	uint32_t head;
+	uint32_t tail;
+	uint32_t dropped;
+	int orphan;
+	pid_t tid;
+	/* Records are LOG_ALIGN()ed from here */
+	char buf[LOG_RING_SIZE] __attribute__((aligned(8)));
+};
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_t thread;
+	int enabled;
+	int running;
+	int stop;
+	int idle;
+	int fd;
+	int atexit_registered;
+	pthread_mutex_t rings_lock;
+	struct _log_ring *rings;
+	char batch[LOG_BATCH_SIZE];
+	int batch_len;
+} _log_async = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.rings_lock = PTHREAD_MUTEX_INITIALIZER,
+	.fd = -1
+};
+
+static pthread_key_t _log_ring_key;
+static pthread_once_t _log_ring_key_once = PTHREAD_ONCE_INIT;
+static __thread struct _log_ring *_log_thread_ring;
+static __thread int _log_is_async_thread;
+
 static enum artik_log_system _log_system = LOG_SYSTEM_STDERR;
 static enum artik_log_prefix _log_prefix_fields = LOG_PREFIX_DEFAULT;
 static artik_log_handler _log_handler;
 static void *_log_handler_user_data;
 static int _log_override_enabled;
 static int _log_override_checked;
+/* Same encoding as artik_log_filter, regardless of the log system */
+static int _log_levels[ARTIK_LOG_MAX_MODULES];
+
+/* Everything filtered out when no system is set */
+#define LOG_FILTER_ALL		(LOG_LEVEL_DEBUG + 1)
+
+EXPORT_API int artik_log_filter[ARTIK_LOG_MAX_MODULES];
 
 /* Initialization must follow artik_log_level order form artik_log.h */
 static struct _log_level_info {
@@ -51,7 +151,46 @@ static struct _log_level_info {
 	{ 'D', LOG_DEBUG }
 };
 
-static void _log_check_override(void)
+static void _log_update_filter(void)
+{
+	int i;
+
+	for (i = 0; i < ARTIK_LOG_MAX_MODULES; i++)
+		__atomic_store_n(&artik_log_filter[i],
+			(_log_system == LOG_SYSTEM_NONE) ? LOG_FILTER_ALL :
+			_log_levels[i],
+			__ATOMIC_RELAXED);
+}
+
+static void _log_check_level_override(void)
+{
+	const char *env = getenv("ARTIK_LOG_LEVEL");
+	enum artik_log_level level;
+	int i;
+
+	if (!env)
+		return;
+
+	if (!strncasecmp(env, "error", 6))
+		level = LOG_LEVEL_ERROR;
+	else if (!strncasecmp(env, "warning", 8))
+		level = LOG_LEVEL_WARNING;
+	else if (!strncasecmp(env, "info", 5))
+		level = LOG_LEVEL_INFO;
+	else if (!strncasecmp(env, "debug", 6))
+		level = LOG_LEVEL_DEBUG;
+	else
+		return;
+
+	for (i = 0; i < ARTIK_LOG_MAX_MODULES; i++)
+		_log_levels[i] = LOG_LEVEL_DEBUG - level;
+}
+
+/*
+ * Run at load time, so that the filters read by the logging macros
+ * reflect the environment before the first message.
+ */
+__attribute__((constructor)) static void _log_check_override(void)
 {
 	const char *env;
 
@@ -60,9 +199,13 @@ static void _log_check_override(void)
 
 	_log_override_checked = TRUE;
 
+	_log_check_level_override();
+
 	env = getenv("ARTIK_LOG");
-	if (!env)
+	if (!env) {
+		_log_update_filter();
 		return;
+	}
 
 	if (!strncasecmp(env, "stderr", 7)) {
 		_log_override_enabled = TRUE;
@@ -74,25 +217,31 @@ static void _log_check_override(void)
 		_log_override_enabled = TRUE;
 		_log_system = LOG_SYSTEM_NONE;
 	}
+
+	_log_update_filter();
 }
 
 static int _log_make_prefix(char *prefix, int prefix_len,
 			enum artik_log_level level, const char *filename,
-			const char *funcname, int line)
+			const char *funcname, int line,
+			const struct timespec *tp, pid_t tid)
 {
 	const char *pretty_filename = NULL;
 	int len = 0;
 
 	if (_log_prefix_fields & LOG_PREFIX_TIMESTAMP) {
-		struct timespec tp;
+		struct timespec now;
 		struct tm ti;
 
-		clock_gettime(CLOCK_REALTIME, &tp);
-		localtime_r(&(tp.tv_sec), &ti);
+		if (!tp) {
+			clock_gettime(CLOCK_REALTIME, &now);
+			tp = &now;
+		}
+		localtime_r(&(tp->tv_sec), &ti);
 
 		len += (int) strftime(prefix, 15, "%m-%d %H:%M:%S", &ti);
 		len += snprintf(prefix + len, 6, ".%03ld ",
-				tp.tv_nsec / 1000000);
+				tp->tv_nsec / 1000000);
 	}
 
 	if (_log_prefix_fields & LOG_PREFIX_PID) {
@@ -103,12 +252,12 @@ static int _log_make_prefix(char *prefix, int prefix_len,
 	}
 
 	if (_log_prefix_fields & LOG_PREFIX_TID) {
+		if (!tid)
+			tid = (pid_t) syscall(SYS_gettid);
 		if (len > 0)
-			len += snprintf(prefix + len, 7, "%5d ",
-						(pid_t) syscall(SYS_gettid));
+			len += snprintf(prefix + len, 7, "%5d ", tid);
 		else
-			len += snprintf(prefix + len, 7, "%d ",
-						(pid_t) syscall(SYS_gettid));
+			len += snprintf(prefix + len, 7, "%d ", tid);
 	}
 
 	if (_log_prefix_fields & LOG_PREFIX_LEVEL) {
@@ -187,7 +336,7 @@ static void _log_formatted(enum artik_log_level level, const char *filename,
 
 	if (_log_prefix_fields > LOG_PREFIX_NONE)
 		len = _log_make_prefix(prefix, 4096, level, filename, funcname,
-			line);
+			line, NULL, 0);
 
 	if (_log_system == LOG_SYSTEM_STDERR) {
 		if (len > 0)
@@ -203,12 +352,803 @@ static void _log_formatted(enum artik_log_level level, const char *filename,
 	}
 }
 
+static const char *_log_parse_spec(const char *p, struct _log_spec *spec)
+{
+	const char *start = p++;
+	int length = 0;
+
+	spec->stars = 0;
+	spec->type = LOG_ARG_INVALID;
+
+	if (*p == '%') {
+		spec->len = 2;
+		spec->type = LOG_ARG_NONE;
+		return p + 1;
+	}
+
+	while (*p && strchr("-+ #0'", *p))
+		p++;
+
+	if (*p == '*') {
+		spec->stars++;
+		p++;
+	} else {
+		while (*p >= '0' && *p <= '9')
+			p++;
+	}
+
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->stars++;
+			p++;
+		} else {
+			while (*p >= '0' && *p <= '9')
+				p++;
+		}
+	}
+
+	/* Length modifier, stored as the conversion it maps to */
+	switch (*p) {
+	case 'h':
+		p += (p[1] == 'h') ? 2 : 1;
+		break;
+	case 'l':
+		if (p[1] == 'l') {
+			length = LOG_ARG_LLONG;
+			p += 2;
+		} else {
+			length = LOG_ARG_LONG;
+			p++;
+		}
+		break;
+	case 'q':
+	case 'L':
+		length = LOG_ARG_LLONG;
+		p++;
+		break;
+	case 'j':
+		length = LOG_ARG_INTMAX;
+		p++;
+		break;
+	case 'z':
+		length = LOG_ARG_SIZE;
+		p++;
+		break;
+	case 't':
+		length = LOG_ARG_PTRDIFF;
+		p++;
+		break;
+	default:
+		break;
+	}
+
+	switch (*p) {
+	case 'd':
+	case 'i':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+		spec->type = length ? length : LOG_ARG_INT;
+		break;
+	case 'c':
+		if (!length || length == LOG_ARG_LONG)
+			spec->type = LOG_ARG_INT;
+		break;
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		spec->type = (*(p - 1) == 'L') ? LOG_ARG_LDOUBLE :
+								LOG_ARG_DOUBLE;
+		break;
+	case 's':
+		if (!length)
+			spec->type = LOG_ARG_STRING;
+		break;
+	case 'p':
+		spec->type = LOG_ARG_POINTER;
+		break;
+	case 'm':
+		spec->type = LOG_ARG_ERRNO;
+		break;
+	default:
+		/* %n, wide strings and unknown conversions */
+		break;
+	}
+
+	if (*p)
+		p++;
+	spec->len = p - start;
+
+	return p;
+}
+
+#define LOG_ENCODE(type, value) do {				\
+		type __v = (value);					\
+		if (len + (int)sizeof(__v) > size)			\
+			return -1;					\
+		memcpy(buf + len, &__v, sizeof(__v));			\
+		len += sizeof(__v);					\
+	} while (0)
+
+static int _log_encode_text(char *buf, int size, const char *str, int max)
+{
+	uint16_t slen = LOG_NULL_STRING;
+	int len = sizeof(slen);
+
+	if (size < len)
+		return -1;
+
+	if (str) {
+		slen = strnlen(str, max - 1);
+		if (len + slen + 1 > size)
+			slen = size - len - 1;
+		memcpy(buf + len, str, slen);
+		buf[len + slen] = '\0';
+		len += slen + 1;
+	}
+	memcpy(buf, &slen, sizeof(slen));
+
+	return len;
+}
+
+static int _log_encode_string(char *buf, int size, const char *str)
+{
+	return _log_encode_text(buf, size, str, LOG_STRING_MAX);
+}
+
+/* The prefix only shows the end of the file and function names */
+static const char *_log_name_tail(const char *name, size_t max)
+{
+	size_t len;
+
+	if (!name)
+		return NULL;
+
+	len = strlen(name);
+
+	return len < max ? name : name + len - (max - 1);
+}
+
+/* Returns the string encoded at *p and moves *p past it */
+static const char *_log_decode_string(const char **p, const char *end)
+{
+	const char *str = NULL;
+	uint16_t slen;
+
+	if (*p + sizeof(slen) > end)
+		return NULL;
+
+	memcpy(&slen, *p, sizeof(slen));
+	*p += sizeof(slen);
+	if (slen != LOG_NULL_STRING) {
+		if (*p + slen + 1 > end)
+			return NULL;
+		str = *p;
+		*p += slen + 1;
+	}
+
+	return str;
+}
+
+static int _log_encode_args(char *buf, int size, const char *format,
+				va_list arg, int saved_errno)
+{
+	struct _log_spec spec;
+	const char *p = format;
+	int len = 0;
+	int i;
+
+	while ((p = strchr(p, '%'))) {
+		p = _log_parse_spec(p, &spec);
+
+		for (i = 0; i < spec.stars; i++)
+			LOG_ENCODE(int, va_arg(arg, int));
+
+		switch (spec.type) {
+		case LOG_ARG_NONE:
+			break;
+		case LOG_ARG_INT:
+			LOG_ENCODE(int, va_arg(arg, int));
+			break;
+		case LOG_ARG_LONG:
+			LOG_ENCODE(long, va_arg(arg, long));
+			break;
+		case LOG_ARG_LLONG:
+			LOG_ENCODE(long long, va_arg(arg, long long));
+			break;
+		case LOG_ARG_INTMAX:
+			LOG_ENCODE(intmax_t, va_arg(arg, intmax_t));
+			break;
+		case LOG_ARG_SIZE:
+			LOG_ENCODE(size_t, va_arg(arg, size_t));
+			break;
+		case LOG_ARG_PTRDIFF:
+			LOG_ENCODE(ptrdiff_t, va_arg(arg, ptrdiff_t));
+			break;
+		case LOG_ARG_DOUBLE:
+			LOG_ENCODE(double, va_arg(arg, double));
+			break;
+		case LOG_ARG_LDOUBLE:
+			LOG_ENCODE(long double, va_arg(arg, long double));
+			break;
+		case LOG_ARG_POINTER:
+			LOG_ENCODE(void *, va_arg(arg, void *));
+			break;
+		case LOG_ARG_STRING:
+		case LOG_ARG_ERRNO: {
+			const char *str = (spec.type == LOG_ARG_STRING) ?
+				va_arg(arg, const char *) :
+				strerror(saved_errno);
+			int n = _log_encode_string(buf + len, size - len, str);
+
+			if (n < 0)
+				return -1;
+			len += n;
+			break;
+		}
+		default:
+			return -1;
+		}
+	}
+
+	return len;
+}
+
+#define LOG_DECODE(type) do {						\
+		type __v;						\
+		if (args + sizeof(__v) > end)				\
+			goto exit;					\
+		memcpy(&__v, args, sizeof(__v));			\
+		args += sizeof(__v);					\
+		if (spec.stars == 0)					\
+			n = snprintf(msg + len, size - len, fmt, __v);	\
+		else if (spec.stars == 1)				\
+			n = snprintf(msg + len, size - len, fmt,	\
+					stars[0], __v);			\
+		else							\
+			n = snprintf(msg + len, size - len, fmt,	\
+					stars[0], stars[1], __v);	\
+	} while (0)
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+
+/* Format a record, conversion by conversion, from its encoded arguments */
+static int _log_decode(char *msg, int size, const char *format,
+			const char *args, const char *end)
+{
+	struct _log_spec spec;
+	const char *p = format;
+	char fmt[LOG_SPEC_MAX];
+	int stars[2];
+	int len = 0;
+	int n;
+	int i;
+
+	while (*p && len < size - 1) {
+		const char *next = strchr(p, '%');
+
+		if (!next)
+			next = p + strlen(p);
+
+		n = next - p;
+		if (n > size - 1 - len)
+			n = size - 1 - len;
+		memcpy(msg + len, p, n);
+		len += n;
+		p = next;
+
+		if (!*p || len >= size - 1)
+			break;
+
+		p = _log_parse_spec(p, &spec);
+		if (spec.type == LOG_ARG_NONE) {
+			msg[len++] = '%';
+			continue;
+		}
+
+		if (spec.len >= LOG_SPEC_MAX)
+			break;
+		memcpy(fmt, p - spec.len, spec.len);
+		fmt[spec.len] = '\0';
+
+		for (i = 0; i < spec.stars; i++) {
+			if (args + sizeof(int) > end)
+				goto exit;
+			memcpy(&stars[i], args, sizeof(int));
+			args += sizeof(int);
+		}
+
+		n = 0;
+		switch (spec.type) {
+		case LOG_ARG_INT:
+			LOG_DECODE(int);
+			break;
+		case LOG_ARG_LONG:
+			LOG_DECODE(long);
+			break;
+		case LOG_ARG_LLONG:
+			LOG_DECODE(long long);
+			break;
+		case LOG_ARG_INTMAX:
+			LOG_DECODE(intmax_t);
+			break;
+		case LOG_ARG_SIZE:
+			LOG_DECODE(size_t);
+			break;
+		case LOG_ARG_PTRDIFF:
+			LOG_DECODE(ptrdiff_t);
+			break;
+		case LOG_ARG_DOUBLE:
+			LOG_DECODE(double);
+			break;
+		case LOG_ARG_LDOUBLE:
+			LOG_DECODE(long double);
+			break;
+		case LOG_ARG_POINTER:
+			LOG_DECODE(void *);
+			break;
+		case LOG_ARG_STRING:
+		case LOG_ARG_ERRNO: {
+			uint16_t slen;
+			const char *str = NULL;
+
+			if (args + sizeof(slen) > end)
+				goto exit;
+			memcpy(&slen, args, sizeof(slen));
+			args += sizeof(slen);
+			if (slen != LOG_NULL_STRING) {
+				str = args;
+				args += slen + 1;
+			}
+
+			/* %m was resolved by the caller */
+			fmt[spec.len - 1] = 's';
+			if (spec.stars == 0)
+				n = snprintf(msg + len, size - len, fmt, str);
+			else if (spec.stars == 1)
+				n = snprintf(msg + len, size - len, fmt,
+						stars[0], str);
+			else
+				n = snprintf(msg + len, size - len, fmt,
+						stars[0], stars[1], str);
+			break;
+		}
+		default:
+			goto exit;
+		}
+
+		if (n > 0)
+			len += (n < size - len) ? n : size - 1 - len;
+	}
+
+exit:
+	msg[len] = '\0';
+
+	return len;
+}
+
+#pragma GCC diagnostic pop
+
+static void _log_ring_release(void *data)
+{
+	struct _log_ring *ring = data;
+
+	/* Freed by the log thread once drained */
+	__atomic_store_n(&ring->orphan, 1, __ATOMIC_RELEASE);
+}
+
+static void _log_ring_key_create(void)
+{
+	pthread_key_create(&_log_ring_key, _log_ring_release);
+}
+
+static struct _log_ring *_log_get_ring(void)
+{
+	struct _log_ring *ring = _log_thread_ring;
+
+	if (ring)
+		return ring;
+
+	pthread_once(&_log_ring_key_once, _log_ring_key_create);
+
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+
+	ring->tid = (pid_t) syscall(SYS_gettid);
+	pthread_setspecific(_log_ring_key, ring);
+
+	pthread_mutex_lock(&_log_async.rings_lock);
+	ring->next = _log_async.rings;
+	_log_async.rings = ring;
+	pthread_mutex_unlock(&_log_async.rings_lock);
+
+	_log_thread_ring = ring;
+
+	return ring;
+}
+
+static void _log_async_print(enum artik_log_level level, const char *filename,
+		const char *funcname, int line, const char *format,
+		va_list arg, int saved_errno)
+{
+	union {
+		struct _log_record hdr;
+		char buf[LOG_RECORD_MAX];
+	} rec;
+	struct _log_ring *ring = _log_get_ring();
+	uint32_t head, tail, off, room, size;
+	va_list copy;
+	int len, n, names;
+
+	if (!ring)
+		return;
+
+	len = sizeof(rec.hdr);
+	n = _log_encode_text(rec.buf + len, sizeof(rec.buf) - len,
+			_log_name_tail(filename, LOG_NAME_MAX), LOG_NAME_MAX);
+	if (n < 0)
+		return;
+	len += n;
+	n = _log_encode_text(rec.buf + len, sizeof(rec.buf) - len,
+			_log_name_tail(funcname, LOG_NAME_MAX), LOG_NAME_MAX);
+	if (n < 0)
+		return;
+	len += n;
+	names = len;
+
+	n = _log_encode_text(rec.buf + len, sizeof(rec.buf) - len, format,
+			LOG_RECORD_MAX);
+	if (n >= 0) {
+		va_copy(copy, arg);
+		len += n;
+		n = _log_encode_args(rec.buf + len, sizeof(rec.buf) - len,
+				format, copy, saved_errno);
+		va_end(copy);
+	}
+
+	if (n < 0) {
+		/* Not encodable, format it here and log it as a string */
+		char msg[LOG_STRING_MAX];
+
+		vsnprintf(msg, sizeof(msg), format, arg);
+		len = names;
+		len += _log_encode_string(rec.buf + len,
+				sizeof(rec.buf) - len, "%s");
+		n = _log_encode_string(rec.buf + len, sizeof(rec.buf) - len,
+				msg);
+	}
+	len += n;
+
+	size = LOG_ALIGN(len);
+	rec.hdr.size = size;
+	rec.hdr.flags = 0;
+	rec.hdr.level = level;
+	rec.hdr.line = line;
+	clock_gettime(CLOCK_REALTIME, &rec.hdr.ts);
+
+	head = ring->head;
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	off = head & LOG_RING_MASK;
+	room = LOG_RING_SIZE - off;
+
+	if (LOG_RING_SIZE - (head - tail) < size + (room < size ? room : 0)) {
+		__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	if (room < size) {
+		struct _log_record *pad = (struct _log_record *)
+							(ring->buf + off);
+
+		/* Only the size and flags fit in the smallest padding */
+		pad->size = room;
+		pad->flags = LOG_RECORD_PADDING;
+		head += room;
+		off = 0;
+	}
+
+	memcpy(ring->buf + off, rec.buf, size);
+	__atomic_store_n(&ring->head, head + size, __ATOMIC_SEQ_CST);
+
+	if (__atomic_exchange_n(&_log_async.idle, 0, __ATOMIC_SEQ_CST)) {
+		uint64_t one = 1;
+
+		if (write(_log_async.fd, &one, sizeof(one)) < 0)
+			return;
+	}
+}
+
+/* Next record of a ring, skipping the padding at the end of the buffer */
+static struct _log_record *_log_ring_peek(struct _log_ring *ring)
+{
+	struct _log_record *rec;
+	uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+	while (ring->tail != head) {
+		rec = (struct _log_record *)(ring->buf +
+						(ring->tail & LOG_RING_MASK));
+		if (!(rec->flags & LOG_RECORD_PADDING))
+			return rec;
+
+		__atomic_store_n(&ring->tail, ring->tail + rec->size,
+							__ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+static void _log_batch_flush(void)
+{
+	if (!_log_async.batch_len)
+		return;
+
+	fwrite(_log_async.batch, 1, _log_async.batch_len, stderr);
+	fflush(stderr);
+	_log_async.batch_len = 0;
+}
+
+static void _log_async_output(enum artik_log_level level, const char *prefix,
+				int prefix_len, const char *msg, int msg_len)
+{
+	switch (_log_system) {
+	case LOG_SYSTEM_STDERR:
+		if (_log_async.batch_len + prefix_len + msg_len + 2 >
+							LOG_BATCH_SIZE)
+			_log_batch_flush();
+
+		if (prefix_len + msg_len + 2 > LOG_BATCH_SIZE) {
+			if (prefix_len > 0)
+				fprintf(stderr, "%s ", prefix);
+			fprintf(stderr, "%s\n", msg);
+			break;
+		}
+
+		if (prefix_len > 0) {
+			memcpy(_log_async.batch + _log_async.batch_len, prefix,
+								prefix_len);
+			_log_async.batch_len += prefix_len;
+			_log_async.batch[_log_async.batch_len++] = ' ';
+		}
+		memcpy(_log_async.batch + _log_async.batch_len, msg, msg_len);
+		_log_async.batch_len += msg_len;
+		_log_async.batch[_log_async.batch_len++] = '\n';
+		break;
+	case LOG_SYSTEM_SYSLOG:
+		syslog(_log_level_map[level].syslog_level, "%s", msg);
+		break;
+	case LOG_SYSTEM_CUSTOM:
+		if (_log_handler)
+			_log_handler(level, prefix, msg,
+						_log_handler_user_data);
+		break;
+	case LOG_SYSTEM_NONE:
+	default:
+		break;
+	}
+}
+
+static void _log_async_write(struct _log_ring *ring, struct _log_record *rec)
+{
+	const char *args = (const char *)(rec + 1);
+	const char *end = (const char *)rec + rec->size;
+	const char *filename, *funcname, *format;
+	char prefix[512] = { 0 };
+	char msg[4096];
+	int prefix_len = 0;
+	int msg_len;
+
+	filename = _log_decode_string(&args, end);
+	funcname = _log_decode_string(&args, end);
+	format = _log_decode_string(&args, end);
+	if (!format)
+		return;
+
+	if (_log_prefix_fields > LOG_PREFIX_NONE)
+		prefix_len = _log_make_prefix(prefix, sizeof(prefix),
+				rec->level, filename, funcname,
+				rec->line, &rec->ts, ring->tid);
+
+	msg_len = _log_decode(msg, sizeof(msg), format, args, end);
+
+	_log_async_output(rec->level, prefix, prefix_len, msg, msg_len);
+}
+
+static void _log_report_dropped(struct _log_ring *ring)
+{
+	uint32_t dropped = __atomic_exchange_n(&ring->dropped, 0,
+							__ATOMIC_RELAXED);
+	char prefix[512] = { 0 };
+	char msg[64];
+	int prefix_len = 0;
+	int len;
+
+	if (!dropped)
+		return;
+
+	if (_log_prefix_fields > LOG_PREFIX_NONE)
+		prefix_len = _log_make_prefix(prefix, sizeof(prefix),
+				LOG_LEVEL_WARNING, __FILE__, __func__,
+				__LINE__, NULL, ring->tid);
+
+	len = snprintf(msg, sizeof(msg), "%u log messages dropped", dropped);
+	_log_async_output(LOG_LEVEL_WARNING, prefix, prefix_len, msg, len);
+}
+
+/* Write out all the pending records in timestamp order */
+static int _log_async_drain(void)
+{
+	struct _log_ring **pring;
+	int count = 0;
+
+	pthread_mutex_lock(&_log_async.rings_lock);
+
+	while (1) {
+		struct _log_ring *best = NULL;
+		struct _log_record *best_rec = NULL;
+		struct _log_ring *ring;
+
+		for (ring = _log_async.rings; ring; ring = ring->next) {
+			struct _log_record *rec = _log_ring_peek(ring);
+
+			if (!rec)
+				continue;
+
+			if (!best_rec || rec->ts.tv_sec < best_rec->ts.tv_sec ||
+				(rec->ts.tv_sec == best_rec->ts.tv_sec &&
+				 rec->ts.tv_nsec < best_rec->ts.tv_nsec)) {
+				best = ring;
+				best_rec = rec;
+			}
+		}
+
+		if (!best)
+			break;
+
+		_log_async_write(best, best_rec);
+		__atomic_store_n(&best->tail, best->tail + best_rec->size,
+							__ATOMIC_RELEASE);
+		count++;
+	}
+
+	pring = &_log_async.rings;
+	while (*pring) {
+		struct _log_ring *ring = *pring;
+
+		_log_report_dropped(ring);
+
+		if (__atomic_load_n(&ring->orphan, __ATOMIC_ACQUIRE) &&
+				!_log_ring_peek(ring)) {
+			*pring = ring->next;
+			free(ring);
+			continue;
+		}
+
+		pring = &ring->next;
+	}
+
+	pthread_mutex_unlock(&_log_async.rings_lock);
+
+	_log_batch_flush();
+
+	return count;
+}
+
+static void *_log_async_thread(void *arg)
+{
+	struct pollfd pfd = { .fd = _log_async.fd, .events = POLLIN };
+	uint64_t n;
+
+	/* Messages logged by a custom handler are written synchronously */
+	_log_is_async_thread = 1;
+
+	while (1) {
+		if (_log_async_drain())
+			continue;
+
+		if (__atomic_load_n(&_log_async.stop, __ATOMIC_ACQUIRE))
+			break;
+
+		/* Producers wake us up only when this flag is set */
+		__atomic_store_n(&_log_async.idle, 1, __ATOMIC_SEQ_CST);
+		if (_log_async_drain()) {
+			__atomic_store_n(&_log_async.idle, 0, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		if (poll(&pfd, 1, LOG_IDLE_MSEC) > 0 &&
+				read(_log_async.fd, &n, sizeof(n)) < 0)
+			break;
+		__atomic_store_n(&_log_async.idle, 0, __ATOMIC_RELAXED);
+	}
+
+	return NULL;
+}
+
+/* Must be called with _log_async.lock held */
+static void _log_async_stop(void)
+{
+	uint64_t one = 1;
+
+	if (!_log_async.running)
+		return;
+
+	__atomic_store_n(&_log_async.enabled, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&_log_async.stop, 1, __ATOMIC_RELEASE);
+	if (write(_log_async.fd, &one, sizeof(one)) < 0)
+		log_err("failed to wake up the log thread (%d)", errno);
+
+	pthread_join(_log_async.thread, NULL);
+	_log_async.running = 0;
+
+	/* Records pushed while the thread was exiting */
+	_log_async_drain();
+}
+
+static void _log_async_atexit(void)
+{
+	pthread_mutex_lock(&_log_async.lock);
+	_log_async_stop();
+	pthread_mutex_unlock(&_log_async.lock);
+}
+
+/* Must be called with _log_async.lock held */
+static artik_error _log_async_start(void)
+{
+	if (_log_async.running)
+		return S_OK;
+
+	if (_log_async.fd < 0) {
+		_log_async.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (_log_async.fd < 0)
+			return E_NO_MEM;
+	}
+
+	_log_async.stop = 0;
+	_log_async.idle = 0;
+	if (pthread_create(&_log_async.thread, NULL, _log_async_thread,
+									NULL))
+		return E_NO_MEM;
+	_log_async.running = 1;
+
+	if (!_log_async.atexit_registered) {
+		atexit(_log_async_atexit);
+		_log_async.atexit_registered = 1;
+	}
+
+	__atomic_store_n(&_log_async.enabled, 1, __ATOMIC_RELEASE);
+
+	return S_OK;
+}
+
 void os_log_print(enum artik_log_level level, const char *filename,
 		const char *funcname, int line, const char *format, va_list arg)
 {
+	int saved_errno = errno;
+
 	if (!_log_override_checked)
 		_log_check_override();
 
+	if (_log_system == LOG_SYSTEM_NONE)
+		return;
+
+	if (__atomic_load_n(&_log_async.enabled, __ATOMIC_ACQUIRE) &&
+						!_log_is_async_thread) {
+		_log_async_print(level, filename, funcname, line, format, arg,
+								saved_errno);
+		errno = saved_errno;
+		return;
+	}
+
 	switch (_log_system) {
 	case LOG_SYSTEM_SYSLOG:
 		vsyslog(_log_level_map[level].syslog_level, format, arg);
@@ -233,6 +1173,7 @@ artik_error os_log_set_system(enum artik_log_system system)
 	if (_log_override_enabled)
 		return 0;
 	_log_system = system;
+	_log_update_filter();
 
 	return S_OK;
 }
@@ -250,6 +1191,7 @@ artik_error os_log_set_handler(artik_log_handler handler, void *user_data)
 	_log_system = LOG_SYSTEM_CUSTOM;
 	_log_handler = handler;
 	_log_handler_user_data = user_data;
+	_log_update_filter();
 
 	return S_OK;
 }
@@ -263,3 +1205,72 @@ enum artik_log_prefix os_log_get_prefix_fields(void)
 {
 	return _log_prefix_fields;
 }
+
+artik_error os_log_set_async(bool enable)
+{
+	artik_error ret = S_OK;
+
+	pthread_mutex_lock(&_log_async.lock);
+	if (enable)
+		ret = _log_async_start();
+	else
+		_log_async_stop();
+	pthread_mutex_unlock(&_log_async.lock);
+
+	return ret;
+}
+
+artik_error os_log_set_level(int module, enum artik_log_level level)
+{
+	int i;
+
+	if (module < ARTIK_LOG_MODULE_ALL || module >= ARTIK_LOG_MAX_MODULES ||
+						level > LOG_LEVEL_DEBUG) {
+		log_err("invalid module(%d) or level(%d)", module, level);
+		return E_BAD_ARGS;
+	}
+
+	for (i = 0; i < ARTIK_LOG_MAX_MODULES; i++)
+		if (module == ARTIK_LOG_MODULE_ALL || module == i)
+			_log_levels[i] = LOG_LEVEL_DEBUG - level;
+	_log_update_filter();
+
+	return S_OK;
+}
+
+enum artik_log_level os_log_get_level(int module)
+{
+	if (module < 0 || module >= ARTIK_LOG_MAX_MODULES)
+		return LOG_LEVEL_DEBUG;
+
+	return LOG_LEVEL_DEBUG - _log_levels[module];
+}
+
+int os_log_ratelimit(artik_log_ratelimit_state *state)
+{
+	struct timespec ts;
+	long long now;
+	int missed;
+
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	now = ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+
+	/* Races between threads only make the limit approximate */
+	if (!state->begin ||
+			now - state->begin >= ARTIK_LOG_RATELIMIT_INTERVAL) {
+		missed = state->missed;
+		state->begin = now;
+		state->printed = 1;
+		state->missed = 0;
+		return missed;
+	}
+
+	if (state->printed < ARTIK_LOG_RATELIMIT_BURST) {
+		state->printed++;
+		return 0;
+	}
+
+	state->missed++;
+
+	return -1;
+}
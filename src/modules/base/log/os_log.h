@@ -29,5 +29,9 @@ enum artik_log_prefix os_log_get_prefix_fields(void);
 void os_log_print(enum artik_log_level level, const char *filename,
 		const char *funcname, int line, const char *format,
 		va_list arg);
+artik_error os_log_set_async(bool enable);
+artik_error os_log_set_level(int module, enum artik_log_level level);
+enum artik_log_level os_log_get_level(int module);
+int os_log_ratelimit(artik_log_ratelimit_state *state);
 
 #endif	/* __OS_LOG_H */
@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <artik_log.h>
 
@@ -33,6 +34,8 @@ static void *_log_handler_user_data;
 static int _log_override_enabled;
 static int _log_override_checked;
 
+EXPORT_API int artik_log_filter[ARTIK_LOG_MAX_MODULES];
+
 /* Initialization must follow artik_log_level order form artik_log.h */
 static char _log_level_map[] = { 'E', 'W', 'I', 'D' };
 
@@ -202,3 +205,61 @@ enum artik_log_prefix os_log_get_prefix_fields(void)
 {
 	return _log_prefix_fields;
 }
+
+artik_error os_log_set_async(bool enable)
+{
+	return E_NOT_SUPPORTED;
+}
+
+artik_error os_log_set_level(int module, enum artik_log_level level)
+{
+	int i;
+
+	if (module < ARTIK_LOG_MODULE_ALL || module >= ARTIK_LOG_MAX_MODULES ||
+						level > LOG_LEVEL_DEBUG)
+		return E_BAD_ARGS;
+
+	for (i = 0; i < ARTIK_LOG_MAX_MODULES; i++)
+		if (module == ARTIK_LOG_MODULE_ALL || module == i)
+			artik_log_filter[i] = LOG_LEVEL_DEBUG - level;
+
+	return S_OK;
+}
+
+enum artik_log_level os_log_get_level(int module)
+{
+	if (module < 0 || module >= ARTIK_LOG_MAX_MODULES)
+		return LOG_LEVEL_DEBUG;
+
+	return LOG_LEVEL_DEBUG - artik_log_filter[module];
+}
+
+int os_log_ratelimit(artik_log_ratelimit_state *state)
+{
+	struct timespec ts;
+	long long now;
+	int missed;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+		return 0;
+	now = ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+
+	/* Races between tasks only make the limit approximate */
+	if (!state->begin ||
+			now - state->begin >= ARTIK_LOG_RATELIMIT_INTERVAL) {
+		missed = state->missed;
+		state->begin = now;
+		state->printed = 1;
+		state->missed = 0;
+		return missed;
+	}
+
+	if (state->printed < ARTIK_LOG_RATELIMIT_BURST) {
+		state->printed++;
+		return 0;
+	}
+
+	state->missed++;
+
+	return -1;
+}
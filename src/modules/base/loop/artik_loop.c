@@ -40,6 +40,41 @@ static artik_error	remove_signal_watch(int signal_id);
 static artik_error	add_idle_callback(int *idle_id, idle_callback func,
 							void *user_data);
 static artik_error	remove_idle_callback(int idle_id);
+static artik_error	create_loop(artik_loop_handle *handle);
+static artik_error	destroy_loop(artik_loop_handle handle);
+static artik_error	post(artik_loop_handle handle, post_callback func,
+					void *user_data);
+static artik_error	add_timeout_callback_to_loop(artik_loop_handle handle,
+					int *timeout_id, unsigned int msec,
+					timeout_callback func, void *user_data);
+static artik_error	remove_timeout_callback_from_loop(
+					artik_loop_handle handle,
+					int timeout_id);
+static artik_error	add_periodic_callback_to_loop(artik_loop_handle handle,
+					int *periodic_id, unsigned int msec,
+					periodic_callback func,
+					void *user_data);
+static artik_error	remove_periodic_callback_from_loop(
+					artik_loop_handle handle,
+					int periodic_id);
+static artik_error	add_fd_watch_to_loop(artik_loop_handle handle, int fd,
+					enum watch_io io, watch_callback func,
+					void *user_data, int *watch_id);
+static artik_error	remove_fd_watch_from_loop(artik_loop_handle handle,
+					int watch_id);
+static artik_error	add_idle_callback_to_loop(artik_loop_handle handle,
+					int *idle_id, idle_callback func,
+					void *user_data);
+static artik_error	remove_idle_callback_from_loop(artik_loop_handle handle,
+					int idle_id);
+static artik_error	submit_work(work_callback work_func,
+					work_done_callback done_func,
+					void *user_data);
+static artik_error	add_timeout_with_slack(int *timeout_id,
+					unsigned int msec,
+					unsigned int slack_msec,
+					timeout_callback func,
+					void *user_data);
 
 EXPORT_API const artik_loop_module loop_module = {
 	loop_run,
@@ -53,7 +88,20 @@ EXPORT_API const artik_loop_module loop_module = {
 	add_signal_watch,
 	remove_signal_watch,
 	add_idle_callback,
-	remove_idle_callback
+	remove_idle_callback,
+	create_loop,
+	destroy_loop,
+	post,
+	add_timeout_callback_to_loop,
+	remove_timeout_callback_from_loop,
+	add_periodic_callback_to_loop,
+	remove_periodic_callback_from_loop,
+	add_fd_watch_to_loop,
+	remove_fd_watch_from_loop,
+	add_idle_callback_to_loop,
+	remove_idle_callback_from_loop,
+	submit_work,
+	add_timeout_with_slack
 };
 
 void loop_run(void)
@@ -117,3 +165,85 @@ artik_error remove_idle_callback(int idle_id)
 {
 	return os_remove_idle_callback(idle_id);
 }
+
+artik_error create_loop(artik_loop_handle *handle)
+{
+	return os_create_loop(handle);
+}
+
+artik_error destroy_loop(artik_loop_handle handle)
+{
+	return os_destroy_loop(handle);
+}
+
+artik_error post(artik_loop_handle handle, post_callback func, void *user_data)
+{
+	return os_post(handle, func, user_data);
+}
+
+artik_error add_timeout_callback_to_loop(artik_loop_handle handle,
+		int *timeout_id, unsigned int msec, timeout_callback func,
+		void *user_data)
+{
+	return os_add_timeout_callback_to_loop(handle, timeout_id, msec, func,
+								user_data);
+}
+
+artik_error remove_timeout_callback_from_loop(artik_loop_handle handle,
+		int timeout_id)
+{
+	return os_remove_timeout_callback_from_loop(handle, timeout_id);
+}
+
+artik_error add_periodic_callback_to_loop(artik_loop_handle handle,
+		int *periodic_id, unsigned int msec, periodic_callback func,
+		void *user_data)
+{
+	return os_add_periodic_callback_to_loop(handle, periodic_id, msec, func,
+								user_data);
+}
+
+artik_error remove_periodic_callback_from_loop(artik_loop_handle handle,
+		int periodic_id)
+{
+	return os_remove_periodic_callback_from_loop(handle, periodic_id);
+}
+
+artik_error add_fd_watch_to_loop(artik_loop_handle handle, int fd,
+		enum watch_io io, watch_callback func, void *user_data,
+		int *watch_id)
+{
+	return os_add_fd_watch_to_loop(handle, fd, io, func, user_data,
+								watch_id);
+}
+
+artik_error remove_fd_watch_from_loop(artik_loop_handle handle, int watch_id)
+{
+	return os_remove_fd_watch_from_loop(handle, watch_id);
+}
+
+artik_error add_idle_callback_to_loop(artik_loop_handle handle, int *idle_id,
+		idle_callback func, void *user_data)
+{
+	return os_add_idle_callback_to_loop(handle, idle_id, func, user_data);
+}
+
+artik_error remove_idle_callback_from_loop(artik_loop_handle handle,
+		int idle_id)
+{
+	return os_remove_idle_callback_from_loop(handle, idle_id);
+}
+
+artik_error submit_work(work_callback work_func, work_done_callback done_func,
+		void *user_data)
+{
+	return os_submit_work(work_func, done_func, user_data);
+}
+
+artik_error add_timeout_with_slack(int *timeout_id, unsigned int msec,
+		unsigned int slack_msec, timeout_callback func,
+		void *user_data)
+{
+	return os_add_timeout_with_slack(timeout_id, msec, slack_msec, func,
+								user_data);
+}
@@ -91,3 +91,77 @@ artik_error artik::Loop::add_idle_callback(int *idle_id, idle_callback func,
 artik_error artik::Loop::remove_idle_callback(int idle_id) {
   return this->m_module->remove_idle_callback(idle_id);
 }
+
+artik_error artik::Loop::create_loop(artik_loop_handle *handle) {
+  return this->m_module->create_loop(handle);
+}
+
+artik_error artik::Loop::destroy_loop(artik_loop_handle handle) {
+  return this->m_module->destroy_loop(handle);
+}
+
+artik_error artik::Loop::post(artik_loop_handle handle, post_callback func,
+    void *user_data) {
+  return this->m_module->post(handle, func, user_data);
+}
+
+artik_error artik::Loop::add_timeout_callback_to_loop(artik_loop_handle handle,
+    int *timeout_id, unsigned int msec, timeout_callback func,
+    void *user_data) {
+  return this->m_module->add_timeout_callback_to_loop(handle, timeout_id,
+      msec, func, user_data);
+}
+
+artik_error artik::Loop::remove_timeout_callback_from_loop(
+    artik_loop_handle handle, int timeout_id) {
+  return this->m_module->remove_timeout_callback_from_loop(handle,
+      timeout_id);
+}
+
+artik_error artik::Loop::add_periodic_callback_to_loop(
+    artik_loop_handle handle, int *periodic_id, unsigned int msec,
+    periodic_callback func, void *user_data) {
+  return this->m_module->add_periodic_callback_to_loop(handle, periodic_id,
+      msec, func, user_data);
+}
+
+artik_error artik::Loop::remove_periodic_callback_from_loop(
+    artik_loop_handle handle, int periodic_id) {
+  return this->m_module->remove_periodic_callback_from_loop(handle,
+      periodic_id);
+}
+
+artik_error artik::Loop::add_fd_watch_to_loop(artik_loop_handle handle,
+    int fd, enum watch_io io, watch_callback func, void *user_data,
+    int *watch_id) {
+  return this->m_module->add_fd_watch_to_loop(handle, fd, io, func,
+      user_data, watch_id);
+}
+
+artik_error artik::Loop::remove_fd_watch_from_loop(artik_loop_handle handle,
+    int watch_id) {
+  return this->m_module->remove_fd_watch_from_loop(handle, watch_id);
+}
+
+artik_error artik::Loop::add_idle_callback_to_loop(artik_loop_handle handle,
+    int *idle_id, idle_callback func, void *user_data) {
+  return this->m_module->add_idle_callback_to_loop(handle, idle_id, func,
+      user_data);
+}
+
+artik_error artik::Loop::remove_idle_callback_from_loop(
+    artik_loop_handle handle, int idle_id) {
+  return this->m_module->remove_idle_callback_from_loop(handle, idle_id);
+}
+
+artik_error artik::Loop::submit_work(work_callback work_func,
+    work_done_callback done_func, void *user_data) {
+  return this->m_module->submit_work(work_func, done_func, user_data);
+}
+
+artik_error artik::Loop::add_timeout_with_slack(int *timeout_id,
+    unsigned int msec, unsigned int slack_msec, timeout_callback func,
+    void *user_data) {
+  return this->m_module->add_timeout_with_slack(timeout_id, msec, slack_msec,
+      func, user_data);
+}
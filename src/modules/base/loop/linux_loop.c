@@ -17,8 +17,14 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <glib.h>
 #include <glib-unix.h>
 
@@ -27,16 +33,56 @@
 
 #include "os_loop.h"
 
-struct _timeout {
-	timeout_callback func;
-	void *user_data;
-	guint id;
+#define WORK_QUEUE_SIZE		256
+#define WORK_NUM_THREADS	4
+
+/*
+ * Timeouts and periodics are kept in a hierarchical timing wheel of
+ * WHEEL_LEVELS levels of WHEEL_SIZE slots, with a 1 ms tick. Level 0
+ * holds the timers expiring within the next WHEEL_SIZE ticks, each upper
+ * level covers WHEEL_SIZE times the range of the level below and is
+ * cascaded down when the lower level wraps. A single timerfd per loop is
+ * armed on the earliest slot that needs processing.
+ */
+#define WHEEL_BITS		6
+#define WHEEL_SIZE		(1 << WHEEL_BITS)
+#define WHEEL_MASK		(WHEEL_SIZE - 1)
+#define WHEEL_LEVELS		4
+#define WHEEL_MAX_DELTA		((1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+#define WHEEL_NOT_ARMED		UINT64_MAX
+
+struct _timer_link {
+	struct _timer_link *prev;
+	struct _timer_link *next;
 };
 
-struct _periodic {
-	periodic_callback func;
+struct _timer {
+	struct _timer_link link;	/* must stay first */
+	uint64_t expires;
+	uint64_t deadline;		/* expires before the slack */
+	unsigned int period;
+	unsigned int slack;
+	timeout_callback timeout_func;
+	periodic_callback periodic_func;
 	void *user_data;
-	guint id;
+	int id;
+	int level;
+	int slot;
+	bool cancelled;
+};
+
+struct _wheel {
+	pthread_mutex_t lock;
+	uint64_t start_ns;
+	uint64_t base;
+	uint64_t armed;
+	uint64_t bitmap[WHEEL_LEVELS];
+	struct _timer_link slots[WHEEL_LEVELS][WHEEL_SIZE];
+	GHashTable *timers;
+	struct _timer *running;
+	int next_id;
+	int fd;
+	guint watch_id;
 };
 
 struct _idle {
@@ -57,144 +103,899 @@ struct _signal {
 	guint id;
 };
 
-static GMainLoop *mainloop;
+struct _post {
+	post_callback func;
+	void *user_data;
+	struct _post *next;
+};
+
+struct _loop {
+	GMainContext *context;
+	GMainLoop *mainloop;
+	pthread_t thread;
+	int post_fd;
+	guint post_id;
+	pthread_mutex_t lock;
+	struct _post *post_head;
+	struct _post *post_tail;
+	struct _wheel *wheel;
+	/* Held by requested_loops and each call using the loop */
+	int refs;
+};
+
+typedef struct {
+	artik_list node;
+	struct _loop *loop;
+} loop_node;
+
+static struct _loop default_loop = {
+	.post_fd = -1,
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+static artik_list *requested_loops = NULL;
+static pthread_mutex_t loops_lock = PTHREAD_MUTEX_INITIALIZER;
 
-static gboolean _timeout_callback(gpointer user_data)
+/*
+ * Returns the loop with a reference, so that a concurrent destroy_loop
+ * can not free it. Release it with _put_loop once done.
+ */
+static struct _loop *_get_loop(artik_loop_handle handle)
 {
-	struct _timeout *timeout = user_data;
+	struct _loop *loop = NULL;
+	loop_node *node;
+
+	if (!handle)
+		return &default_loop;
+
+	pthread_mutex_lock(&loops_lock);
+	node = (loop_node *)artik_list_get_by_handle(requested_loops,
+						(ARTIK_LIST_HANDLE)handle);
+	if (node) {
+		loop = node->loop;
+		loop->refs++;
+	}
+	pthread_mutex_unlock(&loops_lock);
 
-	timeout->func(timeout->user_data);
+	return loop;
+}
 
-	return FALSE;
+static gboolean _remove_source(GMainContext *context, guint id)
+{
+	GSource *source = g_main_context_find_source_by_id(context, id);
+
+	if (!source)
+		return FALSE;
+
+	g_source_destroy(source);
+
+	return TRUE;
 }
 
-static void _timeout_destroy_callback(gpointer user_data)
+static void _link_init(struct _timer_link *head)
 {
-	struct _timeout *timeout = user_data;
+	head->prev = head;
+	head->next = head;
+}
 
-	memset(timeout, 0, sizeof(struct _timeout));
-	g_free(timeout);
+static bool _link_empty(struct _timer_link *head)
+{
+	return head->next == head;
 }
 
-artik_error os_add_timeout_callback(int *timeout_id, unsigned int msec,
-				    timeout_callback func, void *user_data)
+static void _link_add_tail(struct _timer_link *head, struct _timer_link *node)
 {
-	struct _timeout *timeout = NULL;
-	GSource *source = NULL;
+	node->prev = head->prev;
+	node->next = head;
+	head->prev->next = node;
+	head->prev = node;
+}
 
-	if (!func || !timeout_id)
-		return E_BAD_ARGS;
+static void _link_del(struct _timer_link *node)
+{
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+	_link_init(node);
+}
 
-	timeout = g_try_new0(struct _timeout, 1);
-	if (!timeout)
-		return E_NO_MEM;
+/* Move all the nodes of head to the empty list dst */
+static void _link_splice(struct _timer_link *head, struct _timer_link *dst)
+{
+	if (_link_empty(head)) {
+		_link_init(dst);
+		return;
+	}
+
+	dst->next = head->next;
+	dst->prev = head->prev;
+	dst->next->prev = dst;
+	dst->prev->next = dst;
+	_link_init(head);
+}
+
+static uint64_t _monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* First tick not earlier than msec from now */
+static uint64_t _wheel_expires(struct _wheel *wheel, unsigned int msec)
+{
+	uint64_t ns = _monotonic_ns() - wheel->start_ns +
+						(uint64_t)msec * 1000000ULL;
+
+	return (ns + 999999ULL) / 1000000ULL;
+}
+
+/*
+ * Move the expiry to the latest tick of [expires, expires + slack] with
+ * the most trailing zero bits, so that timers with overlapping windows
+ * end up on the same tick and the loop wakes up once for all of them.
+ */
+static uint64_t _wheel_apply_slack(uint64_t expires, unsigned int slack)
+{
+	uint64_t limit = expires + slack;
+	int bit;
+
+	if (!slack)
+		return expires;
+
+	bit = 63 - __builtin_clzll(expires ^ limit);
+
+	return limit & ~((1ULL << bit) - 1);
+}
+
+static void _wheel_enqueue(struct _wheel *wheel, struct _timer *timer)
+{
+	uint64_t expires = timer->expires;
+	uint64_t delta;
+	int level;
+
+	if (expires < wheel->base)
+		expires = wheel->base;
+
+	delta = expires - wheel->base;
+	if (delta > WHEEL_MAX_DELTA) {
+		/* Parked on the last level, re-queued when cascaded */
+		delta = WHEEL_MAX_DELTA;
+		expires = wheel->base + delta;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		if (delta < (1ULL << (WHEEL_BITS * (level + 1))))
+			break;
+
+	timer->level = level;
+	timer->slot = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	_link_add_tail(&wheel->slots[level][timer->slot], &timer->link);
+	wheel->bitmap[level] |= 1ULL << timer->slot;
+}
+
+static void _wheel_dequeue(struct _wheel *wheel, struct _timer *timer)
+{
+	_link_del(&timer->link);
+
+	if (timer->level >= 0 &&
+			_link_empty(&wheel->slots[timer->level][timer->slot]))
+		wheel->bitmap[timer->level] &= ~(1ULL << timer->slot);
 
-	timeout->func = func;
-	timeout->user_data = user_data;
+	timer->level = -1;
+}
+
+static int _wheel_cascade(struct _wheel *wheel, int level)
+{
+	int slot = (wheel->base >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	struct _timer_link list;
+
+	_link_splice(&wheel->slots[level][slot], &list);
+	wheel->bitmap[level] &= ~(1ULL << slot);
+
+	while (!_link_empty(&list)) {
+		struct _timer *timer = (struct _timer *)list.next;
+
+		_link_del(&timer->link);
+		_wheel_enqueue(wheel, timer);
+	}
+
+	return slot;
+}
+
+/*
+ * Earliest tick needing processing: the first occupied slot of level 0,
+ * or the next cascade of an occupied slot of an upper level.
+ */
+static uint64_t _wheel_next_expiry(struct _wheel *wheel)
+{
+	uint64_t next = WHEEL_NOT_ARMED;
+	int level;
+
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		int shift = WHEEL_BITS * level;
+		uint64_t cur = wheel->base >> shift;
+		uint64_t bitmap = wheel->bitmap[level];
+		uint64_t rotated;
+		uint64_t tick;
+		int idx = cur & WHEEL_MASK;
+		int d;
+
+		if (!bitmap)
+			continue;
+
+		rotated = idx ? (bitmap >> idx) | (bitmap << (WHEEL_SIZE - idx))
+			      : bitmap;
+		d = __builtin_ctzll(rotated);
+		if (!d && (wheel->base & ((1ULL << shift) - 1)))
+			d = WHEEL_SIZE;
+
+		tick = (cur + d) << shift;
+		if (tick < next)
+			next = tick;
+	}
 
-	source = g_timeout_source_new(msec);
+	return next;
+}
+
+static bool _wheel_empty(struct _wheel *wheel)
+{
+	int level;
+
+	for (level = 0; level < WHEEL_LEVELS; level++)
+		if (wheel->bitmap[level])
+			return false;
+
+	return true;
+}
+
+/* Must be called with wheel->lock held */
+static void _wheel_arm(struct _wheel *wheel)
+{
+	uint64_t next = _wheel_next_expiry(wheel);
+	struct itimerspec its;
+
+	if (next == wheel->armed)
+		return;
+
+	memset(&its, 0, sizeof(its));
+	if (next != WHEEL_NOT_ARMED) {
+		uint64_t ns = wheel->start_ns + next * 1000000ULL;
+
+		its.it_value.tv_sec = ns / 1000000000ULL;
+		its.it_value.tv_nsec = ns % 1000000000ULL;
+	}
+
+	if (timerfd_settime(wheel->fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+		log_err("failed to arm timer wheel (%d)", errno);
+		return;
+	}
+
+	wheel->armed = next;
+}
+
+/* Called with wheel->lock held, released while the callback runs */
+static void _wheel_fire(struct _wheel *wheel, struct _timer *timer)
+{
+	int ret = 0;
+
+	wheel->running = timer;
+	pthread_mutex_unlock(&wheel->lock);
+
+	if (timer->periodic_func)
+		ret = timer->periodic_func(timer->user_data);
+	else
+		timer->timeout_func(timer->user_data);
+
+	pthread_mutex_lock(&wheel->lock);
+	wheel->running = NULL;
+
+	if (ret == 1 && !timer->cancelled) {
+		uint64_t now = (_monotonic_ns() - wheel->start_ns) / 1000000ULL;
+
+		/*
+		 * Count from the previous deadline so that the dispatch
+		 * latency does not accumulate, but skip the periods missed
+		 * by a late callback rather than firing them in a burst.
+		 */
+		timer->deadline += timer->period;
+		if (timer->deadline < now && timer->period)
+			timer->deadline += (now - timer->deadline +
+				timer->period - 1) / timer->period *
+				timer->period;
+		timer->expires = _wheel_apply_slack(timer->deadline,
+							timer->slack);
+		_wheel_enqueue(wheel, timer);
+		return;
+	}
+
+	if (!timer->cancelled)
+		g_hash_table_remove(wheel->timers,
+					GINT_TO_POINTER(timer->id));
+	g_free(timer);
+}
+
+/* Must be called with wheel->lock held */
+static void _wheel_run(struct _wheel *wheel)
+{
+	uint64_t now = (_monotonic_ns() - wheel->start_ns) / 1000000ULL;
+	struct _timer_link expired;
+	int level;
+	int idx;
+
+	while (wheel->base <= now) {
+		idx = wheel->base & WHEEL_MASK;
+
+		if (!idx) {
+			for (level = 1; level < WHEEL_LEVELS; level++)
+				if (_wheel_cascade(wheel, level))
+					break;
+		} else if (!wheel->bitmap[0]) {
+			/* Nothing to run until the next cascade */
+			wheel->base = (wheel->base | WHEEL_MASK) + 1;
+			if (wheel->base > now + 1)
+				wheel->base = now + 1;
+			continue;
+		}
+
+		_link_splice(&wheel->slots[0][idx], &expired);
+		wheel->bitmap[0] &= ~(1ULL << idx);
+
+		/* Timers added from the callbacks go to the next ticks */
+		wheel->base++;
+
+		while (!_link_empty(&expired)) {
+			struct _timer *timer = (struct _timer *)expired.next;
+
+			_link_del(&timer->link);
+			timer->level = -1;
+			_wheel_fire(wheel, timer);
+		}
+	}
+}
+
+static gboolean _wheel_callback(GIOChannel *channel, GIOCondition cond,
+				gpointer user_data)
+{
+	struct _wheel *wheel = user_data;
+	uint64_t n;
+
+	if (read(wheel->fd, &n, sizeof(n)) < 0 && errno != EAGAIN)
+		log_err("failed to read timer wheel timerfd (%d)", errno);
+
+	pthread_mutex_lock(&wheel->lock);
+	wheel->armed = WHEEL_NOT_ARMED;
+	_wheel_run(wheel);
+	_wheel_arm(wheel);
+	pthread_mutex_unlock(&wheel->lock);
+
+	return TRUE;
+}
+
+static struct _wheel *_wheel_new(GMainContext *context)
+{
+	struct _wheel *wheel;
+	GIOChannel *channel;
+	GSource *source;
+	int level, slot;
+
+	wheel = g_try_new0(struct _wheel, 1);
+	if (!wheel)
+		return NULL;
+
+	wheel->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (wheel->fd < 0) {
+		log_err("failed to create timerfd (%d)", errno);
+		g_free(wheel);
+		return NULL;
+	}
+
+	pthread_mutex_init(&wheel->lock, NULL);
+	for (level = 0; level < WHEEL_LEVELS; level++)
+		for (slot = 0; slot < WHEEL_SIZE; slot++)
+			_link_init(&wheel->slots[level][slot]);
+	wheel->timers = g_hash_table_new(g_direct_hash, g_direct_equal);
+	wheel->start_ns = _monotonic_ns();
+	wheel->armed = WHEEL_NOT_ARMED;
+
+	channel = g_io_channel_unix_new(wheel->fd);
+	source = g_io_create_watch(channel, G_IO_IN);
 	g_source_set_priority(source, G_PRIORITY_HIGH);
-	g_source_set_callback(source, _timeout_callback, timeout,
-			      _timeout_destroy_callback);
-	timeout->id = g_source_attach(source, NULL);
+	g_source_set_callback(source, (GSourceFunc)_wheel_callback, wheel,
+			      NULL);
+	wheel->watch_id = g_source_attach(source, context);
 	g_source_unref(source);
+	g_io_channel_unref(channel);
 
-	*timeout_id = timeout->id;
+	return wheel;
+}
 
-	return S_OK;
+static void _wheel_free(struct _wheel *wheel, GMainContext *context)
+{
+	GHashTableIter iter;
+	gpointer timer;
+
+	_remove_source(context, wheel->watch_id);
+	close(wheel->fd);
+
+	g_hash_table_iter_init(&iter, wheel->timers);
+	while (g_hash_table_iter_next(&iter, NULL, &timer))
+		g_free(timer);
+	g_hash_table_destroy(wheel->timers);
+
+	pthread_mutex_destroy(&wheel->lock);
+	g_free(wheel);
 }
 
-artik_error os_remove_timeout_callback(int timeout_id)
+static struct _wheel *_get_wheel(struct _loop *loop)
 {
-	gboolean ret;
+	struct _wheel *wheel;
 
-	if (timeout_id <= 0)
+	pthread_mutex_lock(&loop->lock);
+	if (!loop->wheel)
+		loop->wheel = _wheel_new(loop->context);
+	wheel = loop->wheel;
+	pthread_mutex_unlock(&loop->lock);
+
+	return wheel;
+}
+
+static void _loop_free(struct _loop *loop)
+{
+	struct _post *post;
+
+	if (loop->post_fd >= 0) {
+		_remove_source(loop->context, loop->post_id);
+		close(loop->post_fd);
+	}
+
+	post = loop->post_head;
+	while (post) {
+		struct _post *next = post->next;
+
+		g_free(post);
+		post = next;
+	}
+
+	if (loop->wheel)
+		_wheel_free(loop->wheel, loop->context);
+
+	g_main_loop_unref(loop->mainloop);
+	g_main_context_unref(loop->context);
+	pthread_mutex_destroy(&loop->lock);
+	g_free(loop);
+}
+
+static void _put_loop(struct _loop *loop)
+{
+	bool last;
+
+	if (loop == &default_loop)
+		return;
+
+	pthread_mutex_lock(&loops_lock);
+	last = --loop->refs == 0;
+	pthread_mutex_unlock(&loops_lock);
+
+	if (last)
+		_loop_free(loop);
+}
+
+static artik_error _wheel_add(artik_loop_handle handle, int *timer_id,
+		unsigned int msec, unsigned int slack, timeout_callback tfunc,
+		periodic_callback pfunc, void *user_data)
+{
+	struct _loop *loop;
+	struct _wheel *wheel;
+	struct _timer *timer;
+
+	if ((!tfunc && !pfunc) || !timer_id)
 		return E_BAD_ARGS;
 
-	ret = g_source_remove((guint) timeout_id);
-	if (ret == FALSE)
+	loop = _get_loop(handle);
+	if (!loop)
 		return E_BAD_ARGS;
 
+	wheel = _get_wheel(loop);
+	timer = wheel ? g_try_new0(struct _timer, 1) : NULL;
+	if (!timer) {
+		_put_loop(loop);
+		return E_NO_MEM;
+	}
+
+	timer->timeout_func = tfunc;
+	timer->periodic_func = pfunc;
+	timer->user_data = user_data;
+	timer->period = msec;
+	timer->slack = slack;
+
+	pthread_mutex_lock(&wheel->lock);
+	do {
+		if (++wheel->next_id <= 0)
+			wheel->next_id = 1;
+	} while (g_hash_table_contains(wheel->timers,
+					GINT_TO_POINTER(wheel->next_id)));
+	timer->id = wheel->next_id;
+	g_hash_table_insert(wheel->timers, GINT_TO_POINTER(timer->id), timer);
+
+	timer->deadline = _wheel_expires(wheel, msec);
+	timer->expires = _wheel_apply_slack(timer->deadline, slack);
+	if (_wheel_empty(wheel)) {
+		/* Skip the ticks elapsed while the wheel was idle */
+		uint64_t now = (_monotonic_ns() - wheel->start_ns) / 1000000ULL;
+
+		if (now > wheel->base)
+			wheel->base = now;
+	}
+	_wheel_enqueue(wheel, timer);
+	_wheel_arm(wheel);
+	*timer_id = timer->id;
+	pthread_mutex_unlock(&wheel->lock);
+
+	_put_loop(loop);
+
 	return S_OK;
 }
 
+static artik_error _wheel_remove(artik_loop_handle handle, int timer_id)
+{
+	struct _loop *loop;
+	struct _wheel *wheel;
+	struct _timer *timer;
+
+	if (timer_id <= 0)
+		return E_BAD_ARGS;
+
+	loop = _get_loop(handle);
+	if (!loop)
+		return E_BAD_ARGS;
+
+	pthread_mutex_lock(&loop->lock);
+	wheel = loop->wheel;
+	pthread_mutex_unlock(&loop->lock);
+	if (!wheel) {
+		_put_loop(loop);
+		return E_BAD_ARGS;
+	}
+
+	pthread_mutex_lock(&wheel->lock);
+	timer = g_hash_table_lookup(wheel->timers, GINT_TO_POINTER(timer_id));
+	if (timer) {
+		g_hash_table_remove(wheel->timers, GINT_TO_POINTER(timer_id));
+		if (timer == wheel->running) {
+			/* Freed by _wheel_fire once the callback returns */
+			timer->cancelled = true;
+		} else {
+			_wheel_dequeue(wheel, timer);
+			g_free(timer);
+		}
+	}
+	pthread_mutex_unlock(&wheel->lock);
+
+	_put_loop(loop);
+
+	return timer ? S_OK : E_BAD_ARGS;
+}
+
+artik_error os_add_timeout_callback(int *timeout_id, unsigned int msec,
+				    timeout_callback func, void *user_data)
+{
+	return os_add_timeout_callback_to_loop(NULL, timeout_id, msec, func,
+								user_data);
+}
 
-static gboolean _periodic_callback(gpointer user_data)
+artik_error os_add_timeout_with_slack(int *timeout_id, unsigned int msec,
+		unsigned int slack_msec, timeout_callback func,
+		void *user_data)
 {
-	struct _periodic *periodic = user_data;
-	int ret;
+	if (!func)
+		return E_BAD_ARGS;
 
-	ret = periodic->func(periodic->user_data);
-	if (ret == 1)
-		return TRUE;
+	return _wheel_add(NULL, timeout_id, msec, slack_msec, func, NULL,
+								user_data);
+}
 
-	return FALSE;
+artik_error os_add_timeout_callback_to_loop(artik_loop_handle handle,
+		int *timeout_id, unsigned int msec, timeout_callback func,
+		void *user_data)
+{
+	if (!func)
+		return E_BAD_ARGS;
+
+	return _wheel_add(handle, timeout_id, msec, 0, func, NULL, user_data);
 }
 
-static void _periodic_destroy_callback(gpointer user_data)
+artik_error os_remove_timeout_callback(int timeout_id)
 {
-	struct _periodic *periodic = user_data;
+	return os_remove_timeout_callback_from_loop(NULL, timeout_id);
+}
 
-	memset(periodic, 0, sizeof(struct _periodic));
-	g_free(periodic);
+artik_error os_remove_timeout_callback_from_loop(artik_loop_handle handle,
+		int timeout_id)
+{
+	return _wheel_remove(handle, timeout_id);
 }
 
 artik_error os_add_periodic_callback(int *periodic_id, unsigned int msec,
 		periodic_callback func, void *user_data)
 {
-	struct _periodic *periodic;
-	GSource *source;
+	return os_add_periodic_callback_to_loop(NULL, periodic_id, msec, func,
+								user_data);
+}
 
-	if (!func || !periodic_id)
+artik_error os_add_periodic_callback_to_loop(artik_loop_handle handle,
+		int *periodic_id, unsigned int msec, periodic_callback func,
+		void *user_data)
+{
+	if (!func)
 		return E_BAD_ARGS;
 
-	periodic = g_try_new0(struct _periodic, 1);
-	if (!periodic)
-		return E_NO_MEM;
+	return _wheel_add(handle, periodic_id, msec, 0, NULL, func, user_data);
+}
+
+artik_error os_remove_periodic_callback(int periodic_id)
+{
+	return os_remove_periodic_callback_from_loop(NULL, periodic_id);
+}
+
+artik_error os_remove_periodic_callback_from_loop(artik_loop_handle handle,
+		int periodic_id)
+{
+	return _wheel_remove(handle, periodic_id);
+}
+
+void os_loop_run(void)
+{
+	if (!default_loop.mainloop)
+		default_loop.mainloop = g_main_loop_new(NULL, FALSE);
+
+	g_main_loop_run(default_loop.mainloop);
+}
+
+void os_loop_quit(void)
+{
+	if (!default_loop.mainloop)
+		return;
+
+	g_main_loop_quit(default_loop.mainloop);
+}
+
+static gboolean _post_callback(GIOChannel *channel, GIOCondition cond,
+			       gpointer user_data)
+{
+	struct _loop *loop = user_data;
+	struct _post *post;
+	uint64_t n;
+
+	if (read(loop->post_fd, &n, sizeof(n)) < 0 && errno != EAGAIN) {
+		log_err("failed to read post eventfd (%d)", errno);
+		return TRUE;
+	}
+
+	pthread_mutex_lock(&loop->lock);
+	post = loop->post_head;
+	loop->post_head = NULL;
+	loop->post_tail = NULL;
+	pthread_mutex_unlock(&loop->lock);
+
+	while (post) {
+		struct _post *next = post->next;
+
+		post->func(post->user_data);
+		g_free(post);
+		post = next;
+	}
+
+	return TRUE;
+}
+
+/* Must be called with loop->lock held */
+static artik_error _post_init(struct _loop *loop)
+{
+	GIOChannel *channel;
+	GSource *source;
+
+	if (loop->post_fd >= 0)
+		return S_OK;
 
-	periodic->func = func;
-	periodic->user_data = user_data;
+	loop->post_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (loop->post_fd < 0) {
+		log_err("failed to create post eventfd (%d)", errno);
+		return E_BUSY;
+	}
 
-	source = g_timeout_source_new(msec);
+	channel = g_io_channel_unix_new(loop->post_fd);
+	source = g_io_create_watch(channel, G_IO_IN);
 	g_source_set_priority(source, G_PRIORITY_HIGH);
-	g_source_set_callback(source, _periodic_callback, periodic,
-			_periodic_destroy_callback);
-	periodic->id = g_source_attach(source, NULL);
+	g_source_set_callback(source, (GSourceFunc)_post_callback, loop,
+			      NULL);
+	loop->post_id = g_source_attach(source, loop->context);
 	g_source_unref(source);
+	g_io_channel_unref(channel);
+
+	return S_OK;
+}
+
+static artik_error _loop_post(struct _loop *loop, post_callback func,
+				void *user_data)
+{
+	struct _post *post;
+	artik_error ret;
+	uint64_t n = 1;
+
+	post = g_try_new0(struct _post, 1);
+	if (!post)
+		return E_NO_MEM;
+
+	post->func = func;
+	post->user_data = user_data;
+
+	pthread_mutex_lock(&loop->lock);
+	ret = _post_init(loop);
+	if (ret != S_OK) {
+		pthread_mutex_unlock(&loop->lock);
+		g_free(post);
+		return ret;
+	}
+
+	if (loop->post_tail)
+		loop->post_tail->next = post;
+	else
+		loop->post_head = post;
+	loop->post_tail = post;
+	pthread_mutex_unlock(&loop->lock);
 
-	*periodic_id = periodic->id;
+	if (write(loop->post_fd, &n, sizeof(n)) < 0 && errno != EAGAIN) {
+		log_err("failed to wake up loop (%d)", errno);
+		return E_BUSY;
+	}
 
 	return S_OK;
 }
 
-artik_error os_remove_periodic_callback(int periodic_id)
+artik_error os_post(artik_loop_handle handle, post_callback func,
+				void *user_data)
 {
-	gboolean ret;
+	struct _loop *loop;
+	artik_error ret;
 
-	if (periodic_id <= 0)
+	if (!func)
 		return E_BAD_ARGS;
 
-	ret = g_source_remove((guint) periodic_id);
-	if (ret == FALSE)
+	loop = _get_loop(handle);
+	if (!loop)
 		return E_BAD_ARGS;
 
-	return S_OK;
+	ret = _loop_post(loop, func, user_data);
+	_put_loop(loop);
+
+	return ret;
 }
 
-void os_loop_run(void)
+static void *_loop_thread(void *user_data)
 {
-	if (!mainloop)
-		mainloop = g_main_loop_new(NULL, FALSE);
+	struct _loop *loop = user_data;
+
+	g_main_context_push_thread_default(loop->context);
+	g_main_loop_run(loop->mainloop);
+	g_main_context_pop_thread_default(loop->context);
 
-	g_main_loop_run(mainloop);
+	return NULL;
 }
 
-void os_loop_quit(void)
+static void _loop_quit_callback(void *user_data)
 {
-	if (!mainloop)
-		return;
+	struct _loop *loop = user_data;
 
-	g_main_loop_quit(mainloop);
+	g_main_loop_quit(loop->mainloop);
+}
+
+artik_error os_create_loop(artik_loop_handle *handle)
+{
+	loop_node *node;
+	struct _loop *loop;
+	artik_error ret;
+
+	if (!handle)
+		return E_BAD_ARGS;
+
+	loop = g_try_new0(struct _loop, 1);
+	if (!loop)
+		return E_NO_MEM;
+
+	loop->post_fd = -1;
+	loop->refs = 1;
+	pthread_mutex_init(&loop->lock, NULL);
+	loop->context = g_main_context_new();
+	loop->mainloop = g_main_loop_new(loop->context, FALSE);
+
+	ret = _post_init(loop);
+	if (ret != S_OK)
+		goto error;
+
+	if (pthread_create(&loop->thread, NULL, _loop_thread, loop)) {
+		log_err("failed to create loop thread");
+		ret = E_BUSY;
+		goto error;
+	}
+
+	pthread_mutex_lock(&loops_lock);
+	node = (loop_node *)artik_list_add(&requested_loops, 0,
+						sizeof(loop_node));
+	if (node)
+		node->loop = loop;
+	pthread_mutex_unlock(&loops_lock);
+	if (!node) {
+		_loop_post(loop, _loop_quit_callback, loop);
+		pthread_join(loop->thread, NULL);
+		ret = E_NO_MEM;
+		goto error;
+	}
+
+	*handle = (artik_loop_handle)node->node.handle;
+
+	return S_OK;
+
+error:
+	_loop_free(loop);
+
+	return ret;
+}
+
+artik_error os_destroy_loop(artik_loop_handle handle)
+{
+	struct _loop *loop;
+	loop_node *node;
+	artik_error ret;
+
+	if (!handle)
+		return E_BAD_ARGS;
+
+	loop = _get_loop(handle);
+	if (!loop)
+		return E_BAD_ARGS;
+
+	if (pthread_equal(pthread_self(), loop->thread)) {
+		_put_loop(loop);
+		return E_BUSY;
+	}
+
+	/*
+	 * Quit from inside the loop, so a quit request can not be lost
+	 * if the thread did not enter g_main_loop_run() yet.
+	 */
+	ret = _loop_post(loop, _loop_quit_callback, loop);
+	if (ret != S_OK) {
+		_put_loop(loop);
+		return ret;
+	}
+
+	/* Only one of concurrent destroy_loop calls takes it out */
+	pthread_mutex_lock(&loops_lock);
+	node = (loop_node *)artik_list_get_by_handle(requested_loops,
+						(ARTIK_LIST_HANDLE)handle);
+	if (node && node->loop == loop)
+		artik_list_delete_node(&requested_loops, (artik_list *)node);
+	else
+		node = NULL;
+	pthread_mutex_unlock(&loops_lock);
+
+	if (!node) {
+		_put_loop(loop);
+		return E_BAD_ARGS;
+	}
+
+	pthread_join(loop->thread, NULL);
+
+	/*
+	 * Drop the reference of the list and ours, the loop is freed
+	 * once the calls still using it return.
+	 */
+	_put_loop(loop);
+	_put_loop(loop);
+
+	return S_OK;
 }
 
 static gboolean _gio_callback(GIOChannel *channel, GIOCondition cond,
@@ -258,8 +1059,18 @@ static void _gio_destroy_callback(gpointer user_data)
 artik_error os_add_fd_watch(int fd, enum watch_io io, watch_callback func,
 						void *user_data, int *watch_id)
 {
+	return os_add_fd_watch_to_loop(NULL, fd, io, func, user_data,
+								watch_id);
+}
+
+artik_error os_add_fd_watch_to_loop(artik_loop_handle handle, int fd,
+		enum watch_io io, watch_callback func, void *user_data,
+		int *watch_id)
+{
+	struct _loop *loop;
 	struct _watch *watch;
 	GIOChannel *channel;
+	GSource *source;
 	GIOCondition cond = 0;
 
 	if (fd < 0) {
@@ -277,9 +1088,17 @@ artik_error os_add_fd_watch(int fd, enum watch_io io, watch_callback func,
 		return E_BAD_ARGS;
 	}
 
+	loop = _get_loop(handle);
+	if (!loop) {
+		log_err("invalid loop handle");
+		return E_BAD_ARGS;
+	}
+
 	watch = g_try_new0(struct _watch, 1);
-	if (!watch)
+	if (!watch) {
+		_put_loop(loop);
 		return E_NO_MEM;
+	}
 
 	if (io & WATCH_IO_IN)
 		cond |= G_IO_IN;
@@ -298,10 +1117,15 @@ artik_error os_add_fd_watch(int fd, enum watch_io io, watch_callback func,
 	watch->user_data = user_data;
 
 	channel = g_io_channel_unix_new(fd);
-	watch->id = g_io_add_watch_full(channel, G_PRIORITY_HIGH, cond,
-			_gio_callback, watch, _gio_destroy_callback);
+	source = g_io_create_watch(channel, cond);
+	g_source_set_priority(source, G_PRIORITY_HIGH);
+	g_source_set_callback(source, (GSourceFunc)_gio_callback, watch,
+			      _gio_destroy_callback);
+	watch->id = g_source_attach(source, loop->context);
+	g_source_unref(source);
 	g_io_channel_set_flags(channel, G_IO_FLAG_NONBLOCK, NULL);
 	g_io_channel_unref(channel);
+	_put_loop(loop);
 
 	if (watch_id)
 		*watch_id = (int)watch->id;
@@ -311,6 +1135,13 @@ artik_error os_add_fd_watch(int fd, enum watch_io io, watch_callback func,
 
 artik_error os_remove_fd_watch(int watch_id)
 {
+	return os_remove_fd_watch_from_loop(NULL, watch_id);
+}
+
+artik_error os_remove_fd_watch_from_loop(artik_loop_handle handle,
+		int watch_id)
+{
+	struct _loop *loop;
 	gboolean ret;
 
 	if (watch_id <= 0) {
@@ -318,7 +1149,14 @@ artik_error os_remove_fd_watch(int watch_id)
 		return -EINVAL;
 	}
 
-	ret = g_source_remove((guint) watch_id);
+	loop = _get_loop(handle);
+	if (!loop) {
+		log_err("invalid loop handle");
+		return -EINVAL;
+	}
+
+	ret = _remove_source(loop->context, (guint) watch_id);
+	_put_loop(loop);
 	if (ret == FALSE) {
 		log_err("invalid watch_id(%d)", watch_id);
 		return -EINVAL;
@@ -390,19 +1228,38 @@ static void _idle_destroy_callback(gpointer user_data)
 artik_error os_add_idle_callback(int *idle_id, idle_callback func,
 				void *user_data)
 {
+	return os_add_idle_callback_to_loop(NULL, idle_id, func, user_data);
+}
+
+artik_error os_add_idle_callback_to_loop(artik_loop_handle handle,
+		int *idle_id, idle_callback func, void *user_data)
+{
+	struct _loop *loop;
 	struct _idle *idle;
+	GSource *source;
 
 	if (!func)
 		return E_BAD_ARGS;
 
+	loop = _get_loop(handle);
+	if (!loop)
+		return E_BAD_ARGS;
+
 	idle = g_try_new0(struct _idle, 1);
-	if (!idle)
+	if (!idle) {
+		_put_loop(loop);
 		return E_NO_MEM;
+	}
 
 	idle->func = func;
 	idle->user_data = user_data;
-	idle->id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, _idle_callback,
-				idle, _idle_destroy_callback);
+	source = g_idle_source_new();
+	g_source_set_priority(source, G_PRIORITY_DEFAULT_IDLE);
+	g_source_set_callback(source, _idle_callback, idle,
+			      _idle_destroy_callback);
+	idle->id = g_source_attach(source, loop->context);
+	g_source_unref(source);
+	_put_loop(loop);
 
 	*idle_id = (int)idle->id;
 
@@ -411,11 +1268,120 @@ artik_error os_add_idle_callback(int *idle_id, idle_callback func,
 
 artik_error os_remove_idle_callback(int idle_id)
 {
+	return os_remove_idle_callback_from_loop(NULL, idle_id);
+}
+
+artik_error os_remove_idle_callback_from_loop(artik_loop_handle handle,
+		int idle_id)
+{
+	struct _loop *loop;
+	gboolean ret;
+
 	if (idle_id <= 0)
 		return E_BAD_ARGS;
 
-	if (!g_source_remove((guint)idle_id))
+	loop = _get_loop(handle);
+	if (!loop)
 		return E_BAD_ARGS;
 
-	return S_OK;
+	ret = _remove_source(loop->context, (guint)idle_id);
+	_put_loop(loop);
+
+	return ret ? S_OK : E_BAD_ARGS;
+}
+
+struct _work {
+	work_callback work_func;
+	work_done_callback done_func;
+	void *user_data;
+};
+
+static struct {
+	struct _work queue[WORK_QUEUE_SIZE];
+	unsigned int head;
+	unsigned int count;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int started;
+} work_pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER
+};
+
+static void *_work_thread(void *user_data)
+{
+	struct _work work;
+
+	for (;;) {
+		pthread_mutex_lock(&work_pool.lock);
+		while (!work_pool.count)
+			pthread_cond_wait(&work_pool.cond, &work_pool.lock);
+		work = work_pool.queue[work_pool.head];
+		work_pool.head = (work_pool.head + 1) % WORK_QUEUE_SIZE;
+		work_pool.count--;
+		pthread_mutex_unlock(&work_pool.lock);
+
+		work.work_func(work.user_data);
+
+		/* Completions share the main loop post eventfd */
+		if (work.done_func &&
+		    os_post(NULL, work.done_func, work.user_data) != S_OK)
+			log_err("failed to deliver work completion");
+	}
+
+	return NULL;
+}
+
+/* Must be called with work_pool.lock held */
+static artik_error _work_pool_start(void)
+{
+	pthread_t thread;
+	int i;
+
+	if (work_pool.started)
+		return S_OK;
+
+	for (i = 0; i < WORK_NUM_THREADS; i++) {
+		if (pthread_create(&thread, NULL, _work_thread, NULL)) {
+			log_err("failed to create worker thread");
+			break;
+		}
+		pthread_detach(thread);
+		work_pool.started++;
+	}
+
+	return work_pool.started ? S_OK : E_BUSY;
+}
+
+artik_error os_submit_work(work_callback work_func,
+		work_done_callback done_func, void *user_data)
+{
+	struct _work *work;
+	artik_error ret;
+
+	if (!work_func)
+		return E_BAD_ARGS;
+
+	pthread_mutex_lock(&work_pool.lock);
+	ret = _work_pool_start();
+	if (ret != S_OK)
+		goto exit;
+
+	if (work_pool.count == WORK_QUEUE_SIZE) {
+		ret = E_BUSY;
+		goto exit;
+	}
+
+	work = &work_pool.queue[(work_pool.head + work_pool.count) %
+							WORK_QUEUE_SIZE];
+	work->work_func = work_func;
+	work->done_func = done_func;
+	work->user_data = user_data;
+	work_pool.count++;
+	pthread_cond_signal(&work_pool.cond);
+
+exit:
+	pthread_mutex_unlock(&work_pool.lock);
+
+	return ret;
 }
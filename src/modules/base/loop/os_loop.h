@@ -38,5 +38,33 @@ artik_error os_remove_signal_watch(int signal_id);
 artik_error os_add_idle_callback(int *idle_id, idle_callback func,
 				void *user_data);
 artik_error os_remove_idle_callback(int idle_id);
+artik_error os_create_loop(artik_loop_handle *handle);
+artik_error os_destroy_loop(artik_loop_handle handle);
+artik_error os_post(artik_loop_handle handle, post_callback func,
+				void *user_data);
+artik_error os_add_timeout_callback_to_loop(artik_loop_handle handle,
+		int *timeout_id, unsigned int msec, timeout_callback func,
+		void *user_data);
+artik_error os_remove_timeout_callback_from_loop(artik_loop_handle handle,
+		int timeout_id);
+artik_error os_add_periodic_callback_to_loop(artik_loop_handle handle,
+		int *periodic_id, unsigned int msec, periodic_callback func,
+		void *user_data);
+artik_error os_remove_periodic_callback_from_loop(artik_loop_handle handle,
+		int periodic_id);
+artik_error os_add_fd_watch_to_loop(artik_loop_handle handle, int fd,
+		enum watch_io io, watch_callback func, void *user_data,
+		int *watch_id);
+artik_error os_remove_fd_watch_from_loop(artik_loop_handle handle,
+		int watch_id);
+artik_error os_add_idle_callback_to_loop(artik_loop_handle handle,
+		int *idle_id, idle_callback func, void *user_data);
+artik_error os_remove_idle_callback_from_loop(artik_loop_handle handle,
+		int idle_id);
+artik_error os_submit_work(work_callback work_func,
+		work_done_callback done_func, void *user_data);
+artik_error os_add_timeout_with_slack(int *timeout_id, unsigned int msec,
+		unsigned int slack_msec, timeout_callback func,
+		void *user_data);
 
 #endif /* _OS_LOOP_H_ */
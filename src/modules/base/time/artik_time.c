@@ -43,6 +43,19 @@ static artik_error artik_time_get_delay_alarm(artik_alarm_handle handle,
 static artik_error artik_time_sync_ntp(const char *hostname);
 static int artik_time_compare_dates(const artik_time *date1,
 		const artik_time *date2);
+static artik_nsecond artik_time_get_monotonic(artik_clock_id clock);
+static artik_nsecond artik_time_get_elapsed(artik_nsecond start);
+static artik_nsecond artik_time_get_deadline(artik_msecond timeout);
+static artik_msecond artik_time_get_remaining(artik_nsecond deadline);
+static artik_error artik_time_start_ntp_sync(artik_ntp_handle *handle,
+					const artik_ntp_config *config,
+					ntp_callback func, void *user_data);
+static artik_error artik_time_stop_ntp_sync(artik_ntp_handle handle);
+static artik_error artik_time_create_alarm_cron(artik_time_zone gmt,
+						const char *spec,
+						artik_alarm_handle *handle,
+						alarm_callback func,
+						void *user_data);
 
 EXPORT_API artik_time_module time_module = {
 	artik_time_set_time,
@@ -54,7 +67,14 @@ EXPORT_API artik_time_module time_module = {
 	artik_time_delete_alarm,
 	artik_time_get_delay_alarm,
 	artik_time_sync_ntp,
-	artik_time_compare_dates
+	artik_time_compare_dates,
+	artik_time_get_monotonic,
+	artik_time_get_elapsed,
+	artik_time_get_deadline,
+	artik_time_get_remaining,
+	artik_time_start_ntp_sync,
+	artik_time_stop_ntp_sync,
+	artik_time_create_alarm_cron
 };
 
 static artik_error artik_time_set_time(artik_time date, artik_time_zone gmt)
@@ -163,3 +183,61 @@ int artik_time_compare_dates(const artik_time *date1, const artik_time *date2)
 	return 0;
 }
 
+static artik_nsecond artik_time_get_monotonic(artik_clock_id clock)
+{
+	return os_time_get_monotonic(clock);
+}
+
+static artik_nsecond artik_time_get_elapsed(artik_nsecond start)
+{
+	artik_nsecond now = os_time_get_monotonic(ARTIK_CLOCK_MONOTONIC);
+
+	return (now > start) ? now - start : 0;
+}
+
+static artik_nsecond artik_time_get_deadline(artik_msecond timeout)
+{
+	return os_time_get_monotonic(ARTIK_CLOCK_MONOTONIC) +
+					(artik_nsecond)timeout * 1000000ULL;
+}
+
+static artik_msecond artik_time_get_remaining(artik_nsecond deadline)
+{
+	artik_nsecond now = os_time_get_monotonic(ARTIK_CLOCK_MONOTONIC);
+
+	if (now >= deadline)
+		return 0;
+
+	return (deadline - now + 999999ULL) / 1000000ULL;
+}
+
+static artik_error artik_time_start_ntp_sync(artik_ntp_handle *handle,
+					const artik_ntp_config *config,
+					ntp_callback func, void *user_data)
+{
+	if (!handle || !config || !config->servers || config->num_servers <= 0
+								|| !func)
+		return E_BAD_ARGS;
+
+	return os_time_start_ntp_sync(handle, config, func, user_data);
+}
+
+static artik_error artik_time_stop_ntp_sync(artik_ntp_handle handle)
+{
+	if (!handle)
+		return E_BAD_ARGS;
+
+	return os_time_stop_ntp_sync(handle);
+}
+
+static artik_error artik_time_create_alarm_cron(artik_time_zone gmt,
+						const char *spec,
+						artik_alarm_handle *handle,
+						alarm_callback func,
+						void *user_data)
+{
+	if (!spec || !handle || *handle)
+		return E_BAD_ARGS;
+
+	return os_time_create_alarm_cron(gmt, handle, func, user_data, spec);
+}
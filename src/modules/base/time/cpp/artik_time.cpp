@@ -18,6 +18,7 @@
 
 
 #include "artik_time.hh"
+#include "artik_steady_clock.hh"
 
 artik_alarm_handle *artik::Alarm::get_handle(void) {
   return reinterpret_cast<artik_alarm_handle*>(&this->m_handle);
@@ -54,6 +55,17 @@ artik::Alarm::Alarm(artik_time_zone gmt, artik_msecond second,
       user_data);
 }
 
+artik::Alarm::Alarm(artik_time_zone gmt, const char *spec,
+    alarm_callback func, void *user_data, artik_time_module *module) {
+  if (!module)
+    module = reinterpret_cast<artik_time_module*>(
+        artik_request_api_module("time"));
+  this->m_handle = NULL;
+  this->m_module = &(*module);
+  this->m_module->create_alarm_cron(gmt, spec, &this->m_handle, func,
+      user_data);
+}
+
 artik::Alarm::Alarm() {
   this->m_handle = NULL;
 }
@@ -121,7 +133,44 @@ artik::Alarm *artik::Time::create_alarm_date(artik_time_zone gmt,
   return new Alarm(gmt, date, func, user_data, this->m_module);
 }
 
+artik::Alarm *artik::Time::create_alarm_cron(artik_time_zone gmt,
+    const char *spec, alarm_callback func, void *user_data) {
+  return new Alarm(gmt, spec, func, user_data, this->m_module);
+}
+
 int artik::Time::compare_dates(const artik_time *date1,
     const artik_time *date2) {
   return this->m_module->compare_dates(date1, date2);
 }
+
+artik_nsecond artik::Time::get_monotonic(artik_clock_id clock) const {
+  return this->m_module->get_monotonic(clock);
+}
+
+artik_nsecond artik::Time::get_elapsed(artik_nsecond start) const {
+  return this->m_module->get_elapsed(start);
+}
+
+artik_nsecond artik::Time::get_deadline(artik_msecond timeout) const {
+  return this->m_module->get_deadline(timeout);
+}
+
+artik_msecond artik::Time::get_remaining(artik_nsecond deadline) const {
+  return this->m_module->get_remaining(deadline);
+}
+
+artik_error artik::Time::start_ntp_sync(artik_ntp_handle *handle,
+    const artik_ntp_config *config, ntp_callback func, void *user_data) {
+  return this->m_module->start_ntp_sync(handle, config, func, user_data);
+}
+
+artik_error artik::Time::stop_ntp_sync(artik_ntp_handle handle) {
+  return this->m_module->stop_ntp_sync(handle);
+}
+
+const bool artik::SteadyClock::is_steady;
+
+artik::SteadyClock::time_point artik::SteadyClock::now() {
+  return time_point(duration(time_module.get_monotonic(
+      ARTIK_CLOCK_MONOTONIC)));
+}
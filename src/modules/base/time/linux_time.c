@@ -27,7 +27,9 @@
 #include <sys/time.h>
 #include <sys/timerfd.h>
 #include <sys/eventfd.h>
+#include <sys/timex.h>
 #include <poll.h>
+#include <pthread.h>
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -58,6 +60,21 @@
 #define NTP_TIMEOUT_SEC 3
 #define EPOCH_BALANCE 2208988800U
 
+#define NTP_PACKET_SIZE		48
+#define NTP_MAX_SERVERS		8
+#define NTP_DEFAULT_TIMEOUT	2000
+#define NTP_DEFAULT_STEP	128
+/* Version 4, client mode */
+#define NTP_CLIENT_HEADER	0x23
+#define NTP_MODE_SERVER		4
+#define NTP_LI_UNSYNC		3
+#define NTP_MAX_STRATUM		15
+/* Offsets closer than this to the median are never outliers */
+#define NTP_OUTLIER_MIN_NS	1000000LL
+/* Highest frequency correction accepted by the kernel */
+#define NTP_MAX_PPB		500000LL
+#define NSEC_PER_SEC		1000000000LL
+
 #define MAX(a, b)	((a > b) ? a : b)
 
 typedef struct {
@@ -65,14 +82,64 @@ typedef struct {
 	char *format_mod;
 } artik_time_parser_t;
 
+/* Day of the month and day of the week constraints of a cron spec */
+#define CRON_ANY_DAY		(1 << 0)
+#define CRON_ANY_WEEKDAY	(1 << 1)
+
+#define ALARM_HEAP_MIN		64
+/* Give up on cron specs never matching, e.g. February 30th */
+#define ALARM_CRON_SEARCH_SEC	(5LL * 366 * 24 * 3600)
+
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET	(1 << 1)
+#endif
+
+typedef struct {
+	uint64_t minutes;
+	uint32_t hours;
+	uint32_t days;
+	uint16_t months;
+	uint8_t weekdays;
+	uint8_t flags;
+} artik_time_cron_t;
+
 typedef struct {
 	artik_time_zone gmt;
 	alarm_callback func;
-	artik_msecond date_alarm;
-	artik_loop_module *loop;
-	int alarm_id;
+	void *user_data;
+	/* CLOCK_REALTIME expiration in ns */
+	long long expiry;
+	/* CLOCK_MONOTONIC expiration of the alarms set by a delay */
+	artik_nsecond deadline;
+	bool relative;
+	bool recurring;
+	artik_time_cron_t cron;
+	/* Position in the scheduler heap, -1 once set off */
+	int index;
 } artik_time_alarm_t;
 
+/*
+ * All the alarms share a min-heap ordered on their expiration and a single
+ * CLOCK_REALTIME timerfd armed on the earliest one. The timer is canceled
+ * when the system time is set, so that alarms are rescheduled accordingly.
+ * Alarms may be created and deleted from any thread, alarm_lock protects
+ * the scheduler and is released while the callbacks run.
+ */
+struct alarm_scheduler {
+	artik_loop_module *loop;
+	artik_time_alarm_t **heap;
+	int count;
+	int size;
+	int refs;
+	int fd;
+	int watch_id;
+	long long armed;
+	bool dispatching;
+};
+
+static struct alarm_scheduler *scheduler;
+static pthread_mutex_t alarm_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static artik_error os_time_struct_empty(void *data, int len)
 {
 	int *addr = data;
@@ -261,12 +328,473 @@ artik_msecond os_time_get_tick(void)
 	return curr_in_sec;
 }
 
+static long long _time_realtime_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	return (long long)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void _alarm_heap_set(struct alarm_scheduler *s, int i,
+				artik_time_alarm_t *alarm)
+{
+	s->heap[i] = alarm;
+	alarm->index = i;
+}
+
+static void _alarm_sift_up(struct alarm_scheduler *s, int i)
+{
+	artik_time_alarm_t *alarm = s->heap[i];
+
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+
+		if (s->heap[parent]->expiry <= alarm->expiry)
+			break;
+
+		_alarm_heap_set(s, i, s->heap[parent]);
+		i = parent;
+	}
+
+	_alarm_heap_set(s, i, alarm);
+}
+
+static void _alarm_sift_down(struct alarm_scheduler *s, int i)
+{
+	artik_time_alarm_t *alarm = s->heap[i];
+
+	for (;;) {
+		int child = 2 * i + 1;
+
+		if (child >= s->count)
+			break;
+
+		if (child + 1 < s->count &&
+			s->heap[child + 1]->expiry < s->heap[child]->expiry)
+			child++;
+
+		if (alarm->expiry <= s->heap[child]->expiry)
+			break;
+
+		_alarm_heap_set(s, i, s->heap[child]);
+		i = child;
+	}
+
+	_alarm_heap_set(s, i, alarm);
+}
+
+static artik_error _alarm_insert(struct alarm_scheduler *s,
+				artik_time_alarm_t *alarm)
+{
+	if (s->count == s->size) {
+		int size = s->size ? s->size * 2 : ALARM_HEAP_MIN;
+		artik_time_alarm_t **heap = realloc(s->heap,
+							size * sizeof(*heap));
+
+		if (!heap)
+			return E_NO_MEM;
+
+		s->heap = heap;
+		s->size = size;
+	}
+
+	_alarm_heap_set(s, s->count++, alarm);
+	_alarm_sift_up(s, alarm->index);
+
+	return S_OK;
+}
+
+static void _alarm_remove(struct alarm_scheduler *s, artik_time_alarm_t *alarm)
+{
+	artik_time_alarm_t *last = s->heap[--s->count];
+	int i = alarm->index;
+
+	alarm->index = -1;
+	if (last == alarm)
+		return;
+
+	_alarm_heap_set(s, i, last);
+	_alarm_sift_up(s, i);
+	_alarm_sift_down(s, last->index);
+}
+
+static void _alarm_arm(struct alarm_scheduler *s)
+{
+	long long expiry = s->count ? s->heap[0]->expiry : 0;
+	struct itimerspec its;
+
+	if (expiry == s->armed)
+		return;
+
+	memset(&its, 0, sizeof(its));
+	if (s->count) {
+		/* A zero value would disarm the timer */
+		if (expiry <= 0)
+			expiry = 1;
+		its.it_value.tv_sec = expiry / NSEC_PER_SEC;
+		its.it_value.tv_nsec = expiry % NSEC_PER_SEC;
+	}
+
+	if (timerfd_settime(s->fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+							&its, NULL) < 0) {
+		log_err("Failed to arm the alarm timer (%d)", errno);
+		s->armed = -1;
+		return;
+	}
+
+	s->armed = expiry;
+}
+
+static bool _alarm_cron_day(const artik_time_cron_t *cron, const struct tm *tm)
+{
+	bool day = cron->days & (1U << tm->tm_mday);
+	bool weekday = cron->weekdays & (1U << tm->tm_wday);
+
+	/* Like cron, either of two restricted day fields is enough */
+	if (!(cron->flags & (CRON_ANY_DAY | CRON_ANY_WEEKDAY)))
+		return day || weekday;
+
+	return day && weekday;
+}
+
+/* Next occurrence strictly after 'after', -1 if there is none */
+static long long _alarm_cron_next(const artik_time_cron_t *cron,
+				artik_time_zone gmt, long long after)
+{
+	time_t offset = (time_t)gmt * 3600;
+	time_t t = after / NSEC_PER_SEC + offset;
+	time_t limit;
+	struct tm tm;
+
+	/* GMT offsets have no daylight saving, a day is always 86400s */
+	t = t - t % 60 + 60;
+	limit = t + ALARM_CRON_SEARCH_SEC;
+
+	while (t < limit) {
+		gmtime_r(&t, &tm);
+
+		if (!(cron->months & (1U << (tm.tm_mon + 1)))) {
+			tm.tm_mon++;
+			tm.tm_mday = 1;
+			tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+			t = timegm(&tm);
+		} else if (!_alarm_cron_day(cron, &tm)) {
+			t += 86400 - tm.tm_hour * 3600 - tm.tm_min * 60;
+		} else if (!(cron->hours & (1U << tm.tm_hour))) {
+			t += 3600 - tm.tm_min * 60;
+		} else if (!(cron->minutes & (1ULL << tm.tm_min))) {
+			t += 60;
+		} else {
+			return (long long)(t - offset) * NSEC_PER_SEC;
+		}
+	}
+
+	return -1;
+}
+
+/* Parse a cron field: '*', values, ranges and steps separated by commas */
+static artik_error _alarm_cron_field(const char *field, int min, int max,
+				uint64_t *mask)
+{
+	const char *p = field;
+
+	*mask = 0;
+
+	for (;;) {
+		long first = min, last = max, step = 1;
+		bool any = *p == '*';
+		char *end;
+		long v;
+
+		if (any) {
+			p++;
+		} else {
+			first = last = strtol(p, &end, 10);
+			if (end == p)
+				return E_BAD_ARGS;
+			p = end;
+
+			if (*p == '-') {
+				p++;
+				last = strtol(p, &end, 10);
+				if (end == p)
+					return E_BAD_ARGS;
+				p = end;
+			}
+		}
+
+		if (*p == '/') {
+			p++;
+			step = strtol(p, &end, 10);
+			if (end == p || step <= 0)
+				return E_BAD_ARGS;
+			p = end;
+
+			/* 'N/step' stands for 'N-max/step' */
+			if (!any && first == last)
+				last = max;
+		}
+
+		if (first < min || last > max || first > last)
+			return E_BAD_ARGS;
+
+		for (v = first; v <= last; v += step)
+			*mask |= 1ULL << v;
+
+		if (*p == '\0')
+			return S_OK;
+
+		if (*p++ != ',')
+			return E_BAD_ARGS;
+	}
+}
+
+/* Standard 5 fields spec: minute hour day-of-month month day-of-week */
+static artik_error _alarm_cron_parse(const char *spec, artik_time_cron_t *cron)
+{
+	static const int ranges[5][2] = {
+		{ 0, 59 }, { 0, 23 }, { 1, 31 }, { 1, 12 }, { 0, 7 }
+	};
+	uint64_t masks[5];
+	char buf[128];
+	char *field, *saveptr = NULL;
+	int i;
+
+	if (strlen(spec) >= sizeof(buf))
+		return E_BAD_ARGS;
+
+	strncpy(buf, spec, sizeof(buf));
+	memset(cron, 0, sizeof(*cron));
+
+	field = strtok_r(buf, " \t", &saveptr);
+	for (i = 0; i < 5; i++) {
+		if (!field || _alarm_cron_field(field, ranges[i][0],
+					ranges[i][1], &masks[i]) != S_OK)
+			return E_BAD_ARGS;
+
+		if (i == 2 && field[0] == '*')
+			cron->flags |= CRON_ANY_DAY;
+		else if (i == 4 && field[0] == '*')
+			cron->flags |= CRON_ANY_WEEKDAY;
+
+		field = strtok_r(NULL, " \t", &saveptr);
+	}
+
+	if (field)
+		return E_BAD_ARGS;
+
+	cron->minutes = masks[0];
+	cron->hours = masks[1];
+	cron->days = masks[2];
+	cron->months = masks[3];
+	/* Both 0 and 7 are Sunday */
+	cron->weekdays = (masks[4] | (masks[4] >> 7)) & 0x7f;
+
+	return S_OK;
+}
+
+/* The system time was set, recompute what depends on it */
+static void _alarm_clock_changed(struct alarm_scheduler *s)
+{
+	artik_nsecond mono = os_time_get_monotonic(ARTIK_CLOCK_MONOTONIC);
+	long long now = _time_realtime_ns();
+	artik_time_alarm_t *last;
+	int i;
+
+	log_dbg("System time changed, rescheduling %d alarms", s->count);
+
+	/* Backwards, a removed alarm is replaced by one already updated */
+	for (i = s->count - 1; i >= 0; i--) {
+		artik_time_alarm_t *alarm = s->heap[i];
+
+		if (alarm->relative) {
+			alarm->expiry = now;
+			if (alarm->deadline > mono)
+				alarm->expiry += alarm->deadline - mono;
+		} else if (alarm->recurring) {
+			alarm->expiry = _alarm_cron_next(&alarm->cron,
+						alarm->gmt, now - 1);
+			/* No date left, as when dispatching */
+			if (alarm->expiry < 0) {
+				last = s->heap[--s->count];
+				if (last != alarm)
+					_alarm_heap_set(s, i, last);
+				alarm->index = -1;
+			}
+		}
+	}
+
+	for (i = s->count / 2 - 1; i >= 0; i--)
+		_alarm_sift_down(s, i);
+}
+
+static void _alarm_scheduler_free(struct alarm_scheduler *s)
+{
+	if (s->watch_id)
+		s->loop->remove_fd_watch(s->watch_id);
+
+	close(s->fd);
+	artik_release_api_module(s->loop);
+	free(s->heap);
+	free(s);
+	scheduler = NULL;
+}
+
+static int _alarm_on_timer(int fd, enum watch_io io, void *user_data)
+{
+	struct alarm_scheduler *s = user_data;
+	uint64_t expirations;
+	long long now;
+
+	pthread_mutex_lock(&alarm_lock);
+
+	/* Freed by another thread while this watch was being dispatched */
+	if (s != scheduler) {
+		pthread_mutex_unlock(&alarm_lock);
+		return 0;
+	}
+
+	if (read(s->fd, &expirations, sizeof(expirations)) < 0 &&
+							errno == ECANCELED)
+		_alarm_clock_changed(s);
+
+	s->armed = -1;
+	s->dispatching = true;
+	now = _time_realtime_ns();
+
+	/* Callbacks may create or delete any alarm, including this one */
+	while (s->count && s->heap[0]->expiry <= now) {
+		artik_time_alarm_t *alarm = s->heap[0];
+		alarm_callback func = alarm->func;
+		void *user_data = alarm->user_data;
+
+		if (alarm->recurring) {
+			alarm->expiry = _alarm_cron_next(&alarm->cron,
+							alarm->gmt, now);
+			if (alarm->expiry < 0)
+				_alarm_remove(s, alarm);
+			else
+				_alarm_sift_down(s, 0);
+		} else {
+			_alarm_remove(s, alarm);
+		}
+
+		/* The alarm may be deleted as soon as the lock is released */
+		pthread_mutex_unlock(&alarm_lock);
+		func(user_data);
+		pthread_mutex_lock(&alarm_lock);
+	}
+
+	s->dispatching = false;
+	if (!s->refs) {
+		/* Returning 0 already removes the watch */
+		s->watch_id = 0;
+		_alarm_scheduler_free(s);
+		pthread_mutex_unlock(&alarm_lock);
+		return 0;
+	}
+
+	_alarm_arm(s);
+	pthread_mutex_unlock(&alarm_lock);
+
+	return 1;
+}
+
+static struct alarm_scheduler *_alarm_scheduler_get(void)
+{
+	struct alarm_scheduler *s = scheduler;
+
+	if (s) {
+		s->refs++;
+		return s;
+	}
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return NULL;
+
+	s->loop = (artik_loop_module *)artik_request_api_module("loop");
+	if (!s->loop) {
+		free(s);
+		return NULL;
+	}
+
+	s->fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (s->fd < 0) {
+		log_err("Failed to create the alarm timer (%d)", errno);
+		artik_release_api_module(s->loop);
+		free(s);
+		return NULL;
+	}
+
+	if (s->loop->add_fd_watch(s->fd, WATCH_IO_IN, _alarm_on_timer, s,
+						&s->watch_id) != S_OK) {
+		close(s->fd);
+		artik_release_api_module(s->loop);
+		free(s);
+		return NULL;
+	}
+
+	s->armed = -1;
+	s->refs = 1;
+	scheduler = s;
+
+	return s;
+}
+
+static void _alarm_scheduler_put(struct alarm_scheduler *s)
+{
+	/* Freed at the end of the dispatch if needed */
+	if (--s->refs || s->dispatching)
+		return;
+
+	_alarm_scheduler_free(s);
+}
+
+static artik_error _alarm_schedule(artik_alarm_handle *handle,
+				artik_time_alarm_t *alarm)
+{
+	struct alarm_scheduler *s;
+
+	pthread_mutex_lock(&alarm_lock);
+
+	s = _alarm_scheduler_get();
+	if (!s) {
+		pthread_mutex_unlock(&alarm_lock);
+		free(alarm);
+		return E_BUSY;
+	}
+
+	if (_alarm_insert(s, alarm) != S_OK) {
+		_alarm_scheduler_put(s);
+		pthread_mutex_unlock(&alarm_lock);
+		free(alarm);
+		return E_NO_MEM;
+	}
+
+	/* Rearmed once all the expired alarms are dispatched */
+	if (alarm->index == 0 && !s->dispatching)
+		_alarm_arm(s);
+
+	/* Set before the alarm can go off and be deleted */
+	*handle = alarm;
+
+	pthread_mutex_unlock(&alarm_lock);
+
+	return S_OK;
+}
+
 artik_error os_time_create_alarm_second(artik_time_zone gmt,
 					artik_alarm_handle *handle,
 					alarm_callback func,
 					void *user_data,
 					artik_msecond second)
 {
+	artik_time_alarm_t *alarm;
+	long long delay;
+
 	if (gmt < ARTIK_TIME_UTC || gmt > ARTIK_TIME_GMT12)
 		return E_BAD_ARGS;
 
@@ -276,35 +804,19 @@ artik_error os_time_create_alarm_second(artik_time_zone gmt,
 	if (!func)
 		return E_BAD_ARGS;
 
-	artik_time_alarm_t *alarm_data = NULL;
-	struct tm curr_usr;
-	time_t curr_in_sec;
-
-	memset(&curr_usr, 1, sizeof(curr_usr));
-	os_time_get_sys(&curr_usr, gmt);
-	curr_usr.tm_yday = 0;
-	curr_usr.tm_year -= EPOCH_DEF;
-	curr_in_sec = mktime(&curr_usr);
-	if (curr_in_sec < 0)
-		return E_BAD_ARGS;
-
-	curr_in_sec += (time_t) second;
-
-	*handle = malloc(sizeof(artik_time_alarm_t));
+	alarm = calloc(1, sizeof(*alarm));
+	if (!alarm)
+		return E_NO_MEM;
 
-	alarm_data = *handle;
-	alarm_data->loop = (artik_loop_module *)
-					artik_request_api_module("loop");
-	alarm_data->func = func;
-	alarm_data->gmt = gmt;
-	alarm_data->date_alarm = curr_in_sec;
+	delay = (long long)second * NSEC_PER_SEC;
+	alarm->gmt = gmt;
+	alarm->func = func;
+	alarm->user_data = user_data;
+	alarm->relative = true;
+	alarm->deadline = os_time_get_monotonic(ARTIK_CLOCK_MONOTONIC) + delay;
+	alarm->expiry = _time_realtime_ns() + delay;
 
-	if (!alarm_data->loop)
-		return E_BUSY;
-
-	return alarm_data->loop->add_timeout_callback(&alarm_data->alarm_id,
-						(unsigned int)second*1000,
-						func, user_data);
+	return _alarm_schedule(handle, alarm);
 }
 
 artik_error os_time_create_alarm_date(artik_time_zone gmt,
@@ -313,6 +825,11 @@ artik_error os_time_create_alarm_date(artik_time_zone gmt,
 				      void *user_data,
 				      artik_time date)
 {
+	artik_time_alarm_t *alarm;
+	struct tm date_usr;
+	time_t date_in_sec;
+	long long expiry;
+
 	if (gmt < ARTIK_TIME_UTC || gmt > ARTIK_TIME_GMT12)
 		return E_BAD_ARGS;
 
@@ -346,47 +863,91 @@ artik_error os_time_create_alarm_date(artik_time_zone gmt,
 	if ((int)date.msecond < 0)
 		return E_BAD_ARGS;
 
-	time_t date_in_sec = 0, curr_in_sec = 0;
-	double diff_t;
-	struct tm date_usr, curr_usr;
-
-	memset(&curr_usr, 0, sizeof(curr_usr));
-	os_time_get_sys(&curr_usr, gmt);
+	/* The date is expressed in the 'gmt' time zone */
+	memset(&date_usr, 0, sizeof(date_usr));
+	date_usr.tm_sec = date.second;
+	date_usr.tm_min = date.minute;
+	date_usr.tm_hour = date.hour;
+	date_usr.tm_mday = date.day;
+	date_usr.tm_mon = date.month - 1;
+	date_usr.tm_year = date.year - EPOCH_DEF;
+
+	date_in_sec = timegm(&date_usr);
+	if (date_in_sec == (time_t)-1)
+		return E_INVALID_VALUE;
 
-	curr_usr.tm_yday = 0;
-	curr_usr.tm_year -= EPOCH_DEF;
-	curr_in_sec = mktime(&curr_usr);
+	expiry = ((long long)date_in_sec - gmt * 3600) * NSEC_PER_SEC +
+					(long long)date.msecond * 1000000;
+	if (expiry < _time_realtime_ns())
+		return E_BAD_ARGS;
 
-	if (curr_in_sec < 0)
-		return E_INVALID_VALUE;
+	alarm = calloc(1, sizeof(*alarm));
+	if (!alarm)
+		return E_NO_MEM;
 
-	memset(&date_usr, 0, sizeof(date_usr));
-	memcpy(&date_usr, &date, sizeof(date));
+	alarm->gmt = gmt;
+	alarm->func = func;
+	alarm->user_data = user_data;
+	alarm->expiry = expiry;
 
-	if (date_usr.tm_year > EPOCH_DEF) {
-		date_usr.tm_year -= EPOCH_DEF;
-		date_usr.tm_mon--;
-	}
+	return _alarm_schedule(handle, alarm);
+}
 
-	date_usr.tm_yday = 0;
+artik_error os_time_create_alarm_cron(artik_time_zone gmt,
+				      artik_alarm_handle *handle,
+				      alarm_callback func,
+				      void *user_data,
+				      const char *spec)
+{
+	artik_time_alarm_t *alarm;
+	artik_time_cron_t cron;
 
-	date_in_sec = mktime(&date_usr);
+	if (gmt < ARTIK_TIME_UTC || gmt > ARTIK_TIME_GMT12)
+		return E_BAD_ARGS;
 
-	if (date_in_sec < 0)
-		return E_INVALID_VALUE;
+	if (!func || _alarm_cron_parse(spec, &cron) != S_OK)
+		return E_BAD_ARGS;
 
-	diff_t = difftime(date_in_sec, curr_in_sec);
+	alarm = calloc(1, sizeof(*alarm));
+	if (!alarm)
+		return E_NO_MEM;
+
+	alarm->gmt = gmt;
+	alarm->func = func;
+	alarm->user_data = user_data;
+	alarm->recurring = true;
+	alarm->cron = cron;
+	alarm->expiry = _alarm_cron_next(&cron, gmt, _time_realtime_ns());
+	if (alarm->expiry < 0) {
+		log_err("Cron spec '%s' never matches", spec);
+		free(alarm);
+		return E_BAD_ARGS;
+	}
 
-	return os_time_create_alarm_second(gmt, handle, func, user_data,
-		diff_t);
+	return _alarm_schedule(handle, alarm);
 }
 
 artik_error os_time_delete_alarm(artik_alarm_handle handle)
 {
-	artik_time_alarm_t *alarm_data = handle;
+	artik_time_alarm_t *alarm = handle;
+	struct alarm_scheduler *s;
+
+	pthread_mutex_lock(&alarm_lock);
+
+	s = scheduler;
+	if (!s) {
+		pthread_mutex_unlock(&alarm_lock);
+		return E_BAD_ARGS;
+	}
+
+	if (alarm->index >= 0)
+		_alarm_remove(s, alarm);
 
-	if (alarm_data)
-		free(handle);
+	_alarm_scheduler_put(s);
+
+	pthread_mutex_unlock(&alarm_lock);
+
+	free(alarm);
 
 	return S_OK;
 }
@@ -394,100 +955,670 @@ artik_error os_time_delete_alarm(artik_alarm_handle handle)
 artik_error os_time_get_delay_alarm(artik_alarm_handle handle,
 				    artik_msecond *msecond)
 {
-	artik_time_alarm_t *alarm_data = handle;
-	struct tm curr_usr;
-	artik_msecond curr_in_sec = 0;
-	int res = 0;
+	artik_time_alarm_t *alarm = handle;
+	long long remaining = 0;
+
+	pthread_mutex_lock(&alarm_lock);
+	if (alarm->index >= 0)
+		remaining = alarm->expiry - _time_realtime_ns();
+	pthread_mutex_unlock(&alarm_lock);
+
+	*msecond = remaining <= 0 ? 0 :
+		(remaining + NSEC_PER_SEC - 1) / NSEC_PER_SEC;
+
+	return S_OK;
+}
+
+struct ntp_sample {
+	long long offset;
+	long long delay;
+};
+
+struct ntp_client;
+
+struct ntp_server {
+	struct ntp_client *client;
+	char *hostname;
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	int fd;
+	int watch_id;
+	uint64_t sent;
+	bool answered;
+	struct ntp_sample sample;
+};
+
+struct ntp_client {
+	artik_loop_module *loop;
+	artik_ntp_config config;
+	ntp_callback func;
+	void *user_data;
+	struct ntp_server servers[NTP_MAX_SERVERS];
+	int num_servers;
+	int pending;
+	int timeout_id;
+	int period_id;
+	bool resolving;
+	bool stopped;
+	/* Drift estimation state */
+	bool has_last;
+	long long last_offset;
+	long long last_applied;
+	artik_nsecond last_sync;
+	long long drift_ppb;
+};
+
+static uint64_t _ntp_from_ns(long long ns)
+{
+	uint64_t sec = ns / NSEC_PER_SEC + EPOCH_BALANCE;
+	uint64_t frac = ((uint64_t)(ns % NSEC_PER_SEC) << 32) / NSEC_PER_SEC;
+
+	return (sec << 32) | frac;
+}
+
+static long long _ntp_to_ns(uint64_t ts)
+{
+	long long sec = (long long)(ts >> 32) - EPOCH_BALANCE;
+	uint64_t frac = ((ts & 0xffffffffULL) * NSEC_PER_SEC) >> 32;
+
+	/* NTP era 1 starts in 2036 */
+	if ((ts >> 32) < EPOCH_BALANCE)
+		sec += 1LL << 32;
+
+	return sec * NSEC_PER_SEC + frac;
+}
+
+static uint64_t _ntp_read_ts(const unsigned char *p)
+{
+	uint32_t sec, frac;
+
+	memcpy(&sec, p, sizeof(sec));
+	memcpy(&frac, p + 4, sizeof(frac));
+
+	return ((uint64_t)ntohl(sec) << 32) | ntohl(frac);
+}
+
+static uint64_t _ntp_make_request(unsigned char *msg)
+{
+	uint64_t now = _ntp_from_ns(_time_realtime_ns());
+	uint32_t sec = htonl(now >> 32);
+	uint32_t frac = htonl(now & 0xffffffffULL);
+
+	memset(msg, 0, NTP_PACKET_SIZE);
+	msg[0] = NTP_CLIENT_HEADER;
+	/* Transmit timestamp, echoed back as originate timestamp */
+	memcpy(msg + 40, &sec, sizeof(sec));
+	memcpy(msg + 44, &frac, sizeof(frac));
+
+	return now;
+}
+
+/*
+ * Compute offset and round trip delay from the four timestamps:
+ * t1 request sent, t2 request received, t3 answer sent by the server,
+ * t4 answer received.
+ */
+static artik_error _ntp_parse_response(const unsigned char *msg, int len,
+				uint64_t sent, long long t4,
+				struct ntp_sample *sample)
+{
+	long long t1, t2, t3;
+
+	if (len < NTP_PACKET_SIZE)
+		return E_INVALID_VALUE;
+
+	if ((msg[0] & 0x7) != NTP_MODE_SERVER ||
+			(msg[0] >> 6) == NTP_LI_UNSYNC ||
+			msg[1] == 0 || msg[1] > NTP_MAX_STRATUM) {
+		log_dbg("rejected NTP answer (header 0x%x, stratum %d)",
+							msg[0], msg[1]);
+		return E_INVALID_VALUE;
+	}
+
+	if (_ntp_read_ts(msg + 24) != sent || !_ntp_read_ts(msg + 40)) {
+		log_dbg("NTP answer does not match the request");
+		return E_INVALID_VALUE;
+	}
+
+	t1 = _ntp_to_ns(sent);
+	t2 = _ntp_to_ns(_ntp_read_ts(msg + 32));
+	t3 = _ntp_to_ns(_ntp_read_ts(msg + 40));
+
+	sample->offset = ((t2 - t1) + (t3 - t4)) / 2;
+	sample->delay = (t4 - t1) - (t3 - t2);
+	if (sample->delay < 0)
+		sample->delay = 0;
+
+	return S_OK;
+}
+
+static int _ntp_compare_ll(const void *a, const void *b)
+{
+	long long la = *(const long long *)a;
+	long long lb = *(const long long *)b;
+
+	return (la > lb) - (la < lb);
+}
+
+/*
+ * Drop the samples too far from the median offset, then keep the one
+ * with the shortest round trip, the least affected by network jitter.
+ */
+static int _ntp_select(const struct ntp_sample *samples, int count,
+				struct ntp_sample *best)
+{
+	long long offsets[NTP_MAX_SERVERS];
+	long long devs[NTP_MAX_SERVERS];
+	long long median, mad;
+	int kept = 0;
+	int i;
+
+	if (!count)
+		return 0;
+
+	for (i = 0; i < count; i++)
+		offsets[i] = samples[i].offset;
+	qsort(offsets, count, sizeof(long long), _ntp_compare_ll);
+	median = (count % 2) ? offsets[count / 2] :
+		(offsets[count / 2 - 1] + offsets[count / 2]) / 2;
+
+	for (i = 0; i < count; i++)
+		devs[i] = llabs(samples[i].offset - median);
+	qsort(devs, count, sizeof(long long), _ntp_compare_ll);
+	mad = devs[count / 2];
+
+	for (i = 0; i < count; i++) {
+		if (llabs(samples[i].offset - median) >
+					3 * mad + NTP_OUTLIER_MIN_NS)
+			continue;
+
+		if (!kept || samples[i].delay < best->delay)
+			*best = samples[i];
+		kept++;
+	}
+
+	return kept;
+}
+
+/* Slew the clock for small offsets, step it otherwise */
+static artik_error _ntp_apply(long long offset, artik_msecond step_threshold,
+				bool *stepped)
+{
+	*stepped = llabs(offset) >= (long long)step_threshold * 1000000LL;
+
+	if (*stepped) {
+		long long now = _time_realtime_ns() + offset;
+		struct timespec ts;
+
+		ts.tv_sec = now / NSEC_PER_SEC;
+		ts.tv_nsec = now % NSEC_PER_SEC;
+		if (clock_settime(CLOCK_REALTIME, &ts) < 0) {
+			log_err("Failed to set new time (%d)", errno);
+			return (errno == EPERM) ? E_ACCESS_DENIED : E_BAD_ARGS;
+		}
+	} else {
+		struct timeval delta;
+
+		delta.tv_sec = offset / NSEC_PER_SEC;
+		delta.tv_usec = (offset % NSEC_PER_SEC) / 1000;
+		if (adjtime(&delta, NULL) < 0) {
+			log_err("Failed to slew the clock (%d)", errno);
+			return (errno == EPERM) ? E_ACCESS_DENIED : E_BAD_ARGS;
+		}
+	}
+
+	return S_OK;
+}
+
+/* Add a frequency error in ppb to the kernel clock frequency */
+static void _ntp_correct_frequency(long long drift_ppb)
+{
+	struct timex tx;
+	long long freq;
+
+	memset(&tx, 0, sizeof(tx));
+	if (adjtimex(&tx) < 0)
+		return;
+
+	/* Kernel frequency unit is ppm with a 16 bit fractional part */
+	freq = tx.freq + drift_ppb * 65536 / 1000;
+	if (freq > NTP_MAX_PPB * 65536 / 1000)
+		freq = NTP_MAX_PPB * 65536 / 1000;
+	else if (freq < -NTP_MAX_PPB * 65536 / 1000)
+		freq = -NTP_MAX_PPB * 65536 / 1000;
+
+	memset(&tx, 0, sizeof(tx));
+	tx.modes = ADJ_FREQUENCY;
+	tx.freq = freq;
+	if (adjtimex(&tx) < 0)
+		log_err("Failed to correct the clock frequency (%d)", errno);
+}
+
+/*
+ * The offset expected now is what remained after the previous
+ * correction, any difference accumulated since is the clock drift.
+ */
+static void _ntp_update_drift(struct ntp_client *client, long long offset,
+				long long applied)
+{
+	artik_nsecond now = os_time_get_monotonic(ARTIK_CLOCK_MONOTONIC);
+	long long elapsed = now - client->last_sync;
+	long long residual, drift;
+
+	/* A slew runs at most at 500 ppm, wait for its end */
+	if (client->has_last && elapsed >= NSEC_PER_SEC &&
+			llabs(client->last_applied) <=
+				elapsed / NSEC_PER_SEC * NTP_MAX_PPB) {
+		residual = offset -
+			(client->last_offset - client->last_applied);
+		/* In ms over the interval, it does not overflow for steps */
+		drift = residual * 1000 / (elapsed / 1000000);
+		if (llabs(drift) <= NTP_MAX_PPB) {
+			/* Smooth the reported estimate over a few rounds */
+			if (client->drift_ppb)
+				client->drift_ppb +=
+					(drift - client->drift_ppb) / 4;
+			else
+				client->drift_ppb = drift;
+			if (client->config.adjust_clock)
+				_ntp_correct_frequency(drift);
+		}
+	}
+
+	client->has_last = true;
+	client->last_offset = offset;
+	client->last_applied = applied;
+	client->last_sync = now;
+}
+
+static void _ntp_close_server(struct ntp_client *client,
+				struct ntp_server *server)
+{
+	if (server->watch_id) {
+		client->loop->remove_fd_watch(server->watch_id);
+		server->watch_id = 0;
+	}
+
+	if (server->fd >= 0) {
+		close(server->fd);
+		server->fd = -1;
+	}
+}
+
+static void _ntp_free(struct ntp_client *client)
+{
+	int i;
 
-	memset(&curr_usr, 1, sizeof(curr_usr));
+	for (i = 0; i < client->num_servers; i++) {
+		_ntp_close_server(client, &client->servers[i]);
+		free(client->servers[i].hostname);
+	}
 
-	artik_error ret = os_time_get_sys(&curr_usr, alarm_data->gmt);
+	artik_release_api_module(client->loop);
+	free(client);
+}
 
+static void _ntp_start_round(void *user_data);
+
+static void _ntp_finish_round(void *user_data)
+{
+	struct ntp_client *client = user_data;
+	struct ntp_sample samples[NTP_MAX_SERVERS];
+	struct ntp_sample best;
+	artik_ntp_result result;
+	artik_error ret = S_OK;
+	int count = 0;
+	int i;
+
+	client->timeout_id = 0;
+
+	for (i = 0; i < client->num_servers; i++) {
+		struct ntp_server *server = &client->servers[i];
+
+		_ntp_close_server(client, server);
+		if (server->answered)
+			samples[count++] = server->sample;
+		server->answered = false;
+	}
+
+	memset(&result, 0, sizeof(result));
+	result.num_samples = _ntp_select(samples, count, &best);
+	if (!result.num_samples) {
+		log_err("No valid answer from the NTP servers");
+		ret = E_TIMEOUT;
+	} else {
+		result.offset_usec = best.offset / 1000;
+		result.delay_usec = best.delay / 1000;
+
+		if (client->config.adjust_clock)
+			ret = _ntp_apply(best.offset,
+					client->config.step_threshold,
+					&result.stepped);
+
+		if (ret == S_OK) {
+			_ntp_update_drift(client, best.offset,
+				client->config.adjust_clock ? best.offset : 0);
+			result.drift_ppb = client->drift_ppb;
+		}
+	}
+
+	if (client->config.period)
+		client->loop->add_timeout_callback(&client->period_id,
+				client->config.period, _ntp_start_round,
+				client);
+
+	client->func(ret, (ret == S_OK) ? &result : NULL, client->user_data);
+}
+
+static int _ntp_on_response(int fd, enum watch_io io, void *user_data)
+{
+	struct ntp_server *server = user_data;
+	struct ntp_client *client = server->client;
+	unsigned char msg[NTP_PACKET_SIZE * 2];
+	long long t4 = _time_realtime_ns();
+	int len;
+
+	len = recv(fd, msg, sizeof(msg), 0);
+	if (len < 0 && (errno == EAGAIN || errno == EINTR))
+		return 1;
+
+	if (len < 0) {
+		/* e.g. ICMP port unreachable, the round timeout ends it */
+		log_dbg("%s: %s", server->hostname, strerror(errno));
+		server->watch_id = 0;
+		return 0;
+	}
+
+	/* Ignore bogus datagrams, a valid answer may still come */
+	if (_ntp_parse_response(msg, len, server->sent, t4,
+						&server->sample) != S_OK)
+		return 1;
+
+	server->answered = true;
+	server->watch_id = 0;
+	close(server->fd);
+	server->fd = -1;
+
+	if (--client->pending == 0 && client->timeout_id) {
+		client->loop->remove_timeout_callback(client->timeout_id);
+		_ntp_finish_round(client);
+	}
+
+	return 0;
+}
+
+/* Runs on a worker thread, getaddrinfo() may block */
+static void _ntp_resolve(void *user_data)
+{
+	struct ntp_client *client = user_data;
+	struct addrinfo hints;
+	char port[8];
+	int i;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	snprintf(port, sizeof(port), "%u", client->config.port);
+
+	for (i = 0; i < client->num_servers; i++) {
+		struct ntp_server *server = &client->servers[i];
+		struct addrinfo *res = NULL;
+
+		server->addr_len = 0;
+		if (getaddrinfo(server->hostname, port, &hints, &res) || !res) {
+			log_err("Failed to resolve %s", server->hostname);
+			continue;
+		}
+
+		memcpy(&server->addr, res->ai_addr, res->ai_addrlen);
+		server->addr_len = res->ai_addrlen;
+		freeaddrinfo(res);
+	}
+}
+
+static void _ntp_send_requests(void *user_data)
+{
+	struct ntp_client *client = user_data;
+	unsigned char msg[NTP_PACKET_SIZE];
+	int i;
+
+	client->resolving = false;
+	if (client->stopped) {
+		_ntp_free(client);
+		return;
+	}
+
+	client->pending = 0;
+	for (i = 0; i < client->num_servers; i++) {
+		struct ntp_server *server = &client->servers[i];
+
+		if (!server->addr_len)
+			continue;
+
+		server->fd = socket(server->addr.ss_family,
+				SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (server->fd < 0)
+			continue;
+
+		/* Only accept datagrams from the server */
+		if (connect(server->fd, (struct sockaddr *)&server->addr,
+							server->addr_len) < 0) {
+			_ntp_close_server(client, server);
+			continue;
+		}
+
+		server->sent = _ntp_make_request(msg);
+		if (send(server->fd, msg, sizeof(msg), 0) != sizeof(msg) ||
+			client->loop->add_fd_watch(server->fd, WATCH_IO_IN,
+				_ntp_on_response, server,
+				&server->watch_id) != S_OK) {
+			log_err("Failed to query %s", server->hostname);
+			_ntp_close_server(client, server);
+			continue;
+		}
+
+		client->pending++;
+	}
+
+	client->loop->add_timeout_callback(&client->timeout_id,
+		client->pending ? client->config.timeout : 0,
+		_ntp_finish_round, client);
+}
+
+static artik_error _ntp_resolve_servers(struct ntp_client *client)
+{
+	artik_error ret;
+
+	/* Resolve again each time, pool servers rotate their addresses */
+	ret = client->loop->submit_work(_ntp_resolve, _ntp_send_requests,
+									client);
+	client->resolving = (ret == S_OK);
+
+	return ret;
+}
+
+static void _ntp_start_round(void *user_data)
+{
+	struct ntp_client *client = user_data;
+
+	client->period_id = 0;
+
+	if (_ntp_resolve_servers(client) != S_OK) {
+		/* Last, the callback may stop the client */
+		if (client->config.period)
+			client->loop->add_timeout_callback(&client->period_id,
+				client->config.period, _ntp_start_round,
+				client);
+		client->func(E_BUSY, NULL, client->user_data);
+	}
+}
+
+artik_error os_time_start_ntp_sync(artik_ntp_handle *handle,
+				const artik_ntp_config *config,
+				ntp_callback func, void *user_data)
+{
+	struct ntp_client *client;
+	artik_error ret;
+	int i;
+
+	if (config->num_servers > NTP_MAX_SERVERS)
+		return E_BAD_ARGS;
+
+	client = calloc(1, sizeof(*client));
+	if (!client)
+		return E_NO_MEM;
+
+	client->loop = (artik_loop_module *)artik_request_api_module("loop");
+	if (!client->loop) {
+		free(client);
+		return E_NOT_INITIALIZED;
+	}
+
+	client->config = *config;
+	client->config.servers = NULL;
+	if (!client->config.port)
+		client->config.port = NTP_PORT;
+	if (!client->config.timeout)
+		client->config.timeout = NTP_DEFAULT_TIMEOUT;
+	if (!client->config.step_threshold)
+		client->config.step_threshold = NTP_DEFAULT_STEP;
+	client->func = func;
+	client->user_data = user_data;
+
+	for (i = 0; i < config->num_servers; i++) {
+		struct ntp_server *server = &client->servers[i];
+
+		server->client = client;
+		server->fd = -1;
+		server->hostname = strdup(config->servers[i]);
+		client->num_servers++;
+		if (!server->hostname) {
+			_ntp_free(client);
+			return E_NO_MEM;
+		}
+	}
+
+	/* Fail here rather than calling back before the handle is set */
+	ret = _ntp_resolve_servers(client);
 	if (ret != S_OK) {
-		*msecond = 0;
+		_ntp_free(client);
 		return ret;
 	}
 
-	curr_usr.tm_year -= EPOCH_DEF;
-	curr_usr.tm_yday = 0;
-	res = mktime(&curr_usr);
+	*handle = client;
 
-	if (res == 0)
-		*msecond = 0;
-	else if (res < 0) {
-		*msecond = 0;
-		return E_INVALID_VALUE;
+	return S_OK;
+}
+
+artik_error os_time_stop_ntp_sync(artik_ntp_handle handle)
+{
+	struct ntp_client *client = handle;
+
+	if (client->timeout_id)
+		client->loop->remove_timeout_callback(client->timeout_id);
+	if (client->period_id)
+		client->loop->remove_timeout_callback(client->period_id);
+
+	/* Freed once the pending resolution completes */
+	if (client->resolving) {
+		client->stopped = true;
+		return S_OK;
 	}
 
-	curr_in_sec = res;
-	*msecond = alarm_data->date_alarm <= curr_in_sec ?
-		0 : (alarm_data->date_alarm - curr_in_sec);
+	_ntp_free(client);
 
 	return S_OK;
 }
 
 artik_error os_time_sync_ntp(const char *hostname)
 {
-	unsigned char msg[48] = { 010, 0, 0, 0, 0, 0, 0, 0, 0 };
-	unsigned long buf[1024];
-
+	unsigned char msg[NTP_PACKET_SIZE * 2];
+	struct addrinfo hints, *res = NULL;
+	struct ntp_sample sample;
+	struct pollfd pfd;
+	artik_nsecond deadline;
+	long long left;
+	char port[8];
+	uint64_t sent;
+	bool stepped;
 	int sock;
-	int res;
-
-	struct protoent *proto;
-	struct sockaddr_in server_addr;
-	struct sockaddr saddr;
-	socklen_t saddr_l;
-	struct hostent *host_resolv;
-	struct timeval time_struct = { NTP_TIMEOUT_SEC, 0 };
+	int len;
+	artik_error ret;
 
 	log_dbg("");
 	if (!hostname)
 		return E_BAD_ARGS;
-	proto = getprotobyname("udp");
-	sock = socket(PF_INET, SOCK_DGRAM, proto->p_proto);
-
-	if (setsockopt
-	    (sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&time_struct,
-	     sizeof(time_struct)) < 0) {
-		log_err("Failed to set socket options");
-		return E_BAD_ARGS;
-	}
 
-	memset(&server_addr, 0, sizeof(server_addr));
-	server_addr.sin_family = AF_INET;
-	host_resolv = gethostbyname(hostname);
-	if (!host_resolv) {
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	snprintf(port, sizeof(port), "%u", NTP_PORT);
+	if (getaddrinfo(hostname, port, &hints, &res) || !res) {
 		log_err("Failed to resolve host name");
 		return E_HTTP_ERROR;
 	}
 
-	server_addr.sin_addr.s_addr =
-	    inet_addr(inet_ntoa
-		      (*(struct in_addr *)host_resolv->h_addr_list[0]));
-	server_addr.sin_port = htons(NTP_PORT);
-
-	res =
-	    sendto(sock, msg, sizeof(msg), 0, (struct sockaddr *)&server_addr,
-		   sizeof(server_addr));
-	if (res != 48) {
-		log_err("Failed to send request to socket");
+	sock = socket(res->ai_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (sock < 0 || connect(sock, res->ai_addr, res->ai_addrlen) < 0) {
+		log_err("Failed to create socket");
+		freeaddrinfo(res);
+		if (sock >= 0)
+			close(sock);
 		return E_BAD_ARGS;
 	}
+	freeaddrinfo(res);
 
-	saddr_l = sizeof(saddr);
-	res = recvfrom(sock, buf, 48, 0, &saddr, &saddr_l);
-	if (res != 48) {
-		log_err("Timeout on receiving response over the socket");
+	sent = _ntp_make_request(msg);
+	if (send(sock, msg, NTP_PACKET_SIZE, 0) != NTP_PACKET_SIZE) {
+		log_err("Failed to send request to socket");
+		close(sock);
 		return E_BAD_ARGS;
 	}
 
-	time_struct.tv_sec = ntohl((time_t) buf[4]) - EPOCH_BALANCE;
-	res = settimeofday(&time_struct, NULL);
-	if (res != 0) {
-		log_err("Failed to set new time");
-		return E_BAD_ARGS;
-	}
+	/* Bogus datagrams do not extend the wait */
+	deadline = os_time_get_monotonic(ARTIK_CLOCK_MONOTONIC) +
+				NTP_TIMEOUT_SEC * NSEC_PER_SEC;
+	pfd.fd = sock;
+	pfd.events = POLLIN;
+	do {
+		left = (long long)(deadline -
+				os_time_get_monotonic(ARTIK_CLOCK_MONOTONIC));
+		if (left <= 0 ||
+				poll(&pfd, 1, (left + 999999) / 1000000) <= 0) {
+			log_err("Timeout on receiving the NTP response");
+			close(sock);
+			return E_TIMEOUT;
+		}
+		len = recv(sock, msg, sizeof(msg), 0);
+	} while (len < 0 || _ntp_parse_response(msg, len, sent,
+				_time_realtime_ns(), &sample) != S_OK);
+	close(sock);
+
+	ret = _ntp_apply(sample.offset, NTP_DEFAULT_STEP, &stepped);
+	if (ret != S_OK)
+		return ret;
+
+	log_dbg("%s clock by %lld us", stepped ? "Stepped" : "Slewing",
+							sample.offset / 1000);
 
 	return S_OK;
 }
+
+artik_nsecond os_time_get_monotonic(artik_clock_id clock)
+{
+	static const clockid_t clock_ids[] = {
+		CLOCK_MONOTONIC,
+		CLOCK_MONOTONIC_RAW,
+		CLOCK_MONOTONIC_COARSE
+	};
+	struct timespec ts;
+
+	if (clock < ARTIK_CLOCK_MONOTONIC ||
+			clock > ARTIK_CLOCK_MONOTONIC_COARSE)
+		return 0;
+
+	if (clock_gettime(clock_ids[clock], &ts) < 0)
+		return 0;
+
+	return (artik_nsecond)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -41,5 +41,14 @@ artik_error os_time_delete_alarm(artik_alarm_handle handle);
 artik_error os_time_get_delay_alarm(artik_alarm_handle handle,
 				    artik_msecond *msecond);
 artik_error os_time_sync_ntp(const char *hostname);
+artik_nsecond os_time_get_monotonic(artik_clock_id clock);
+artik_error os_time_start_ntp_sync(artik_ntp_handle *handle,
+				const artik_ntp_config *config,
+				ntp_callback func, void *user_data);
+artik_error os_time_stop_ntp_sync(artik_ntp_handle handle);
+artik_error os_time_create_alarm_cron(artik_time_zone gmt,
+				artik_alarm_handle *handle,
+				alarm_callback func, void *user_data,
+				const char *spec);
 
 #endif  /* __OS_TIME_H__ */
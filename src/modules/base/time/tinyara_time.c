@@ -239,3 +239,35 @@ artik_error os_time_sync_ntp(const char *hostname)
 {
 	return E_NOT_SUPPORTED;
 }
+
+artik_error os_time_start_ntp_sync(artik_ntp_handle *handle,
+				const artik_ntp_config *config,
+				ntp_callback func, void *user_data)
+{
+	return E_NOT_SUPPORTED;
+}
+
+artik_error os_time_stop_ntp_sync(artik_ntp_handle handle)
+{
+	return E_NOT_SUPPORTED;
+}
+
+artik_error os_time_create_alarm_cron(artik_time_zone gmt,
+				      artik_alarm_handle *handle,
+				      alarm_callback func,
+				      void *user_data,
+				      const char *spec)
+{
+	return E_NOT_SUPPORTED;
+}
+
+artik_nsecond os_time_get_monotonic(artik_clock_id clock)
+{
+	struct timespec ts;
+
+	/* Only one monotonic clock is available */
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+		return 0;
+
+	return (artik_nsecond)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
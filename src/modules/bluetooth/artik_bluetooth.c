@@ -183,6 +183,46 @@ static artik_error artik_bluetooth_agent_send_passkey(artik_bt_agent_request_han
 static artik_error artik_bluetooth_agent_send_error(artik_bt_agent_request_handle handle,
 		artik_bt_agent_request_error e, const char *err_msg);
 static artik_error artik_bluetooth_agent_send_empty_response(artik_bt_agent_request_handle handle);
+static artik_error artik_bluetooth_set_async_timeout(unsigned int timeout_ms);
+static artik_error artik_bluetooth_connect_async(const char *addr,
+		artik_bt_async_callback callback, void *user_data);
+static artik_error artik_bluetooth_disconnect_async(const char *addr,
+		artik_bt_async_callback callback, void *user_data);
+static artik_error artik_bluetooth_get_device_property_async(const char *addr,
+		const char *property, artik_bt_async_callback callback,
+		void *user_data);
+static artik_error artik_bluetooth_gatt_char_read_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data);
+static artik_error artik_bluetooth_gatt_char_write_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		const unsigned char byte[], int byte_len,
+		artik_bt_async_callback callback, void *user_data);
+static artik_error artik_bluetooth_gatt_start_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data);
+static artik_error artik_bluetooth_gatt_stop_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data);
+static artik_error artik_bluetooth_set_scan_report(
+		const artik_bt_scan_report_config *config);
+static artik_error artik_bluetooth_uuid_parse(const char *str,
+		artik_bt_uuid128 *uuid);
+static artik_error artik_bluetooth_uuid_format(const artik_bt_uuid128 *uuid,
+		char *str, unsigned int len);
+static artik_error artik_bluetooth_uuid_get_name(const char *uuid,
+		const char **name);
+static artik_error artik_bluetooth_spp_stream_open(int fd,
+		const artik_bt_spp_stream_config *config,
+		artik_bt_spp_stream_handle *handle);
+static artik_error artik_bluetooth_spp_stream_write(
+		artik_bt_spp_stream_handle handle, const unsigned char *data,
+		unsigned int len);
+static artik_error artik_bluetooth_spp_stream_get_stats(
+		artik_bt_spp_stream_handle handle,
+		artik_bt_spp_stream_stats *stats);
+static artik_error artik_bluetooth_spp_stream_close(
+		artik_bt_spp_stream_handle handle);
 const artik_bluetooth_module bluetooth_module = {
 	artik_bluetooth_start_scan,
 	artik_bluetooth_stop_scan,
@@ -291,7 +331,23 @@ const artik_bluetooth_module bluetooth_module = {
 	artik_bluetooth_agent_send_pincode,
 	artik_bluetooth_agent_send_passkey,
 	artik_bluetooth_agent_send_error,
-	artik_bluetooth_agent_send_empty_response
+	artik_bluetooth_agent_send_empty_response,
+	artik_bluetooth_set_async_timeout,
+	artik_bluetooth_connect_async,
+	artik_bluetooth_disconnect_async,
+	artik_bluetooth_get_device_property_async,
+	artik_bluetooth_gatt_char_read_value_async,
+	artik_bluetooth_gatt_char_write_value_async,
+	artik_bluetooth_gatt_start_notify_async,
+	artik_bluetooth_gatt_stop_notify_async,
+	artik_bluetooth_set_scan_report,
+	artik_bluetooth_uuid_parse,
+	artik_bluetooth_uuid_format,
+	artik_bluetooth_uuid_get_name,
+	artik_bluetooth_spp_stream_open,
+	artik_bluetooth_spp_stream_write,
+	artik_bluetooth_spp_stream_get_stats,
+	artik_bluetooth_spp_stream_close
 };
 
 artik_error artik_bluetooth_set_scan_filter(artik_bt_scan_filter *filter)
@@ -1037,3 +1093,164 @@ artik_error artik_bluetooth_agent_send_empty_response(artik_bt_agent_request_han
 
 	return os_bt_agent_send_empty_response(handle);
 }
+
+artik_error artik_bluetooth_set_async_timeout(unsigned int timeout_ms)
+{
+	if (!timeout_ms)
+		return E_BAD_ARGS;
+
+	return os_bt_set_async_timeout(timeout_ms);
+}
+
+artik_error artik_bluetooth_connect_async(const char *addr,
+		artik_bt_async_callback callback, void *user_data)
+{
+	if (!addr || !callback)
+		return E_BAD_ARGS;
+
+	return os_bt_connect_async(addr, callback, user_data);
+}
+
+artik_error artik_bluetooth_disconnect_async(const char *addr,
+		artik_bt_async_callback callback, void *user_data)
+{
+	if (!addr || !callback)
+		return E_BAD_ARGS;
+
+	return os_bt_disconnect_async(addr, callback, user_data);
+}
+
+artik_error artik_bluetooth_get_device_property_async(const char *addr,
+		const char *property, artik_bt_async_callback callback,
+		void *user_data)
+{
+	if (!addr || !property || !callback)
+		return E_BAD_ARGS;
+
+	return os_bt_get_device_property_async(addr, property, callback,
+			user_data);
+}
+
+artik_error artik_bluetooth_gatt_char_read_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data)
+{
+	if (!addr || !srv_uuid || !char_uuid || !callback)
+		return E_BAD_ARGS;
+
+	return os_bt_gatt_char_read_value_async(addr, srv_uuid, char_uuid,
+			callback, user_data);
+}
+
+artik_error artik_bluetooth_gatt_char_write_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		const unsigned char byte[], int byte_len,
+		artik_bt_async_callback callback, void *user_data)
+{
+	if (!addr || !srv_uuid || !char_uuid || !callback || byte_len < 0 ||
+			(byte_len > 0 && !byte))
+		return E_BAD_ARGS;
+
+	return os_bt_gatt_char_write_value_async(addr, srv_uuid, char_uuid,
+			byte, byte_len, callback, user_data);
+}
+
+artik_error artik_bluetooth_gatt_start_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data)
+{
+	if (!addr || !srv_uuid || !char_uuid || !callback)
+		return E_BAD_ARGS;
+
+	return os_bt_gatt_start_notify_async(addr, srv_uuid, char_uuid,
+			callback, user_data);
+}
+
+artik_error artik_bluetooth_gatt_stop_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data)
+{
+	if (!addr || !srv_uuid || !char_uuid || !callback)
+		return E_BAD_ARGS;
+
+	return os_bt_gatt_stop_notify_async(addr, srv_uuid, char_uuid,
+			callback, user_data);
+}
+
+artik_error artik_bluetooth_set_scan_report(
+		const artik_bt_scan_report_config *config)
+{
+	if (config && (!config->interval ||
+			(config->address_length && !config->address_list) ||
+			(config->uuid_length && !config->uuid_list)))
+		return E_BAD_ARGS;
+
+	return os_bt_set_scan_report(config);
+}
+
+artik_error artik_bluetooth_uuid_parse(const char *str, artik_bt_uuid128 *uuid)
+{
+	if (!str || !uuid)
+		return E_BAD_ARGS;
+
+	return os_bt_uuid_parse(str, uuid);
+}
+
+artik_error artik_bluetooth_uuid_format(const artik_bt_uuid128 *uuid,
+		char *str, unsigned int len)
+{
+	if (!uuid || !str || len < BT_UUID_STR_LEN)
+		return E_BAD_ARGS;
+
+	return os_bt_uuid_format(uuid, str);
+}
+
+artik_error artik_bluetooth_uuid_get_name(const char *uuid, const char **name)
+{
+	if (!uuid || !name)
+		return E_BAD_ARGS;
+
+	return os_bt_uuid_get_name(uuid, name);
+}
+
+artik_error artik_bluetooth_spp_stream_open(int fd,
+		const artik_bt_spp_stream_config *config,
+		artik_bt_spp_stream_handle *handle)
+{
+	if (fd < 0 || !config || !handle)
+		return E_BAD_ARGS;
+
+	return os_bt_spp_stream_open(fd, config, handle);
+}
+
+artik_error artik_bluetooth_spp_stream_write(
+		artik_bt_spp_stream_handle handle, const unsigned char *data,
+		unsigned int len)
+{
+	if (!handle || (!data && len))
+		return E_BAD_ARGS;
+
+	if (!len)
+		return S_OK;
+
+	return os_bt_spp_stream_write(handle, data, len);
+}
+
+artik_error artik_bluetooth_spp_stream_get_stats(
+		artik_bt_spp_stream_handle handle,
+		artik_bt_spp_stream_stats *stats)
+{
+	if (!handle || !stats)
+		return E_BAD_ARGS;
+
+	return os_bt_spp_stream_get_stats(handle, stats);
+}
+
+artik_error artik_bluetooth_spp_stream_close(
+		artik_bt_spp_stream_handle handle)
+{
+	if (!handle)
+		return E_BAD_ARGS;
+
+	return os_bt_spp_stream_close(handle);
+}
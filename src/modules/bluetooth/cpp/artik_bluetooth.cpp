@@ -529,3 +529,94 @@ artik_error artik::Bluetooth::agent_send_empty_response(
     artik_bt_agent_request_handle handle) {
   return m_module->agent_send_empty_response(handle);
 }
+
+artik_error artik::Bluetooth::set_async_timeout(unsigned int timeout_ms) {
+  return m_module->set_async_timeout(timeout_ms);
+}
+
+artik_error artik::Bluetooth::connect_async(const char *addr,
+    artik_bt_async_callback callback, void *user_data) {
+  return m_module->connect_async(addr, callback, user_data);
+}
+
+artik_error artik::Bluetooth::disconnect_async(const char *addr,
+    artik_bt_async_callback callback, void *user_data) {
+  return m_module->disconnect_async(addr, callback, user_data);
+}
+
+artik_error artik::Bluetooth::get_device_property_async(const char *addr,
+    const char *property, artik_bt_async_callback callback,
+    void *user_data) {
+  return m_module->get_device_property_async(addr, property, callback,
+      user_data);
+}
+
+artik_error artik::Bluetooth::gatt_char_read_value_async(const char *addr,
+    const char *srv_uuid, const char *char_uuid,
+    artik_bt_async_callback callback, void *user_data) {
+  return m_module->gatt_char_read_value_async(addr, srv_uuid, char_uuid,
+      callback, user_data);
+}
+
+artik_error artik::Bluetooth::gatt_char_write_value_async(const char *addr,
+    const char *srv_uuid, const char *char_uuid, const unsigned char byte[],
+    int byte_len, artik_bt_async_callback callback, void *user_data) {
+  return m_module->gatt_char_write_value_async(addr, srv_uuid, char_uuid,
+      byte, byte_len, callback, user_data);
+}
+
+artik_error artik::Bluetooth::gatt_start_notify_async(const char *addr,
+    const char *srv_uuid, const char *char_uuid,
+    artik_bt_async_callback callback, void *user_data) {
+  return m_module->gatt_start_notify_async(addr, srv_uuid, char_uuid,
+      callback, user_data);
+}
+
+artik_error artik::Bluetooth::gatt_stop_notify_async(const char *addr,
+    const char *srv_uuid, const char *char_uuid,
+    artik_bt_async_callback callback, void *user_data) {
+  return m_module->gatt_stop_notify_async(addr, srv_uuid, char_uuid,
+      callback, user_data);
+}
+
+artik_error artik::Bluetooth::set_scan_report(
+    const artik_bt_scan_report_config *config) {
+  return m_module->set_scan_report(config);
+}
+
+artik_error artik::Bluetooth::uuid_parse(const char *str,
+    artik_bt_uuid128 *uuid) {
+  return m_module->uuid_parse(str, uuid);
+}
+
+artik_error artik::Bluetooth::uuid_format(const artik_bt_uuid128 *uuid,
+    char *str, unsigned int len) {
+  return m_module->uuid_format(uuid, str, len);
+}
+
+artik_error artik::Bluetooth::uuid_get_name(const char *uuid,
+    const char **name) {
+  return m_module->uuid_get_name(uuid, name);
+}
+
+artik_error artik::Bluetooth::spp_stream_open(int fd,
+    const artik_bt_spp_stream_config *config,
+    artik_bt_spp_stream_handle *handle) {
+  return m_module->spp_stream_open(fd, config, handle);
+}
+
+artik_error artik::Bluetooth::spp_stream_write(
+    artik_bt_spp_stream_handle handle, const unsigned char *data,
+    unsigned int len) {
+  return m_module->spp_stream_write(handle, data, len);
+}
+
+artik_error artik::Bluetooth::spp_stream_get_stats(
+    artik_bt_spp_stream_handle handle, artik_bt_spp_stream_stats *stats) {
+  return m_module->spp_stream_get_stats(handle, stats);
+}
+
+artik_error artik::Bluetooth::spp_stream_close(
+    artik_bt_spp_stream_handle handle) {
+  return m_module->spp_stream_close(handle);
+}
@@ -27,6 +27,7 @@
 #include "core.h"
 #include "adapter.h"
 #include "device.h"
+#include "async.h"
 
 artik_error bt_set_scan_filter(artik_bt_scan_filter * filter)
 {
@@ -321,6 +322,50 @@ artik_error bt_get_device_property(const char *addr, const char *property, char
 	return S_OK;
 }
 
+static void _device_property_reply(bt_async_call *call, GVariant *reply,
+		GUnixFDList *fd_list, GError *error)
+{
+	GVariant *v;
+	gchar *value;
+
+	if (error != NULL) {
+		_async_call_done(call, _async_error(error), NULL, 0);
+		return;
+	}
+
+	g_variant_get(reply, "(v)", &v);
+	if (g_variant_is_of_type(v, G_VARIANT_TYPE_STRING) ||
+			g_variant_is_of_type(v, G_VARIANT_TYPE_OBJECT_PATH))
+		value = g_variant_dup_string(v, NULL);
+	else
+		value = g_variant_print(v, FALSE);
+	g_variant_unref(v);
+
+	_async_call_done(call, S_OK, (const unsigned char *)value,
+			strlen(value));
+	g_free(value);
+}
+
+artik_error bt_get_device_property_async(const char *addr,
+		const char *property, artik_bt_async_callback callback,
+		void *user_data)
+{
+	gchar *path = NULL;
+
+	bt_init(G_BUS_TYPE_SYSTEM, &(hci.conn));
+
+	_get_object_path(addr, &path);
+	if (path == NULL)
+		return E_BT_ERROR;
+
+	_async_call_submit(_async_call_new(path, DBUS_IF_PROPERTIES, "Get",
+			g_variant_new("(ss)", DBUS_IF_DEVICE1, property),
+			_device_property_reply, callback, user_data));
+	g_free(path);
+
+	return S_OK;
+}
+
 artik_error bt_get_adapter_info(artik_bt_adapter *adapter)
 {
 	GVariant *r, *v;
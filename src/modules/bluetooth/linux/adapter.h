@@ -36,6 +36,9 @@ artik_error bt_stop_scan(void);
 bool bt_is_scanning(void);
 artik_error bt_get_device_property(const char *addr, const char *property,
 	char **value);
+artik_error bt_get_device_property_async(const char *addr,
+	const char *property, artik_bt_async_callback callback,
+	void *user_data);
 artik_error bt_get_adapter_info(artik_bt_adapter *adapter);
 
 #ifdef __cplusplus
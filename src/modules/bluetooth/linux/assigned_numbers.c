@@ -26,6 +26,7 @@
 
 #include "assigned_numbers.h"
 
+/* Sorted by UUID, _get_uuid16_name() looks it up by binary search */
 static struct {
 	uint16_t uuid;
 	const char *name;
@@ -138,247 +139,247 @@ static struct {
 	{0x1402, "HDP Sink", "Health Device Profile (HDP)"},
 
 	/* GATT Services */
-	{0x1811, "Alert Notification Service", "org.bluetooth.service.alert_notification"},
-	{0x1815, "Automation IO", "org.bluetooth.service.automation_io"},
-	{0x180F, "Battery Service", "org.bluetooth.service.battery_service"},
-	{0x1810, "Blood Pressure", "org.bluetooth.service.blood_pressure"},
-	{0x181B, "Body Composition", "org.bluetooth.service.body_composition"},
-	{0x181E, "Bond Management", "org.bluetooth.service.bond_management"},
-	{0x181F, "Continuous Glucose Monitoring", "org.bluetooth.service.continuous_glucose_monitoring"},
-	{0x1805, "Current Time Service", "org.bluetooth.service.current_time"},
-	{0x1818, "Cycling Power", "org.bluetooth.service.cycling_power"},
-	{0x1816, "Cycling Speed and Cadence", "org.bluetooth.service.cycling_speed_and_cadence"},
-	{0x180A, "Device Information", "org.bluetooth.service.device_information"},
-	{0x181A, "Environmental Sensing", "org.bluetooth.service.environmental_sensing"},
 	{0x1800, "Generic Access", "org.bluetooth.service.generic_access"},
 	{0x1801, "Generic Attribute", "org.bluetooth.service.generic_attribute"},
-	{0x1808, "Glucose", "org.bluetooth.service.glucose"},
-	{0x1809, "Health Thermometer", "org.bluetooth.service.health_thermometer"},
-	{0x180D, "Heart Rate", "org.bluetooth.service.heart_rate"},
-	{0x1823, "HTTP Proxy", "org.bluetooth.service.http_proxy"},
-	{0x1812, "Human Interface Device", "org.bluetooth.service.human_interface_device"},
 	{0x1802, "Immediate Alert", "org.bluetooth.service.immediate_alert"},
-	{0x1821, "Indoor Positioning", "org.bluetooth.service.indoor_positioning"},
-	{0x1820, "Internet Protocol Support", "org.bluetooth.service.internet_protocol_support"},
 	{0x1803, "Link Loss", "org.bluetooth.service.link_loss"},
-	{0x1819, "Location and Navigation", "org.bluetooth.service.location_and_navigation"},
+	{0x1804, "Tx Power", "org.bluetooth.service.tx_power"},
+	{0x1805, "Current Time Service", "org.bluetooth.service.current_time"},
+	{0x1806, "Reference Time Update Service", "org.bluetooth.service.reference_time_update"},
 	{0x1807, "Next DST Change Service", "org.bluetooth.service.next_dst_change"},
-	{0x1825, "Object Transfer", "org.bluetooth.service.object_transfer"},
+	{0x1808, "Glucose", "org.bluetooth.service.glucose"},
+	{0x1809, "Health Thermometer", "org.bluetooth.service.health_thermometer"},
+	{0x180A, "Device Information", "org.bluetooth.service.device_information"},
+	{0x180D, "Heart Rate", "org.bluetooth.service.heart_rate"},
 	{0x180E, "Phone Alert Status Service", "org.bluetooth.service.phone_alert_status"},
-	{0x1822, "Pulse Oximeter", "org.bluetooth.service.pulse_oximeter"},
-	{0x1806, "Reference Time Update Service", "org.bluetooth.service.reference_time_update"},
-	{0x1814, "Running Speed and Cadence", "org.bluetooth.service.running_speed_and_cadence"},
+	{0x180F, "Battery Service", "org.bluetooth.service.battery_service"},
+	{0x1810, "Blood Pressure", "org.bluetooth.service.blood_pressure"},
+	{0x1811, "Alert Notification Service", "org.bluetooth.service.alert_notification"},
+	{0x1812, "Human Interface Device", "org.bluetooth.service.human_interface_device"},
 	{0x1813, "Scan Parameters", "org.bluetooth.service.scan_parameters"},
-	{0x1824, "Transport Discovery", "org.bluetooth.service.transport_discovery"},
-	{0x1804, "Tx Power", "org.bluetooth.service.tx_power"},
+	{0x1814, "Running Speed and Cadence", "org.bluetooth.service.running_speed_and_cadence"},
+	{0x1815, "Automation IO", "org.bluetooth.service.automation_io"},
+	{0x1816, "Cycling Speed and Cadence", "org.bluetooth.service.cycling_speed_and_cadence"},
+	{0x1818, "Cycling Power", "org.bluetooth.service.cycling_power"},
+	{0x1819, "Location and Navigation", "org.bluetooth.service.location_and_navigation"},
+	{0x181A, "Environmental Sensing", "org.bluetooth.service.environmental_sensing"},
+	{0x181B, "Body Composition", "org.bluetooth.service.body_composition"},
 	{0x181C, "User Data", "org.bluetooth.service.user_data"},
 	{0x181D, "Weight Scale", "org.bluetooth.service.weight_scale"},
+	{0x181E, "Bond Management", "org.bluetooth.service.bond_management"},
+	{0x181F, "Continuous Glucose Monitoring", "org.bluetooth.service.continuous_glucose_monitoring"},
+	{0x1820, "Internet Protocol Support", "org.bluetooth.service.internet_protocol_support"},
+	{0x1821, "Indoor Positioning", "org.bluetooth.service.indoor_positioning"},
+	{0x1822, "Pulse Oximeter", "org.bluetooth.service.pulse_oximeter"},
+	{0x1823, "HTTP Proxy", "org.bluetooth.service.http_proxy"},
+	{0x1824, "Transport Discovery", "org.bluetooth.service.transport_discovery"},
+	{0x1825, "Object Transfer", "org.bluetooth.service.object_transfer"},
+
+	/* Descriptors */
+	{0x2900, "Characteristic Extended Properties",
+		"org.bluetooth.descriptor.gatt.characteristic_extended_properties"},
+	{0x2901, "Characteristic User Description", "org.bluetooth.descriptor.gatt.characteristic_user_description"},
+	{0x2902, "Client Characteristic Configuration",
+		"org.bluetooth.descriptor.gatt.client_characteristic_configuration"},
+	{0x2903, "Server Characteristic Configuration",
+		"org.bluetooth.descriptor.gatt.server_characteristic_configuration"},
+	{0x2904, "Characteristic Presentation Format",
+		"org.bluetooth.descriptor.gatt.characteristic_presentation_format"},
+	{0x2905, "Characteristic Aggregate Format", "org.bluetooth.descriptor.gatt.characteristic_aggregate_format"},
+	{0x2906, "Valid Range", "org.bluetooth.descriptor.valid_range"},
+	{0x2907, "External Report Reference", "org.bluetooth.descriptor.external_report_reference"},
+	{0x2908, "Report Reference", "org.bluetooth.descriptor.report_reference"},
+	{0x2909, "Number of Digitals", "org.bluetooth.descriptor.number_of_digitals"},
+	{0x290A, "Value Trigger Setting", "org.bluetooth.descriptor.value_trigger_setting"},
+	{0x290B, "Environmental Sensing Configuration", "org.bluetooth.descriptor.es_configuration"},
+	{0x290C, "Environmental Sensing Measurement", "org.bluetooth.descriptor.es_measurement"},
+	{0x290D, "Environmental Sensing Trigger Setting", "org.bluetooth.descriptor.es_trigger_setting"},
+	{0x290E, "Time Trigger Setting", "org.bluetooth.descriptor.time_trigger_setting"},
 
 	/* Characteristics */
-	{0x2A7E, "Aerobic Heart Rate Lower Limit", "org.bluetooth.characteristic.aerobic_heart_rate_lower_limit"},
-	{0x2A84, "Aerobic Heart Rate Upper Limit", "org.bluetooth.characteristic.aerobic_heart_rate_upper_limit"},
-	{0x2A7F, "Aerobic Threshold", "org.bluetooth.characteristic.aerobic_threshold"},
-	{0x2A80, "Age", "org.bluetooth.characteristic.age"},
-	{0x2A5A, "Aggregate", "org.bluetooth.characteristic.aggregate"},
-	{0x2A43, "Alert Category ID", "org.bluetooth.characteristic.alert_category_id"},
-	{0x2A42, "Alert Category ID Bit Mask", "org.bluetooth.characteristic.alert_category_id_bit_mask"},
-	{0x2A06, "Alert Level", "org.bluetooth.characteristic.alert_level"},
-	{0x2A44, "Alert Notification Control Point", "org.bluetooth.characteristic.alert_notification_control_point"},
-	{0x2A3F, "Alert Status", "org.bluetooth.characteristic.alert_status"},
-	{0x2AB3, "Altitude", "org.bluetooth.characteristic.altitude"},
-	{0x2A81, "Anaerobic Heart Rate Lower Limit", "org.bluetooth.characteristic.anaerobic_heart_rate_lower_limit"},
-	{0x2A82, "Anaerobic Heart Rate Upper Limit", "org.bluetooth.characteristic.anaerobic_heart_rate_upper_limit"},
-	{0x2A83, "Anaerobic Threshold", "org.bluetooth.characteristic.anaerobic_threshold"},
-	{0x2A58, "Analog", "org.bluetooth.characteristic.analog"},
-	{0x2A73, "Apparent Wind Direction", "org.bluetooth.characteristic.apparent_wind_direction"},
-	{0x2A72, "Apparent Wind Speed", "org.bluetooth.characteristic.apparent_wind_speed"},
+	{0x2A00, "Device Name", "org.bluetooth.characteristic.gap.device_name"},
 	{0x2A01, "Appearance", "org.bluetooth.characteristic.gap.appearance"},
-	{0x2AA3, "Barometric Pressure Trend", "org.bluetooth.characteristic.barometric_pressure_trend"},
+	{0x2A02, "Peripheral Privacy Flag", "org.bluetooth.characteristic.gap.peripheral_privacy_flag"},
+	{0x2A03, "Reconnection Address", "org.bluetooth.characteristic.gap.reconnection_address"},
+	{0x2A04, "Peripheral Preferred Connection Parameters",
+		"org.bluetooth.characteristic.gap.peripheral_preferred_connection_parameters"},
+	{0x2A05, "Service Changed", "org.bluetooth.characteristic.gatt.service_changed"},
+	{0x2A06, "Alert Level", "org.bluetooth.characteristic.alert_level"},
+	{0x2A07, "Tx Power Level", "org.bluetooth.characteristic.tx_power_level"},
+	{0x2A08, "Date Time", "org.bluetooth.characteristic.date_time"},
+	{0x2A09, "Day of Week", "org.bluetooth.characteristic.day_of_week"},
+	{0x2A0A, "Day Date Time", "org.bluetooth.characteristic.day_date_time"},
+	{0x2A0C, "Exact Time 256", "org.bluetooth.characteristic.exact_time_256"},
+	{0x2A0D, "DST Offset", "org.bluetooth.characteristic.dst_offset"},
+	{0x2A0E, "Time Zone", "org.bluetooth.characteristic.time_zone"},
+	{0x2A0F, "Local Time Information", "org.bluetooth.characteristic.local_time_information"},
+	{0x2A11, "Time with DST", "org.bluetooth.characteristic.time_with_dst"},
+	{0x2A12, "Time Accuracy", "org.bluetooth.characteristic.time_accuracy"},
+	{0x2A13, "Time Source", "org.bluetooth.characteristic.time_source"},
+	{0x2A14, "Reference Time Information", "org.bluetooth.characteristic.reference_time_information"},
+	{0x2A16, "Time Update Control Point", "org.bluetooth.characteristic.time_update_control_point"},
+	{0x2A17, "Time Update State", "org.bluetooth.characteristic.time_update_state"},
+	{0x2A18, "Glucose Measurement", "org.bluetooth.characteristic.glucose_measurement"},
 	{0x2A19, "Battery Level", "org.bluetooth.characteristic.battery_level"},
-	{0x2A49, "Blood Pressure Feature", "org.bluetooth.characteristic.blood_pressure_feature"},
-	{0x2A35, "Blood Pressure Measurement", "org.bluetooth.characteristic.blood_pressure_measurement"},
-	{0x2A9B, "Body Composition Feature", "org.bluetooth.characteristic.body_composition_feature"},
-	{0x2A9C, "Body Composition Measurement", "org.bluetooth.characteristic.body_composition_measurement"},
-	{0x2A38, "Body Sensor Location", "org.bluetooth.characteristic.body_sensor_location"},
-	{0x2AA4, "Bond Management Control Point", "org.bluetooth.characteristic.bond_management_control_point"},
-	{0x2AA5, "Bond Management Feature", "org.bluetooth.characteristic.bond_management_feature"},
+	{0x2A1C, "Temperature Measurement", "org.bluetooth.characteristic.temperature_measurement"},
+	{0x2A1D, "Temperature Type", "org.bluetooth.characteristic.temperature_type"},
+	{0x2A1E, "Intermediate Temperature", "org.bluetooth.characteristic.intermediate_temperature"},
+	{0x2A21, "Measurement Interval", "org.bluetooth.characteristic.measurement_interval"},
 	{0x2A22, "Boot Keyboard Input Report", "org.bluetooth.characteristic.boot_keyboard_input_report"},
+	{0x2A23, "System ID", "org.bluetooth.characteristic.system_id"},
+	{0x2A24, "Model Number String", "org.bluetooth.characteristic.model_number_string"},
+	{0x2A25, "Serial Number String", "org.bluetooth.characteristic.serial_number_string"},
+	{0x2A26, "Firmware Revision String", "org.bluetooth.characteristic.firmware_revision_string"},
+	{0x2A27, "Hardware Revision String", "org.bluetooth.characteristic.hardware_revision_string"},
+	{0x2A28, "Software Revision String", "org.bluetooth.characteristic.software_revision_string"},
+	{0x2A29, "Manufacturer Name String", "org.bluetooth.characteristic.manufacturer_name_string"},
+	{0x2A2A, "IEEE 11073-20601 Regulatory Certification Data List",
+		"org.bluetooth.characteristic.ieee_11073-20601_regulatory_certification_data_list"},
+	{0x2A2B, "Current Time", "org.bluetooth.characteristic.current_time"},
+	{0x2A2C, "Magnetic Declination", "org.bluetooth.characteristic.magnetic_declination"},
+	{0x2A31, "Scan Refresh", "org.bluetooth.characteristic.scan_refresh"},
 	{0x2A32, "Boot Keyboard Output Report", "org.bluetooth.characteristic.boot_keyboard_output_report"},
 	{0x2A33, "Boot Mouse Input Report", "org.bluetooth.characteristic.boot_mouse_input_report"},
-	{0x2AA6, "Central Address Resolution", "org.bluetooth.characteristic.gap.central_address_resolution_support"},
-	{0x2AA8, "CGM Feature", "org.bluetooth.characteristic.cgm_feature"},
-	{0x2AA7, "CGM Measurement", "org.bluetooth.characteristic.cgm_measurement"},
-	{0x2AAB, "CGM Session Run Time", "org.bluetooth.characteristic.cgm_session_run_time"},
-	{0x2AAA, "CGM Session Start Time", "org.bluetooth.characteristic.cgm_session_start_time"},
-	{0x2AAC, "CGM Specific Ops Control Point", "org.bluetooth.characteristic.cgm_specific_ops_control_point"},
-	{0x2AA9, "CGM Status", "org.bluetooth.characteristic.cgm_status"},
-	{0x2A5C, "CSC Feature", "org.bluetooth.characteristic.csc_feature"},
+	{0x2A34, "Glucose Measurement Context", "org.bluetooth.characteristic.glucose_measurement_context"},
+	{0x2A35, "Blood Pressure Measurement", "org.bluetooth.characteristic.blood_pressure_measurement"},
+	{0x2A36, "Intermediate Cuff Pressure", "org.bluetooth.characteristic.intermediate_cuff_pressure"},
+	{0x2A37, "Heart Rate Measurement", "org.bluetooth.characteristic.heart_rate_measurement"},
+	{0x2A38, "Body Sensor Location", "org.bluetooth.characteristic.body_sensor_location"},
+	{0x2A39, "Heart Rate Control Point", "org.bluetooth.characteristic.heart_rate_control_point"},
+	{0x2A3F, "Alert Status", "org.bluetooth.characteristic.alert_status"},
+	{0x2A40, "Ringer Control Point", "org.bluetooth.characteristic.ringer_control_point"},
+	{0x2A41, "Ringer Setting", "org.bluetooth.characteristic.ringer_setting"},
+	{0x2A42, "Alert Category ID Bit Mask", "org.bluetooth.characteristic.alert_category_id_bit_mask"},
+	{0x2A43, "Alert Category ID", "org.bluetooth.characteristic.alert_category_id"},
+	{0x2A44, "Alert Notification Control Point", "org.bluetooth.characteristic.alert_notification_control_point"},
+	{0x2A45, "Unread Alert Status", "org.bluetooth.characteristic.unread_alert_status"},
+	{0x2A46, "New Alert", "org.bluetooth.characteristic.new_alert"},
+	{0x2A47, "Supported New Alert Category", "org.bluetooth.characteristic.supported_new_alert_category"},
+	{0x2A48, "Supported Unread Alert Category", "org.bluetooth.characteristic.supported_unread_alert_category"},
+	{0x2A49, "Blood Pressure Feature", "org.bluetooth.characteristic.blood_pressure_feature"},
+	{0x2A4A, "HID Information", "org.bluetooth.characteristic.hid_information"},
+	{0x2A4B, "Report Map", "org.bluetooth.characteristic.report_map"},
+	{0x2A4C, "HID Control Point", "org.bluetooth.characteristic.hid_control_point"},
+	{0x2A4D, "Report", "org.bluetooth.characteristic.report"},
+	{0x2A4E, "Protocol Mode", "org.bluetooth.characteristic.protocol_mode"},
+	{0x2A4F, "Scan Interval Window", "org.bluetooth.characteristic.scan_interval_window"},
+	{0x2A50, "PnP ID", "org.bluetooth.characteristic.pnp_id"},
+	{0x2A51, "Glucose Feature", "org.bluetooth.characteristic.glucose_feature"},
+	{0x2A52, "Record Access Control Point", "org.bluetooth.characteristic.record_access_control_point"},
+	{0x2A53, "RSC Measurement", "org.bluetooth.characteristic.rsc_measurement"},
+	{0x2A54, "RSC Feature", "org.bluetooth.characteristic.rsc_feature"},
+	{0x2A55, "SC Control Point", "org.bluetooth.characteristic.sc_control_point"},
+	{0x2A56, "Digital", "org.bluetooth.characteristic.digital"},
+	{0x2A58, "Analog", "org.bluetooth.characteristic.analog"},
+	{0x2A5A, "Aggregate", "org.bluetooth.characteristic.aggregate"},
 	{0x2A5B, "CSC Measurement", "org.bluetooth.characteristic.csc_measurement"},
-	{0x2A2B, "Current Time", "org.bluetooth.characteristic.current_time"},
-	{0x2A66, "Cycling Power Control Point", "org.bluetooth.characteristic.cycling_power_control_point"},
-	{0x2A65, "Cycling Power Feature", "org.bluetooth.characteristic.cycling_power_feature"},
+	{0x2A5C, "CSC Feature", "org.bluetooth.characteristic.csc_feature"},
+	{0x2A5D, "Sensor Location", "org.blueooth.characteristic.sensor_location"},
+	{0x2A5E, "PLX Spot-Check Measurement", "org.bluetooth.characteristic.plx_spot_check_measurement"},
+	{0x2A5F, "PLX Continuous Measurement", "org.bluetooth.characteristic.plx_continuous_measurement"},
+	{0x2A60, "PLX Features", "org.bluetooth.characteristic.plx_features"},
 	{0x2A63, "Cycling Power Measurement", "org.bluetooth.characteristic.cycling_power_measurement"},
 	{0x2A64, "Cycling Power Vector", "org.bluetooth.characteristic.cycling_power_vector"},
-	{0x2A99, "Database Change Increment", "org.bluetooth.characteristic.database_change_increment"},
+	{0x2A65, "Cycling Power Feature", "org.bluetooth.characteristic.cycling_power_feature"},
+	{0x2A66, "Cycling Power Control Point", "org.bluetooth.characteristic.cycling_power_control_point"},
+	{0x2A67, "Location and Speed", "org.bluetooth.characteristic.location_and_speed"},
+	{0x2A68, "Navigation", "org.bluetooth.characteristic.navigation"},
+	{0x2A69, "Position Quality", "org.bluetooth.characteristic.position_quality"},
+	{0x2A6A, "LN Feature", "org.bluetooth.characteristic.ln_feature"},
+	{0x2A6B, "LN Control Point", "org.bluetooth.characteristic.ln_control_point"},
+	{0x2A6C, "Elevation", "org.bluetooth.characteristic.elevation"},
+	{0x2A6D, "Pressure", "org.bluetooth.characteristic.pressure"},
+	{0x2A6E, "Temperature", "org.bluetooth.characteristic.temperature"},
+	{0x2A6F, "Humidity", "org.bluetooth.characteristic.humidity"},
+	{0x2A70, "True Wind Speed", "org.bluetooth.characteristic.true_wind_speed"},
+	{0x2A71, "True Wind Direction", "org.bluetooth.characteristic.true_wind_direction"},
+	{0x2A72, "Apparent Wind Speed", "org.bluetooth.characteristic.apparent_wind_speed"},
+	{0x2A73, "Apparent Wind Direction", "org.bluetooth.characteristic.apparent_wind_direction"},
+	{0x2A74, "Gust Factor", "org.bluetooth.characteristic.gust_factor"},
+	{0x2A75, "Pollen Concentration", "org.bluetooth.characteristic.pollen_concentration"},
+	{0x2A76, "UV Index", "org.bluetooth.characteristic.uv_index"},
+	{0x2A77, "Irradiance", "org.bluetooth.characteristic.irradiance"},
+	{0x2A78, "Rainfall", "org.bluetooth.characteristic.rainfall"},
+	{0x2A79, "Wind Chill", "org.bluetooth.characteristic.wind_chill "},
+	{0x2A7A, "Heat Index", "org.bluetooth.characteristic.heat_index"},
+	{0x2A7B, "Dew Point", "org.bluetooth.characteristic.dew_point"},
+	{0x2A7D, "Descriptor Value Changed", "org.bluetooth.characteristic.descriptor_value_changed"},
+	{0x2A7E, "Aerobic Heart Rate Lower Limit", "org.bluetooth.characteristic.aerobic_heart_rate_lower_limit"},
+	{0x2A7F, "Aerobic Threshold", "org.bluetooth.characteristic.aerobic_threshold"},
+	{0x2A80, "Age", "org.bluetooth.characteristic.age"},
+	{0x2A81, "Anaerobic Heart Rate Lower Limit", "org.bluetooth.characteristic.anaerobic_heart_rate_lower_limit"},
+	{0x2A82, "Anaerobic Heart Rate Upper Limit", "org.bluetooth.characteristic.anaerobic_heart_rate_upper_limit"},
+	{0x2A83, "Anaerobic Threshold", "org.bluetooth.characteristic.anaerobic_threshold"},
+	{0x2A84, "Aerobic Heart Rate Upper Limit", "org.bluetooth.characteristic.aerobic_heart_rate_upper_limit"},
 	{0x2A85, "Date of Birth", "org.bluetooth.characteristic.date_of_birth"},
 	{0x2A86, "Date of Threshold Assessment", "org.bluetooth.characteristic.date_of_threshold_assessment"},
-	{0x2A08, "Date Time", "org.bluetooth.characteristic.date_time"},
-	{0x2A0A, "Day Date Time", "org.bluetooth.characteristic.day_date_time"},
-	{0x2A09, "Day of Week", "org.bluetooth.characteristic.day_of_week"},
-	{0x2A7D, "Descriptor Value Changed", "org.bluetooth.characteristic.descriptor_value_changed"},
-	{0x2A00, "Device Name", "org.bluetooth.characteristic.gap.device_name"},
-	{0x2A7B, "Dew Point", "org.bluetooth.characteristic.dew_point"},
-	{0x2A56, "Digital", "org.bluetooth.characteristic.digital"},
-	{0x2A0D, "DST Offset", "org.bluetooth.characteristic.dst_offset"},
-	{0x2A6C, "Elevation", "org.bluetooth.characteristic.elevation"},
 	{0x2A87, "Email Address", "org.bluetooth.characteristic.email_address"},
-	{0x2A0C, "Exact Time 256", "org.bluetooth.characteristic.exact_time_256"},
 	{0x2A88, "Fat Burn Heart Rate Lower Limit", "org.bluetooth.characteristic.fat_burn_heart_rate_lower_limit"},
 	{0x2A89, "Fat Burn Heart Rate Upper Limit", "org.bluetooth.characteristic.fat_burn_heart_rate_upper_limit"},
-	{0x2A26, "Firmware Revision String", "org.bluetooth.characteristic.firmware_revision_string"},
 	{0x2A8A, "First Name", "org.bluetooth.characteristic.first_name"},
 	{0x2A8B, "Five Zone Heart Rate Limits", "org.bluetooth.characteristic.five_zone_heart_rate_limits"},
-	{0x2AB2, "Floor Number", "org.bluetooth.characteristic.floor_number"},
 	{0x2A8C, "Gender", "org.bluetooth.characteristic.gender"},
-	{0x2A51, "Glucose Feature", "org.bluetooth.characteristic.glucose_feature"},
-	{0x2A18, "Glucose Measurement", "org.bluetooth.characteristic.glucose_measurement"},
-	{0x2A34, "Glucose Measurement Context", "org.bluetooth.characteristic.glucose_measurement_context"},
-	{0x2A74, "Gust Factor", "org.bluetooth.characteristic.gust_factor"},
-	{0x2A27, "Hardware Revision String", "org.bluetooth.characteristic.hardware_revision_string"},
-	{0x2A39, "Heart Rate Control Point", "org.bluetooth.characteristic.heart_rate_control_point"},
 	{0x2A8D, "Heart Rate Max", "org.bluetooth.characteristic.heart_rate_max"},
-	{0x2A37, "Heart Rate Measurement", "org.bluetooth.characteristic.heart_rate_measurement"},
-	{0x2A7A, "Heat Index", "org.bluetooth.characteristic.heat_index"},
 	{0x2A8E, "Height", "org.bluetooth.characteristic.height"},
-	{0x2A4C, "HID Control Point", "org.bluetooth.characteristic.hid_control_point"},
-	{0x2A4A, "HID Information", "org.bluetooth.characteristic.hid_information"},
 	{0x2A8F, "Hip Circumference", "org.bluetooth.characteristic.hip_circumference"},
-	{0x2ABA, "HTTP Control Point", "org.bluetooth.characteristic.http_control_point"},
-	{0x2AB9, "HTTP Entity Body", "org.bluetooth.characteristic.http_entity_body"},
-	{0x2AB7, "HTTP Headers", "org.bluetooth.characteristic.http_headers"},
-	{0x2AB8, "HTTP Status Code", "org.bluetooth.characteristic.http_status_code"},
-	{0x2ABB, "HTTPS Security", "org.bluetooth.characteristic.https_security"},
-	{0x2A6F, "Humidity", "org.bluetooth.characteristic.humidity"},
-	{0x2A2A, "IEEE 11073-20601 Regulatory Certification Data List",
-		"org.bluetooth.characteristic.ieee_11073-20601_regulatory_certification_data_list"},
-	{0x2AAD, "Indoor Positioning Configuration", "org.bluetooth.characteristic.indoor_positioning_configuration"},
-	{0x2A36, "Intermediate Cuff Pressure", "org.bluetooth.characteristic.intermediate_cuff_pressure"},
-	{0x2A1E, "Intermediate Temperature", "org.bluetooth.characteristic.intermediate_temperature"},
-	{0x2A77, "Irradiance", "org.bluetooth.characteristic.irradiance"},
-	{0x2AA2, "Language", "org.bluetooth.characteristic.language"},
 	{0x2A90, "Last Name", "org.bluetooth.characteristic.last_name"},
-	{0x2AAE, "Latitude", "org.bluetooth.characteristic.latitude"},
-	{0x2A6B, "LN Control Point", "org.bluetooth.characteristic.ln_control_point"},
-	{0x2A6A, "LN Feature", "org.bluetooth.characteristic.ln_feature"},
-	{0x2AB1, "Local East Coordinate", "org.bluetooth.characteristic.local_east_coordinate"},
-	{0x2AB0, "Local North Coordinate", "org.bluetooth.characteristic.local_north_coordinate"},
-	{0x2A0F, "Local Time Information", "org.bluetooth.characteristic.local_time_information"},
-	{0x2A67, "Location and Speed", "org.bluetooth.characteristic.location_and_speed"},
-	{0x2AB5, "Location Name", "org.bluetooth.characteristic.location_name"},
-	{0x2AAF, "Longitude", "org.bluetooth.characteristic.longitude"},
-	{0x2A2C, "Magnetic Declination", "org.bluetooth.characteristic.magnetic_declination"},
-	{0x2AA0, "Magnetic Flux Density - 2D", "org.bluetooth.characteristic.magnetic_flux_density_2D"},
-	{0x2AA1, "Magnetic Flux Density - 3D", "org.bluetooth.characteristic.magnetic_flux_density_3D "},
-	{0x2A29, "Manufacturer Name String", "org.bluetooth.characteristic.manufacturer_name_string"},
 	{0x2A91, "Maximum Recommended Heart Rate", "org.bluetooth.characteristic.maximum_recommended_heart_rate"},
-	{0x2A21, "Measurement Interval", "org.bluetooth.characteristic.measurement_interval"},
-	{0x2A24, "Model Number String", "org.bluetooth.characteristic.model_number_string"},
-	{0x2A68, "Navigation", "org.bluetooth.characteristic.navigation"},
-	{0x2A46, "New Alert", "org.bluetooth.characteristic.new_alert"},
-	{0x2AC5, "Object Action Control Point", "org.bluetooth.characteristic.object_action_control_point"},
-	{0x2AC8, "Object Changed", "org.bluetooth.characteristic.object_changed "},
-	{0x2AC1, "Object First-Created", "org.bluetooth.characteristic.object_first_created"},
-	{0x2AC3, "Object ID", "org.bluetooth.characteristic.object_id"},
-	{0x2AC2, "Object Last-Modified", "org.bluetooth.characteristic.object_last_modified"},
-	{0x2AC6, "Object List Control Point", "org.bluetooth.characteristic.object_list_control_point"},
-	{0x2AC7, "Object List Filter", "org.bluetooth.characteristic.object_list_filter "},
-	{0x2ABE, "Object Name", "org.bluetooth.characteristic.object_name"},
-	{0x2AC4, "Object Properties", "org.bluetooth.characteristic.object_properties"},
-	{0x2AC0, "Object Size", "org.bluetooth.characteristic.object_size"},
-	{0x2ABF, "Object Type", "org.bluetooth.characteristic.object_type"},
-	{0x2ABD, "OTS Feature", "org.bluetooth.characteristic.ots_feature"},
-	{0x2A04, "Peripheral Preferred Connection Parameters",
-		"org.bluetooth.characteristic.gap.peripheral_preferred_connection_parameters"},
-	{0x2A02, "Peripheral Privacy Flag", "org.bluetooth.characteristic.gap.peripheral_privacy_flag"},
-	{0x2A5F, "PLX Continuous Measurement", "org.bluetooth.characteristic.plx_continuous_measurement"},
-	{0x2A60, "PLX Features", "org.bluetooth.characteristic.plx_features"},
-	{0x2A5E, "PLX Spot-Check Measurement", "org.bluetooth.characteristic.plx_spot_check_measurement"},
-	{0x2A50, "PnP ID", "org.bluetooth.characteristic.pnp_id"},
-	{0x2A75, "Pollen Concentration", "org.bluetooth.characteristic.pollen_concentration"},
-	{0x2A69, "Position Quality", "org.bluetooth.characteristic.position_quality"},
-	{0x2A6D, "Pressure", "org.bluetooth.characteristic.pressure"},
-	{0x2A4E, "Protocol Mode", "org.bluetooth.characteristic.protocol_mode"},
-	{0x2A78, "Rainfall", "org.bluetooth.characteristic.rainfall"},
-	{0x2A03, "Reconnection Address", "org.bluetooth.characteristic.gap.reconnection_address"},
-	{0x2A52, "Record Access Control Point", "org.bluetooth.characteristic.record_access_control_point"},
-	{0x2A14, "Reference Time Information", "org.bluetooth.characteristic.reference_time_information"},
-	{0x2A4D, "Report", "org.bluetooth.characteristic.report"},
-	{0x2A4B, "Report Map", "org.bluetooth.characteristic.report_map"},
 	{0x2A92, "Resting Heart Rate", "org.bluetooth.characteristic.resting_heart_rate"},
-	{0x2A40, "Ringer Control Point", "org.bluetooth.characteristic.ringer_control_point"},
-	{0x2A41, "Ringer Setting", "org.bluetooth.characteristic.ringer_setting"},
-	{0x2A54, "RSC Feature", "org.bluetooth.characteristic.rsc_feature"},
-	{0x2A53, "RSC Measurement", "org.bluetooth.characteristic.rsc_measurement"},
-	{0x2A55, "SC Control Point", "org.bluetooth.characteristic.sc_control_point"},
-	{0x2A4F, "Scan Interval Window", "org.bluetooth.characteristic.scan_interval_window"},
-	{0x2A31, "Scan Refresh", "org.bluetooth.characteristic.scan_refresh"},
-	{0x2A5D, "Sensor Location", "org.blueooth.characteristic.sensor_location"},
-	{0x2A25, "Serial Number String", "org.bluetooth.characteristic.serial_number_string"},
-	{0x2A05, "Service Changed", "org.bluetooth.characteristic.gatt.service_changed"},
-	{0x2A28, "Software Revision String", "org.bluetooth.characteristic.software_revision_string"},
 	{0x2A93, "Sport Type for Aerobic and Anaerobic Thresholds",
 		"org.bluetooth.characteristic.sport_type_for_aerobic_and_anaerobic_thresholds"},
-	{0x2A47, "Supported New Alert Category", "org.bluetooth.characteristic.supported_new_alert_category"},
-	{0x2A48, "Supported Unread Alert Category", "org.bluetooth.characteristic.supported_unread_alert_category"},
-	{0x2A23, "System ID", "org.bluetooth.characteristic.system_id"},
-	{0x2ABC, "TDS Control Point", "org.bluetooth.characteristic.tds_control_point"},
-	{0x2A6E, "Temperature", "org.bluetooth.characteristic.temperature"},
-	{0x2A1C, "Temperature Measurement", "org.bluetooth.characteristic.temperature_measurement"},
-	{0x2A1D, "Temperature Type", "org.bluetooth.characteristic.temperature_type"},
 	{0x2A94, "Three Zone Heart Rate Limits", "org.bluetooth.characteristic.three_zone_heart_rate_limits "},
-	{0x2A12, "Time Accuracy", "org.bluetooth.characteristic.time_accuracy"},
-	{0x2A13, "Time Source", "org.bluetooth.characteristic.time_source"},
-	{0x2A16, "Time Update Control Point", "org.bluetooth.characteristic.time_update_control_point"},
-	{0x2A17, "Time Update State", "org.bluetooth.characteristic.time_update_state"},
-	{0x2A11, "Time with DST", "org.bluetooth.characteristic.time_with_dst"},
-	{0x2A0E, "Time Zone", "org.bluetooth.characteristic.time_zone"},
-	{0x2A71, "True Wind Direction", "org.bluetooth.characteristic.true_wind_direction"},
-	{0x2A70, "True Wind Speed", "org.bluetooth.characteristic.true_wind_speed"},
 	{0x2A95, "Two Zone Heart Rate Limit", "org.bluetooth.characteristic.two_zone_heart_rate_limit "},
-	{0x2A07, "Tx Power Level", "org.bluetooth.characteristic.tx_power_level"},
-	{0x2AB4, "Uncertainty", "org.bluetooth.characteristic.uncertainty"},
-	{0x2A45, "Unread Alert Status", "org.bluetooth.characteristic.unread_alert_status"},
-	{0x2AB6, "URI", "org.bluetooth.characteristic.uri"},
-	{0x2A9F, "User Control Point", "org.bluetooth.characteristic.user_control_point"},
-	{0x2A9A, "User Index", "org.bluetooth.characteristic.user_index "},
-	{0x2A76, "UV Index", "org.bluetooth.characteristic.uv_index"},
 	{0x2A96, "VO2 Max", "org.bluetooth.characteristic.vo2_max"},
 	{0x2A97, "Waist Circumference", "org.bluetooth.characteristic.waist_circumference"},
 	{0x2A98, "Weight", "org.bluetooth.characteristic.weight"},
+	{0x2A99, "Database Change Increment", "org.bluetooth.characteristic.database_change_increment"},
+	{0x2A9A, "User Index", "org.bluetooth.characteristic.user_index "},
+	{0x2A9B, "Body Composition Feature", "org.bluetooth.characteristic.body_composition_feature"},
+	{0x2A9C, "Body Composition Measurement", "org.bluetooth.characteristic.body_composition_measurement"},
 	{0x2A9D, "Weight Measurement", "org.bluetooth.characteristic.weight_measurement"},
 	{0x2A9E, "Weight Scale Feature", "org.bluetooth.characteristic.weight_scale_feature"},
-	{0x2A79, "Wind Chill", "org.bluetooth.characteristic.wind_chill "},
-
-	/* Descriptors */
-	{0x2900, "Characteristic Extended Properties",
-		"org.bluetooth.descriptor.gatt.characteristic_extended_properties"},
-	{0x2901, "Characteristic User Description", "org.bluetooth.descriptor.gatt.characteristic_user_description"},
-	{0x2902, "Client Characteristic Configuration",
-		"org.bluetooth.descriptor.gatt.client_characteristic_configuration"},
-	{0x2903, "Server Characteristic Configuration",
-		"org.bluetooth.descriptor.gatt.server_characteristic_configuration"},
-	{0x2904, "Characteristic Presentation Format",
-		"org.bluetooth.descriptor.gatt.characteristic_presentation_format"},
-	{0x2905, "Characteristic Aggregate Format", "org.bluetooth.descriptor.gatt.characteristic_aggregate_format"},
-	{0x2906, "Valid Range", "org.bluetooth.descriptor.valid_range"},
-	{0x2907, "External Report Reference", "org.bluetooth.descriptor.external_report_reference"},
-	{0x2908, "Report Reference", "org.bluetooth.descriptor.report_reference"},
-	{0x2909, "Number of Digitals", "org.bluetooth.descriptor.number_of_digitals"},
-	{0x290A, "Value Trigger Setting", "org.bluetooth.descriptor.value_trigger_setting"},
-	{0x290B, "Environmental Sensing Configuration", "org.bluetooth.descriptor.es_configuration"},
-	{0x290C, "Environmental Sensing Measurement", "org.bluetooth.descriptor.es_measurement"},
-	{0x290D, "Environmental Sensing Trigger Setting", "org.bluetooth.descriptor.es_trigger_setting"},
-	{0x290E, "Time Trigger Setting", "org.bluetooth.descriptor.time_trigger_setting"},
+	{0x2A9F, "User Control Point", "org.bluetooth.characteristic.user_control_point"},
+	{0x2AA0, "Magnetic Flux Density - 2D", "org.bluetooth.characteristic.magnetic_flux_density_2D"},
+	{0x2AA1, "Magnetic Flux Density - 3D", "org.bluetooth.characteristic.magnetic_flux_density_3D "},
+	{0x2AA2, "Language", "org.bluetooth.characteristic.language"},
+	{0x2AA3, "Barometric Pressure Trend", "org.bluetooth.characteristic.barometric_pressure_trend"},
+	{0x2AA4, "Bond Management Control Point", "org.bluetooth.characteristic.bond_management_control_point"},
+	{0x2AA5, "Bond Management Feature", "org.bluetooth.characteristic.bond_management_feature"},
+	{0x2AA6, "Central Address Resolution", "org.bluetooth.characteristic.gap.central_address_resolution_support"},
+	{0x2AA7, "CGM Measurement", "org.bluetooth.characteristic.cgm_measurement"},
+	{0x2AA8, "CGM Feature", "org.bluetooth.characteristic.cgm_feature"},
+	{0x2AA9, "CGM Status", "org.bluetooth.characteristic.cgm_status"},
+	{0x2AAA, "CGM Session Start Time", "org.bluetooth.characteristic.cgm_session_start_time"},
+	{0x2AAB, "CGM Session Run Time", "org.bluetooth.characteristic.cgm_session_run_time"},
+	{0x2AAC, "CGM Specific Ops Control Point", "org.bluetooth.characteristic.cgm_specific_ops_control_point"},
+	{0x2AAD, "Indoor Positioning Configuration", "org.bluetooth.characteristic.indoor_positioning_configuration"},
+	{0x2AAE, "Latitude", "org.bluetooth.characteristic.latitude"},
+	{0x2AAF, "Longitude", "org.bluetooth.characteristic.longitude"},
+	{0x2AB0, "Local North Coordinate", "org.bluetooth.characteristic.local_north_coordinate"},
+	{0x2AB1, "Local East Coordinate", "org.bluetooth.characteristic.local_east_coordinate"},
+	{0x2AB2, "Floor Number", "org.bluetooth.characteristic.floor_number"},
+	{0x2AB3, "Altitude", "org.bluetooth.characteristic.altitude"},
+	{0x2AB4, "Uncertainty", "org.bluetooth.characteristic.uncertainty"},
+	{0x2AB5, "Location Name", "org.bluetooth.characteristic.location_name"},
+	{0x2AB6, "URI", "org.bluetooth.characteristic.uri"},
+	{0x2AB7, "HTTP Headers", "org.bluetooth.characteristic.http_headers"},
+	{0x2AB8, "HTTP Status Code", "org.bluetooth.characteristic.http_status_code"},
+	{0x2AB9, "HTTP Entity Body", "org.bluetooth.characteristic.http_entity_body"},
+	{0x2ABA, "HTTP Control Point", "org.bluetooth.characteristic.http_control_point"},
+	{0x2ABB, "HTTPS Security", "org.bluetooth.characteristic.https_security"},
+	{0x2ABC, "TDS Control Point", "org.bluetooth.characteristic.tds_control_point"},
+	{0x2ABD, "OTS Feature", "org.bluetooth.characteristic.ots_feature"},
+	{0x2ABE, "Object Name", "org.bluetooth.characteristic.object_name"},
+	{0x2ABF, "Object Type", "org.bluetooth.characteristic.object_type"},
+	{0x2AC0, "Object Size", "org.bluetooth.characteristic.object_size"},
+	{0x2AC1, "Object First-Created", "org.bluetooth.characteristic.object_first_created"},
+	{0x2AC2, "Object Last-Modified", "org.bluetooth.characteristic.object_last_modified"},
+	{0x2AC3, "Object ID", "org.bluetooth.characteristic.object_id"},
+	{0x2AC4, "Object Properties", "org.bluetooth.characteristic.object_properties"},
+	{0x2AC5, "Object Action Control Point", "org.bluetooth.characteristic.object_action_control_point"},
+	{0x2AC6, "Object List Control Point", "org.bluetooth.characteristic.object_list_control_point"},
+	{0x2AC7, "Object List Filter", "org.bluetooth.characteristic.object_list_filter "},
+	{0x2AC8, "Object Changed", "org.bluetooth.characteristic.object_changed "},
 	{ 0 },
 };
 
@@ -2771,33 +2772,118 @@ const char *_get_company_name(const int id)
 {
 	if (id == 65535)
 		return "internal use";
-	else if (id > 1190)
+	else if (id < 0 || id >= (int)G_N_ELEMENTS(bt_company_names))
 		return "not assigned";
 	else
 		return bt_company_names[id];
 }
 
-const char *_get_uuid_name(const char *uuid)
+/* 16 and 32-bit UUIDs stand for this base with the first bytes replaced */
+static const uint8_t bt_base_uuid[16] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+	0x80, 0x00, 0x00, 0x80, 0x5f, 0x9b, 0x34, 0xfb
+};
+
+/* Value of each hexadecimal digit plus one, 0 for other characters */
+static const uint8_t hex_values[256] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+	['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static int _parse_hex(const char *str, uint8_t *bytes, int len)
 {
-	uint32_t uuid32;
-	int i;
+	int i, hi, lo;
 
-	if (!uuid || strlen(uuid) != 36)
-		return NULL;
+	for (i = 0; i < len; i++) {
+		hi = hex_values[(uint8_t)str[2 * i]];
+		if (!hi)
+			return -1;
+		lo = hex_values[(uint8_t)str[2 * i + 1]];
+		if (!lo)
+			return -1;
+		bytes[i] = (hi - 1) << 4 | (lo - 1);
+	}
 
-	if (g_strcmp0(uuid + 8, "-0000-1000-8000-00805f9b34fb"))
-		return "Vendor specific";
+	return 0;
+}
 
-	if (sscanf(uuid, "%08x-0000-1000-8000-00805f9b34fb", &uuid32) != 1)
-		return NULL;
+int _uuid_parse(const char *str, uint8_t uuid[16])
+{
+	size_t len;
 
-	if ((uuid32 & 0xffff0000) != 0x0000)
-		return "Unknown";
+	if (!str)
+		return -1;
+
+	len = strnlen(str, UUID_STR_LEN + 1);
+	switch (len) {
+	case 4:
+	case 8:
+		memcpy(uuid, bt_base_uuid, 16);
+		return _parse_hex(str, uuid + 4 - len / 2, len / 2);
+	case UUID_STR_LEN:
+		if (str[8] != '-' || str[13] != '-' || str[18] != '-' ||
+				str[23] != '-')
+			return -1;
+		if (_parse_hex(str, uuid, 4) < 0 ||
+				_parse_hex(str + 9, uuid + 4, 2) < 0 ||
+				_parse_hex(str + 14, uuid + 6, 2) < 0 ||
+				_parse_hex(str + 19, uuid + 8, 2) < 0 ||
+				_parse_hex(str + 24, uuid + 10, 6) < 0)
+			return -1;
+		return 0;
+	default:
+		return -1;
+	}
+}
 
-	for (i = 0; bt_uuids[i].uuid; i++) {
-		if (bt_uuids[i].uuid == (uuid32 & 0x0000ffff))
-			return bt_uuids[i].name;
+void _uuid_format(const uint8_t uuid[16], char *str)
+{
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		if (i == 4 || i == 6 || i == 8 || i == 10)
+			*str++ = '-';
+		*str++ = hex_digits[uuid[i] >> 4];
+		*str++ = hex_digits[uuid[i] & 0x0f];
 	}
+	*str = '\0';
+}
+
+static const char *_get_uuid16_name(uint16_t uuid)
+{
+	/* The last entry only terminates the table */
+	unsigned int low = 0, high = G_N_ELEMENTS(bt_uuids) - 1, mid;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (bt_uuids[mid].uuid < uuid)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low < G_N_ELEMENTS(bt_uuids) - 1 && bt_uuids[low].uuid == uuid)
+		return bt_uuids[low].name;
 
 	return "Unknown";
 }
+
+const char *_get_uuid_name(const char *uuid)
+{
+	uint8_t bytes[16];
+
+	if (_uuid_parse(uuid, bytes) < 0)
+		return NULL;
+
+	if (memcmp(bytes + 4, bt_base_uuid + 4, 12))
+		return "Vendor specific";
+
+	if (bytes[0] || bytes[1])
+		return "Unknown";
+
+	return _get_uuid16_name(bytes[2] << 8 | bytes[3]);
+}
@@ -19,16 +19,28 @@
 #ifndef __ARTIK_BT_ASSIGNED_NUMBERS_H
 #define __ARTIK_BT_ASSIGNED_NUMBERS_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define UUID_BODY_SENSOR_LOCATION "00002a38-0000-1000-8000-00805f9b34fb"
 #define UUID_HEART_RATE_MEASUREMENT "00002a37-0000-1000-8000-00805f9b34fb"
+#define UUID_STR_LEN 36
 
 const char *_get_company_name(const int id);
 const char *_get_uuid_name(const char *uuid);
 
+/*
+ * Parses a 16, 32 or 128-bit UUID string, in either case, to its 16 bytes.
+ * Returns -1 if 'str' is not a UUID.
+ */
+int _uuid_parse(const char *str, uint8_t uuid[16]);
+
+/* Writes the UUID_STR_LEN lowercase characters of 'uuid' and a NUL */
+void _uuid_format(const uint8_t uuid[16], char *str);
+
 #ifdef __cplusplus
 }
 #endif
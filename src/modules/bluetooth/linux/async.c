@@ -0,0 +1,227 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+#include <string.h>
+
+#include "core.h"
+#include "async.h"
+
+static const struct {
+	const char *name;
+	artik_error err;
+} bluez_errors[] = {
+	{ "org.bluez.Error.NotConnected", E_NOT_CONNECTED },
+	{ "org.bluez.Error.NotSupported", E_NOT_SUPPORTED },
+	{ "org.bluez.Error.NotPermitted", E_ACCESS_DENIED },
+	{ "org.bluez.Error.NotAuthorized", E_ACCESS_DENIED },
+	{ "org.bluez.Error.InProgress", E_IN_PROGRESS },
+	{ "org.bluez.Error.InvalidArguments", E_BAD_ARGS },
+	{ "org.bluez.Error.InvalidValueLength", E_BAD_ARGS },
+	{ "org.freedesktop.DBus.Error.NoReply", E_TIMEOUT },
+};
+
+artik_error _async_error(GError *error)
+{
+	artik_error err = E_BT_ERROR;
+	gchar *name;
+	guint i;
+
+	if (error == NULL)
+		return S_OK;
+
+	if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT))
+		return E_TIMEOUT;
+
+	if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		return E_INTERRUPTED;
+
+	name = g_dbus_error_get_remote_error(error);
+	for (i = 0; name && i < G_N_ELEMENTS(bluez_errors); i++) {
+		if (!g_strcmp0(name, bluez_errors[i].name)) {
+			err = bluez_errors[i].err;
+			break;
+		}
+	}
+	g_free(name);
+
+	return err;
+}
+
+bt_async_call *_async_call_new(const gchar *path, const gchar *interface,
+		const gchar *method, GVariant *parameters, bt_async_reply reply,
+		artik_bt_async_callback callback, void *user_data)
+{
+	bt_async_call *call = g_new0(bt_async_call, 1);
+
+	call->conn = g_object_ref(hci.conn);
+	call->path = g_strdup(path);
+	call->interface = interface;
+	call->callback = callback;
+	call->user_data = user_data;
+	_async_call_set_method(call, method, parameters, reply);
+
+	return call;
+}
+
+void _async_call_set_method(bt_async_call *call, const gchar *method,
+		GVariant *parameters, bt_async_reply reply)
+{
+	if (call->parameters)
+		g_variant_unref(call->parameters);
+
+	call->method = method;
+	call->parameters = parameters ? g_variant_ref_sink(parameters) : NULL;
+	call->reply = reply;
+}
+
+static void _async_call_free(bt_async_call *call)
+{
+	if (call->parameters)
+		g_variant_unref(call->parameters);
+	if (call->data_free)
+		call->data_free(call->data);
+	g_object_unref(call->conn);
+	g_free(call->path);
+	g_free(call);
+}
+
+static void _async_send(bt_async_call *call);
+
+static void _async_pump(void)
+{
+	bt_async_call *call;
+
+	while (hci.async_calls && hci.async_in_flight < BT_ASYNC_MAX_IN_FLIGHT) {
+		call = g_queue_pop_head(hci.async_calls);
+		if (call == NULL)
+			break;
+		_async_send(call);
+	}
+}
+
+static void _async_call_reply(GObject *source, GAsyncResult *res,
+		gpointer user_data)
+{
+	bt_async_call *call = (bt_async_call *)user_data;
+	GUnixFDList *fd_list = NULL;
+	GError *e = NULL;
+	GVariant *r;
+
+	r = g_dbus_connection_call_with_unix_fd_list_finish(
+			G_DBUS_CONNECTION(source), &fd_list, res, &e);
+	hci.async_in_flight--;
+
+	if (e != NULL)
+		log_dbg("%s %s: %s", call->method, call->path, e->message);
+
+	/* The call is freed or sent again from here */
+	call->reply(call, r, fd_list, e);
+
+	if (r)
+		g_variant_unref(r);
+	if (fd_list)
+		g_object_unref(fd_list);
+	if (e)
+		g_error_free(e);
+
+	_async_pump();
+}
+
+static void _async_send(bt_async_call *call)
+{
+	if (hci.async_cancellable == NULL)
+		hci.async_cancellable = g_cancellable_new();
+
+	log_dbg("%s [%s]", call->method, call->path);
+
+	hci.async_in_flight++;
+	g_dbus_connection_call_with_unix_fd_list(
+			call->conn,
+			DBUS_BLUEZ_BUS,
+			call->path,
+			call->interface,
+			call->method,
+			call->parameters,
+			NULL, G_DBUS_CALL_FLAGS_NONE,
+			hci.async_timeout ? hci.async_timeout :
+				BT_ASYNC_DEFAULT_TIMEOUT,
+			NULL, hci.async_cancellable, _async_call_reply, call);
+}
+
+void _async_call_submit(bt_async_call *call)
+{
+	if (hci.async_in_flight < BT_ASYNC_MAX_IN_FLIGHT) {
+		_async_send(call);
+		return;
+	}
+
+	if (hci.async_calls == NULL)
+		hci.async_calls = g_queue_new();
+	g_queue_push_tail(hci.async_calls, call);
+}
+
+void _async_call_done(bt_async_call *call, artik_error result,
+		const unsigned char *bytes, int len)
+{
+	call->callback(result, bytes, len, call->user_data);
+	_async_call_free(call);
+}
+
+static gboolean _async_call_idle(gpointer user_data)
+{
+	bt_async_call *call = (bt_async_call *)user_data;
+
+	_async_call_done(call, call->result, NULL, 0);
+
+	return G_SOURCE_REMOVE;
+}
+
+void _async_call_done_later(bt_async_call *call, artik_error result)
+{
+	/* Never call back from within the function starting the operation */
+	call->result = result;
+	g_idle_add(_async_call_idle, call);
+}
+
+void _async_cancel_all(void)
+{
+	GQueue *calls = hci.async_calls;
+	bt_async_call *call;
+
+	/* Calls in flight complete with E_INTERRUPTED from their reply */
+	if (hci.async_cancellable) {
+		g_cancellable_cancel(hci.async_cancellable);
+		g_object_unref(hci.async_cancellable);
+		hci.async_cancellable = NULL;
+	}
+
+	hci.async_calls = NULL;
+	if (calls == NULL)
+		return;
+
+	while ((call = g_queue_pop_head(calls)) != NULL)
+		_async_call_done(call, E_INTERRUPTED, NULL, 0);
+	g_queue_free(calls);
+}
+
+artik_error bt_set_async_timeout(unsigned int timeout_ms)
+{
+	hci.async_timeout = MIN(timeout_ms, G_MAXINT);
+
+	return S_OK;
+}
@@ -0,0 +1,87 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef __ARTIK_BT_ASYNC_H
+#define __ARTIK_BT_ASYNC_H
+
+#include <artik_bluetooth.h>
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include <gio/gio.h>
+#pragma GCC diagnostic pop
+#include <gio-unix-2.0/gio/gunixfdlist.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BT_ASYNC_DEFAULT_TIMEOUT	10000
+/* BlueZ calls sent at once, further calls wait in a queue */
+#define BT_ASYNC_MAX_IN_FLIGHT		64
+
+typedef struct bt_async_call bt_async_call;
+
+/*
+ * Handles the reply of a call. It either completes the call with
+ * _async_call_done() or sends a follow-up with _async_call_submit().
+ * 'error' is NULL on success, it is freed by the caller.
+ */
+typedef void (*bt_async_reply)(bt_async_call *call, GVariant *reply,
+		GUnixFDList *fd_list, GError *error);
+
+struct bt_async_call {
+	GDBusConnection *conn;
+	gchar *path;
+	const gchar *interface;
+	const gchar *method;
+	GVariant *parameters;
+	bt_async_reply reply;
+	artik_bt_async_callback callback;
+	void *user_data;
+	/* Result reported by _async_call_done_later() */
+	artik_error result;
+	/* Operation specific state, freed with the call */
+	gpointer data;
+	GDestroyNotify data_free;
+};
+
+bt_async_call *_async_call_new(const gchar *path, const gchar *interface,
+		const gchar *method, GVariant *parameters, bt_async_reply reply,
+		artik_bt_async_callback callback, void *user_data);
+
+void _async_call_set_method(bt_async_call *call, const gchar *method,
+		GVariant *parameters, bt_async_reply reply);
+
+void _async_call_submit(bt_async_call *call);
+
+void _async_call_done(bt_async_call *call, artik_error result,
+		const unsigned char *bytes, int len);
+
+void _async_call_done_later(bt_async_call *call, artik_error result);
+
+artik_error _async_error(GError *error);
+
+void _async_cancel_all(void);
+
+artik_error bt_set_async_timeout(unsigned int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ARTIK_BT_ASYNC_H */
@@ -22,6 +22,7 @@
 #include "assigned_numbers.h"
 #include "helper.h"
 #include "device.h"
+#include "async.h"
 #include <inttypes.h>
 
 bt_handler hci = {0};
@@ -43,68 +44,41 @@ void _set_device_class(artik_bt_class *class, uint32_t cod)
 		class->service_class |= BT_SERVICE_CLASS_LIMITED_DISCOVERABLE_MODE;
 }
 
-static void _on_gatt_data_received(GVariant *properties, gchar *srv_uuid, gchar *char_uuid)
+static void _on_gatt_data_received(const guchar *bytes, gsize len,
+		gchar *srv_uuid, gchar *char_uuid)
 {
-	GVariant *prop = NULL, *v = NULL, *v1 = NULL;
-	gchar *key = NULL;
-	guint i = 0, len = 0;
 	artik_bt_gatt_data data;
 
 	log_dbg("%s [%s]", __func__, char_uuid);
 
 	memset(&data, 0x00, sizeof(artik_bt_gatt_data));
 
-	prop = g_variant_get_child_value(properties, 0);
-	g_variant_get(prop, "{&sv}", &key, &v);
-	if (g_strcmp0(key, "Value") != 0)
-		return;
-
-	len = g_variant_n_children(v);
-
+	/* The bytes are only borrowed for the callback duration */
 	data.srv_uuid = srv_uuid;
 	data.char_uuid = char_uuid;
+	data.bytes = (unsigned char *)bytes;
 	data.length = len;
-	data.bytes = (unsigned char *)malloc(sizeof(unsigned char) * len);
-
-	for (i = 0; i < len; i++) {
-		v1 = g_variant_get_child_value(v, i);
-		data.bytes[i] = g_variant_get_byte(v1);
-	}
 
 	_user_callback(BT_EVENT_PF_CUSTOM, &data);
-
-	g_variant_unref(prop);
-	g_variant_unref(v);
-	g_variant_unref(v1);
-	g_free(data.bytes);
 }
 
-static void _on_hrp_measurement_received(GVariant *properties)
+static void _on_hrp_measurement_received(const guchar *bytes, gsize len,
+		gchar *srv_uuid, gchar *char_uuid)
 {
-	GVariant *prop, *val, *v0, *v1, *v2, *v3;
-	gchar *key;
 	guchar flags = 0, hr = 0, ee = 0, ee_val = 0, format = 0,
 			sc_status = 0, ee_status = 0;
 	artik_bt_hrp_data data;
 
 	memset(&data, 0x00, sizeof(artik_bt_hrp_data));
 
-	prop = g_variant_get_child_value(properties, 0);
-	g_variant_get(prop, "{&sv}", &key, &val);
-	if (g_strcmp0(key, "Value") != 0)
-		return;
-
-	if (g_variant_n_children(val) < 3)
+	if (len < 3)
 		return;
-	v0 = g_variant_get_child_value(val, 0);
-	v1 = g_variant_get_child_value(val, 1);
-	v2 = g_variant_get_child_value(val, 2);
-	v3 = g_variant_get_child_value(val, 3);
 
-	g_variant_get(v0, "y", &flags);
-	g_variant_get(v1, "y", &hr);
-	g_variant_get(v2, "y", &ee);
-	g_variant_get(v3, "y", &ee_val);
+	flags = bytes[0];
+	hr = bytes[1];
+	ee = bytes[2];
+	if (len > 3)
+		ee_val = bytes[3];
 
 	format = flags & 0x01;
 	sc_status = (flags >> 1) & 0x03;
@@ -129,13 +103,14 @@ static void _on_hrp_measurement_received(GVariant *properties)
 		data.contact = false;
 
 	_user_callback(BT_EVENT_PF_HEARTRATE, &data);
+}
+
+gatt_notify_callback _get_gatt_notify_callback(const char *char_uuid)
+{
+	if (g_ascii_strcasecmp(char_uuid, UUID_HEART_RATE_MEASUREMENT) == 0)
+		return _on_hrp_measurement_received;
 
-	g_variant_unref(prop);
-	g_variant_unref(val);
-	g_variant_unref(v0);
-	g_variant_unref(v1);
-	g_variant_unref(v2);
-	g_variant_unref(v3);
+	return _on_gatt_data_received;
 }
 
 artik_error bt_init(GBusType dbus_type, GDBusConnection **connection)
@@ -195,10 +170,31 @@ artik_error bt_deinit(void)
 		GPOINTER_TO_INT(g_hash_table_lookup(hci.subscribe_ids,
 			"InterfacesAdded")));
 
+	g_dbus_connection_signal_unsubscribe(hci.conn,
+		GPOINTER_TO_INT(g_hash_table_lookup(hci.subscribe_ids,
+			"InterfacesRemoved")));
+
 	g_dbus_connection_signal_unsubscribe(hci.conn,
 		GPOINTER_TO_INT(g_hash_table_lookup(hci.subscribe_ids,
 			"PropertiesChanged")));
 
+	_async_cancel_all();
+	_scan_free();
+
+	/* The acquired write links are only valid for this connection */
+	if (hci.gatt_writers != NULL) {
+		g_hash_table_destroy(hci.gatt_writers);
+		hci.gatt_writers = NULL;
+	}
+
+	/* Without the signals the object cache can no longer be kept current */
+	if (hci.objects != NULL) {
+		g_hash_table_destroy(hci.object_index);
+		g_hash_table_destroy(hci.objects);
+		hci.object_index = NULL;
+		hci.objects = NULL;
+	}
+
 	return S_OK;
 }
 
@@ -215,6 +211,9 @@ void _user_callback(artik_bt_event event, void *data)
 	case BT_EVENT_SCAN:
 		user_data = (artik_bt_device *)data;
 		break;
+	case BT_EVENT_SCAN_REPORT:
+		user_data = (artik_bt_scan_report *)data;
+		break;
 	case BT_EVENT_BOND:
 	case BT_EVENT_CONNECT:
 		user_data = (gboolean *)data;
@@ -496,43 +495,239 @@ artik_error _get_managed_objects(GVariant **variant)
 	return bt_check_error(e);
 }
 
-void _get_object_path(const char *addr, char **path)
+/*
+ * Object path cache of the BlueZ tree. Devices are indexed by address and
+ * GATT objects by their parent object path and UUID, so resolving an
+ * (address, service, characteristic) triple is a chain of hash lookups
+ * instead of a GetManagedObjects round trip per level. The cache is loaded
+ * from GetManagedObjects on first use or on a miss, and kept current from
+ * the InterfacesAdded and InterfacesRemoved signals.
+ */
+typedef struct {
+	const gchar *interface;
+	const gchar *parent;
+} bt_object_type;
+
+static const bt_object_type object_types[] = {
+	{ DBUS_IF_DEVICE1, NULL },
+	{ DBUS_IF_GATTSERVICE1, "Device" },
+	{ DBUS_IF_GATTCHARACTERISTIC1, "Service" },
+	{ DBUS_IF_GATTDESCRIPTOR1, "Characteristic" },
+};
+
+typedef struct {
+	const gchar *interface;
+	gchar *key;
+} bt_object;
+
+static gchar *_object_key(const gchar *parent, const gchar *id)
 {
-	GVariant *obj1, *ar1, *ar2;
-	GVariantIter *iter1, *iter2;
-	gchar *dev_path, *itf;
-	artik_bt_device device;
+	gchar *uuid, *key;
 
-	*path = NULL;
+	if (parent == NULL)
+		return g_ascii_strup(id, -1);
 
-	if (_get_managed_objects(&obj1) != S_OK)
+	uuid = g_ascii_strdown(id, -1);
+	key = g_strconcat(parent, "|", uuid, NULL);
+	g_free(uuid);
+
+	return key;
+}
+
+static void _object_free(gpointer data)
+{
+	bt_object *object = (bt_object *)data;
+
+	g_free(object->key);
+	g_free(object);
+}
+
+static void _object_cache_remove(const gchar *path)
+{
+	GHashTableIter iter;
+	gpointer obj_path, obj, other_path, other;
+	bt_object *object;
+
+	if (!g_hash_table_lookup_extended(hci.objects, path, &obj_path, &obj))
 		return;
 
-	g_variant_get(obj1, "(a{oa{sa{sv}}})", &iter1);
-	while (g_variant_iter_loop(iter1, "{&o@a{sa{sv}}}", &dev_path, &ar1)) {
+	object = (bt_object *)obj;
+	if (g_hash_table_lookup(hci.object_index, object->key) == obj_path) {
+		g_hash_table_remove(hci.object_index, object->key);
+
+		/* Another instance of the same service may take over the key */
+		g_hash_table_iter_init(&iter, hci.objects);
+		while (g_hash_table_iter_next(&iter, &other_path, &other)) {
+			if (other == obj ||
+				g_strcmp0(((bt_object *)other)->key, object->key))
+				continue;
 
-		if (*path != NULL) {
-			g_variant_unref(ar1);
+			g_hash_table_insert(hci.object_index,
+				((bt_object *)other)->key, other_path);
 			break;
 		}
+	}
 
-		g_variant_get(ar1, "a{sa{sv}}", &iter2);
-		while (g_variant_iter_loop(iter2, "{&s@a{sv}}", &itf, &ar2)) {
+	g_hash_table_remove(hci.objects, path);
+}
 
-			if (strcasecmp(itf, DBUS_IF_DEVICE1) != 0)
-				continue;
+static void _object_cache_add(const gchar *path, GVariant *interfaces)
+{
+	GVariant *prop_array = NULL;
+	const gchar *id = NULL, *parent = NULL;
+	bt_object *object;
+	gchar *obj_path;
+	guint i;
+
+	if (!g_str_has_prefix(path, DBUS_BLUEZ_OBJECT_PATH))
+		return;
+
+	for (i = 0; i < G_N_ELEMENTS(object_types); i++) {
+		prop_array = g_variant_lookup_value(interfaces,
+			object_types[i].interface, G_VARIANT_TYPE("a{sv}"));
+		if (prop_array != NULL)
+			break;
+	}
+
+	if (prop_array == NULL)
+		return;
+
+	if (object_types[i].parent == NULL) {
+		g_variant_lookup(prop_array, "Address", "&s", &id);
+	} else {
+		g_variant_lookup(prop_array, "UUID", "&s", &id);
+		g_variant_lookup(prop_array, object_types[i].parent, "&o", &parent);
+	}
+
+	if (id == NULL || (object_types[i].parent != NULL && parent == NULL)) {
+		g_variant_unref(prop_array);
+		return;
+	}
+
+	_object_cache_remove(path);
+
+	object = g_new0(bt_object, 1);
+	object->interface = object_types[i].interface;
+	object->key = _object_key(parent, id);
+	obj_path = g_strdup(path);
+
+	g_hash_table_insert(hci.objects, obj_path, object);
+	if (!g_hash_table_contains(hci.object_index, object->key))
+		g_hash_table_insert(hci.object_index, object->key, obj_path);
+
+	g_variant_unref(prop_array);
+}
+
+static artik_error _object_cache_load(void)
+{
+	GVariant *obj1, *ar1;
+	GVariantIter *iter1;
+	gchar *path;
+	artik_error ret;
+
+	ret = _get_managed_objects(&obj1);
+	if (ret != S_OK)
+		return ret;
+
+	if (hci.objects == NULL) {
+		hci.objects = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, _object_free);
+		hci.object_index = g_hash_table_new(g_str_hash, g_str_equal);
+	} else {
+		g_hash_table_remove_all(hci.object_index);
+		g_hash_table_remove_all(hci.objects);
+	}
+
+	g_variant_get(obj1, "(a{oa{sa{sv}}})", &iter1);
+	while (g_variant_iter_loop(iter1, "{&o@a{sa{sv}}}", &path, &ar1))
+		_object_cache_add(path, ar1);
+	g_variant_iter_free(iter1);
+	g_variant_unref(obj1);
+
+	log_dbg("%s: %d objects", __func__, g_hash_table_size(hci.objects));
+
+	return S_OK;
+}
+
+static const gchar *_object_index_lookup(const gchar *interface,
+		const gchar *key)
+{
+	const gchar *path;
+	bt_object *object;
 
-			_get_device_properties(ar2, &device);
-			if (strcasecmp(device.remote_address, addr) == 0) {
-				*path = g_strdup(dev_path);
-				g_variant_unref(ar2);
+	if (hci.objects == NULL)
+		return NULL;
+
+	path = g_hash_table_lookup(hci.object_index, key);
+	if (path == NULL)
+		return NULL;
+
+	object = g_hash_table_lookup(hci.objects, path);
+	if (g_strcmp0(object->interface, interface) != 0)
+		return NULL;
+
+	return path;
+}
+
+static const gchar *_object_cache_lookup(const gchar *interface,
+		const gchar *parent, const gchar *id)
+{
+	const gchar *path;
+	gchar *key;
+
+	key = _object_key(parent, id);
+
+	/*
+	 * A miss either means the object does not exist or that its
+	 * InterfacesAdded signal has not been dispatched yet, e.g. when the
+	 * application has not run the loop since connecting. Reload once.
+	 */
+	path = _object_index_lookup(interface, key);
+	if (path == NULL && _object_cache_load() == S_OK)
+		path = _object_index_lookup(interface, key);
+
+	g_free(key);
+
+	return path;
+}
+
+static void _object_cache_update(const gchar *signal_name,
+		GVariant *parameters)
+{
+	GVariant *interfaces;
+	const gchar **itfs;
+	const gchar *path;
+	bt_object *object;
+	guint i;
+
+	if (hci.objects == NULL)
+		return;
+
+	if (g_strcmp0(signal_name, "InterfacesAdded") == 0) {
+		g_variant_get(parameters, "(&o@a{sa{sv}})", &path, &interfaces);
+		_object_cache_add(path, interfaces);
+		g_variant_unref(interfaces);
+	} else if (g_strcmp0(signal_name, "InterfacesRemoved") == 0) {
+		g_variant_get(parameters, "(&o^a&s)", &path, &itfs);
+		object = g_hash_table_lookup(hci.objects, path);
+		for (i = 0; object != NULL && itfs[i] != NULL; i++) {
+			if (g_strcmp0(itfs[i], object->interface) == 0) {
+				_object_cache_remove(path);
 				break;
 			}
 		}
-		g_variant_iter_free(iter2);
+		g_free(itfs);
 	}
-	g_variant_iter_free(iter1);
-	g_variant_unref(obj1);
+}
+
+void _get_object_path(const char *addr, char **path)
+{
+	*path = NULL;
+
+	if (addr == NULL)
+		return;
+
+	*path = g_strdup(_object_cache_lookup(DBUS_IF_DEVICE1, NULL, addr));
 }
 
 artik_error _get_devices(bt_device_state state,
@@ -606,74 +801,22 @@ artik_error _get_devices(bt_device_state state,
 void _get_gatt_path(const char *addr, const char *interface,
 		const char *uuid, const char *property, const char *value, gchar **gatt_path)
 {
-	GVariant *obj1, *ar1, *ar2, *val;
-	GVariantIter *iter1, *iter2, *iter3;
-	gchar *path, *dev_path, *itf, *key;
+	gchar *dev_path = NULL;
 
 	*gatt_path = NULL;
 
-	_get_object_path(addr, &dev_path);
-	if (dev_path == NULL)
+	if (uuid == NULL)
 		return;
 
-	if (_get_managed_objects(&obj1) != S_OK)
-		return;
-
-	g_variant_get(obj1, "(a{oa{sa{sv}}})", &iter1);
-	while (g_variant_iter_loop(iter1, "{&o@a{sa{sv}}}", &path, &ar1)) {
-		if (*gatt_path != NULL) {
-			g_variant_unref(ar1);
-			break;
-		}
-
-		if (!g_str_has_prefix(path, dev_path))
-			continue;
-
-		g_variant_get(ar1, "a{sa{sv}}", &iter2);
-		while (g_variant_iter_loop(iter2, "{&s@a{sv}}", &itf, &ar2)) {
-
-			if (*gatt_path != NULL) {
-				g_variant_unref(ar2);
-				break;
-			}
-
-			if (g_strcmp0(itf, interface) != 0)
-				continue;
-
-			bool is_good_uuid = false;
-			bool is_good_property = false;
-
-			if (property == NULL)
-				is_good_property = true;
-
-			g_variant_get(ar2, "a{sv}", &iter3);
-			while (g_variant_iter_loop(iter3, "{&sv}", &key, &val)) {
-				if (!g_strcmp0(key, "UUID")) {
-					const gchar *id = g_variant_get_string(val, NULL);
-
-					if (!g_strcmp0(uuid, id))
-						is_good_uuid = true;
-				}
-
-				if (!g_strcmp0(key, property)) {
-					const gchar *str_val = g_variant_get_string(val, NULL);
+	/* Services hang off the device, other attributes off their parent */
+	if (property == NULL) {
+		_get_object_path(addr, &dev_path);
+		value = dev_path;
+	}
 
-					if (!g_strcmp0(value, str_val))
-						is_good_property = true;
-				}
+	if (value != NULL)
+		*gatt_path = g_strdup(_object_cache_lookup(interface, value, uuid));
 
-				if (is_good_property && is_good_uuid) {
-					*gatt_path = strdup(path);
-					g_variant_unref(val);
-					break;
-				}
-			}
-			g_variant_iter_free(iter3);
-		}
-		g_variant_iter_free(iter2);
-	}
-	g_variant_iter_free(iter1);
-	g_variant_unref(obj1);
 	g_free(dev_path);
 }
 
@@ -742,36 +885,26 @@ static void _process_gatt_service(gchar *path)
 static void _gatt_properties_changed(const gchar *object_path,
 		GVariant *properties)
 {
-	GVariant *r, *v;
-	guint i = 0, len = 0;
+	GVariant *value;
+	gconstpointer bytes;
+	gsize len = 0;
 	bt_gatt_client *client;
 
-	r = g_dbus_connection_call_sync(
-			hci.conn,
-			DBUS_BLUEZ_BUS,
-			object_path,
-			DBUS_IF_PROPERTIES,
-			"Get",
-			g_variant_new("(ss)", DBUS_IF_GATTCHARACTERISTIC1, "UUID"),
-			NULL, G_DBUS_CALL_FLAGS_NONE, G_MAXINT, NULL, NULL);
+	if (hci.gatt_clients == NULL)
+		return;
 
-	g_variant_get(r, "(v)", &v);
-	if (g_strcmp0(g_variant_get_string(v, NULL),
-			UUID_HEART_RATE_MEASUREMENT) == 0) {
-		_on_hrp_measurement_received(properties);
+	client = g_hash_table_lookup(hci.gatt_clients, object_path);
+	if (client == NULL)
+		return;
 
-	} else {
-		len = g_slist_length(hci.gatt_clients);
-		for (i = 0; i < len; i++) {
-			client =  g_slist_nth_data(hci.gatt_clients, i);
-			if (g_strcmp0(object_path, client->path) == 0) {
-				_on_gatt_data_received(properties, client->srv_uuid, client->char_uuid);
-				break;
-			}
-		}
-	}
-	g_variant_unref(r);
-	g_variant_unref(v);
+	value = g_variant_lookup_value(properties, "Value",
+			G_VARIANT_TYPE_BYTESTRING);
+	if (value == NULL)
+		return;
+
+	bytes = g_variant_get_fixed_array(value, &len, sizeof(guchar));
+	client->notify(bytes, len, client->srv_uuid, client->char_uuid);
+	g_variant_unref(value);
 }
 
 static gboolean _on_timeout(gpointer user_data)
@@ -799,6 +932,11 @@ void _on_interface_added(const gchar *sender_name,
 	g_variant_get(device_array, "a{sa{sv}}", &iter);
 	while (g_variant_iter_loop(iter, "{&s@a{sv}}", &interface, &prop_array)) {
 		if (g_strcmp0(interface, DBUS_IF_DEVICE1) == 0) {
+			/* Reported in batches instead while aggregation is on */
+			if (hci.scan != NULL) {
+				_scan_device_added(path, prop_array);
+				continue;
+			}
 			device = (artik_bt_device *)malloc(sizeof(artik_bt_device));
 			_get_device_properties(prop_array, device);
 			_user_callback(BT_EVENT_SCAN, device);
@@ -859,7 +997,9 @@ void _on_interface_removed(const gchar *sender_name,
 	log_dbg("InterfacesRemoved [%s]", path);
 
 	while (g_variant_iter_loop(iter, "s", &interface)) {
-		if (g_strcmp0(interface, DBUS_IF_OBEX_SESSION) == 0) {
+		if (g_strcmp0(interface, DBUS_IF_DEVICE1) == 0) {
+			_scan_device_removed(path);
+		} else if (g_strcmp0(interface, DBUS_IF_OBEX_SESSION) == 0) {
 			memset(session_path, 0, SESSION_PATH_LEN);
 		} else if (g_strcmp0(interface, DBUS_IF_OBEX_TRANSFER) == 0) {
 			if (transfer_property.object_path != NULL) {
@@ -904,6 +1044,7 @@ void _on_properties_changed(const gchar *sender_name,
 
 		if (g_strcmp0(DBUS_IF_DEVICE1, interface) == 0) {
 			_device_properties_changed(properties);
+			_scan_device_changed(object_path, properties);
 
 		} else if (g_strcmp0(DBUS_IF_PROXIMITYREPORTER1, interface) == 0 ||
 				g_strcmp0(DBUS_IF_PROXIMITYMONITOR1, interface) == 0) {
@@ -937,6 +1078,9 @@ void _dbus_signal_callback(GDBusConnection *conn,
 	const gchar *interface_name, const gchar *signal_name,
 	GVariant *parameters, gpointer user_data)
 {
+	if (conn == hci.conn)
+		_object_cache_update(signal_name, parameters);
+
 	if (g_strcmp0(signal_name, "InterfacesAdded") == 0) {
 		_on_interface_added(sender_name, object_path, interface_name,
 			parameters, user_data);
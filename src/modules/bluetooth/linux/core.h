@@ -30,6 +30,8 @@
 #include <artik_log.h>
 
 #include "device.h"
+#include "gatt_io.h"
+#include "scan.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -135,10 +137,15 @@ typedef struct {
 	gboolean is_svc_primary;
 } bt_gatt_service;
 
+typedef void (*gatt_notify_callback)(const guchar *bytes, gsize len,
+		gchar *srv_uuid, gchar *char_uuid);
+
 typedef struct {
 	gchar *char_uuid;
 	gchar *srv_uuid;
 	gchar *path;
+	gatt_notify_callback notify;
+	bt_gatt_io *io;
 } bt_gatt_client;
 
 typedef struct {
@@ -151,6 +158,7 @@ typedef struct {
 	guint value_length;
 	guint flags_length;
 	GSList *desc_data;
+	bt_gatt_io *notify_io;
 
 	artik_bt_gatt_req_read read_callback;
 	artik_bt_gatt_req_write write_callback;
@@ -204,11 +212,19 @@ typedef struct {
 	GHashTable *registration_ids;
 	bt_event_callback callback[BT_EVENT_END];
 	GSList *gatt_services;
-	GSList *gatt_clients;
+	GHashTable *gatt_clients;
+	GHashTable *gatt_writers;
 	GSList *advertisements;
 	GSource *source;
 	bt_device_state state;
 	prop_change_callback prop_callback;
+	GHashTable *objects;
+	GHashTable *object_index;
+	GQueue *async_calls;
+	guint async_in_flight;
+	GCancellable *async_cancellable;
+	gint async_timeout;
+	bt_scan_aggregator *scan;
 } bt_handler;
 
 extern bt_handler hci;
@@ -222,6 +238,10 @@ artik_error bt_deinit(void);
 
 void _user_callback(artik_bt_event event, void *data);
 
+gatt_notify_callback _get_gatt_notify_callback(const char *char_uuid);
+
+void _set_device_class(artik_bt_class *class, uint32_t cod);
+
 void _get_adapter_properties(GVariant *prop_array, artik_bt_adapter *adapter);
 
 void _get_device_properties(GVariant *prop_array, artik_bt_device *device);
@@ -26,6 +26,7 @@
 #pragma GCC diagnostic pop
 
 #include "core.h"
+#include "async.h"
 
 static void _set_trusted(const char *device_path, gboolean value)
 {
@@ -363,6 +364,46 @@ exit:
 	return ret;
 }
 
+static void _device_call_reply(bt_async_call *call, GVariant *reply,
+		GUnixFDList *fd_list, GError *error)
+{
+	_async_call_done(call, _async_error(error), NULL, 0);
+}
+
+static artik_error _device_call_async(const char *remote_address,
+		const char *method, artik_bt_async_callback callback,
+		void *user_data)
+{
+	gchar *path;
+
+	bt_init(G_BUS_TYPE_SYSTEM, &(hci.conn));
+
+	_get_object_path(remote_address, &path);
+
+	if (path == NULL)
+		return E_BT_ERROR;
+
+	_async_call_submit(_async_call_new(path, DBUS_IF_DEVICE1, method, NULL,
+			_device_call_reply, callback, user_data));
+	g_free(path);
+
+	return S_OK;
+}
+
+artik_error bt_connect_async(const char *remote_address,
+		artik_bt_async_callback callback, void *user_data)
+{
+	return _device_call_async(remote_address, "Connect", callback,
+			user_data);
+}
+
+artik_error bt_disconnect_async(const char *remote_address,
+		artik_bt_async_callback callback, void *user_data)
+{
+	return _device_call_async(remote_address, "Disconnect", callback,
+			user_data);
+}
+
 artik_error bt_stop_bond(const char *remote_address)
 {
 	GVariant *result;
@@ -36,6 +36,10 @@ artik_error bt_remove_unpaired_devices(void);
 artik_error bt_connect(const char *remote_address);
 artik_error bt_connect_profile(const char *remote_address, const char *uuid);
 artik_error bt_disconnect(const char *remote_address);
+artik_error bt_connect_async(const char *remote_address,
+		artik_bt_async_callback callback, void *user_data);
+artik_error bt_disconnect_async(const char *remote_address,
+		artik_bt_async_callback callback, void *user_data);
 artik_error bt_set_trust(const char *remote_address);
 artik_error bt_unset_trust(const char *remote_address);
 artik_error bt_set_block(const char *remote_address);
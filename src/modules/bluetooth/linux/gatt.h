@@ -66,6 +66,19 @@ artik_error bt_gatt_req_set_value(artik_bt_gatt_req request,
 artik_error bt_gatt_req_set_result(artik_bt_gatt_req request,
 		artik_bt_gatt_req_state_type state, const char *err_msg);
 artik_error bt_gatt_notify(int svc_id, int char_id, unsigned char *byte, int len);
+artik_error bt_gatt_char_read_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data);
+artik_error bt_gatt_char_write_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		const unsigned char byte[], int byte_len,
+		artik_bt_async_callback callback, void *user_data);
+artik_error bt_gatt_start_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data);
+artik_error bt_gatt_stop_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data);
 
 #ifdef __cplusplus
 } $
@@ -22,32 +22,123 @@
 #pragma GCC diagnostic pop
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include "core.h"
 #include "gatt.h"
 #include "helper.h"
+#include "gatt_io.h"
+#include "async.h"
 
-static void _remove_notify(gpointer data, gpointer user_data)
+static void _free_client(gpointer data)
 {
 	bt_gatt_client *client = (bt_gatt_client *)data;
 
-	if (g_strcmp0(client->char_uuid, user_data))
-		return;
-
-	hci.gatt_clients = g_slist_remove(hci.gatt_clients, client);
-	log_dbg("number of gatt client: %d", g_slist_length(hci.gatt_clients));
-
+	_gatt_io_free(client->io);
 	g_free(client->char_uuid);
 	g_free(client->srv_uuid);
 	g_free(client->path);
 	g_free(client);
 }
 
+static void _on_client_notify(const guchar *bytes, gsize len, void *user_data)
+{
+	bt_gatt_client *client = (bt_gatt_client *)user_data;
+
+	client->notify(bytes, len, client->srv_uuid, client->char_uuid);
+}
+
+static void _on_client_io_closed(void *user_data)
+{
+	bt_gatt_client *client = (bt_gatt_client *)user_data;
+
+	/* BlueZ hangs up on disconnection, start_notify acquires again */
+	g_hash_table_remove(hci.gatt_clients, client->path);
+}
+
+static void _on_writer_closed(void *user_data)
+{
+	g_hash_table_remove(hci.gatt_writers, user_data);
+}
+
+/*
+ * AcquireWrite only sends write commands, so use it where WriteValue
+ * would have sent a write command too.
+ */
+static gboolean _is_write_acquirable(const gchar *path)
+{
+	GVariant *r, *props;
+	GError *e = NULL;
+	const gchar **flags = NULL;
+	gboolean acquired, command = FALSE, request = FALSE;
+	guint i;
+
+	r = g_dbus_connection_call_sync(
+			hci.conn,
+			DBUS_BLUEZ_BUS,
+			path,
+			DBUS_IF_PROPERTIES,
+			"GetAll",
+			g_variant_new("(s)", DBUS_IF_GATTCHARACTERISTIC1),
+			G_VARIANT_TYPE("(a{sv})"), G_DBUS_CALL_FLAGS_NONE,
+			GATT_IO_ACQUIRE_TIMEOUT, NULL, &e);
+
+	if (e != NULL) {
+		log_dbg("%s", e->message);
+		g_error_free(e);
+		return FALSE;
+	}
+
+	props = g_variant_get_child_value(r, 0);
+	if (g_variant_lookup(props, "WriteAcquired", "b", &acquired) &&
+			g_variant_lookup(props, "Flags", "^a&s", &flags)) {
+		for (i = 0; flags[i] != NULL; i++) {
+			if (!g_strcmp0(flags[i], "write-without-response"))
+				command = TRUE;
+			else if (!g_strcmp0(flags[i], "write"))
+				request = TRUE;
+		}
+		g_free(flags);
+	}
+
+	g_variant_unref(props);
+	g_variant_unref(r);
+
+	return command && !request;
+}
+
+/* Returns the acquired write link of a characteristic, NULL to use D-Bus */
+static bt_gatt_io *_get_gatt_writer(const gchar *path)
+{
+	gpointer io = NULL;
+	gchar *key;
+	guint16 mtu = 0;
+	int fd;
+
+	if (hci.gatt_writers == NULL)
+		hci.gatt_writers = g_hash_table_new_full(g_str_hash, g_str_equal,
+				g_free, (GDestroyNotify)_gatt_io_free);
+
+	if (g_hash_table_lookup_extended(hci.gatt_writers, path, NULL, &io))
+		return io;
+
+	key = g_strdup(path);
+	if (_is_write_acquirable(path)) {
+		fd = _gatt_io_acquire(path, "AcquireWrite", &mtu);
+		if (fd >= 0)
+			io = _gatt_io_new(fd, mtu, NULL, _on_writer_closed, key);
+	}
+	g_hash_table_insert(hci.gatt_writers, key, io);
+
+	return io;
+}
+
 artik_error _read_value(const char *itf, const char *path,
 		unsigned char **byte, int *byte_len)
 {
-	GVariant *r = NULL, *v1 = NULL, *v2 = NULL;
+	GVariant *r = NULL, *v1 = NULL;
 	GError *e = NULL;
-	guint i = 0, len = 0;
+	gconstpointer bytes;
+	gsize len = 0;
 
 	log_dbg("bt_gatt_read_value [%s]", path);
 	r = g_dbus_connection_call_sync(
@@ -66,18 +157,15 @@ artik_error _read_value(const char *itf, const char *path,
 	}
 
 	v1 = g_variant_get_child_value(r, 0);
-	len = g_variant_n_children(v1);
+	bytes = g_variant_get_fixed_array(v1, &len, sizeof(guchar));
 	*byte_len = len;
 
 	*byte = (unsigned char *)malloc(sizeof(unsigned char) * len);
-	for (i = 0; i < len; i++) {
-		v2 = g_variant_get_child_value(v1, i);
-		(*byte)[i] = g_variant_get_byte(v2);
-	}
+	if (len > 0)
+		memcpy(*byte, bytes, len);
 
 	g_variant_unref(r);
 	g_variant_unref(v1);
-	g_variant_unref(v2);
 
 	return S_OK;
 }
@@ -85,16 +173,13 @@ artik_error _read_value(const char *itf, const char *path,
 artik_error _write_value(const char *itf, const char *path,
 		const unsigned char byte[], int byte_len)
 {
-	GVariantBuilder *b;
+	GVariant *value;
 	GError *e = NULL;
-	gint i = 0;
 
 	bt_init(G_BUS_TYPE_SYSTEM, &(hci.conn));
 
-
-	b = g_variant_builder_new(G_VARIANT_TYPE("ay"));
-	for (i = 0; i < byte_len; i++)
-		g_variant_builder_add(b, "y", byte[i]);
+	value = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, byte, byte_len,
+			sizeof(guchar));
 
 	log_dbg("%s [%s]", __func__, path);
 	g_dbus_connection_call_sync(
@@ -103,7 +188,7 @@ artik_error _write_value(const char *itf, const char *path,
 			path,
 			itf,
 			"WriteValue",
-			g_variant_new("(aya{sv})", b, NULL),
+			g_variant_new("(@aya{sv})", value, NULL),
 			NULL, G_DBUS_CALL_FLAGS_NONE, G_MAXINT, NULL, &e);
 
 	if (e != NULL) {
@@ -112,8 +197,6 @@ artik_error _write_value(const char *itf, const char *path,
 		return E_BT_ERROR;
 	}
 
-	g_variant_builder_unref(b);
-
 	return S_OK;
 }
 
@@ -151,7 +234,25 @@ artik_error bt_gatt_char_write_value(const char *addr, const char *srv_uuid, con
 		return E_BT_ERROR;
 
 
-	artik_error err = _write_value(DBUS_IF_GATTCHARACTERISTIC1, char_path, byte, byte_len);
+	artik_error err = E_BT_ERROR;
+	bt_gatt_io *writer = _get_gatt_writer(char_path);
+
+	/* Values too long for a single write command go through D-Bus */
+	if (_gatt_io_fits(writer, byte_len)) {
+		err = _gatt_io_write(writer, byte, byte_len);
+		/* Only a broken link falls back, values never change path */
+		if (err == S_OK || err == E_BUSY) {
+			g_free(char_path);
+			return err;
+		}
+		g_hash_table_remove(hci.gatt_writers, char_path);
+	} else if (_gatt_io_pending(writer)) {
+		/* Do not overtake the values still queued on the link */
+		g_free(char_path);
+		return E_BUSY;
+	}
+
+	err = _write_value(DBUS_IF_GATTCHARACTERISTIC1, char_path, byte, byte_len);
 
 	g_free(char_path);
 	return err;
@@ -203,11 +304,41 @@ artik_error bt_gatt_desc_write_value(const char *addr, const char *srv_uuid, con
 	return err;
 }
 
+static bt_gatt_client *_get_gatt_client(const gchar *path)
+{
+	if (hci.gatt_clients == NULL)
+		return NULL;
+
+	return g_hash_table_lookup(hci.gatt_clients, path);
+}
+
+static bt_gatt_client *_add_gatt_client(const gchar *path,
+		const char *srv_uuid, const char *char_uuid)
+{
+	bt_gatt_client *client;
+
+	if (hci.gatt_clients == NULL)
+		hci.gatt_clients = g_hash_table_new_full(g_str_hash, g_str_equal,
+				NULL, _free_client);
+
+	client = g_new0(bt_gatt_client, 1);
+	client->srv_uuid = g_strdup(srv_uuid);
+	client->char_uuid = g_strdup(char_uuid);
+	client->path = g_strdup(path);
+	client->notify = _get_gatt_notify_callback(char_uuid);
+	g_hash_table_insert(hci.gatt_clients, client->path, client);
+	log_dbg("number of gatt client: %d", g_hash_table_size(hci.gatt_clients));
+
+	return client;
+}
+
 artik_error bt_gatt_start_notify(const char *addr, const char *srv_uuid, const char *char_uuid)
 {
 	gchar *path = NULL;
 	gchar *srv_path = NULL;
 	bt_gatt_client *client;
+	guint16 mtu = 0;
+	int fd;
 
 	bt_init(G_BUS_TYPE_SYSTEM, &(hci.conn));
 
@@ -219,21 +350,28 @@ artik_error bt_gatt_start_notify(const char *addr, const char *srv_uuid, const c
 	if (path == NULL)
 		return E_BT_ERROR;
 
-	client = g_new0(bt_gatt_client, 1);
-	client->srv_uuid = g_strdup(srv_uuid);
-	client->char_uuid = g_strdup(char_uuid);
-	client->path = g_strdup(path);
-	hci.gatt_clients = g_slist_append(hci.gatt_clients, client);
+	client = _get_gatt_client(path);
+	if (client == NULL) {
+		client = _add_gatt_client(path, srv_uuid, char_uuid);
 
-	log_dbg("%s [%s]", __func__, path);
-	g_dbus_connection_call(
-			hci.conn,
-			DBUS_BLUEZ_BUS,
-			path,
-			DBUS_IF_GATTCHARACTERISTIC1,
-			"StartNotify",
-			NULL, NULL, G_DBUS_CALL_FLAGS_NONE, -1,
-			NULL, NULL, NULL);
+		/* Prefer reading notifications from a socket over signals */
+		fd = _gatt_io_acquire(path, "AcquireNotify", &mtu);
+		if (fd >= 0)
+			client->io = _gatt_io_new(fd, mtu, _on_client_notify,
+					_on_client_io_closed, client);
+	}
+
+	if (client->io == NULL) {
+		log_dbg("%s [%s]", __func__, path);
+		g_dbus_connection_call(
+				hci.conn,
+				DBUS_BLUEZ_BUS,
+				path,
+				DBUS_IF_GATTCHARACTERISTIC1,
+				"StartNotify",
+				NULL, NULL, G_DBUS_CALL_FLAGS_NONE, -1,
+				NULL, NULL, NULL);
+	}
 
 	g_free(path);
 
@@ -244,6 +382,7 @@ artik_error bt_gatt_stop_notify(const char *addr, const char *srv_uuid, const ch
 {
 	gchar *path = NULL;
 	gchar *srv_path = NULL;
+	bt_gatt_client *client;
 
 	bt_init(G_BUS_TYPE_SYSTEM, &(hci.conn));
 
@@ -255,18 +394,223 @@ artik_error bt_gatt_stop_notify(const char *addr, const char *srv_uuid, const ch
 	if (path == NULL)
 		return E_BT_ERROR;
 
-	log_dbg("%s [%s]", __func__, path);
-	g_dbus_connection_call(
-			hci.conn,
-			DBUS_BLUEZ_BUS,
-			path,
-			DBUS_IF_GATTCHARACTERISTIC1,
-			"StopNotify",
-			NULL, NULL, G_DBUS_CALL_FLAGS_NONE, -1,
-			NULL, NULL, NULL);
+	client = _get_gatt_client(path);
+
+	/* Closing an acquired socket is enough to stop notifications */
+	if (client == NULL || client->io == NULL) {
+		log_dbg("%s [%s]", __func__, path);
+		g_dbus_connection_call(
+				hci.conn,
+				DBUS_BLUEZ_BUS,
+				path,
+				DBUS_IF_GATTCHARACTERISTIC1,
+				"StopNotify",
+				NULL, NULL, G_DBUS_CALL_FLAGS_NONE, -1,
+				NULL, NULL, NULL);
+	}
+
+	if (client != NULL)
+		g_hash_table_remove(hci.gatt_clients, path);
+
+	g_free(path);
+
+	return S_OK;
+}
+
+static gchar *_get_char_path(const char *addr, const char *srv_uuid,
+		const char *char_uuid)
+{
+	gchar *srv_path = NULL, *char_path = NULL;
+
+	bt_init(G_BUS_TYPE_SYSTEM, &(hci.conn));
+
+	_get_gatt_path(addr, DBUS_IF_GATTSERVICE1, srv_uuid, NULL, NULL, &srv_path);
+	if (srv_path == NULL)
+		return NULL;
+	_get_gatt_path(addr, DBUS_IF_GATTCHARACTERISTIC1, char_uuid, "Service", srv_path, &char_path);
+	g_free(srv_path);
+
+	return char_path;
+}
+
+static void _char_call_reply(bt_async_call *call, GVariant *reply,
+		GUnixFDList *fd_list, GError *error)
+{
+	_async_call_done(call, _async_error(error), NULL, 0);
+}
+
+static void _read_value_reply(bt_async_call *call, GVariant *reply,
+		GUnixFDList *fd_list, GError *error)
+{
+	GVariant *v;
+	gconstpointer bytes;
+	gsize len = 0;
+
+	if (error != NULL) {
+		_async_call_done(call, _async_error(error), NULL, 0);
+		return;
+	}
+
+	v = g_variant_get_child_value(reply, 0);
+	bytes = g_variant_get_fixed_array(v, &len, sizeof(guchar));
+	_async_call_done(call, S_OK, bytes, len);
+	g_variant_unref(v);
+}
+
+artik_error bt_gatt_char_read_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data)
+{
+	gchar *path = _get_char_path(addr, srv_uuid, char_uuid);
+
+	if (path == NULL)
+		return E_BT_ERROR;
+
+	_async_call_submit(_async_call_new(path, DBUS_IF_GATTCHARACTERISTIC1,
+			"ReadValue", g_variant_new("(a{sv})", NULL),
+			_read_value_reply, callback, user_data));
+	g_free(path);
+
+	return S_OK;
+}
+
+/*
+ * Always uses WriteValue rather than an acquired socket, so that the
+ * callback reports the outcome of write requests.
+ */
+artik_error bt_gatt_char_write_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		const unsigned char byte[], int byte_len,
+		artik_bt_async_callback callback, void *user_data)
+{
+	gchar *path = _get_char_path(addr, srv_uuid, char_uuid);
+	GVariant *value;
+
+	if (path == NULL)
+		return E_BT_ERROR;
+
+	value = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, byte, byte_len,
+			sizeof(guchar));
+	_async_call_submit(_async_call_new(path, DBUS_IF_GATTCHARACTERISTIC1,
+			"WriteValue", g_variant_new("(@aya{sv})", value, NULL),
+			_char_call_reply, callback, user_data));
+	g_free(path);
+
+	return S_OK;
+}
+
+static void _start_notify_reply(bt_async_call *call, GVariant *reply,
+		GUnixFDList *fd_list, GError *error)
+{
+	bt_gatt_client *client = _get_gatt_client(call->path);
+	artik_error err = _async_error(error);
+
+	/* Let a later start_notify try again */
+	if (err != S_OK && client != NULL && client->io == NULL)
+		g_hash_table_remove(hci.gatt_clients, call->path);
+
+	_async_call_done(call, err, NULL, 0);
+}
+
+static void _acquire_notify_reply(bt_async_call *call, GVariant *reply,
+		GUnixFDList *fd_list, GError *error)
+{
+	bt_gatt_client *client = _get_gatt_client(call->path);
+	artik_error err = _async_error(error);
+	gint32 idx;
+	guint16 mtu = 0;
+	int fd = -1;
+
+	if (err == S_OK && fd_list != NULL &&
+			g_variant_is_of_type(reply, G_VARIANT_TYPE("(hq)"))) {
+		g_variant_get(reply, "(hq)", &idx, &mtu);
+		fd = g_unix_fd_list_get(fd_list, idx, NULL);
+	}
+
+	/* Stopped before BlueZ answered */
+	if (client == NULL) {
+		if (fd >= 0)
+			close(fd);
+		_async_call_done(call, E_INTERRUPTED, NULL, 0);
+		return;
+	}
+
+	if (fd >= 0 && client->io == NULL)
+		client->io = _gatt_io_new(fd, mtu, _on_client_notify,
+				_on_client_io_closed, client);
+	else if (fd >= 0)
+		close(fd);
+
+	if (client->io != NULL) {
+		_async_call_done(call, S_OK, NULL, 0);
+		return;
+	}
+
+	/* No point in asking again a device which is gone or silent */
+	if (err == E_TIMEOUT || err == E_NOT_CONNECTED || err == E_INTERRUPTED) {
+		_start_notify_reply(call, NULL, NULL, error);
+		return;
+	}
+
+	_async_call_set_method(call, "StartNotify", NULL, _start_notify_reply);
+	_async_call_submit(call);
+}
+
+artik_error bt_gatt_start_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data)
+{
+	gchar *path = _get_char_path(addr, srv_uuid, char_uuid);
+	bt_gatt_client *client;
+	bt_async_call *call;
+
+	if (path == NULL)
+		return E_BT_ERROR;
+
+	call = _async_call_new(path, DBUS_IF_GATTCHARACTERISTIC1,
+			"StartNotify", NULL, _start_notify_reply, callback,
+			user_data);
+
+	client = _get_gatt_client(path);
+	if (client == NULL) {
+		_add_gatt_client(path, srv_uuid, char_uuid);
+		_async_call_set_method(call, "AcquireNotify",
+				g_variant_new("(a{sv})", NULL),
+				_acquire_notify_reply);
+	}
+
+	if (client != NULL && client->io != NULL)
+		_async_call_done_later(call, S_OK);
+	else
+		_async_call_submit(call);
+	g_free(path);
+
+	return S_OK;
+}
+
+artik_error bt_gatt_stop_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data)
+{
+	gchar *path = _get_char_path(addr, srv_uuid, char_uuid);
+	bt_gatt_client *client;
+	bt_async_call *call;
+
+	if (path == NULL)
+		return E_BT_ERROR;
+
+	call = _async_call_new(path, DBUS_IF_GATTCHARACTERISTIC1,
+			"StopNotify", NULL, _char_call_reply, callback, user_data);
 
-	g_slist_foreach(hci.gatt_clients, _remove_notify, (char *)char_uuid);
+	/* Closing an acquired socket is enough to stop notifications */
+	client = _get_gatt_client(path);
+	if (client != NULL && client->io != NULL)
+		_async_call_done_later(call, S_OK);
+	else
+		_async_call_submit(call);
 
+	if (client != NULL)
+		g_hash_table_remove(hci.gatt_clients, path);
 	g_free(path);
 
 	return S_OK;
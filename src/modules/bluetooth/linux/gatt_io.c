@@ -0,0 +1,267 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <artik_module.h>
+#include <gio-unix-2.0/gio/gunixfdlist.h>
+
+#include "core.h"
+#include "gatt_io.h"
+
+/* Largest attribute value allowed by the ATT protocol */
+#define GATT_IO_MAX_VALUE_LEN	512
+/* Datagrams read per wakeup before giving the loop back */
+#define GATT_IO_READ_BATCH	32
+
+int _gatt_io_acquire(const char *path, const char *method, guint16 *mtu)
+{
+	GVariant *r;
+	GUnixFDList *fd_list = NULL;
+	GError *e = NULL;
+	gint32 idx;
+	int fd;
+
+	r = g_dbus_connection_call_with_unix_fd_list_sync(
+			hci.conn,
+			DBUS_BLUEZ_BUS,
+			path,
+			DBUS_IF_GATTCHARACTERISTIC1,
+			method,
+			g_variant_new("(a{sv})", NULL),
+			G_VARIANT_TYPE("(hq)"), G_DBUS_CALL_FLAGS_NONE,
+			GATT_IO_ACQUIRE_TIMEOUT, NULL, &fd_list, NULL, &e);
+
+	if (e != NULL) {
+		log_dbg("%s %s: %s", method, path, e->message);
+		g_error_free(e);
+		return -1;
+	}
+
+	g_variant_get(r, "(hq)", &idx, mtu);
+	g_variant_unref(r);
+
+	fd = g_unix_fd_list_get(fd_list, idx, &e);
+	g_object_unref(fd_list);
+	if (e != NULL) {
+		log_dbg("%s %s: %s", method, path, e->message);
+		g_error_free(e);
+		return -1;
+	}
+
+	log_dbg("%s %s: fd %d, mtu %d", method, path, fd, *mtu);
+
+	return fd;
+}
+
+static void _gatt_io_destroy(bt_gatt_io *io)
+{
+	if (io->out_watch_id)
+		io->loop->remove_fd_watch(io->out_watch_id);
+	g_queue_free_full(io->tx, (GDestroyNotify)g_bytes_unref);
+	artik_release_api_module(io->loop);
+	close(io->fd);
+	g_free(io);
+}
+
+static int _gatt_io_watch(int fd, enum watch_io io, void *user_data)
+{
+	bt_gatt_io *gio = (bt_gatt_io *)user_data;
+	guchar buf[GATT_IO_MAX_VALUE_LEN];
+	ssize_t len;
+	int i;
+
+	gio->dispatching = TRUE;
+	for (i = 0; (io & WATCH_IO_IN) && i < GATT_IO_READ_BATCH; i++) {
+		len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+		if (len > 0) {
+			if (gio->read_callback)
+				gio->read_callback(buf, len, gio->user_data);
+			/* The callback may have released the link */
+			if (gio->freed)
+				break;
+			continue;
+		}
+
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+
+		/* Peer closed its end */
+		io |= WATCH_IO_HUP;
+		break;
+	}
+	gio->dispatching = FALSE;
+
+	if (gio->freed) {
+		_gatt_io_destroy(gio);
+		return 0;
+	}
+
+	if (!(io & (WATCH_IO_HUP | WATCH_IO_ERR | WATCH_IO_NVAL)))
+		return 1;
+
+	log_dbg("%s: fd %d closed", __func__, fd);
+
+	/* The loop drops the watch when we return 0 */
+	gio->watch_id = 0;
+	if (gio->close_callback)
+		gio->close_callback(gio->user_data);
+
+	return 0;
+}
+
+bt_gatt_io *_gatt_io_new(int fd, guint16 mtu,
+		gatt_io_read_callback read_callback,
+		gatt_io_close_callback close_callback, void *user_data)
+{
+	bt_gatt_io *io;
+	enum watch_io cond = WATCH_IO_HUP | WATCH_IO_ERR | WATCH_IO_NVAL;
+
+	io = g_new0(bt_gatt_io, 1);
+	io->fd = fd;
+	io->mtu = mtu;
+	io->tx = g_queue_new();
+	io->read_callback = read_callback;
+	io->close_callback = close_callback;
+	io->user_data = user_data;
+
+	if (read_callback)
+		cond |= WATCH_IO_IN;
+
+	io->loop = (artik_loop_module *)artik_request_api_module("loop");
+	if (io->loop->add_fd_watch(fd, cond, _gatt_io_watch, io,
+			&io->watch_id) != S_OK) {
+		log_err("Failed to watch fd %d", fd);
+		_gatt_io_destroy(io);
+		return NULL;
+	}
+
+	return io;
+}
+
+gboolean _gatt_io_fits(bt_gatt_io *io, int len)
+{
+	return io != NULL && len > 0 &&
+		len <= io->mtu - GATT_IO_ATT_HEADER_LEN;
+}
+
+gboolean _gatt_io_pending(bt_gatt_io *io)
+{
+	return io != NULL && !g_queue_is_empty(io->tx);
+}
+
+/* Returns 1 when sent, 0 when the socket is full, -1 on error */
+static int _gatt_io_send(bt_gatt_io *io, const void *byte, gsize len)
+{
+	while (send(io->fd, byte, len, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+		if (errno == EINTR)
+			continue;
+
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return 0;
+
+		log_dbg("%s: fd %d: %s", __func__, io->fd, strerror(errno));
+		return -1;
+	}
+
+	return 1;
+}
+
+static int _gatt_io_out_watch(int fd, enum watch_io cond, void *user_data)
+{
+	bt_gatt_io *io = (bt_gatt_io *)user_data;
+	GBytes *value;
+	gsize len;
+	const void *data;
+	int ret = 1;
+
+	while ((value = g_queue_peek_head(io->tx)) != NULL) {
+		data = g_bytes_get_data(value, &len);
+		ret = _gatt_io_send(io, data, len);
+		if (ret <= 0)
+			break;
+
+		g_bytes_unref(g_queue_pop_head(io->tx));
+	}
+
+	if (ret < 0) {
+		/* The hang-up watch reports the closed link */
+		g_queue_free_full(io->tx, (GDestroyNotify)g_bytes_unref);
+		io->tx = g_queue_new();
+	}
+
+	if (!g_queue_is_empty(io->tx))
+		return 1;
+
+	/* The loop drops the watch when we return 0 */
+	io->out_watch_id = 0;
+
+	return 0;
+}
+
+/*
+ * Never blocks the loop. Values the socket cannot take yet are queued and
+ * sent in order once it drains, E_BUSY once the queue is full.
+ */
+artik_error _gatt_io_write(bt_gatt_io *io, const unsigned char *byte,
+		int len)
+{
+	if (g_queue_is_empty(io->tx)) {
+		switch (_gatt_io_send(io, byte, len)) {
+		case 1:
+			return S_OK;
+		case -1:
+			return E_BT_ERROR;
+		}
+	} else if (g_queue_get_length(io->tx) >= GATT_IO_TX_QUEUE_MAX) {
+		return E_BUSY;
+	}
+
+	if (io->out_watch_id == 0 && io->loop->add_fd_watch(io->fd,
+			WATCH_IO_OUT, _gatt_io_out_watch, io,
+			&io->out_watch_id) != S_OK) {
+		log_err("Failed to watch fd %d", io->fd);
+		io->out_watch_id = 0;
+		return E_BT_ERROR;
+	}
+
+	g_queue_push_tail(io->tx, g_bytes_new(byte, len));
+
+	return S_OK;
+}
+
+void _gatt_io_free(bt_gatt_io *io)
+{
+	if (io == NULL)
+		return;
+
+	/* Inside a read callback, let the watch finish and drop itself */
+	if (io->dispatching) {
+		io->freed = TRUE;
+		return;
+	}
+
+	if (io->watch_id)
+		io->loop->remove_fd_watch(io->watch_id);
+
+	_gatt_io_destroy(io);
+}
@@ -0,0 +1,85 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef __ARTIK_BT_GATT_IO_H
+#define __ARTIK_BT_GATT_IO_H
+
+#include <artik_error.h>
+#include <artik_loop.h>
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include <gio/gio.h>
+#pragma GCC diagnostic pop
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size of the ATT header preceding a value in a write command/notification */
+#define GATT_IO_ATT_HEADER_LEN	3
+
+typedef void (*gatt_io_read_callback)(const guchar *bytes, gsize len,
+		void *user_data);
+typedef void (*gatt_io_close_callback)(void *user_data);
+
+/*
+ * Bound on the calls acquiring a link, in ms. They run from
+ * start_notify and the first write, which must not hang the loop.
+ */
+#define GATT_IO_ACQUIRE_TIMEOUT	2000
+/* Values waiting for a full socket before writes are refused */
+#define GATT_IO_TX_QUEUE_MAX	64
+
+/*
+ * Characteristic value link over a file descriptor handed out by BlueZ
+ * through AcquireWrite/AcquireNotify. Each datagram carries one value.
+ */
+typedef struct {
+	int fd;
+	guint16 mtu;
+	int watch_id;
+	int out_watch_id;
+	GQueue *tx;
+	artik_loop_module *loop;
+	gatt_io_read_callback read_callback;
+	gatt_io_close_callback close_callback;
+	void *user_data;
+	gboolean dispatching;
+	gboolean freed;
+} bt_gatt_io;
+
+int _gatt_io_acquire(const char *path, const char *method, guint16 *mtu);
+
+bt_gatt_io *_gatt_io_new(int fd, guint16 mtu,
+		gatt_io_read_callback read_callback,
+		gatt_io_close_callback close_callback, void *user_data);
+
+gboolean _gatt_io_fits(bt_gatt_io *io, int len);
+
+gboolean _gatt_io_pending(bt_gatt_io *io);
+
+artik_error _gatt_io_write(bt_gatt_io *io, const unsigned char *byte,
+		int len);
+
+void _gatt_io_free(bt_gatt_io *io);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ARTIK_BT_GATT_IO_H */
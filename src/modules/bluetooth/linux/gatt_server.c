@@ -22,8 +22,10 @@
 #pragma GCC diagnostic pop
 #include <string.h>
 #include <stdlib.h>
+#include <gio-unix-2.0/gio/gunixfdlist.h>
 #include "core.h"
 #include "gatt.h"
+#include "gatt_io.h"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Woverlength-strings"
@@ -63,6 +65,10 @@ static const gchar char_introspection_xml[] =
 "\t\t</method>"
 "\t\t<method name='StopNotify'>"
 "\t\t</method>"
+"\t\t<method name='AcquireNotify'>"
+"\t\t\t<arg type='h' name='fd' direction='in'/>"
+"\t\t\t<arg type='a{sv}' name='options' direction='in'/>"
+"\t\t</method>"
 "\t\t<method name='IndicateConfirm'>"
 "\t\t\t<arg type='s' name='address' direction='in'/>"
 "\t\t\t<arg type='b' name='complete' direction='in'/>"
@@ -77,6 +83,8 @@ static const gchar char_introspection_xml[] =
 "\t\t</property>"
 "\t\t<property type='b' name='Notifying' access='read'>"
 "\t\t</property>"
+"\t\t<property type='b' name='NotifyAcquired' access='read'>"
+"\t\t</property>"
 "\t\t<property type='as' name='Flags' access='read'>"
 "\t\t</property>"
 "\t\t<property type='s' name='Unicast' access='read'>"
@@ -190,6 +198,11 @@ static void _serv_method_call(GDBusConnection * connection, const gchar *sender,
 					g_variant_new("as", b_char12));
 			g_variant_builder_add(b_char1, "{sv}", "Notifying",
 					g_variant_new("b", notify));
+			/* Lets BlueZ hand notifications a socket via AcquireNotify */
+			if (g_slist_find_custom(char_info->char_props, "notify",
+					(GCompareFunc)g_strcmp0))
+				g_variant_builder_add(b_char1, "{sv}", "NotifyAcquired",
+						g_variant_new("b", char_info->notify_io != NULL));
 			g_variant_builder_add(b_char1, "{sv}", "Unicast",
 					g_variant_new("s", unicast));
 
@@ -389,6 +402,55 @@ static void _extract_value_parameter(GVariant *parameters, unsigned int *len, gu
 	g_variant_unref(v2);
 }
 
+static void _on_notify_io_closed(void *user_data)
+{
+	bt_gatt_char *chr = (bt_gatt_char *)user_data;
+
+	_gatt_io_free(chr->notify_io);
+	chr->notify_io = NULL;
+
+	if (chr->notify_callback)
+		chr->notify_callback(false, chr->notify_user_data);
+}
+
+static void _acquire_notify(bt_gatt_char *chr, GVariant *parameters,
+		GDBusMethodInvocation *invocation)
+{
+	GDBusMessage *message;
+	GUnixFDList *fd_list;
+	GVariant *options;
+	GError *e = NULL;
+	gint32 idx;
+	guint16 mtu = 0;
+	gint fd = -1;
+
+	g_variant_get(parameters, "(h@a{sv})", &idx, &options);
+	g_variant_lookup(options, "mtu", "q", &mtu);
+	g_variant_unref(options);
+
+	message = g_dbus_method_invocation_get_message(invocation);
+	fd_list = g_dbus_message_get_unix_fd_list(message);
+	if (fd_list)
+		fd = g_unix_fd_list_get(fd_list, idx, &e);
+
+	if (fd < 0) {
+		if (e) {
+			log_dbg("%s", e->message);
+			g_clear_error(&e);
+		}
+		g_dbus_method_invocation_return_dbus_error(invocation,
+				"org.bluez.Error.Failed", "No file descriptor");
+		return;
+	}
+
+	_gatt_io_free(chr->notify_io);
+	chr->notify_io = _gatt_io_new(fd, mtu, NULL, _on_notify_io_closed, chr);
+	g_dbus_method_invocation_return_value(invocation, NULL);
+
+	if (chr->notify_io && chr->notify_callback)
+		chr->notify_callback(true, chr->notify_user_data);
+}
+
 static void _char_method_call(GDBusConnection *connection, const gchar *sender,
 		const gchar *object_path, const gchar *interface_name,
 		const gchar *method_name, GVariant *parameters,
@@ -445,6 +507,9 @@ static void _char_method_call(GDBusConnection *connection, const gchar *sender,
 		if (chr->notify_callback)
 			chr->notify_callback(false, chr->notify_user_data);
 
+	} else if (g_strcmp0(method_name, "AcquireNotify") == 0) {
+		_acquire_notify(chr, parameters, invocation);
+
 	} else if (g_strcmp0(method_name, "IndicateConfirm") == 0) {
 		/* TODO */
 	}
@@ -902,6 +967,7 @@ void _free_service(int id)
 
 		l1 = g_slist_remove(l1, char_info);
 
+		_gatt_io_free(char_info->notify_io);
 		g_free(char_info->char_path);
 		g_free(char_info->char_uuid);
 		if (char_info->value_length > 0)
@@ -1053,8 +1119,8 @@ int bt_gatt_unregister_service(int id)
 
 int bt_gatt_notify(int service_id, int char_id, unsigned char *byte, int len)
 {
-	GVariantBuilder *b1, *b11;
-	int i = 0;
+	GVariantBuilder *b1;
+	artik_error err;
 
 	bt_init(G_BUS_TYPE_SYSTEM, &(hci.conn));
 
@@ -1066,26 +1132,34 @@ int bt_gatt_notify(int service_id, int char_id, unsigned char *byte, int len)
 	if (!chr)
 		return E_BT_ERROR;
 
-	b1 = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
-	b11 = g_variant_builder_new(G_VARIANT_TYPE("ay"));
-
-	for (i = 0; i < len; i++)
-		g_variant_builder_add(b11, "y", byte[i]);
-
-	g_variant_builder_add(b1, "{sv}", "Value", g_variant_new("ay", b11));
-
 	if (chr->char_value)
 		free(chr->char_value);
 
 	chr->value_length = len;
 	chr->char_value = malloc(sizeof(unsigned char)*len);
 	memcpy(chr->char_value, byte, len);
+
+	/* Values too long for a single notification go through D-Bus */
+	if (_gatt_io_fits(chr->notify_io, len)) {
+		err = _gatt_io_write(chr->notify_io, byte, len);
+		/* Only a broken link falls back, values never change path */
+		if (err == S_OK || err == E_BUSY)
+			return err;
+	} else if (_gatt_io_pending(chr->notify_io)) {
+		/* Do not overtake the values still queued on the link */
+		return E_BUSY;
+	}
+
+	b1 = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
+	g_variant_builder_add(b1, "{sv}", "Value",
+			g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, byte, len,
+				sizeof(guchar)));
+
 	g_dbus_connection_emit_signal(hci.conn, DBUS_BLUEZ_BUS, chr->char_path,
 			DBUS_IF_PROPERTIES, "PropertiesChanged", g_variant_new("(sa{sv}as)",
 			DBUS_IF_GATTCHARACTERISTIC1, b1, NULL), NULL);
 
 	g_variant_builder_unref(b1);
-	g_variant_builder_unref(b11);
 
 	return S_OK;
 }
@@ -20,10 +20,16 @@
 
 void print_variant(GVariant *v)
 {
+#if !defined(CONFIG_RELEASE) && !defined(CONFIG_LOG_NO_DEBUG)
 	gchar *pretty;
 
+	/* Formatting the whole variant is costly, skip it when filtered out */
+	if (!artik_log_enabled(LOG_LEVEL_DEBUG))
+		return;
+
 	pretty = g_variant_print(v, TRUE);
 	log_dbg("GVariant type: %s", g_variant_get_type_string(v));
 	log_dbg("GVariant value: %s", pretty);
 	g_free(pretty);
+#endif
 }
@@ -25,9 +25,13 @@
 #include "avrcp.h"
 #include "pan.h"
 #include "spp.h"
+#include "spp_stream.h"
 #include "ftp.h"
 #include "advertisement.h"
 #include "agent.h"
+#include "async.h"
+#include "scan.h"
+#include "assigned_numbers.h"
 
 artik_error os_bt_set_scan_filter(artik_bt_scan_filter *filter)
 {
@@ -642,3 +646,109 @@ artik_error os_bt_agent_send_empty_response(artik_bt_agent_request_handle handle
 {
 	return bt_agent_send_empty_response(handle);
 }
+
+artik_error os_bt_set_async_timeout(unsigned int timeout_ms)
+{
+	return bt_set_async_timeout(timeout_ms);
+}
+
+artik_error os_bt_connect_async(const char *addr,
+		artik_bt_async_callback callback, void *user_data)
+{
+	return bt_connect_async(addr, callback, user_data);
+}
+
+artik_error os_bt_disconnect_async(const char *addr,
+		artik_bt_async_callback callback, void *user_data)
+{
+	return bt_disconnect_async(addr, callback, user_data);
+}
+
+artik_error os_bt_get_device_property_async(const char *addr,
+		const char *property, artik_bt_async_callback callback,
+		void *user_data)
+{
+	return bt_get_device_property_async(addr, property, callback,
+			user_data);
+}
+
+artik_error os_bt_gatt_char_read_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data)
+{
+	return bt_gatt_char_read_value_async(addr, srv_uuid, char_uuid,
+			callback, user_data);
+}
+
+artik_error os_bt_gatt_char_write_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		const unsigned char byte[], int byte_len,
+		artik_bt_async_callback callback, void *user_data)
+{
+	return bt_gatt_char_write_value_async(addr, srv_uuid, char_uuid,
+			byte, byte_len, callback, user_data);
+}
+
+artik_error os_bt_gatt_start_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data)
+{
+	return bt_gatt_start_notify_async(addr, srv_uuid, char_uuid,
+			callback, user_data);
+}
+
+artik_error os_bt_gatt_stop_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data)
+{
+	return bt_gatt_stop_notify_async(addr, srv_uuid, char_uuid,
+			callback, user_data);
+}
+
+artik_error os_bt_set_scan_report(const artik_bt_scan_report_config *config)
+{
+	return bt_set_scan_report(config);
+}
+
+artik_error os_bt_uuid_parse(const char *str, artik_bt_uuid128 *uuid)
+{
+	return _uuid_parse(str, uuid->bytes) < 0 ? E_BAD_ARGS : S_OK;
+}
+
+artik_error os_bt_uuid_format(const artik_bt_uuid128 *uuid, char *str)
+{
+	_uuid_format(uuid->bytes, str);
+
+	return S_OK;
+}
+
+artik_error os_bt_uuid_get_name(const char *uuid, const char **name)
+{
+	*name = _get_uuid_name(uuid);
+
+	return *name ? S_OK : E_BAD_ARGS;
+}
+
+artik_error os_bt_spp_stream_open(int fd,
+		const artik_bt_spp_stream_config *config,
+		artik_bt_spp_stream_handle *handle)
+{
+	return bt_spp_stream_open(fd, config, handle);
+}
+
+artik_error os_bt_spp_stream_write(artik_bt_spp_stream_handle handle,
+		const unsigned char *data, unsigned int len)
+{
+	return bt_spp_stream_write(handle, data, len);
+}
+
+artik_error os_bt_spp_stream_get_stats(artik_bt_spp_stream_handle handle,
+		artik_bt_spp_stream_stats *stats)
+{
+	return bt_spp_stream_get_stats(handle, stats);
+}
+
+artik_error os_bt_spp_stream_close(artik_bt_spp_stream_handle handle)
+{
+	return bt_spp_stream_close(handle);
+}
@@ -0,0 +1,431 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+#include <string.h>
+
+#include "core.h"
+#include "scan.h"
+#include "assigned_numbers.h"
+
+#define BT_ADDRESS_STR_LEN	17
+#define BT_DEVICE_PATH_PREFIX	"/dev_"
+
+/* BlueZ names device objects after their address, e.g. dev_00_11_22_33_44_55 */
+static gboolean _scan_path_address(const gchar *path, gchar *address)
+{
+	const gchar *dev = g_strrstr(path, BT_DEVICE_PATH_PREFIX);
+	int i;
+
+	if (dev == NULL)
+		return FALSE;
+
+	dev += strlen(BT_DEVICE_PATH_PREFIX);
+	if (strlen(dev) != BT_ADDRESS_STR_LEN)
+		return FALSE;
+
+	for (i = 0; i < BT_ADDRESS_STR_LEN; i++)
+		address[i] = dev[i] == '_' ? ':' : dev[i];
+	address[i] = '\0';
+
+	return TRUE;
+}
+
+static void _scan_clear_uuids(artik_bt_device *device)
+{
+	int i;
+
+	for (i = 0; i < device->uuid_length; i++) {
+		g_free(device->uuid_list[i].uuid);
+		g_free(device->uuid_list[i].uuid_name);
+	}
+	g_free(device->uuid_list);
+	device->uuid_list = NULL;
+	device->uuid_length = 0;
+}
+
+static void _scan_entry_free(gpointer data)
+{
+	bt_scan_entry *entry = (bt_scan_entry *)data;
+
+	_scan_clear_uuids(&entry->device);
+	g_free(entry->device.remote_address);
+	g_free(entry->device.remote_name);
+	g_free(entry->device.manufacturer_data);
+	g_free(entry->device.svc_data);
+	g_free(entry);
+}
+
+static gboolean _scan_merge_bytes(char **data, int *len, GVariant *v)
+{
+	gconstpointer bytes;
+	gsize n = 0;
+
+	if (!g_variant_is_of_type(v, G_VARIANT_TYPE_BYTESTRING))
+		return FALSE;
+
+	bytes = g_variant_get_fixed_array(v, &n, sizeof(guchar));
+	if (*len == (int)n && (n == 0 || !memcmp(*data, bytes, n)))
+		return FALSE;
+
+	g_free(*data);
+	*data = NULL;
+	if (n > 0) {
+		*data = g_malloc(n);
+		memcpy(*data, bytes, n);
+	}
+	*len = n;
+
+	return TRUE;
+}
+
+static gboolean _scan_merge_uuids(artik_bt_device *device, GVariant *v)
+{
+	gsize i, n = g_variant_n_children(v);
+	const gchar *uuid;
+
+	if ((gsize)device->uuid_length == n) {
+		for (i = 0; i < n; i++) {
+			g_variant_get_child(v, i, "&s", &uuid);
+			if (g_strcmp0(uuid, device->uuid_list[i].uuid))
+				break;
+		}
+		if (i == n)
+			return FALSE;
+	}
+
+	_scan_clear_uuids(device);
+	if (n == 0)
+		return TRUE;
+
+	device->uuid_list = g_new0(artik_bt_uuid, n);
+	device->uuid_length = n;
+	for (i = 0; i < n; i++) {
+		g_variant_get_child(v, i, "s", &device->uuid_list[i].uuid);
+		device->uuid_list[i].uuid_name =
+			g_strdup(_get_uuid_name(device->uuid_list[i].uuid));
+	}
+
+	return TRUE;
+}
+
+/* Returns TRUE if one of the properties changed the device */
+static gboolean _scan_merge(artik_bt_device *device, GVariant *properties,
+		guint rssi_hysteresis)
+{
+	GVariantIter iter;
+	GVariant *v, *data;
+	const gchar *key, *str;
+	artik_bt_class cod;
+	gboolean changed = FALSE, b;
+	guint16 id;
+	gint16 rssi;
+	guint delta;
+
+	g_variant_iter_init(&iter, properties);
+	while (g_variant_iter_loop(&iter, "{&sv}", &key, &v)) {
+		if (g_strcmp0(key, "RSSI") == 0) {
+			rssi = g_variant_get_int16(v);
+			delta = ABS(rssi - device->rssi);
+			if (device->rssi == 0 || delta >= MAX(rssi_hysteresis, 1)) {
+				device->rssi = rssi;
+				changed = TRUE;
+			}
+		} else if (g_strcmp0(key, "Name") == 0) {
+			str = g_variant_get_string(v, NULL);
+			if (g_strcmp0(str, device->remote_name)) {
+				g_free(device->remote_name);
+				device->remote_name = g_strdup(str);
+				changed = TRUE;
+			}
+		} else if (g_strcmp0(key, "Class") == 0) {
+			_set_device_class(&cod, g_variant_get_uint32(v));
+			if (memcmp(&cod, &device->cod, sizeof(cod))) {
+				device->cod = cod;
+				changed = TRUE;
+			}
+		} else if (g_strcmp0(key, "Paired") == 0) {
+			b = g_variant_get_boolean(v);
+			if (b != device->is_bonded) {
+				device->is_bonded = b;
+				changed = TRUE;
+			}
+		} else if (g_strcmp0(key, "Connected") == 0) {
+			b = g_variant_get_boolean(v);
+			if (b != device->is_connected) {
+				device->is_connected = b;
+				changed = TRUE;
+			}
+		} else if (g_strcmp0(key, "UUIDs") == 0) {
+			changed |= _scan_merge_uuids(device, v);
+		} else if (g_strcmp0(key, "ManufacturerData") == 0) {
+			if (g_variant_n_children(v) == 0)
+				continue;
+			g_variant_get_child(v, 0, "{qv}", &id, &data);
+			if (id != (guint16)device->manufacturer_id ||
+					device->manufacturer_name[0] == '\0') {
+				device->manufacturer_id = id;
+				strncpy(device->manufacturer_name, _get_company_name(id),
+						MAX_BT_NAME_LEN - 1);
+				changed = TRUE;
+			}
+			changed |= _scan_merge_bytes(&device->manufacturer_data,
+					&device->manufacturer_data_len, data);
+			g_variant_unref(data);
+		} else if (g_strcmp0(key, "ServiceData") == 0) {
+			if (g_variant_n_children(v) == 0)
+				continue;
+			g_variant_get_child(v, 0, "{&sv}", &str, &data);
+			if (g_strcmp0(str, device->svc_uuid)) {
+				strncpy(device->svc_uuid, str, MAX_BT_UUID_LEN - 1);
+				changed = TRUE;
+			}
+			changed |= _scan_merge_bytes(&device->svc_data,
+					&device->svc_data_len, data);
+			g_variant_unref(data);
+		}
+	}
+
+	return changed;
+}
+
+static bt_scan_entry *_scan_entry(bt_scan_aggregator *scan, const gchar *path)
+{
+	gchar address[BT_ADDRESS_STR_LEN + 1];
+	bt_scan_entry *entry;
+
+	if (!_scan_path_address(path, address))
+		return NULL;
+
+	entry = g_hash_table_lookup(scan->devices, address);
+	if (entry != NULL)
+		return entry;
+
+	entry = g_new0(bt_scan_entry, 1);
+	entry->device.remote_address = g_strdup(address);
+	g_hash_table_insert(scan->devices, entry->device.remote_address, entry);
+
+	return entry;
+}
+
+void _scan_device_added(const gchar *path, GVariant *properties)
+{
+	bt_scan_aggregator *scan = hci.scan;
+	bt_scan_entry *entry;
+
+	if (scan == NULL)
+		return;
+
+	entry = _scan_entry(scan, path);
+	if (entry == NULL)
+		return;
+
+	if (_scan_merge(&entry->device, properties, scan->rssi_hysteresis) &&
+			!entry->changed) {
+		entry->changed = TRUE;
+		g_ptr_array_add(scan->changed, entry);
+	}
+}
+
+void _scan_device_changed(const gchar *path, GVariant *properties)
+{
+	/* An update merges the same way, a device seen for the first time
+	 * from an update only lacks the properties not in it.
+	 */
+	_scan_device_added(path, properties);
+}
+
+void _scan_device_removed(const gchar *path)
+{
+	bt_scan_aggregator *scan = hci.scan;
+	gchar address[BT_ADDRESS_STR_LEN + 1];
+	bt_scan_entry *entry;
+
+	if (scan == NULL || !_scan_path_address(path, address))
+		return;
+
+	entry = g_hash_table_lookup(scan->devices, address);
+	if (entry == NULL)
+		return;
+
+	if (entry->changed)
+		g_ptr_array_remove_fast(scan->changed, entry);
+	g_hash_table_remove(scan->devices, address);
+}
+
+static gboolean _scan_strv_contains(gchar **strv, const gchar *str)
+{
+	for (; str && *strv; strv++) {
+		if (g_ascii_strcasecmp(*strv, str) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean _scan_matches(bt_scan_aggregator *scan,
+		const artik_bt_device *device)
+{
+	int i;
+
+	/* A device without RSSI was not received during this scan */
+	if (scan->rssi != 0 && (device->rssi == 0 || device->rssi < scan->rssi))
+		return FALSE;
+
+	if (scan->addresses &&
+			!_scan_strv_contains(scan->addresses, device->remote_address))
+		return FALSE;
+
+	if (scan->uuids == NULL)
+		return TRUE;
+
+	for (i = 0; i < device->uuid_length; i++) {
+		if (_scan_strv_contains(scan->uuids, device->uuid_list[i].uuid))
+			return TRUE;
+	}
+
+	return _scan_strv_contains(scan->uuids, device->svc_uuid);
+}
+
+static gboolean _scan_report(gpointer user_data)
+{
+	bt_scan_aggregator *scan = (bt_scan_aggregator *)user_data;
+	artik_bt_scan_report report;
+	bt_scan_entry *entry;
+	guint i;
+
+	g_array_set_size(scan->report, 0);
+	for (i = 0; i < scan->changed->len; i++) {
+		entry = g_ptr_array_index(scan->changed, i);
+		entry->changed = FALSE;
+		if (_scan_matches(scan, &entry->device))
+			g_array_append_val(scan->report, entry->device);
+	}
+	g_ptr_array_set_size(scan->changed, 0);
+
+	if (scan->report->len == 0)
+		return G_SOURCE_CONTINUE;
+
+	log_dbg("%s: %d devices changed", __func__, scan->report->len);
+
+	/* The devices are borrowed from the table for the callback */
+	report.devices = (artik_bt_device *)scan->report->data;
+	report.num_devices = scan->report->len;
+	_user_callback(BT_EVENT_SCAN_REPORT, &report);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/* Devices already known when reporting starts are reported on their next update */
+static void _scan_load(bt_scan_aggregator *scan)
+{
+	GVariant *objects, *interfaces, *properties;
+	GVariantIter *iter;
+	const gchar *path;
+	bt_scan_entry *entry;
+
+	if (_get_managed_objects(&objects) != S_OK)
+		return;
+
+	g_variant_get(objects, "(a{oa{sa{sv}}})", &iter);
+	while (g_variant_iter_loop(iter, "{&o@a{sa{sv}}}", &path, &interfaces)) {
+		properties = g_variant_lookup_value(interfaces, DBUS_IF_DEVICE1,
+				G_VARIANT_TYPE("a{sv}"));
+		if (properties == NULL)
+			continue;
+
+		entry = _scan_entry(scan, path);
+		if (entry != NULL)
+			_scan_merge(&entry->device, properties, 0);
+		g_variant_unref(properties);
+	}
+	g_variant_iter_free(iter);
+	g_variant_unref(objects);
+}
+
+static void _scan_set_filters(bt_scan_aggregator *scan,
+		const artik_bt_scan_report_config *config)
+{
+	unsigned int i;
+
+	g_strfreev(scan->addresses);
+	g_strfreev(scan->uuids);
+	scan->addresses = NULL;
+	scan->uuids = NULL;
+
+	scan->rssi = config->rssi;
+	scan->rssi_hysteresis = config->rssi_hysteresis;
+
+	if (config->address_length > 0) {
+		scan->addresses = g_new0(gchar *, config->address_length + 1);
+		for (i = 0; i < config->address_length; i++)
+			scan->addresses[i] = g_strdup(config->address_list[i]);
+	}
+
+	if (config->uuid_length > 0) {
+		scan->uuids = g_new0(gchar *, config->uuid_length + 1);
+		for (i = 0; i < config->uuid_length; i++)
+			scan->uuids[i] = g_strdup(config->uuid_list[i].uuid);
+	}
+}
+
+artik_error bt_set_scan_report(const artik_bt_scan_report_config *config)
+{
+	bt_scan_aggregator *scan = hci.scan;
+
+	bt_init(G_BUS_TYPE_SYSTEM, &(hci.conn));
+
+	if (config == NULL) {
+		_scan_free();
+		return S_OK;
+	}
+
+	/* Changing the configuration keeps the devices seen so far */
+	if (scan == NULL) {
+		scan = g_new0(bt_scan_aggregator, 1);
+		scan->devices = g_hash_table_new_full(g_str_hash, g_str_equal,
+				NULL, _scan_entry_free);
+		scan->changed = g_ptr_array_new();
+		scan->report = g_array_new(FALSE, FALSE, sizeof(artik_bt_device));
+		_scan_load(scan);
+		hci.scan = scan;
+	} else {
+		g_source_remove(scan->timeout_id);
+	}
+
+	_scan_set_filters(scan, config);
+	scan->timeout_id = g_timeout_add(config->interval, _scan_report, scan);
+
+	return S_OK;
+}
+
+void _scan_free(void)
+{
+	bt_scan_aggregator *scan = hci.scan;
+
+	if (scan == NULL)
+		return;
+
+	hci.scan = NULL;
+	g_source_remove(scan->timeout_id);
+	g_hash_table_destroy(scan->devices);
+	g_ptr_array_free(scan->changed, TRUE);
+	g_array_free(scan->report, TRUE);
+	g_strfreev(scan->addresses);
+	g_strfreev(scan->uuids);
+	g_free(scan);
+}
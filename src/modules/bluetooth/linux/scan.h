@@ -0,0 +1,63 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef __ARTIK_BT_SCAN_H
+#define __ARTIK_BT_SCAN_H
+
+#include <artik_bluetooth.h>
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include <gio/gio.h>
+#pragma GCC diagnostic pop
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	artik_bt_device device;
+	gboolean changed;
+} bt_scan_entry;
+
+/*
+ * Devices seen by the scan, keyed by address. Updates are merged in the
+ * table as they arrive and the changed entries are reported on a timer.
+ */
+typedef struct {
+	GHashTable *devices;
+	GPtrArray *changed;
+	GArray *report;
+	guint timeout_id;
+	gint16 rssi;
+	guint rssi_hysteresis;
+	gchar **addresses;
+	gchar **uuids;
+} bt_scan_aggregator;
+
+artik_error bt_set_scan_report(const artik_bt_scan_report_config *config);
+
+void _scan_device_added(const gchar *path, GVariant *properties);
+void _scan_device_changed(const gchar *path, GVariant *properties);
+void _scan_device_removed(const gchar *path);
+void _scan_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ARTIK_BT_SCAN_H */
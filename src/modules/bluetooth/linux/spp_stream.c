@@ -0,0 +1,440 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <artik_module.h>
+
+#include "core.h"
+#include "spp_stream.h"
+
+/* Reads per wakeup before giving the loop back */
+#define SPP_STREAM_READ_BATCH	16
+/* Smallest chunk allocated for queued data */
+#define SPP_STREAM_CHUNK_SIZE	(16 * 1024)
+/* Chunks sent by one sendmsg() call */
+#define SPP_STREAM_IOV_MAX	64
+
+static void _spp_stream_destroy(bt_spp_stream *s)
+{
+	if (s->in_watch)
+		s->loop->remove_fd_watch(s->in_watch);
+	if (s->out_watch)
+		s->loop->remove_fd_watch(s->out_watch);
+
+	artik_release_api_module(s->loop);
+	close(s->fd);
+	g_queue_free_full(s->tx, g_free);
+	g_free(s->rx);
+	g_free(s);
+}
+
+/* Drops the queued data, nothing more can be sent */
+static void _spp_stream_shutdown(bt_spp_stream *s)
+{
+	g_queue_free_full(s->tx, g_free);
+	s->tx = g_queue_new();
+	s->stats.tx_queued = 0;
+	s->tx_full = FALSE;
+	s->closed = TRUE;
+
+	if (s->out_watch) {
+		s->loop->remove_fd_watch(s->out_watch);
+		s->out_watch = 0;
+	}
+}
+
+/* Returns -1 on errors, 0 when the queue is empty or the socket is full */
+static int _spp_stream_flush(bt_spp_stream *s)
+{
+	struct iovec iov[SPP_STREAM_IOV_MAX];
+	struct msghdr msg;
+	bt_spp_chunk *chunk;
+	GList *l;
+	gboolean full = FALSE;
+	gsize total;
+	ssize_t n;
+	int i;
+
+	while (!g_queue_is_empty(s->tx)) {
+		total = 0;
+		for (i = 0, l = s->tx->head; l && i < SPP_STREAM_IOV_MAX;
+				i++, l = l->next) {
+			chunk = (bt_spp_chunk *)l->data;
+			iov[i].iov_base = chunk->data + chunk->sent;
+			iov[i].iov_len = chunk->len - chunk->sent;
+			total += iov[i].iov_len;
+		}
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = i;
+
+		n = sendmsg(s->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			log_dbg("%s: fd %d: %s", __func__, s->fd, strerror(errno));
+			return -1;
+		}
+
+		s->stats.tx_writes++;
+		s->stats.tx_bytes += n;
+		s->stats.tx_queued -= n;
+
+		/* A short write filled the socket */
+		if ((gsize)n < total)
+			full = TRUE;
+
+		while (n > 0) {
+			chunk = g_queue_peek_head(s->tx);
+			if ((gsize)n < chunk->len - chunk->sent) {
+				chunk->sent += n;
+				break;
+			}
+			n -= chunk->len - chunk->sent;
+			g_free(g_queue_pop_head(s->tx));
+		}
+
+		if (full)
+			break;
+	}
+
+	return 0;
+}
+
+static void _spp_stream_close_event(bt_spp_stream *s)
+{
+	if (s->closed)
+		return;
+
+	log_dbg("%s: fd %d closed", __func__, s->fd);
+
+	_spp_stream_shutdown(s);
+	if (s->config.close_func)
+		s->config.close_func(s, s->config.user_data);
+}
+
+/* Moves the received data to the start of the buffer */
+static void _spp_stream_linearize(bt_spp_stream *s)
+{
+	guchar *rx = g_malloc(s->config.rx_buffer_size);
+	guint first = s->config.rx_buffer_size - s->rx_head;
+
+	memcpy(rx, s->rx + s->rx_head, first);
+	memcpy(rx + first, s->rx, s->rx_len - first);
+	g_free(s->rx);
+	s->rx = rx;
+	s->rx_head = 0;
+}
+
+/* Returns -1 if nothing can be consumed from a full buffer */
+static int _spp_stream_deliver(bt_spp_stream *s)
+{
+	guint size = s->config.rx_buffer_size;
+	guint len, consumed;
+
+	while (s->rx_len > 0) {
+		len = MIN(s->rx_len, size - s->rx_head);
+		consumed = s->config.read_func(s, s->rx + s->rx_head, len,
+				s->config.user_data);
+		s->stats.rx_batches++;
+		if (s->freed)
+			return 0;
+
+		consumed = MIN(consumed, len);
+		s->rx_head = (s->rx_head + consumed) % size;
+		s->rx_len -= consumed;
+		/* Offer what is left, the reader may take it now */
+		if (consumed > 0)
+			continue;
+
+		/* Pass wrapped data again in one piece */
+		if (len < s->rx_len) {
+			_spp_stream_linearize(s);
+			continue;
+		}
+		break;
+	}
+
+	if (s->rx_len == 0)
+		s->rx_head = 0;
+
+	return s->rx_len == size ? -1 : 0;
+}
+
+/* Returns -1 on errors or end of stream */
+static int _spp_stream_read(bt_spp_stream *s)
+{
+	guint size = s->config.rx_buffer_size;
+	struct iovec iov[2];
+	guint tail, space;
+	ssize_t n;
+	int i;
+
+	for (i = 0; i < SPP_STREAM_READ_BATCH && s->rx_len < size; i++) {
+		tail = (s->rx_head + s->rx_len) % size;
+		space = size - s->rx_len;
+		iov[0].iov_base = s->rx + tail;
+		iov[0].iov_len = MIN(space, size - tail);
+		iov[1].iov_base = s->rx;
+		iov[1].iov_len = space - iov[0].iov_len;
+
+		n = readv(s->fd, iov, iov[1].iov_len ? 2 : 1);
+		if (n > 0) {
+			s->stats.rx_reads++;
+			s->stats.rx_bytes += n;
+			s->rx_len += n;
+			/* A short read drained the socket */
+			if ((guint)n < space)
+				break;
+			continue;
+		}
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+
+		if (n < 0)
+			log_dbg("%s: fd %d: %s", __func__, s->fd, strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+static int _spp_stream_in_watch(int fd, enum watch_io io, void *user_data)
+{
+	bt_spp_stream *s = (bt_spp_stream *)user_data;
+	gboolean end = FALSE;
+
+	s->dispatching = TRUE;
+
+	if (io & WATCH_IO_IN) {
+		if (_spp_stream_read(s) < 0)
+			end = TRUE;
+
+		if (s->rx_len && _spp_stream_deliver(s) < 0) {
+			log_err("%s: %u bytes not consumed", __func__, s->rx_len);
+			end = TRUE;
+		}
+	} else if (io & (WATCH_IO_HUP | WATCH_IO_ERR | WATCH_IO_NVAL)) {
+		end = TRUE;
+	}
+
+	if (end && !s->freed)
+		_spp_stream_close_event(s);
+
+	s->dispatching = FALSE;
+
+	if (s->freed || end) {
+		/* The loop drops the watch when we return 0 */
+		s->in_watch = 0;
+		if (s->freed)
+			_spp_stream_destroy(s);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int _spp_stream_out_watch(int fd, enum watch_io io, void *user_data)
+{
+	bt_spp_stream *s = (bt_spp_stream *)user_data;
+
+	s->dispatching = TRUE;
+
+	if (_spp_stream_flush(s) < 0) {
+		_spp_stream_close_event(s);
+	} else if (s->tx_full &&
+			s->stats.tx_queued <= s->config.tx_queue_limit / 2) {
+		s->tx_full = FALSE;
+		if (s->config.drain_func)
+			s->config.drain_func(s, s->config.user_data);
+	}
+
+	s->dispatching = FALSE;
+
+	if (s->freed) {
+		s->out_watch = 0;
+		_spp_stream_destroy(s);
+		return 0;
+	}
+
+	if (!g_queue_is_empty(s->tx))
+		return 1;
+
+	/* The loop drops the watch when we return 0 */
+	s->out_watch = 0;
+
+	return 0;
+}
+
+artik_error bt_spp_stream_open(int fd, const artik_bt_spp_stream_config *config,
+		artik_bt_spp_stream_handle *handle)
+{
+	enum watch_io cond = WATCH_IO_HUP | WATCH_IO_ERR | WATCH_IO_NVAL;
+	bt_spp_stream *s;
+	int flags;
+
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		log_err("%s: fd %d: %s", __func__, fd, strerror(errno));
+		return E_BAD_ARGS;
+	}
+
+	s = g_new0(bt_spp_stream, 1);
+	s->fd = fd;
+	s->config = *config;
+	if (s->config.rx_buffer_size == 0)
+		s->config.rx_buffer_size = SPP_STREAM_RX_BUFFER_SIZE;
+	if (s->config.tx_queue_limit == 0)
+		s->config.tx_queue_limit = SPP_STREAM_TX_QUEUE_LIMIT;
+	s->tx = g_queue_new();
+
+	if (s->config.read_func) {
+		s->rx = g_malloc(s->config.rx_buffer_size);
+		cond |= WATCH_IO_IN;
+	}
+
+	s->loop = (artik_loop_module *)artik_request_api_module("loop");
+	if (s->loop->add_fd_watch(fd, cond, _spp_stream_in_watch, s,
+			&s->in_watch) != S_OK) {
+		log_err("Failed to watch fd %d", fd);
+		s->in_watch = 0;
+		_spp_stream_destroy(s);
+		return E_BT_ERROR;
+	}
+
+	*handle = s;
+
+	return S_OK;
+}
+
+static void _spp_stream_queue(bt_spp_stream *s, const unsigned char *data,
+		unsigned int len)
+{
+	bt_spp_chunk *chunk = g_queue_peek_tail(s->tx);
+	guint n;
+
+	if (chunk && chunk->len < chunk->size) {
+		n = MIN(len, chunk->size - chunk->len);
+		memcpy(chunk->data + chunk->len, data, n);
+		chunk->len += n;
+		data += n;
+		len -= n;
+	}
+
+	if (len > 0) {
+		chunk = g_malloc(sizeof(bt_spp_chunk) +
+				MAX(len, SPP_STREAM_CHUNK_SIZE));
+		chunk->size = MAX(len, SPP_STREAM_CHUNK_SIZE);
+		chunk->len = len;
+		chunk->sent = 0;
+		memcpy(chunk->data, data, len);
+		g_queue_push_tail(s->tx, chunk);
+	}
+}
+
+artik_error bt_spp_stream_write(artik_bt_spp_stream_handle handle,
+		const unsigned char *data, unsigned int len)
+{
+	bt_spp_stream *s = (bt_spp_stream *)handle;
+	ssize_t n = 0;
+
+	if (s->closed)
+		return E_NOT_CONNECTED;
+
+	/* A single write larger than the limit is let through on its own */
+	if (s->stats.tx_queued &&
+			s->stats.tx_queued + len > s->config.tx_queue_limit) {
+		s->tx_full = TRUE;
+		s->stats.tx_busy++;
+		return E_BUSY;
+	}
+
+	if (g_queue_is_empty(s->tx)) {
+		do {
+			n = send(s->fd, data, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+		} while (n < 0 && errno == EINTR);
+
+		if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			log_dbg("%s: fd %d: %s", __func__, s->fd, strerror(errno));
+			return E_BT_ERROR;
+		}
+
+		if (n < 0) {
+			n = 0;
+		} else {
+			s->stats.tx_writes++;
+			s->stats.tx_bytes += n;
+		}
+	}
+
+	if ((unsigned int)n == len)
+		return S_OK;
+
+	_spp_stream_queue(s, data + n, len - n);
+	s->stats.tx_queued += len - n;
+	s->stats.tx_queue_peak = MAX(s->stats.tx_queue_peak,
+			s->stats.tx_queued);
+
+	if (s->out_watch == 0 && s->loop->add_fd_watch(s->fd, WATCH_IO_OUT,
+			_spp_stream_out_watch, s, &s->out_watch) != S_OK) {
+		log_err("Failed to watch fd %d", s->fd);
+		s->out_watch = 0;
+		return E_BT_ERROR;
+	}
+
+	return S_OK;
+}
+
+artik_error bt_spp_stream_get_stats(artik_bt_spp_stream_handle handle,
+		artik_bt_spp_stream_stats *stats)
+{
+	bt_spp_stream *s = (bt_spp_stream *)handle;
+
+	*stats = s->stats;
+
+	return S_OK;
+}
+
+artik_error bt_spp_stream_close(artik_bt_spp_stream_handle handle)
+{
+	bt_spp_stream *s = (bt_spp_stream *)handle;
+
+	if (s->freed)
+		return E_BAD_ARGS;
+
+	/* Inside a callback, let the watch finish and drop itself */
+	if (s->dispatching) {
+		s->freed = TRUE;
+		return S_OK;
+	}
+
+	_spp_stream_destroy(s);
+
+	return S_OK;
+}
@@ -0,0 +1,81 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef __ARTIK_BT_SPP_STREAM_H
+#define __ARTIK_BT_SPP_STREAM_H
+
+#include <artik_bluetooth.h>
+#include <artik_loop.h>
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include <gio/gio.h>
+#pragma GCC diagnostic pop
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPP_STREAM_RX_BUFFER_SIZE	(64 * 1024)
+#define SPP_STREAM_TX_QUEUE_LIMIT	(1024 * 1024)
+
+/*
+ * Data queued for sending. Small writes are appended to the last chunk,
+ * and the chunks are sent together with one sendmsg() call.
+ */
+typedef struct {
+	guint size;
+	guint len;
+	guint sent;
+	guchar data[];
+} bt_spp_chunk;
+
+typedef struct {
+	int fd;
+	int in_watch;
+	int out_watch;
+	artik_loop_module *loop;
+	artik_bt_spp_stream_config config;
+	/* Received data not consumed yet, starting at rx_head */
+	guchar *rx;
+	guint rx_head;
+	guint rx_len;
+	GQueue *tx;
+	/* A write got E_BUSY, the drain callback is owed */
+	gboolean tx_full;
+	gboolean closed;
+	gboolean dispatching;
+	gboolean freed;
+	artik_bt_spp_stream_stats stats;
+} bt_spp_stream;
+
+artik_error bt_spp_stream_open(int fd, const artik_bt_spp_stream_config *config,
+		artik_bt_spp_stream_handle *handle);
+
+artik_error bt_spp_stream_write(artik_bt_spp_stream_handle handle,
+		const unsigned char *data, unsigned int len);
+
+artik_error bt_spp_stream_get_stats(artik_bt_spp_stream_handle handle,
+		artik_bt_spp_stream_stats *stats);
+
+artik_error bt_spp_stream_close(artik_bt_spp_stream_handle handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ARTIK_BT_SPP_STREAM_H */
@@ -176,6 +176,39 @@ artik_error os_bt_agent_send_passkey(artik_bt_agent_request_handle handle, unsig
 artik_error os_bt_agent_send_error(artik_bt_agent_request_handle handle,
 		artik_bt_agent_request_error e, const char *err_msg);
 artik_error os_bt_agent_send_empty_response(artik_bt_agent_request_handle handle);
+artik_error os_bt_set_async_timeout(unsigned int timeout_ms);
+artik_error os_bt_connect_async(const char *addr,
+		artik_bt_async_callback callback, void *user_data);
+artik_error os_bt_disconnect_async(const char *addr,
+		artik_bt_async_callback callback, void *user_data);
+artik_error os_bt_get_device_property_async(const char *addr,
+		const char *property, artik_bt_async_callback callback,
+		void *user_data);
+artik_error os_bt_gatt_char_read_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data);
+artik_error os_bt_gatt_char_write_value_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		const unsigned char byte[], int byte_len,
+		artik_bt_async_callback callback, void *user_data);
+artik_error os_bt_gatt_start_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data);
+artik_error os_bt_gatt_stop_notify_async(const char *addr,
+		const char *srv_uuid, const char *char_uuid,
+		artik_bt_async_callback callback, void *user_data);
+artik_error os_bt_set_scan_report(const artik_bt_scan_report_config *config);
+artik_error os_bt_uuid_parse(const char *str, artik_bt_uuid128 *uuid);
+artik_error os_bt_uuid_format(const artik_bt_uuid128 *uuid, char *str);
+artik_error os_bt_uuid_get_name(const char *uuid, const char **name);
+artik_error os_bt_spp_stream_open(int fd,
+		const artik_bt_spp_stream_config *config,
+		artik_bt_spp_stream_handle *handle);
+artik_error os_bt_spp_stream_write(artik_bt_spp_stream_handle handle,
+		const unsigned char *data, unsigned int len);
+artik_error os_bt_spp_stream_get_stats(artik_bt_spp_stream_handle handle,
+		artik_bt_spp_stream_stats *stats);
+artik_error os_bt_spp_stream_close(artik_bt_spp_stream_handle handle);
 #ifdef __cplusplus
 }
 #endif
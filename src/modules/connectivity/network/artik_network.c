@@ -55,6 +55,8 @@ static artik_error artik_add_watch_online_status(
 		void *user_data);
 static artik_error artik_remove_watch_online_status(
 		watch_online_status_handle handle);
+static artik_error artik_set_online_status_probe(const char *address,
+		int port, unsigned int timeout_ms);
 
 const artik_network_module network_module = {
 		artik_set_network_config,
@@ -66,7 +68,8 @@ const artik_network_module network_module = {
 		artik_dhcp_server_stop,
 		artik_get_online_status,
 		artik_add_watch_online_status,
-		artik_remove_watch_online_status
+		artik_remove_watch_online_status,
+		artik_set_online_status_probe
 };
 
 artik_error artik_get_current_public_ip(artik_network_ip *ip)
@@ -110,17 +113,10 @@ exit:
 
 artik_error artik_get_online_status(bool *online_status)
 {
-	artik_network_ip current_ip;
-	artik_error ret = artik_get_current_public_ip(&current_ip);
-
-	if (ret == S_OK) {
-		*online_status = true;
-	} else if (ret == E_HTTP_ERROR) {
-		*online_status = false;
-		ret = S_OK;
-	}
+	if (!online_status)
+		return E_BAD_ARGS;
 
-	return ret;
+	return os_network_get_online_status(online_status);
 }
 
 artik_error artik_dhcp_client_start(artik_network_dhcp_client_handle *handle,
@@ -169,3 +165,9 @@ artik_error artik_remove_watch_online_status(watch_online_status_handle handle)
 {
 	return os_network_remove_watch_online_status(handle);
 }
+
+artik_error artik_set_online_status_probe(const char *address, int port,
+					unsigned int timeout_ms)
+{
+	return os_network_set_online_status_probe(address, port, timeout_ms);
+}
@@ -79,3 +79,8 @@ artik_error artik::Network::remove_watch_online_status(
     watch_online_status_handle handle) {
   return m_module->remove_watch_online_status(handle);
 }
+
+artik_error artik::Network::set_online_status_probe(const char *address,
+    int port, unsigned int timeout_ms) {
+  return m_module->set_online_status_probe(address, port, timeout_ms);
+}
@@ -51,21 +51,28 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 
 #include <netinet/in.h>
 #include <net/if.h>
 
 #include <arpa/inet.h>
 
+#include <artik_loop.h>
+#include <artik_module.h>
+
 #include "dhcpc.h"
 
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
 
-#define STATE_INITIAL		0
-#define STATE_HAVE_OFFER	1
-#define STATE_HAVE_LEASE	2
+#define STATE_INIT		0
+#define STATE_SELECTING		1
+#define STATE_REQUESTING	2
+#define STATE_BOUND		3
+#define STATE_RENEWING		4
+#define STATE_REBINDING		5
 
 #define BOOTP_BROADCAST		0x8000
 
@@ -86,6 +93,7 @@
 #define DHCPNAK			6
 #define DHCPRELEASE		7
 
+#define DHCP_OPTION_PAD		0
 #define DHCP_OPTION_SUBNET_MASK 1
 #define DHCP_OPTION_ROUTER	3
 #define DHCP_OPTION_DNS_SERVER	6
@@ -94,9 +102,23 @@
 #define DHCP_OPTION_MSG_TYPE	53
 #define DHCP_OPTION_SERVER_ID	54
 #define DHCP_OPTION_REQ_LIST	55
+#define DHCP_OPTION_RENEWAL_TIME	58
+#define DHCP_OPTION_REBINDING_TIME	59
 #define DHCP_OPTION_END	255
 
-#define BUFFER_SIZE		256
+/* Retransmission delays in seconds (RFC 2131 sections 4.1 and 4.4.5) */
+
+#define DHCPC_BACKOFF_MIN	4
+#define DHCPC_BACKOFF_MAX	64
+#define DHCPC_REQUEST_TRIES	4
+#define DHCPC_RENEW_MIN		60
+
+#define DHCPC_LEASE_MIN		10
+#define DHCPC_LEASE_INFINITE	0xffffffff
+
+/* Longest delay handed to the loop at once, in seconds */
+
+#define DHCPC_TIMER_MAX		(60*60*24)
 
 /****************************************************************************
  * Private Types
@@ -121,26 +143,42 @@ struct dhcp_msg {
 };
 
 struct dhcpc_state_s {
-	const void	*ds_macaddr;
-	int		ds_maclen;
+	char		ds_ifname[IFNAMSIZ];
+	uint8_t		ds_macaddr[IFHWADDRLEN];
 	int		sockfd;
+	int		ds_state;
+	uint32_t	ds_xid;
+	unsigned int	ds_seed;
+	int		ds_backoff;	/* Next retransmission delay */
+	int		ds_tries;
+	time_t		ds_start;	/* Start of the current exchange */
+	time_t		ds_renew;	/* T1 */
+	time_t		ds_rebind;	/* T2 */
+	time_t		ds_expire;
 	struct in_addr	ipaddr;
 	struct in_addr	serverid;
+	struct dhcpc_state ds_lease;
 	struct dhcp_msg	packet;
+	artik_loop_module *ds_loop;
+	int		ds_watch;
+	int		ds_timer;
+	bool		ds_timer_pending;
+	dhcpc_callback	ds_callback;
+	void		*ds_user_data;
 };
 
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
-static const uint8_t xid[4]		= {0xad, 0xde, 0x12, 0x23};
 static const uint8_t magic_cookie[4]	= {99, 130, 83, 99};
 
-
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+static void on_dhcpc_timeout(void *user_data);
+
 /****************************************************************************
  * Name: dhcpc_add<option>
  ****************************************************************************/
@@ -185,40 +223,81 @@ static uint8_t *dhcpc_addend(uint8_t *optptr)
 	return optptr;
 }
 
+/****************************************************************************
+ * Name: dhcpc_now
+ ****************************************************************************/
+
+static time_t dhcpc_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+/****************************************************************************
+ * Name: dhcpc_settimer
+ ****************************************************************************/
+
+static void dhcpc_settimer(struct dhcpc_state_s *pdhcpc, unsigned int msec)
+{
+	if (pdhcpc->ds_timer_pending)
+		pdhcpc->ds_loop->remove_timeout_callback(pdhcpc->ds_timer);
+
+	pdhcpc->ds_timer_pending = pdhcpc->ds_loop->add_timeout_callback(
+			&pdhcpc->ds_timer, msec, on_dhcpc_timeout,
+			pdhcpc) == S_OK;
+}
+
+/* Wake up at a given time, far away deadlines take several timers */
+
+static void dhcpc_settimeruntil(struct dhcpc_state_s *pdhcpc,
+							time_t deadline)
+{
+	time_t delay = deadline - dhcpc_now();
+
+	if (delay < 0)
+		delay = 0;
+	else if (delay > DHCPC_TIMER_MAX)
+		delay = DHCPC_TIMER_MAX;
+
+	dhcpc_settimer(pdhcpc, delay * 1000);
+}
+
+/* Doubling delay randomized by +/- 1 second */
+
+static void dhcpc_setbackoff(struct dhcpc_state_s *pdhcpc)
+{
+	unsigned int msec = pdhcpc->ds_backoff * 1000 - 1000 +
+					rand_r(&pdhcpc->ds_seed) % 2001;
+
+	if (pdhcpc->ds_backoff < DHCPC_BACKOFF_MAX)
+		pdhcpc->ds_backoff *= 2;
+
+	dhcpc_settimer(pdhcpc, msec);
+}
+
 /****************************************************************************
  * Name: dhcpc_sendmsg
  ****************************************************************************/
 
-static int dhcpc_sendmsg(struct dhcpc_state_s *pdhcpc,
-	struct dhcpc_state *presult,
-	int msgtype,
-	const char *interface,
-	bool renew)
+static int dhcpc_sendmsg(struct dhcpc_state_s *pdhcpc, int msgtype)
 {
 	struct sockaddr_in addr;
 	uint8_t *pend;
 	in_addr_t serverid = INADDR_BROADCAST;
+	uint32_t xid = htonl(pdhcpc->ds_xid);
+	time_t secs = dhcpc_now() - pdhcpc->ds_start;
 	int len;
-	uint8_t mac[IFHWADDRLEN];
-
-	/* Get the MAC address */
-	if (getmacaddr(interface, mac) == ERROR) {
-		log_err("Get MAC address failed : %s", strerror(errno));
-		return E_NETWORK_ERROR;
-	}
-
-	pdhcpc->ds_macaddr = &mac;
 
 	/* Create the common message header settings */
 	memset(&pdhcpc->packet, 0, sizeof(pdhcpc->packet));
 	pdhcpc->packet.op    = DHCP_REQUEST;
 	pdhcpc->packet.htype = DHCP_HTYPE_ETHERNET;
-	pdhcpc->packet.hlen  = pdhcpc->ds_maclen;
-	memcpy(pdhcpc->packet.xid, xid, 4);
-	memcpy(pdhcpc->packet.chaddr, (uint8_t *)pdhcpc->ds_macaddr,
-						pdhcpc->ds_maclen);
-	memset(&pdhcpc->packet.chaddr[pdhcpc->ds_maclen], 0,
-							16 - pdhcpc->ds_maclen);
+	pdhcpc->packet.hlen  = IFHWADDRLEN;
+	pdhcpc->packet.secs  = htons(secs > 0xffff ? 0xffff : secs);
+	memcpy(pdhcpc->packet.xid, &xid, 4);
+	memcpy(pdhcpc->packet.chaddr, pdhcpc->ds_macaddr, IFHWADDRLEN);
 	memcpy(pdhcpc->packet.options, magic_cookie, sizeof(magic_cookie));
 
 	/* Add the common header options */
@@ -227,35 +306,32 @@ static int dhcpc_sendmsg(struct dhcpc_state_s *pdhcpc,
 
 	/* Handle the message specific settings */
 	switch (msgtype) {
-	/* Broadcast DISCOVER message to all servers */
+	/* Broadcast DISCOVER message to all servers, asking for the address
+	 * we had before if any.
+	 */
 	case DHCPDISCOVER:
-		/*  Broadcast bit. */
-		pdhcpc->packet.flags	= htons(BOOTP_BROADCAST);
-		pend			= dhcpc_addreqoptions(pend);
+		/*  Broadcast bit, we have no address to receive unicast. */
+		pdhcpc->packet.flags = htons(BOOTP_BROADCAST);
+		if (pdhcpc->ipaddr.s_addr != INADDR_ANY)
+			pend = dhcpc_addreqipaddr(&pdhcpc->ipaddr, pend);
+		pend = dhcpc_addreqoptions(pend);
 		break;
 
-	/* Send REQUEST message to the server that sent the *first* OFFER */
+	/* Accept the OFFER we selected, or extend the lease we hold: unicast
+	 * to its server when RENEWING, broadcast when REBINDING.
+	 */
 	case DHCPREQUEST:
-		/*  Broadcast bit. */
-		pdhcpc->packet.flags = htons(BOOTP_BROADCAST);
-		memcpy(pdhcpc->packet.ciaddr, &pdhcpc->ipaddr.s_addr, 4);
-		if (!renew) {
-			pend	= dhcpc_addserverid(&pdhcpc->serverid, pend);
-			pend	= dhcpc_addreqipaddr(&pdhcpc->ipaddr, pend);
+		if (pdhcpc->ds_state == STATE_REQUESTING) {
+			pdhcpc->packet.flags = htons(BOOTP_BROADCAST);
+			pend = dhcpc_addserverid(&pdhcpc->serverid, pend);
+			pend = dhcpc_addreqipaddr(&pdhcpc->ipaddr, pend);
+		} else {
+			memcpy(pdhcpc->packet.ciaddr, &pdhcpc->ipaddr.s_addr,
+									4);
+			if (pdhcpc->ds_state == STATE_RENEWING)
+				serverid = pdhcpc->serverid.s_addr;
 		}
-		break;
-
-	/* Send DECLINE message to the server that sent the *last* OFFER */
-	case DHCPDECLINE:
-		memcpy(pdhcpc->packet.ciaddr, &presult->ipaddr.s_addr, 4);
-		pend		= dhcpc_addserverid(&presult->serverid, pend);
-		serverid	= presult->serverid.s_addr;
-		break;
-
-	case DHCPRELEASE:
-		memcpy(pdhcpc->packet.ciaddr, &pdhcpc->ipaddr.s_addr, 4);
-		pend	= dhcpc_addserverid(&pdhcpc->serverid, pend);
-		pend	= dhcpc_addreqipaddr(&pdhcpc->ipaddr, pend);
+		pend = dhcpc_addreqoptions(pend);
 		break;
 
 	default:
@@ -274,10 +350,37 @@ static int dhcpc_sendmsg(struct dhcpc_state_s *pdhcpc,
 		(struct sockaddr *)&addr, sizeof(struct sockaddr_in));
 }
 
+/****************************************************************************
+ * Name: dhcpc_transmit
+ ****************************************************************************/
+
+/* Send the message of the current state. A failure is only logged, the
+ * message goes again when the retransmission timer expires.
+ */
+
+static void dhcpc_transmit(struct dhcpc_state_s *pdhcpc)
+{
+	int msgtype = pdhcpc->ds_state == STATE_SELECTING ?
+						DHCPDISCOVER : DHCPREQUEST;
+
+	log_dbg("%s: send %s\n", pdhcpc->ds_ifname,
+			msgtype == DHCPDISCOVER ? "DISCOVER" : "REQUEST");
+
+	if (dhcpc_sendmsg(pdhcpc, msgtype) < 0)
+		log_err("%s: dhcpc_sendmsg : %s", pdhcpc->ds_ifname,
+							strerror(errno));
+}
+
 /****************************************************************************
  * Name: dhcpc_parseoptions
  ****************************************************************************/
 
+static uint32_t dhcpc_getuint32(const uint8_t *ptr)
+{
+	return (uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 |
+				(uint32_t)ptr[2] << 8 | (uint32_t)ptr[3];
+}
+
 static uint8_t dhcpc_parseoptions(struct dhcpc_state *presult, uint8_t *optptr,
 	int len)
 {
@@ -285,6 +388,21 @@ static uint8_t dhcpc_parseoptions(struct dhcpc_state *presult, uint8_t *optptr,
 	uint8_t type = 0;
 
 	while (optptr < end) {
+		if (*optptr == DHCP_OPTION_PAD) {
+			optptr++;
+			continue;
+		}
+
+		if (*optptr == DHCP_OPTION_END || optptr + 2 > end ||
+					optptr + 2 + optptr[1] > end)
+			break;
+
+		/* All the options we use carry 4 bytes but the type */
+		if (optptr[1] < (*optptr == DHCP_OPTION_MSG_TYPE ? 1 : 4)) {
+			optptr += optptr[1] + 2;
+			continue;
+		}
+
 		switch (*optptr) {
 		case DHCP_OPTION_SUBNET_MASK:
 			/* Get subnet mask in network order */
@@ -311,18 +429,20 @@ static uint8_t dhcpc_parseoptions(struct dhcpc_state *presult, uint8_t *optptr,
 			memcpy(&presult->serverid.s_addr, optptr + 2, 4);
 			break;
 
-		case DHCP_OPTION_LEASE_TIME: {
-				/* Get lease time (in seconds) in host order */
-				uint16_t tmp[2];
+		/* Get the lease, renewal and rebinding times (in seconds) in
+		 * host order
+		 */
+		case DHCP_OPTION_LEASE_TIME:
+			presult->lease_time = dhcpc_getuint32(optptr + 2);
+			break;
 
-				memcpy(tmp, optptr + 2, 4);
-				presult->lease_time = ((uint32_t)ntohs(tmp[0]))
-					<< 16 | (uint32_t)ntohs(tmp[1]);
-			}
+		case DHCP_OPTION_RENEWAL_TIME:
+			presult->renewal_time = dhcpc_getuint32(optptr + 2);
 			break;
 
-		case DHCP_OPTION_END:
-			return type;
+		case DHCP_OPTION_REBINDING_TIME:
+			presult->rebinding_time = dhcpc_getuint32(optptr + 2);
+			break;
 		}
 
 		optptr += optptr[1] + 2;
@@ -334,331 +454,389 @@ static uint8_t dhcpc_parseoptions(struct dhcpc_state *presult, uint8_t *optptr,
  * Name: dhcpc_parsemsg
  ****************************************************************************/
 
+/* Only the replies to our current transaction are considered */
+
 static uint8_t dhcpc_parsemsg(struct dhcpc_state_s *pdhcpc, int buflen,
 	struct dhcpc_state *presult)
 {
-	if (pdhcpc->packet.op == DHCP_REPLY &&
-		memcmp(pdhcpc->packet.xid, xid, sizeof(xid)) == 0) {
-		memcpy(&presult->ipaddr.s_addr, pdhcpc->packet.yiaddr, 4);
-		return dhcpc_parseoptions(presult, &pdhcpc->packet.options[4],
-					buflen);
+	uint32_t xid = htonl(pdhcpc->ds_xid);
+
+	if (buflen < DHCP_MSG_LEN + (int)sizeof(magic_cookie) ||
+		pdhcpc->packet.op != DHCP_REPLY ||
+		memcmp(pdhcpc->packet.xid, &xid, 4) != 0 ||
+		memcmp(pdhcpc->packet.chaddr, pdhcpc->ds_macaddr,
+						IFHWADDRLEN) != 0 ||
+		memcmp(pdhcpc->packet.options, magic_cookie,
+						sizeof(magic_cookie)) != 0)
+		return 0;
+
+	memset(presult, 0, sizeof(*presult));
+	presult->lease_time = DHCPC_LEASE_INFINITE;
+	memcpy(&presult->ipaddr.s_addr, pdhcpc->packet.yiaddr, 4);
+
+	return dhcpc_parseoptions(presult, &pdhcpc->packet.options[4],
+			buflen - DHCP_MSG_LEN - sizeof(magic_cookie));
+}
+
+/****************************************************************************
+ * Name: dhcpc_init
+ ****************************************************************************/
+
+/* INIT: start a new transaction looking for a server */
+
+static void dhcpc_init(struct dhcpc_state_s *pdhcpc)
+{
+	pdhcpc->ds_state   = STATE_SELECTING;
+	pdhcpc->ds_xid     = rand_r(&pdhcpc->ds_seed);
+	pdhcpc->ds_start   = dhcpc_now();
+	pdhcpc->ds_backoff = DHCPC_BACKOFF_MIN;
+
+	dhcpc_transmit(pdhcpc);
+	dhcpc_setbackoff(pdhcpc);
+}
+
+/****************************************************************************
+ * Name: dhcpc_select
+ ****************************************************************************/
+
+/* SELECTING: lock on to the first OFFER, later ones are ignored */
+
+static void dhcpc_select(struct dhcpc_state_s *pdhcpc,
+					const struct dhcpc_state *result)
+{
+	log_dbg("%s: received OFFER from %08x\n", pdhcpc->ds_ifname,
+					ntohl(result->serverid.s_addr));
+
+	pdhcpc->ipaddr.s_addr   = result->ipaddr.s_addr;
+	pdhcpc->serverid.s_addr = result->serverid.s_addr;
+
+	pdhcpc->ds_state   = STATE_REQUESTING;
+	pdhcpc->ds_tries   = 0;
+	pdhcpc->ds_backoff = DHCPC_BACKOFF_MIN;
+
+	dhcpc_transmit(pdhcpc);
+	dhcpc_setbackoff(pdhcpc);
+}
+
+/****************************************************************************
+ * Name: dhcpc_bind
+ ****************************************************************************/
+
+/* BOUND: the lease times count from the start of the exchange */
+
+static void dhcpc_bind(struct dhcpc_state_s *pdhcpc,
+					const struct dhcpc_state *result)
+{
+	uint32_t lease = result->lease_time;
+	uint32_t t1 = result->renewal_time;
+	uint32_t t2 = result->rebinding_time;
+
+	log_dbg("%s: got IP address %s, lease %u seconds\n",
+		pdhcpc->ds_ifname, inet_ntoa(result->ipaddr), lease);
+
+	pdhcpc->ds_lease = *result;
+	pdhcpc->ds_state = STATE_BOUND;
+	pdhcpc->ipaddr.s_addr = result->ipaddr.s_addr;
+	if (result->serverid.s_addr != INADDR_ANY)
+		pdhcpc->serverid.s_addr = result->serverid.s_addr;
+
+	if (pdhcpc->ds_timer_pending) {
+		pdhcpc->ds_loop->remove_timeout_callback(pdhcpc->ds_timer);
+		pdhcpc->ds_timer_pending = false;
 	}
-	return 0;
+
+	pdhcpc->ds_callback(pdhcpc, DHCPC_EVENT_BOUND, &pdhcpc->ds_lease,
+							pdhcpc->ds_user_data);
+
+	if (lease == DHCPC_LEASE_INFINITE)
+		return;
+
+	if (lease < DHCPC_LEASE_MIN)
+		lease = DHCPC_LEASE_MIN;
+
+	/* Defaults to 0.5 and 0.875 times the lease (RFC 2131 section 4.4.5) */
+	if (!t2 || t2 >= lease)
+		t2 = lease - lease / 8;
+	if (!t1 || t1 >= t2)
+		t1 = lease / 2;
+
+	pdhcpc->ds_renew  = pdhcpc->ds_start + t1;
+	pdhcpc->ds_rebind = pdhcpc->ds_start + t2;
+	pdhcpc->ds_expire = pdhcpc->ds_start + lease;
+
+	dhcpc_settimeruntil(pdhcpc, pdhcpc->ds_renew);
 }
 
 /****************************************************************************
- * Public Functions
+ * Name: dhcpc_nak
  ****************************************************************************/
 
+/* The server refused our request, go back to INIT after a short delay so
+ * that a server refusing everything is not flooded.
+ */
+
+static void dhcpc_nak(struct dhcpc_state_s *pdhcpc)
+{
+	log_dbg("%s: received NAK\n", pdhcpc->ds_ifname);
+
+	if (pdhcpc->ds_state != STATE_REQUESTING)
+		pdhcpc->ds_callback(pdhcpc, DHCPC_EVENT_EXPIRED,
+				&pdhcpc->ds_lease, pdhcpc->ds_user_data);
+
+	pdhcpc->ipaddr.s_addr = INADDR_ANY;
+	pdhcpc->ds_state      = STATE_INIT;
+	pdhcpc->ds_backoff    = DHCPC_BACKOFF_MIN;
+
+	dhcpc_setbackoff(pdhcpc);
+}
+
 /****************************************************************************
- * Name: dhcpc_open
+ * Name: dhcpc_extend
  ****************************************************************************/
 
-void *dhcpc_open(const void *macaddr, int maclen)
+/* BOUND, RENEWING and REBINDING: ask the server for more time once T1 is
+ * reached, any server once T2 is reached. Retransmissions wait half of the
+ * time left, at least one minute (RFC 2131 section 4.4.5).
+ */
+
+static void dhcpc_extend(struct dhcpc_state_s *pdhcpc)
 {
-	struct dhcpc_state_s *pdhcpc;
-	struct sockaddr_in addr;
-	struct timeval tv;
-	int ret = ERROR;
-	int broadcast = 1;
+	time_t now = dhcpc_now();
+	time_t deadline;
+	time_t next;
+
+	if (now >= pdhcpc->ds_expire) {
+		log_dbg("%s: lease expired\n", pdhcpc->ds_ifname);
+		pdhcpc->ds_callback(pdhcpc, DHCPC_EVENT_EXPIRED,
+				&pdhcpc->ds_lease, pdhcpc->ds_user_data);
+		dhcpc_init(pdhcpc);
+		return;
+	}
 
-	log_dbg("MAC: %02x:%02x:%02x:%02x:%02x:%02x\n",
-	((uint8_t *)macaddr)[0], ((uint8_t *)macaddr)[1],
-	((uint8_t *)macaddr)[2], ((uint8_t *)macaddr)[3],
-	((uint8_t *)macaddr)[4], ((uint8_t *)macaddr)[5]);
+	if (now < pdhcpc->ds_renew) {
+		dhcpc_settimeruntil(pdhcpc, pdhcpc->ds_renew);
+		return;
+	}
 
-	/* Allocate an internal DHCP structure */
-	pdhcpc = (struct dhcpc_state_s *)malloc(sizeof(struct dhcpc_state_s));
-	if (pdhcpc) {
-		/* Initialize the allocated structure */
-		memset(pdhcpc, 0, sizeof(struct dhcpc_state_s));
-		pdhcpc->ds_macaddr = macaddr;
-		pdhcpc->ds_maclen  = maclen;
-
-		/* Create a UDP socket */
-		pdhcpc->sockfd = socket(PF_INET, SOCK_DGRAM, 0);
-		if (pdhcpc->sockfd < 0) {
-			log_err("Error open : %s\n", strerror(errno));
-			free(pdhcpc);
-			return NULL;
+	if (now >= pdhcpc->ds_rebind) {
+		if (pdhcpc->ds_state != STATE_REBINDING) {
+			pdhcpc->ds_state = STATE_REBINDING;
+			pdhcpc->ds_xid   = rand_r(&pdhcpc->ds_seed);
+			pdhcpc->ds_start = now;
 		}
-
-		/* Bind the socket */
-		addr.sin_family      = AF_INET;
-		addr.sin_port        = htons(DHCPC_CLIENT_PORT);
-		addr.sin_addr.s_addr = INADDR_ANY;
-
-		ret = bind(pdhcpc->sockfd, (struct sockaddr *)&addr,
-			sizeof(struct sockaddr_in));
-		if (ret < 0) {
-			log_err("Error open : %s\n", strerror(errno));
-			close(pdhcpc->sockfd);
-			free(pdhcpc);
-			return NULL;
+		deadline = pdhcpc->ds_expire;
+	} else {
+		if (pdhcpc->ds_state != STATE_RENEWING) {
+			pdhcpc->ds_state = STATE_RENEWING;
+			pdhcpc->ds_xid   = rand_r(&pdhcpc->ds_seed);
+			pdhcpc->ds_start = now;
 		}
+		deadline = pdhcpc->ds_rebind;
+	}
+
+	dhcpc_transmit(pdhcpc);
+
+	next = now + (deadline - now) / 2;
+	if (next < now + DHCPC_RENEW_MIN)
+		next = now + DHCPC_RENEW_MIN;
+	if (next > deadline)
+		next = deadline;
+
+	dhcpc_settimeruntil(pdhcpc, next);
+}
 
-		/* Configure for read timeouts */
-		tv.tv_sec  = 10;
-		tv.tv_usec = 0;
-
-		ret = setsockopt(pdhcpc->sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv,
-			sizeof(struct timeval));
-		if (ret < 0) {
-			log_err("Error open : %s\n", strerror(errno));
-			close(pdhcpc->sockfd);
-			free(pdhcpc);
-			return NULL;
+/****************************************************************************
+ * Name: on_dhcpc_timeout
+ ****************************************************************************/
+
+static void on_dhcpc_timeout(void *user_data)
+{
+	struct dhcpc_state_s *pdhcpc = (struct dhcpc_state_s *)user_data;
+
+	pdhcpc->ds_timer_pending = false;
+
+	switch (pdhcpc->ds_state) {
+	case STATE_INIT:
+		dhcpc_init(pdhcpc);
+		break;
+
+	case STATE_SELECTING:
+		dhcpc_transmit(pdhcpc);
+		dhcpc_setbackoff(pdhcpc);
+		break;
+
+	/* Start over if the server does not confirm its offer */
+	case STATE_REQUESTING:
+		if (++pdhcpc->ds_tries >= DHCPC_REQUEST_TRIES) {
+			log_dbg("%s: no answer to REQUEST\n",
+							pdhcpc->ds_ifname);
+			pdhcpc->ipaddr.s_addr = INADDR_ANY;
+			dhcpc_init(pdhcpc);
+			break;
 		}
+		dhcpc_transmit(pdhcpc);
+		dhcpc_setbackoff(pdhcpc);
+		break;
+
+	case STATE_BOUND:
+	case STATE_RENEWING:
+	case STATE_REBINDING:
+		dhcpc_extend(pdhcpc);
+		break;
+	}
+}
+
+/****************************************************************************
+ * Name: on_dhcpc_readable
+ ****************************************************************************/
+
+static int on_dhcpc_readable(int fd, enum watch_io io, void *user_data)
+{
+	struct dhcpc_state_s *pdhcpc = (struct dhcpc_state_s *)user_data;
+	struct dhcpc_state result;
+	ssize_t len;
+	uint8_t msgtype;
+
+	for (;;) {
+		len = recv(fd, &pdhcpc->packet, sizeof(struct dhcp_msg), 0);
+		if (len < 0)
+			break;
 
-		ret = setsockopt(pdhcpc->sockfd, SOL_SOCKET, SO_BROADCAST,
-			&broadcast, sizeof(int));
-		if (ret < 0) {
-			log_err("Error open : %s\n", strerror(errno));
-			close(pdhcpc->sockfd);
-			free(pdhcpc);
-			return NULL;
+		msgtype = dhcpc_parsemsg(pdhcpc, len, &result);
+
+		switch (pdhcpc->ds_state) {
+		case STATE_SELECTING:
+			if (msgtype == DHCPOFFER)
+				dhcpc_select(pdhcpc, &result);
+			break;
+
+		case STATE_REQUESTING:
+		case STATE_RENEWING:
+		case STATE_REBINDING:
+			if (msgtype == DHCPACK)
+				dhcpc_bind(pdhcpc, &result);
+			else if (msgtype == DHCPNAK)
+				dhcpc_nak(pdhcpc);
+			break;
+
+		/* Late replies while in INIT or BOUND are ignored */
+		default:
+			break;
 		}
 	}
 
-	return (void *)pdhcpc;
+	return 1;
 }
 
 /****************************************************************************
- * Name: dhcpc_close
+ * Public Functions
  ****************************************************************************/
 
-void dhcpc_close(void *handle)
+/****************************************************************************
+ * Name: dhcpc_open
+ ****************************************************************************/
+
+void *dhcpc_open(const char *interface, dhcpc_callback callback,
+		void *user_data)
 {
-	struct dhcpc_state_s *pdhcpc = (struct dhcpc_state_s *)handle;
+	struct dhcpc_state_s *pdhcpc;
+	struct sockaddr_in addr;
+	struct timespec ts;
+	uint8_t *mac;
+	int broadcast = 1;
 
-	if (pdhcpc) {
-		if (pdhcpc->sockfd)
-			close(pdhcpc->sockfd);
+	/* Allocate an internal DHCP structure */
+	pdhcpc = (struct dhcpc_state_s *)malloc(sizeof(struct dhcpc_state_s));
+	if (!pdhcpc)
+		return NULL;
+
+	/* Initialize the allocated structure */
+	memset(pdhcpc, 0, sizeof(struct dhcpc_state_s));
+	strncpy(pdhcpc->ds_ifname, interface, IFNAMSIZ - 1);
+	pdhcpc->ds_callback  = callback;
+	pdhcpc->ds_user_data = user_data;
+
+	/* Get the MAC address */
+	mac = pdhcpc->ds_macaddr;
+	if (getmacaddr(interface, mac) == ERROR) {
+		log_err("Get MAC address failed : %s", strerror(errno));
+		free(pdhcpc);
+		return NULL;
+	}
 
+	log_dbg("MAC: %02x:%02x:%02x:%02x:%02x:%02x\n",
+		mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+	/* Transaction IDs must differ between devices and restarts */
+	clock_gettime(CLOCK_REALTIME, &ts);
+	pdhcpc->ds_seed = ts.tv_sec ^ ts.tv_nsec ^ ((uint32_t)mac[2] << 24 |
+		(uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5]);
+
+	/* Create a UDP socket */
+	pdhcpc->sockfd = socket(PF_INET, SOCK_DGRAM | SOCK_NONBLOCK |
+							SOCK_CLOEXEC, 0);
+	if (pdhcpc->sockfd < 0) {
+		log_err("Error open : %s\n", strerror(errno));
 		free(pdhcpc);
+		return NULL;
+	}
+
+	/* Only send and receive on our interface, so that a client can run
+	 * on each interface at the same time.
+	 */
+	if (setsockopt(pdhcpc->sockfd, SOL_SOCKET, SO_BINDTODEVICE,
+			pdhcpc->ds_ifname, strlen(pdhcpc->ds_ifname) + 1) < 0)
+		goto errout;
+
+	if (setsockopt(pdhcpc->sockfd, SOL_SOCKET, SO_BROADCAST,
+			&broadcast, sizeof(int)) < 0)
+		goto errout;
+
+	/* Bind the socket */
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(DHCPC_CLIENT_PORT);
+	addr.sin_addr.s_addr = INADDR_ANY;
+
+	if (bind(pdhcpc->sockfd, (struct sockaddr *)&addr,
+			sizeof(struct sockaddr_in)) < 0)
+		goto errout;
+
+	pdhcpc->ds_loop = (artik_loop_module *)
+					artik_request_api_module("loop");
+	if (pdhcpc->ds_loop->add_fd_watch(pdhcpc->sockfd, WATCH_IO_IN,
+			on_dhcpc_readable, pdhcpc, &pdhcpc->ds_watch) != S_OK) {
+		artik_release_api_module(pdhcpc->ds_loop);
+		goto errout;
 	}
+
+	dhcpc_init(pdhcpc);
+
+	return (void *)pdhcpc;
+
+errout:
+	log_err("Error open : %s\n", strerror(errno));
+	close(pdhcpc->sockfd);
+	free(pdhcpc);
+	return NULL;
 }
 
 /****************************************************************************
- * Name: dhcpc_request
+ * Name: dhcpc_close
  ****************************************************************************/
 
-int dhcpc_request(void *handle, struct dhcpc_state *presult,
-	const char *interface, const struct in_addr *addr, bool renew)
+void dhcpc_close(void *handle)
 {
 	struct dhcpc_state_s *pdhcpc = (struct dhcpc_state_s *)handle;
-	struct in_addr oldaddr;
-	struct in_addr newaddr;
-	ssize_t result;
-	uint8_t msgtype;
-	int	retries;
-	int	state;
-	int	count = 5;
-
-	errno = 0;
-
-	/* Save the currently assigned IP address (should be INADDR_ANY) */
-	oldaddr.s_addr = 0;
-	get_ipv4addr(interface, &oldaddr);
-
-	/* Loop until we receive the lease (or an error occurs) */
-	do {
-		if (!renew) {
-			/* Set the IP address to INADDR_ANY. */
-			newaddr.s_addr = INADDR_ANY;
-			if (set_ipv4addr(interface, &newaddr) == ERROR) {
-				log_err("Set IPv4 address failed: %s",
-					strerror(errno));
-				return ERROR;
-			}
-
-			/* Set default route to 0.0.0.0 in case if we an IP
-			 * not null
-			 */
-			if (oldaddr.s_addr != newaddr.s_addr) {
-				if (set_defaultroute(interface, &newaddr, false)
-								== ERROR) {
-					log_err("Set default route failed: %s",
-						strerror(errno));
-					return ERROR;
-				}
-			}
-		}
 
-		/* Loop sending DISCOVER until we receive an OFFER from a DHCP
-		 * server.  We will lock on to the first OFFER and decline any
-		 * subsequent offers (which will happen if there are more than
-		 * one DHCP servers on the network.
-		 */
+	if (pdhcpc) {
+		if (pdhcpc->ds_timer_pending)
+			pdhcpc->ds_loop->remove_timeout_callback(
+							pdhcpc->ds_timer);
 
-		if (renew)
-			state = STATE_HAVE_OFFER;
-		else
-			state = STATE_INITIAL;
-
-		do {
-			if (state == STATE_HAVE_OFFER)
-				break;
-
-			/* Send the DISCOVER command */
-			log_dbg("Broadcast DISCOVER\n");
-			if (dhcpc_sendmsg(pdhcpc, presult, DHCPDISCOVER,
-						interface, renew) < 0) {
-				log_err("Error: dhcpc_sendmsg : %s",
-					strerror(errno));
-				return ERROR;
-			}
-
-			if (count > 0)
-				count--;
-			else {
-				log_err("Reached the limit of broadcasting\n"
-					"DISCOVER");
-				(void)set_ipv4addr(interface, &oldaddr);
-				return ERROR;
-			}
-
-			/* Get the DHCPOFFER response */
-			result = recv(pdhcpc->sockfd, &pdhcpc->packet,
-				sizeof(struct dhcp_msg), 0);
-			if (result >= 0) {
-				msgtype = dhcpc_parsemsg(pdhcpc, result,
-							presult);
-				if (msgtype == DHCPOFFER) {
-					/* Save the servid from the presult so
-					 * that it is not clobbered by a new
-					 * OFFER.
-					 */
-					log_dbg("Received OFFER from %08x\n",
-					ntohl(presult->serverid.s_addr));
-					pdhcpc->ipaddr.s_addr	=
-						presult->ipaddr.s_addr;
-					pdhcpc->serverid.s_addr =
-						presult->serverid.s_addr;
-
-					/* Temporarily use the address offered
-					 * by the server and break out of the
-					 * loop.
-					 */
-					(void)set_ipv4addr(interface,
-							&presult->ipaddr);
-					state = STATE_HAVE_OFFER;
-				}
-			}
-
-			/* An error has occurred.  If this was a timeout error
-			 * (meaning that nothing was received on this socket for
-			 * a long period of time).
-			 * Then loop and send the DISCOVER command again.
-			 */
-			else if (errno != EAGAIN)
-				/* An error other than a timeout was received
-				 * -- error out
-				 */
-				return ERROR;
-		} while (state == STATE_INITIAL);
-
-
-		/* Loop sending the REQUEST up to three times
-		 * (if there is no response)
-		 */
-		retries = 0;
-		do {
-			/* Send the REQUEST message to obtain the lease that was
-			 * offered to us.
-			 */
-			log_dbg("Send REQUEST\n");
-			if (renew)
-				pdhcpc->ipaddr = *addr;
-			if (dhcpc_sendmsg(pdhcpc, presult, DHCPREQUEST,
-					interface, renew) < 0)
-				return ERROR;
-			retries++;
-
-			/* Get the ACK/NAK response to the REQUEST (or timeout)
-			 */
-			result = recv(pdhcpc->sockfd, &pdhcpc->packet,
-				sizeof(struct dhcp_msg), 0);
-			if (result >= 0) {
-				/* Parse the response */
-				msgtype = dhcpc_parsemsg(pdhcpc, result,
-							presult);
-
-				/* The ACK response means that the server has
-				 * accepted our request and we have the lease.
-				 */
-				if (msgtype == DHCPACK) {
-					log_dbg("Received ACK\n");
-					state = STATE_HAVE_LEASE;
-				}
-
-				/* NAK means the server has refused our request.
-				 * Break out of this loop with state ==
-				 * STATE_HAVE_OFFER and send DISCOVER
-				 * again
-				 */
-				else if (msgtype == DHCPNAK) {
-					log_dbg("Received NAK\n");
-					break;
-				}
-
-				/* If we get any OFFERs from other servers, then
-				 * decline them now and continue waiting for the
-				 * ACK from the server that we requested from.
-				 */
-				else if (msgtype == DHCPOFFER) {
-					log_dbg("Received another OFFER,\n"
-						"send DECLINE\n");
-					(void)dhcpc_sendmsg(pdhcpc, presult,
-						DHCPDECLINE, interface, renew);
-				}
-
-				/* Otherwise, it is something that we do not
-				 * recognize
-				 */
-				else
-					log_dbg("Ignoring msgtype=%d\n",
-						msgtype);
-			}
-
-			/* An error has occurred. If this was a timeout error
-			 * (meaning that nothing was received on this socket for
-			 * a long period of time). Then break out and send the
-			 * DISCOVER command again (at most 3 times).
-			 */
-
-			else if (errno != EAGAIN) {
-				/* An error other than a timeout was received */
-				(void)set_ipv4addr(interface, &oldaddr);
-				return ERROR;
-			}
-
-			if (retries == 3)
-				renew = false;
-		} while (state == STATE_HAVE_OFFER && retries < 3);
-	} while (state != STATE_HAVE_LEASE);
-
-	log_dbg("Got IP address %d.%d.%d.%d\n",
-		(presult->ipaddr.s_addr) & 0xff,
-		(presult->ipaddr.s_addr >> 8) & 0xff,
-		(presult->ipaddr.s_addr >> 16) & 0xff,
-		(presult->ipaddr.s_addr >> 24) & 0xff);
-	log_dbg("Got netmask %d.%d.%d.%d\n",
-		(presult->netmask.s_addr) & 0xff,
-		(presult->netmask.s_addr >> 8) & 0xff,
-		(presult->netmask.s_addr >> 16) & 0xff,
-		(presult->netmask.s_addr >> 24) & 0xff);
-	log_dbg("Got DNS server %d.%d.%d.%d\n",
-		(presult->dnsaddr.s_addr) & 0xff,
-		(presult->dnsaddr.s_addr >> 8) & 0xff,
-		(presult->dnsaddr.s_addr >> 16) & 0xff,
-		(presult->dnsaddr.s_addr >> 24) & 0xff);
-	log_dbg("Got default router %d.%d.%d.%d\n",
-		(presult->default_router.s_addr) & 0xff,
-		(presult->default_router.s_addr >> 8) & 0xff,
-		(presult->default_router.s_addr >> 16) & 0xff,
-		(presult->default_router.s_addr >> 24) & 0xff);
-	log_dbg("Lease expires in %d seconds\n", presult->lease_time);
-
-	return OK;
+		pdhcpc->ds_loop->remove_fd_watch(pdhcpc->ds_watch);
+		close(pdhcpc->sockfd);
+		artik_release_api_module(pdhcpc->ds_loop);
+
+		free(pdhcpc);
+	}
 }
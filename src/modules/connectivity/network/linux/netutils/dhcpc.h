@@ -67,8 +67,22 @@ struct dhcpc_state {
 	struct in_addr dnsaddr;
 	struct in_addr default_router;
 	uint32_t       lease_time; /* Lease expires in this number of seconds */
+	uint32_t       renewal_time;   /* T1, 0 if not given by the server */
+	uint32_t       rebinding_time; /* T2, 0 if not given by the server */
 };
 
+enum dhcpc_event {
+	DHCPC_EVENT_BOUND,	/* A lease was acquired or extended */
+	DHCPC_EVENT_EXPIRED	/* The lease was lost, stop using the address */
+};
+
+/* Called from the main loop each time the lease changes. The handle must
+ * not be closed from the callback.
+ */
+
+typedef void (*dhcpc_callback)(void *handle, enum dhcpc_event event,
+		const struct dhcpc_state *result, void *user_data);
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -79,9 +93,8 @@ extern "C"
 #else
 #endif
 
-void *dhcpc_open(const void *mac_addr, int mac_len);
-int dhcpc_request(void *handle, struct dhcpc_state *presult,
-		const char *interface, const struct in_addr *addr, bool renew);
+void *dhcpc_open(const char *interface, dhcpc_callback callback,
+		void *user_data);
 void dhcpc_close(void *handle);
 
 #ifdef __cplusplus
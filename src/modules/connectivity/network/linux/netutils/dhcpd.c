@@ -43,17 +43,23 @@
 
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <time.h>
 #include <errno.h>
 
 #include <net/if.h>
 #include <net/if_arp.h>
 #include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
 #include <arpa/inet.h>
 
 /****************************************************************************
@@ -154,6 +160,25 @@
 #  define CONFIG_NETUTILS_DHCPD_DECLINETIME (60*60) /* 1 hour */
 #endif
 
+/* Wait for echo replies when probing free addresses for conflicts */
+
+#ifndef CONFIG_NETUTILS_DHCPD_PROBETIME
+#  define CONFIG_NETUTILS_DHCPD_PROBETIME 2000 /* milliseconds */
+#endif
+
+/* Directory holding the lease journal of each interface */
+
+#ifndef CONFIG_NETUTILS_DHCPD_LEASEDIR
+#  define CONFIG_NETUTILS_DHCPD_LEASEDIR "/var/lib/misc"
+#endif
+
+/* Lease journal file format */
+
+#define DHCPD_JOURNAL_MAGIC       0x41444c31 /* "ADL1" */
+#define DHCPD_JOURNAL_SLACK       64
+
+#define DHCPD_MAP_WORDS(n)        (((n) + 31) / 32)
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -168,8 +193,31 @@ struct lease_s {
 	uint8_t mac[DHCP_HLEN_ETHERNET];
 	/* true: IP address is allocated */
 	bool allocated;
+	/* true: IP address is never handed out */
+	bool reserved;
 	/* Lease expiration time (seconds past Epoch) */
 	time_t expiry;
+	/* Next lease in the same MAC hash bucket, -1 for none */
+	int hashnext;
+	/* Position in the expiry heap, -1 if not allocated */
+	int heappos;
+};
+
+/* The lease journal is a header followed by records appended each time a
+ * lease changes. The last record for an address wins when replaying it.
+ */
+
+struct lease_header_s {
+	uint32_t magic;
+	uint32_t recsize;
+};
+
+struct lease_record_s {
+	uint32_t ipaddr;           /* Host order */
+	uint8_t mac[DHCP_HLEN_ETHERNET];
+	uint8_t allocated;
+	uint8_t reserved;
+	int64_t expiry;            /* Seconds past Epoch */
 };
 
 struct dhcpmsg_s {
@@ -190,6 +238,20 @@ struct dhcpmsg_s {
 	uint8_t options[312];
 };
 
+typedef struct {
+
+	unsigned int num_leases;
+
+	const char *interface;
+
+	in_addr_t startip;
+	in_addr_t endip;
+	in_addr_t netmask;
+	in_addr_t gw_addr;
+	in_addr_t *dns_addr;
+
+} dhcp_server_handle;
+
 struct dhcpd_state_s {
 	/* Server configuration */
 
@@ -213,31 +275,50 @@ struct dhcpd_state_s {
 
 	uint8_t         *ds_optend;
 
-	/* Leases */
+	/* Leases, one slot per address of the pool */
 
 	struct lease_s   *ds_leases;
+	unsigned int      ds_nleases;
+	in_addr_t         ds_startip;   /* First pool address (host order) */
+
+	/* Lease indexes */
+
+	int              *ds_machash;   /* First lease of each MAC bucket */
+	unsigned int      ds_hashmask;
+	int              *ds_heap;      /* Allocated leases by expiry */
+	unsigned int      ds_heapsize;
+	uint32_t         *ds_freemap;   /* Addresses that can be offered */
+	uint32_t         *ds_cleanmap;  /* Addresses probed without conflict */
+	uint32_t         *ds_probemap;  /* Addresses waiting to be probed */
+	uint32_t         *ds_pingmap;   /* Addresses being probed */
+	unsigned int      ds_hint;      /* Bitmap word to search first */
+
+	/* Address conflict probing */
+
+	artik_loop_module *ds_loop;
+	int               ds_probefd;
+	bool              ds_proberaw;
+	int               ds_probewatch;
+	int               ds_probetimer;
+	bool              ds_probing;   /* Echo requests are in flight */
+	uint16_t          ds_probeseq;
+
+	/* Lease journal */
+
+	int               ds_journalfd;
+	unsigned int      ds_journalrecs;
+	char              ds_journalpath[128];
+
+	dhcp_server_handle *ds_server;
 };
 
-typedef struct {
-
-	unsigned int num_leases;
-
-	const char *interface;
-
-	in_addr_t startip;
-	in_addr_t endip;
-	in_addr_t netmask;
-	in_addr_t gw_addr;
-	in_addr_t *dns_addr;
-
-} dhcp_server_handle;
-
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
 static const uint8_t	g_magiccookie[4] = {99, 130, 83, 99};
 static const uint8_t	g_anyipaddr[4] = {0, 0, 0, 0};
+static const uint8_t	g_anymac[DHCP_HLEN_ETHERNET];
 static struct dhcpd_state_s g_state;
 
 int set_arpmapping(const struct sockaddr_in *inaddr,
@@ -311,6 +392,714 @@ static time_t dhcpd_time(void)
 	return ret;
 }
 
+/****************************************************************************
+ * Name: dhcpd_map*
+ ****************************************************************************/
+
+static inline void dhcpd_mapset(uint32_t *map, int ndx)
+{
+	map[ndx / 32] |= 1u << (ndx % 32);
+}
+
+static inline void dhcpd_mapclr(uint32_t *map, int ndx)
+{
+	map[ndx / 32] &= ~(1u << (ndx % 32));
+}
+
+static inline bool dhcpd_maptest(const uint32_t *map, int ndx)
+{
+	return (map[ndx / 32] & (1u << (ndx % 32))) != 0;
+}
+
+/* Return the first address set in map (and in mask if not NULL), starting
+ * from where the previous allocation stopped.
+ */
+
+static int dhcpd_mapfind(const uint32_t *map, const uint32_t *mask)
+{
+	unsigned int nwords = DHCPD_MAP_WORDS(g_state.ds_nleases);
+	unsigned int i;
+
+	for (i = 0; i < nwords; i++) {
+		unsigned int w = (g_state.ds_hint + i) % nwords;
+		uint32_t bits = map[w];
+
+		if (mask)
+			bits &= mask[w];
+
+		if (bits) {
+			g_state.ds_hint = w;
+			return w * 32 + __builtin_ctz(bits);
+		}
+	}
+
+	return -1;
+}
+
+/****************************************************************************
+ * Name: dhcpd_heap*
+ ****************************************************************************/
+
+static void dhcpd_heapset(unsigned int pos, int ndx)
+{
+	g_state.ds_heap[pos] = ndx;
+	g_state.ds_leases[ndx].heappos = pos;
+}
+
+static inline time_t dhcpd_heapexpiry(unsigned int pos)
+{
+	return g_state.ds_leases[g_state.ds_heap[pos]].expiry;
+}
+
+static void dhcpd_heapup(unsigned int pos)
+{
+	int ndx = g_state.ds_heap[pos];
+
+	while (pos > 0) {
+		unsigned int parent = (pos - 1) / 2;
+
+		if (dhcpd_heapexpiry(parent) <= g_state.ds_leases[ndx].expiry)
+			break;
+
+		dhcpd_heapset(pos, g_state.ds_heap[parent]);
+		pos = parent;
+	}
+
+	dhcpd_heapset(pos, ndx);
+}
+
+static void dhcpd_heapdown(unsigned int pos)
+{
+	int ndx = g_state.ds_heap[pos];
+
+	for (;;) {
+		unsigned int child = 2 * pos + 1;
+
+		if (child >= g_state.ds_heapsize)
+			break;
+
+		if (child + 1 < g_state.ds_heapsize &&
+			dhcpd_heapexpiry(child + 1) < dhcpd_heapexpiry(child))
+			child++;
+
+		if (g_state.ds_leases[ndx].expiry <= dhcpd_heapexpiry(child))
+			break;
+
+		dhcpd_heapset(pos, g_state.ds_heap[child]);
+		pos = child;
+	}
+
+	dhcpd_heapset(pos, ndx);
+}
+
+/* Insert the lease or move it after its expiry time changed */
+
+static void dhcpd_heapupdate(int ndx)
+{
+	int pos = g_state.ds_leases[ndx].heappos;
+
+	if (pos < 0) {
+		pos = g_state.ds_heapsize++;
+		dhcpd_heapset(pos, ndx);
+	}
+
+	dhcpd_heapup(pos);
+	dhcpd_heapdown(g_state.ds_leases[ndx].heappos);
+}
+
+static void dhcpd_heapremove(int ndx)
+{
+	int pos = g_state.ds_leases[ndx].heappos;
+	int last;
+
+	if (pos < 0)
+		return;
+
+	g_state.ds_leases[ndx].heappos = -1;
+	last = g_state.ds_heap[--g_state.ds_heapsize];
+	if (last == ndx)
+		return;
+
+	dhcpd_heapset(pos, last);
+	dhcpd_heapup(pos);
+	dhcpd_heapdown(g_state.ds_leases[last].heappos);
+}
+
+/****************************************************************************
+ * Name: dhcpd_machash
+ ****************************************************************************/
+
+static unsigned int dhcpd_machash(const uint8_t *mac)
+{
+	uint32_t hash = 2166136261u;
+	int i;
+
+	for (i = 0; i < DHCP_HLEN_ETHERNET; i++)
+		hash = (hash ^ mac[i]) * 16777619u;
+
+	return hash & g_state.ds_hashmask;
+}
+
+static inline bool dhcpd_leasebound(const struct lease_s *lease)
+{
+	return memcmp(lease->mac, g_anymac, DHCP_HLEN_ETHERNET) != 0;
+}
+
+/****************************************************************************
+ * Name: dhcpd_unbind
+ ****************************************************************************/
+
+static void dhcpd_unbind(struct lease_s *lease)
+{
+	int ndx = lease - g_state.ds_leases;
+	int *link;
+
+	if (!dhcpd_leasebound(lease))
+		return;
+
+	link = &g_state.ds_machash[dhcpd_machash(lease->mac)];
+	while (*link >= 0 && *link != ndx)
+		link = &g_state.ds_leases[*link].hashnext;
+
+	if (*link == ndx)
+		*link = lease->hashnext;
+
+	lease->hashnext = -1;
+	memset(lease->mac, 0, DHCP_HLEN_ETHERNET);
+}
+
+/****************************************************************************
+ * Name: dhcpd_bind
+ ****************************************************************************/
+
+static void dhcpd_bind(struct lease_s *lease, const uint8_t *mac)
+{
+	unsigned int bucket;
+
+	if (memcmp(lease->mac, mac, DHCP_HLEN_ETHERNET) == 0)
+		return;
+
+	dhcpd_unbind(lease);
+	memcpy(lease->mac, mac, DHCP_HLEN_ETHERNET);
+	if (!dhcpd_leasebound(lease))
+		return;
+
+	bucket = dhcpd_machash(mac);
+	lease->hashnext = g_state.ds_machash[bucket];
+	g_state.ds_machash[bucket] = lease - g_state.ds_leases;
+}
+
+/****************************************************************************
+ * Name: dhcpd_findbymac
+ ****************************************************************************/
+
+static struct lease_s *dhcpd_findbymac(const uint8_t *mac,
+					unsigned int num_leases)
+{
+	int ndx = g_state.ds_machash[dhcpd_machash(mac)];
+
+	while (ndx >= 0) {
+		struct lease_s *lease = &g_state.ds_leases[ndx];
+
+		if (memcmp(lease->mac, mac, DHCP_HLEN_ETHERNET) == 0)
+			return lease;
+
+		ndx = lease->hashnext;
+	}
+
+	return NULL;
+}
+
+/****************************************************************************
+ * Name: dhcpd_journal
+ ****************************************************************************/
+
+static void dhcpd_journalcompact(void);
+
+static void dhcpd_leaserecord(const struct lease_s *lease,
+						struct lease_record_s *rec)
+{
+	memset(rec, 0, sizeof(*rec));
+	rec->ipaddr = g_state.ds_startip + (lease - g_state.ds_leases);
+	memcpy(rec->mac, lease->mac, DHCP_HLEN_ETHERNET);
+	rec->allocated = lease->allocated;
+	rec->expiry = lease->expiry;
+}
+
+/* Append the current state of the lease. Records are not synced one by
+ * one, a restart of the server keeps them and compaction syncs the file.
+ */
+
+static void dhcpd_journal(const struct lease_s *lease)
+{
+	struct lease_record_s rec;
+
+	if (g_state.ds_journalfd < 0)
+		return;
+
+	dhcpd_leaserecord(lease, &rec);
+	if (write(g_state.ds_journalfd, &rec, sizeof(rec)) != sizeof(rec)) {
+		log_err("ERROR: Failed to write lease journal: %s\n",
+			strerror(errno));
+		return;
+	}
+
+	if (++g_state.ds_journalrecs > 2 * g_state.ds_nleases +
+							DHCPD_JOURNAL_SLACK)
+		dhcpd_journalcompact();
+}
+
+/****************************************************************************
+ * Name: dhcpd_journalcompact
+ ****************************************************************************/
+
+static void dhcpd_journalcompact(void)
+{
+	struct lease_header_s header = { DHCPD_JOURNAL_MAGIC,
+					sizeof(struct lease_record_s) };
+	struct lease_record_s *recs;
+	char tmppath[sizeof(g_state.ds_journalpath) + 4];
+	unsigned int count = 0;
+	unsigned int i;
+	ssize_t len;
+	int fd;
+
+	recs = malloc(g_state.ds_nleases * sizeof(struct lease_record_s));
+	if (!recs)
+		return;
+
+	/* Only keep what matters after a restart, i.e. the current owner of
+	 * each address.
+	 */
+
+	for (i = 0; i < g_state.ds_nleases; i++) {
+		struct lease_s *lease = &g_state.ds_leases[i];
+
+		if (!lease->reserved && (lease->allocated ||
+						dhcpd_leasebound(lease)))
+			dhcpd_leaserecord(lease, &recs[count++]);
+	}
+
+	snprintf(tmppath, sizeof(tmppath), "%s.tmp", g_state.ds_journalpath);
+	fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		log_err("ERROR: Failed to create %s: %s\n", tmppath,
+			strerror(errno));
+		free(recs);
+		return;
+	}
+
+	len = count * sizeof(struct lease_record_s);
+	if (write(fd, &header, sizeof(header)) != sizeof(header) ||
+		write(fd, recs, len) != len || fsync(fd) < 0) {
+		log_err("ERROR: Failed to write %s: %s\n", tmppath,
+			strerror(errno));
+		close(fd);
+		unlink(tmppath);
+		free(recs);
+		return;
+	}
+
+	free(recs);
+	close(fd);
+
+	if (rename(tmppath, g_state.ds_journalpath) < 0) {
+		log_err("ERROR: Failed to rename %s: %s\n", tmppath,
+			strerror(errno));
+		unlink(tmppath);
+		return;
+	}
+
+	/* Further changes are appended to the compacted journal */
+
+	if (g_state.ds_journalfd >= 0)
+		close(g_state.ds_journalfd);
+
+	g_state.ds_journalfd = open(g_state.ds_journalpath,
+				O_WRONLY | O_APPEND | O_CLOEXEC);
+	g_state.ds_journalrecs = count;
+}
+
+/****************************************************************************
+ * Name: dhcpd_journalload
+ ****************************************************************************/
+
+static void dhcpd_journalload(void)
+{
+	struct lease_header_s header;
+	struct lease_record_s recs[64];
+	ssize_t len;
+	int fd;
+	int i;
+
+	fd = open(g_state.ds_journalpath, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	if (read(fd, &header, sizeof(header)) != sizeof(header) ||
+		header.magic != DHCPD_JOURNAL_MAGIC ||
+		header.recsize != sizeof(struct lease_record_s)) {
+		log_err("ERROR: Ignoring invalid lease journal %s\n",
+			g_state.ds_journalpath);
+		close(fd);
+		return;
+	}
+
+	/* Replay the records in order, a truncated last record is dropped */
+
+	while ((len = read(fd, recs, sizeof(recs))) > 0) {
+		for (i = 0; i < len / (ssize_t)sizeof(recs[0]); i++) {
+			int ndx = recs[i].ipaddr - g_state.ds_startip;
+			struct lease_s *lease;
+
+			if (ndx < 0 || ndx >= g_state.ds_nleases)
+				continue;
+
+			lease = &g_state.ds_leases[ndx];
+			if (lease->reserved)
+				continue;
+
+			memcpy(lease->mac, recs[i].mac, DHCP_HLEN_ETHERNET);
+			lease->allocated = recs[i].allocated;
+			lease->expiry = recs[i].expiry;
+		}
+	}
+
+	close(fd);
+}
+
+/****************************************************************************
+ * Name: dhcpd_initleases
+ ****************************************************************************/
+
+static int dhcpd_initleases(unsigned int num_leases, in_addr_t startip,
+						const char *interface)
+{
+	unsigned int nwords = DHCPD_MAP_WORDS(num_leases);
+	unsigned int nbuckets = 16;
+	time_t now = dhcpd_time();
+	unsigned int i;
+
+	while (nbuckets < num_leases)
+		nbuckets <<= 1;
+
+	g_state.ds_nleases = num_leases;
+	g_state.ds_startip = startip;
+	g_state.ds_hashmask = nbuckets - 1;
+	g_state.ds_leases = calloc(num_leases, sizeof(struct lease_s));
+	g_state.ds_machash = malloc(nbuckets * sizeof(int));
+	g_state.ds_heap = malloc(num_leases * sizeof(int));
+	g_state.ds_freemap = calloc(nwords, sizeof(uint32_t));
+	g_state.ds_cleanmap = calloc(nwords, sizeof(uint32_t));
+	g_state.ds_probemap = calloc(nwords, sizeof(uint32_t));
+	g_state.ds_pingmap = calloc(nwords, sizeof(uint32_t));
+
+	if (!g_state.ds_leases || !g_state.ds_machash || !g_state.ds_heap ||
+		!g_state.ds_freemap || !g_state.ds_cleanmap ||
+		!g_state.ds_probemap || !g_state.ds_pingmap)
+		return ERROR;
+
+	for (i = 0; i < nbuckets; i++)
+		g_state.ds_machash[i] = -1;
+
+	/* Never hand out addresses ending in 0 or 255, nor our own */
+
+	for (i = 0; i < num_leases; i++) {
+		in_addr_t ipaddr = startip + i;
+
+		g_state.ds_leases[i].reserved = (ipaddr & 0xff) == 0 ||
+			(ipaddr & 0xff) == 0xff ||
+			ipaddr == ntohl(g_state.ds_serverip);
+	}
+
+	/* Restore the leases from the journal, then build the indexes */
+
+	g_state.ds_journalfd = -1;
+	if (mkdir(CONFIG_NETUTILS_DHCPD_LEASEDIR, 0755) < 0 && errno != EEXIST)
+		log_err("ERROR: Failed to create %s: %s\n",
+			CONFIG_NETUTILS_DHCPD_LEASEDIR, strerror(errno));
+
+	snprintf(g_state.ds_journalpath, sizeof(g_state.ds_journalpath),
+		"%s/artik-dhcpd.%s.leases", CONFIG_NETUTILS_DHCPD_LEASEDIR,
+		interface);
+	dhcpd_journalload();
+
+	for (i = 0; i < num_leases; i++) {
+		struct lease_s *lease = &g_state.ds_leases[i];
+		uint8_t mac[DHCP_HLEN_ETHERNET];
+
+		lease->hashnext = -1;
+		lease->heappos = -1;
+		if (lease->reserved)
+			continue;
+
+		memcpy(mac, lease->mac, DHCP_HLEN_ETHERNET);
+		memset(lease->mac, 0, DHCP_HLEN_ETHERNET);
+		if (!dhcpd_findbymac(mac, num_leases))
+			dhcpd_bind(lease, mac);
+
+		if (lease->allocated && lease->expiry <= now)
+			lease->allocated = false;
+
+		if (lease->allocated)
+			dhcpd_heapupdate(i);
+		else
+			dhcpd_mapset(g_state.ds_freemap, i);
+	}
+
+	/* Start over with a journal holding the restored leases only */
+
+	dhcpd_journalcompact();
+	if (g_state.ds_journalfd < 0)
+		log_err("ERROR: Leases will not persist across restarts\n");
+
+	return OK;
+}
+
+/****************************************************************************
+ * Name: dhcpd_probe*
+ ****************************************************************************/
+
+static uint16_t dhcpd_checksum(const uint16_t *data, int len)
+{
+	uint32_t sum = 0;
+
+	for (; len > 1; len -= 2)
+		sum += *data++;
+
+	if (len)
+		sum += *(const uint8_t *)data;
+
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum += sum >> 16;
+
+	return ~sum;
+}
+
+static void dhcpd_proberound(void);
+
+static void on_probe_timeout(void *user_data)
+{
+	unsigned int nwords = DHCPD_MAP_WORDS(g_state.ds_nleases);
+	unsigned int w;
+
+	/* Nobody answered for the addresses still free */
+
+	g_state.ds_probing = false;
+	for (w = 0; w < nwords; w++) {
+		g_state.ds_cleanmap[w] |= g_state.ds_pingmap[w] &
+						g_state.ds_freemap[w];
+		g_state.ds_pingmap[w] = 0;
+	}
+
+	dhcpd_proberound();
+}
+
+/* Send echo requests to all the addresses waiting for a probe at once,
+ * replies are collected by the loop until the probe time is elapsed.
+ */
+
+static void dhcpd_proberound(void)
+{
+	unsigned int nwords = DHCPD_MAP_WORDS(g_state.ds_nleases);
+	struct icmphdr icmp;
+	struct sockaddr_in addr;
+	unsigned int w;
+	bool sent = false;
+
+	if (g_state.ds_probing || g_state.ds_probefd < 0)
+		return;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+
+	for (w = 0; w < nwords; w++) {
+		uint32_t bits = g_state.ds_probemap[w] & g_state.ds_freemap[w];
+
+		g_state.ds_probemap[w] = 0;
+		while (bits) {
+			int ndx = w * 32 + __builtin_ctz(bits);
+
+			bits &= bits - 1;
+
+			memset(&icmp, 0, sizeof(icmp));
+			icmp.type = ICMP_ECHO;
+			icmp.un.echo.id = htons(getpid() & 0xffff);
+			icmp.un.echo.sequence = htons(g_state.ds_probeseq++);
+			icmp.checksum = dhcpd_checksum((uint16_t *)&icmp,
+								sizeof(icmp));
+
+			addr.sin_addr.s_addr = htonl(g_state.ds_startip + ndx);
+			if (sendto(g_state.ds_probefd, &icmp, sizeof(icmp), 0,
+					(struct sockaddr *)&addr,
+					sizeof(addr)) < 0)
+				continue;
+
+			dhcpd_mapset(g_state.ds_pingmap, ndx);
+			sent = true;
+		}
+	}
+
+	if (sent)
+		g_state.ds_probing = g_state.ds_loop->add_timeout_callback(
+				&g_state.ds_probetimer,
+				CONFIG_NETUTILS_DHCPD_PROBETIME,
+				on_probe_timeout, NULL) == S_OK;
+}
+
+/* Check the address is still free before offering it again */
+
+static void dhcpd_probe(int ndx)
+{
+	dhcpd_mapclr(g_state.ds_cleanmap, ndx);
+	if (g_state.ds_probefd < 0)
+		return;
+
+	dhcpd_mapset(g_state.ds_probemap, ndx);
+	dhcpd_proberound();
+}
+
+/****************************************************************************
+ * Name: dhcpd_conflict
+ ****************************************************************************/
+
+/* Hold an address in use by an unknown host, or declined by a client */
+
+static void dhcpd_conflict(struct lease_s *lease)
+{
+	int ndx = lease - g_state.ds_leases;
+
+	dhcpd_unbind(lease);
+	lease->allocated = true;
+	lease->expiry = dhcpd_time() + CONFIG_NETUTILS_DHCPD_DECLINETIME;
+	dhcpd_mapclr(g_state.ds_freemap, ndx);
+	dhcpd_mapclr(g_state.ds_cleanmap, ndx);
+	dhcpd_heapupdate(ndx);
+}
+
+static int on_probe_reply(int fd, enum watch_io io, void *user_data)
+{
+	uint8_t buf[128];
+	struct sockaddr_in from;
+	socklen_t fromlen;
+	ssize_t len;
+
+	for (;;) {
+		struct icmphdr *icmp = (struct icmphdr *)buf;
+		int ndx;
+
+		fromlen = sizeof(from);
+		len = recvfrom(fd, buf, sizeof(buf), 0,
+				(struct sockaddr *)&from, &fromlen);
+		if (len < 0)
+			break;
+
+		/* Raw sockets get the IP header too and all ICMP traffic */
+
+		if (g_state.ds_proberaw) {
+			struct iphdr *ip = (struct iphdr *)buf;
+
+			if (len < sizeof(*ip) || len < ip->ihl * 4 +
+						(ssize_t)sizeof(*icmp))
+				continue;
+
+			icmp = (struct icmphdr *)(buf + ip->ihl * 4);
+			if (icmp->un.echo.id != htons(getpid() & 0xffff))
+				continue;
+		} else if (len < sizeof(*icmp)) {
+			continue;
+		}
+
+		if (icmp->type != ICMP_ECHOREPLY)
+			continue;
+
+		ndx = ntohl(from.sin_addr.s_addr) - g_state.ds_startip;
+		if (ndx < 0 || ndx >= g_state.ds_nleases ||
+			!dhcpd_maptest(g_state.ds_pingmap, ndx))
+			continue;
+
+		dhcpd_mapclr(g_state.ds_pingmap, ndx);
+		if (dhcpd_maptest(g_state.ds_freemap, ndx)) {
+			log_dbg("Address %08lx in use\n",
+				(long)(g_state.ds_startip + ndx));
+			dhcpd_conflict(&g_state.ds_leases[ndx]);
+		}
+	}
+
+	return 1;
+}
+
+/****************************************************************************
+ * Name: dhcpd_openprobe
+ ****************************************************************************/
+
+static void dhcpd_openprobe(void)
+{
+	unsigned int nwords = DHCPD_MAP_WORDS(g_state.ds_nleases);
+	unsigned int w;
+	int fd;
+
+	/* Use an unprivileged ping socket when allowed, a raw one otherwise.
+	 * Without any, free addresses are probed when offering them.
+	 */
+
+	g_state.ds_proberaw = false;
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+								IPPROTO_ICMP);
+	if (fd < 0) {
+		g_state.ds_proberaw = true;
+		fd = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+								IPPROTO_ICMP);
+	}
+
+	g_state.ds_probefd = fd;
+	if (fd < 0)
+		return;
+
+	if (g_state.ds_loop->add_fd_watch(fd, WATCH_IO_IN, on_probe_reply,
+				NULL, &g_state.ds_probewatch) != S_OK) {
+		close(fd);
+		g_state.ds_probefd = -1;
+		return;
+	}
+
+	for (w = 0; w < nwords; w++)
+		g_state.ds_probemap[w] = g_state.ds_freemap[w];
+
+	dhcpd_proberound();
+}
+
+/****************************************************************************
+ * Name: dhcpd_freelease
+ ****************************************************************************/
+
+/* The address can be offered again. The MAC address is remembered so that
+ * the client gets it back unless the address was given to someone else.
+ */
+
+static void dhcpd_freelease(struct lease_s *lease)
+{
+	int ndx = lease - g_state.ds_leases;
+
+	lease->allocated = false;
+	lease->expiry = 0;
+	dhcpd_heapremove(ndx);
+	dhcpd_mapset(g_state.ds_freemap, ndx);
+	dhcpd_probe(ndx);
+}
+
+/****************************************************************************
+ * Name: dhcpd_expireleases
+ ****************************************************************************/
+
+static void dhcpd_expireleases(void)
+{
+	time_t now = dhcpd_time();
+
+	while (g_state.ds_heapsize > 0 && dhcpd_heapexpiry(0) <= now)
+		dhcpd_freelease(&g_state.ds_leases[g_state.ds_heap[0]]);
+}
+
 /****************************************************************************
  * Name: dhcpd_leaseexpired
  ****************************************************************************/
@@ -319,10 +1108,12 @@ static inline bool dhcpd_leaseexpired(struct lease_s *lease)
 {
 	bool ret;
 
-	if (lease->expiry > dhcpd_time())
+	if (lease->reserved || (lease->allocated &&
+					lease->expiry > dhcpd_time()))
 		ret = false;
 	else {
-		memset(lease, 0, sizeof(struct lease_s));
+		if (lease->allocated)
+			dhcpd_freelease(lease);
 		ret = true;
 	}
 
@@ -350,11 +1141,25 @@ struct lease_s *dhcpd_setlease(const uint8_t *mac, in_addr_t ipaddr,
 
 	/* Verify that the address offset is within the supported range */
 
-	if (ndx >= 0 && ndx < num_leases) {
+	if (ndx >= 0 && ndx < num_leases && !g_state.ds_leases[ndx].reserved) {
+		struct lease_s *old = dhcpd_findbymac(mac, num_leases);
+
 		ret = &g_state.ds_leases[ndx];
-		memcpy(ret->mac, mac, DHCP_HLEN_ETHERNET);
+
+		/* A client holds a single lease */
+
+		if (old && old != ret) {
+			dhcpd_unbind(old);
+			if (old->allocated)
+				dhcpd_freelease(old);
+			dhcpd_journal(old);
+		}
+
+		dhcpd_bind(ret, mac);
 		ret->allocated = true;
 		ret->expiry = dhcpd_time() + expiry;
+		dhcpd_mapclr(g_state.ds_freemap, ndx);
+		dhcpd_heapupdate(ndx);
 	}
 
 	return ret;
@@ -372,24 +1177,6 @@ static inline in_addr_t dhcp_leaseipaddr(struct lease_s *lease,
 	return (in_addr_t)(lease - g_state.ds_leases) + startip;
 }
 
-/****************************************************************************
- * Name: dhcpd_findbymac
- ****************************************************************************/
-
-static struct lease_s *dhcpd_findbymac(const uint8_t *mac,
-					unsigned int num_leases)
-{
-	int i;
-
-	for (i = 0; i < num_leases; i++) {
-		if (memcmp(g_state.ds_leases[i].mac, mac, DHCP_HLEN_ETHERNET)
-									== 0)
-			return &(g_state.ds_leases[i]);
-	}
-
-	return NULL;
-}
-
 /****************************************************************************
  * Name: dhcpd_findbyipaddr
  ****************************************************************************/
@@ -403,7 +1190,7 @@ static struct lease_s *dhcpd_findbyipaddr(in_addr_t ipaddr, in_addr_t startip,
 
 		log_dbg("dhcpd_findbyipaddr lease index = %d", ipaddr -
 								startip);
-		if (lease->allocated > 0) {
+		if (lease->allocated > 0 || lease->reserved) {
 			log_dbg("return lease %d %d", ipaddr - startip,
 			g_state.ds_leases[ipaddr - startip].allocated);
 			return lease;
@@ -421,44 +1208,30 @@ static struct lease_s *dhcpd_findbyipaddr(in_addr_t ipaddr, in_addr_t startip,
 
 static in_addr_t dhcpd_allocipaddr(in_addr_t startip, in_addr_t endip)
 {
-	struct lease_s *lease = NULL;
-	in_addr_t ipaddr;
+	struct in_addr addr;
+	int ndx;
 
-	ipaddr = startip;
-	for (; ipaddr <= endip; ipaddr++) {
-		/* Skip over address ending in 0 or 255 */
+	/* Take a free address already probed for conflicts */
 
-		struct in_addr addr;
+	ndx = dhcpd_mapfind(g_state.ds_freemap, g_state.ds_cleanmap);
+	if (ndx >= 0) {
+		log_dbg("Leases table = %d %d", ndx,
+			g_state.ds_leases[ndx].allocated);
 
-		addr.s_addr = htonl(ipaddr);
-
-		if (verify_ipv4addr_in_used(&addr) == OK)
-			continue;
-
-		if ((ipaddr & 0xff) == 0 || (ipaddr & 0xff) == 0xff)
-			continue;
-
-		/* Is there already a lease on this address?  If so, has
-		 * it expired?
-		 */
+		/* Return the address in host order */
 
-		lease = dhcpd_findbyipaddr(ipaddr, startip, endip);
-		if ((!lease  || dhcpd_leaseexpired(lease))) {
-			log_dbg("Lease pass !!");
+		return startip + ndx;
+	}
 
-			log_dbg("Leases table = %d %d", ipaddr - startip,
-			g_state.ds_leases[ipaddr - startip].allocated);
+	/* None yet, probe free addresses one by one */
 
-			memset(g_state.ds_leases[ipaddr - startip].mac, 0,
-							DHCP_HLEN_ETHERNET);
-			g_state.ds_leases[ipaddr - startip].allocated = true;
-			g_state.ds_leases[ipaddr - startip].expiry =
-				dhcpd_time() + CONFIG_NETUTILS_DHCPD_OFFERTIME;
+	while ((ndx = dhcpd_mapfind(g_state.ds_freemap, NULL)) >= 0) {
+		addr.s_addr = htonl(startip + ndx);
 
-			/* Return the address in host order */
+		if (verify_ipv4addr_in_used(&addr) != OK)
+			return startip + ndx;
 
-			return ipaddr;
-		}
+		dhcpd_conflict(&g_state.ds_leases[ndx]);
 	}
 
 	return 0;
@@ -829,8 +1602,6 @@ static inline int dhcpd_openresponder(void)
 
 static void dhcpd_initpacket(uint8_t mtype)
 {
-	uint32_t nulladdr = 0;
-
 	/* Set up the generic parts of the DHCP server message */
 
 	memset(&g_state.ds_outpacket, 0, sizeof(struct dhcpmsg_s));
@@ -847,12 +1618,11 @@ static void dhcpd_initpacket(uint8_t mtype)
 		g_state.ds_inpacket.chaddr[2], g_state.ds_inpacket.chaddr[3],
 		g_state.ds_inpacket.chaddr[4], g_state.ds_inpacket.chaddr[5]);
 
-	if (memcmp(g_state.ds_outpacket.giaddr, &nulladdr, 4) != 0)
-		g_state.ds_outpacket.flags  = g_state.ds_inpacket.flags;
-	else
-		g_state.ds_outpacket.flags  = 0;
+	/* Keep the broadcast flag, a client without an address yet cannot
+	 * receive a unicast reply.
+	 */
 
-	memset(g_state.ds_outpacket.giaddr, 0, 4);
+	g_state.ds_outpacket.flags  = g_state.ds_inpacket.flags;
 
 	/* Add the generic options */
 
@@ -1015,6 +1785,7 @@ int dhcpd_sendack(in_addr_t ipaddr, in_addr_t startip, in_addr_t netmask,
 		unsigned int num_leases, const char *interface)
 {
 	uint32_t leasetime = CONFIG_NETUTILS_DHCPD_LEASETIME;
+	struct lease_s *lease;
 	in_addr_t netaddr;
 	int i;
 
@@ -1059,8 +1830,10 @@ int dhcpd_sendack(in_addr_t ipaddr, in_addr_t startip, in_addr_t netmask,
 	if (dhcpd_sendpacket(false, interface) < 0)
 		return ERROR;
 
-	dhcpd_setlease(g_state.ds_inpacket.chaddr, ipaddr, leasetime,
+	lease = dhcpd_setlease(g_state.ds_inpacket.chaddr, ipaddr, leasetime,
 		num_leases, startip);
+	if (lease)
+		dhcpd_journal(lease);
 
 
 	return OK;
@@ -1278,9 +2051,8 @@ static inline int dhcpd_decline(unsigned int num_leases)
 		 * address for a period of time.
 		 */
 
-		memset(lease->mac, 0, DHCP_HLEN_ETHERNET);
-		lease->expiry = dhcpd_time() +
-			CONFIG_NETUTILS_DHCPD_DECLINETIME;
+		dhcpd_conflict(lease);
+		dhcpd_journal(lease);
 	}
 
 	return OK;
@@ -1293,9 +2065,14 @@ static inline int dhcpd_release(unsigned int num_leases)
 	/* Find the lease associated with this hardware address */
 
 	lease = dhcpd_findbymac(g_state.ds_inpacket.chaddr, num_leases);
-	if (lease)
+	if (lease) {
 		/* Release the IP address now */
-		memset(lease, 0, sizeof(struct lease_s));
+
+		dhcpd_unbind(lease);
+		if (lease->allocated)
+			dhcpd_freelease(lease);
+		dhcpd_journal(lease);
+	}
 
 	return OK;
 }
@@ -1382,6 +2159,10 @@ static int loop_handler(int fd, enum watch_io io, void *arg)
 
 		log_err("ERROR: No msg type\n");
 
+	/* Reclaim the leases expired since the previous message */
+
+	dhcpd_expireleases();
+
 	/* Now process the incoming DHCP message by its message type */
 
 	switch (g_state.ds_optmsgtype) {
@@ -1462,14 +2243,10 @@ int dhcpd_run(artik_network_dhcp_server_config *config,
 	/* Initialize everything to zero */
 
 	memset(&g_state, 0, sizeof(struct dhcpd_state_s));
-
-	g_state.ds_leases = (struct lease_s *)malloc(num_leases*
-							sizeof(struct lease_s));
-
-	memset(g_state.ds_leases, 0, sizeof(struct lease_s));
-
-	for (int i = 0; i < num_leases; i++)
-		memset(&g_state.ds_leases[i], 0, sizeof(struct lease_s));
+	g_state.ds_loop = loop;
+	g_state.ds_server = server;
+	g_state.ds_probefd = -1;
+	g_state.ds_journalfd = -1;
 
 	/* Now loop indefinitely, reading packets from the DHCP server socket */
 
@@ -1482,9 +2259,56 @@ int dhcpd_run(artik_network_dhcp_server_config *config,
 			log_err("ERROR: Failed to create socket\n");
 	}
 
+	/* The server address is known, set up the leases */
+
+	if (dhcpd_initleases(num_leases, server->startip,
+					server->interface) != OK) {
+		log_err("ERROR: Failed to allocate leases\n");
+		dhcpd_stop();
+		return ERROR;
+	}
+
+	dhcpd_openprobe();
+
 	loop->add_fd_watch(*sockfd,
 		WATCH_IO_IN | WATCH_IO_ERR | WATCH_IO_HUP | WATCH_IO_NVAL,
 		loop_handler, server, watch_id);
 
 	return OK;
 }
+
+/****************************************************************************
+ * Name: dhcpd_stop
+ ****************************************************************************/
+
+void dhcpd_stop(void)
+{
+	if (g_state.ds_probing)
+		g_state.ds_loop->remove_timeout_callback(g_state.ds_probetimer);
+
+	if (g_state.ds_probefd >= 0) {
+		g_state.ds_loop->remove_fd_watch(g_state.ds_probewatch);
+		close(g_state.ds_probefd);
+	}
+
+	if (g_state.ds_journalfd >= 0)
+		close(g_state.ds_journalfd);
+
+	free(g_state.ds_leases);
+	free(g_state.ds_machash);
+	free(g_state.ds_heap);
+	free(g_state.ds_freemap);
+	free(g_state.ds_cleanmap);
+	free(g_state.ds_probemap);
+	free(g_state.ds_pingmap);
+
+	if (g_state.ds_server) {
+		free(g_state.ds_server->dns_addr);
+		free(g_state.ds_server);
+	}
+
+	if (g_state.ds_loop)
+		artik_release_api_module(g_state.ds_loop);
+
+	memset(&g_state, 0, sizeof(struct dhcpd_state_s));
+}
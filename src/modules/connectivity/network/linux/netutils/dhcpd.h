@@ -67,6 +67,7 @@ extern "C"
 
 int dhcpd_run(artik_network_dhcp_server_config * config,
 	int *sockfd, int *watch_id);
+void dhcpd_stop(void);
 
 #ifdef __cplusplus
 }
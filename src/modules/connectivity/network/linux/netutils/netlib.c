@@ -457,14 +457,16 @@ int verify_ipv4addr_in_used(const struct in_addr *inaddr)
 	struct icmphdr icmp_hdr;
 	struct sockaddr_in addr;
 	int sequence = 0;
+	int sock = -1;
 
-	if (system("sysctl -w net.ipv4.ping_group_range=\"0 0\" > NUL") < 0) {
+	if (system("sysctl -w net.ipv4.ping_group_range=\"0 0\" > /dev/null")
+									< 0) {
 		log_err("Error system");
 		ret = ERROR;
 		goto errout;
 	}
 
-	int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+	sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
 
 	log_dbg("Ping IP address %d.%d.%d.%d\n",
 		(inaddr->s_addr) & 0xff,
@@ -558,5 +560,8 @@ int verify_ipv4addr_in_used(const struct in_addr *inaddr)
 	}
 
 errout:
+	if (sock >= 0)
+		close(sock);
+
 	return ret;
 }
@@ -22,6 +22,9 @@
 #include <stdio.h>
 #include <errno.h>
 #include <regex.h>
+#include <poll.h>
+#include <stdint.h>
+#include <time.h>
 
 #include <artik_network.h>
 #include <artik_loop.h>
@@ -42,11 +45,50 @@
 
 #define ROUTE_EXISTS 17
 
+#define ONLINE_MAX_LINKS		32
+#define ONLINE_MAX_PROBES		4
+#define ONLINE_PROBE_TIMEOUT_MS		3000
+#define ONLINE_DEBOUNCE_MS		500
+#define ONLINE_CACHE_MS			30000
+
+/*
+ * Link and default route state as reported by rtnetlink. The device can
+ * only be online if a running link carries a default route.
+ */
+typedef struct {
+	int ifindex;
+	bool running;
+	int default_routes;
+} online_link;
+
+typedef struct {
+	online_link links[ONLINE_MAX_LINKS];
+	int count;
+} online_links;
+
+typedef struct {
+	struct sockaddr_in addr[ONLINE_MAX_PROBES];
+	int count;
+	unsigned int timeout_ms;
+} online_probe_config;
+
 typedef struct {
 	artik_list *root;
 	int fd;
 	bool current_online_status;
+	bool status_known;
 	int watch_id;
+	artik_loop_module *loop;
+	online_links links;
+	bool debounce_pending;
+	int debounce_id;
+	int probe_fd[ONLINE_MAX_PROBES];
+	int probe_watch_id[ONLINE_MAX_PROBES];
+	int probes_running;
+	int probe_timeout_id;
+	bool probe_timeout_pending;
+	bool dispatching;
+	bool released;
 } watch_online_status_t;
 
 typedef struct {
@@ -69,14 +111,9 @@ typedef struct {
 
 typedef struct {
 	artik_list node;
-	int renew_cbk_id;
-	artik_loop_module *loop_module;
 	const char *interface;
 } dhcp_handle_client;
 
-static int dhcp_client_renew(artik_network_dhcp_client_handle *handle,
-		const char *interface);
-
 static watch_online_status_t *watch_online_status = NULL;
 
 static artik_list *requested_node = NULL;
@@ -292,85 +329,545 @@ static int check_network_config(artik_network_config *config)
 	return 0;
 }
 
+static online_probe_config online_probe = {
+	.count = 0,
+	.timeout_ms = ONLINE_PROBE_TIMEOUT_MS
+};
+
+/* Last probe result, shared by the monitor and get_online_status() */
+static struct {
+	bool valid;
+	bool online;
+	uint64_t timestamp;
+} online_cache;
+
+static uint64_t online_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void online_cache_update(bool online)
+{
+	online_cache.online = online;
+	online_cache.timestamp = online_now_ms();
+	online_cache.valid = true;
+}
+
+static void online_probe_defaults(void)
+{
+	static const char * const addresses[] = { "8.8.8.8", "1.1.1.1" };
+	int i;
+
+	/* Public DNS servers, TCP port 53 */
+	for (i = 0; i < 2; i++) {
+		memset(&online_probe.addr[i], 0, sizeof(struct sockaddr_in));
+		online_probe.addr[i].sin_family = AF_INET;
+		online_probe.addr[i].sin_port = htons(53);
+		inet_pton(AF_INET, addresses[i],
+					&online_probe.addr[i].sin_addr);
+	}
+	online_probe.count = 2;
+}
+
+static online_link *online_find_link(online_links *links, int ifindex,
+								bool create)
+{
+	int i;
+
+	for (i = 0; i < links->count; i++) {
+		if (links->links[i].ifindex == ifindex)
+			return &links->links[i];
+	}
+
+	if (!create || links->count == ONLINE_MAX_LINKS)
+		return NULL;
+
+	links->links[links->count].ifindex = ifindex;
+	links->links[links->count].running = false;
+	links->links[links->count].default_routes = 0;
+
+	return &links->links[links->count++];
+}
+
+static bool online_has_route(online_links *links)
+{
+	int i;
+
+	for (i = 0; i < links->count; i++) {
+		if (links->links[i].running &&
+					links->links[i].default_routes > 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Apply one rtnetlink message to the link table. Returns true if it may
+ * change the reachability of the network.
+ */
+static bool online_handle_msg(online_links *links, struct nlmsghdr *hdr)
+{
+	switch (hdr->nlmsg_type) {
+	case RTM_NEWLINK:
+	case RTM_DELLINK: {
+		struct ifinfomsg *info = NLMSG_DATA(hdr);
+		online_link *link;
+		bool running;
+
+		if (hdr->nlmsg_type == RTM_DELLINK) {
+			link = online_find_link(links, info->ifi_index, false);
+			if (!link)
+				return false;
+			*link = links->links[--links->count];
+			return true;
+		}
+
+		link = online_find_link(links, info->ifi_index, true);
+		if (!link)
+			return false;
+
+		running = (info->ifi_flags & IFF_UP) &&
+					(info->ifi_flags & IFF_RUNNING);
+		if (link->running == running)
+			return false;
+
+		link->running = running;
+		return true;
+	}
+	case RTM_NEWROUTE:
+	case RTM_DELROUTE: {
+		struct rtmsg *rtm = NLMSG_DATA(hdr);
+		int len = RTM_PAYLOAD(hdr);
+		struct rtattr *rta;
+		online_link *link = NULL;
+
+		if (rtm->rtm_family != AF_INET ||
+				rtm->rtm_table != RT_TABLE_MAIN ||
+				rtm->rtm_type != RTN_UNICAST ||
+				rtm->rtm_dst_len != 0)
+			return false;
+
+		for (rta = RTM_RTA(rtm); RTA_OK(rta, len);
+						rta = RTA_NEXT(rta, len)) {
+			if (rta->rta_type == RTA_OIF) {
+				link = online_find_link(links,
+					*(int *)RTA_DATA(rta), true);
+				break;
+			}
+		}
+
+		if (!link)
+			return false;
+
+		if (hdr->nlmsg_type == RTM_NEWROUTE)
+			link->default_routes++;
+		else if (link->default_routes > 0)
+			link->default_routes--;
+
+		return true;
+	}
+	case RTM_NEWADDR:
+	case RTM_DELADDR:
+		/* The source address of the probes changed */
+		return true;
+	default:
+		return false;
+	}
+}
+
+static int online_dump(int fd, int type, online_links *links)
+{
+	struct {
+		struct nlmsghdr hdr;
+		struct rtmsg msg;
+	} req;
+
+	memset(&req, 0, sizeof(req));
+	req.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+	req.hdr.nlmsg_type = type;
+	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.hdr.nlmsg_seq = type;
+	req.msg.rtm_family = (type == RTM_GETROUTE) ? AF_INET : AF_UNSPEC;
+
+	if (send(fd, &req, req.hdr.nlmsg_len, 0) < 0)
+		return -1;
+
+	while (1) {
+		unsigned char buf[8192];
+		struct nlmsghdr *hdr;
+		int len = recv(fd, buf, sizeof(buf), 0);
+
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0)
+			return -1;
+
+		for (hdr = (struct nlmsghdr *)buf; NLMSG_OK(hdr, len);
+						hdr = NLMSG_NEXT(hdr, len)) {
+			if (hdr->nlmsg_type == NLMSG_DONE)
+				return 0;
+			if (hdr->nlmsg_type == NLMSG_ERROR)
+				return -1;
+			online_handle_msg(links, hdr);
+		}
+	}
+}
+
+/* Rebuild the link table from a full dump of the links and routes */
+static artik_error online_dump_links(online_links *links)
+{
+	int fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_ROUTE);
+	artik_error ret = S_OK;
+
+	if (fd < 0)
+		return E_ACCESS_DENIED;
+
+	links->count = 0;
+	if (online_dump(fd, RTM_GETLINK, links) < 0 ||
+				online_dump(fd, RTM_GETROUTE, links) < 0) {
+		log_err("failed to dump links and routes");
+		ret = E_NETWORK_ERROR;
+	}
+
+	close(fd);
+
+	return ret;
+}
+
+/*
+ * Start a non blocking TCP connection to a probe address. Getting a
+ * connection or a refusal both prove that the address is reachable.
+ */
+static int online_probe_connect(struct sockaddr_in *addr)
+{
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+									0);
+
+	if (fd < 0)
+		return -1;
+
+	if (connect(fd, (struct sockaddr *)addr, sizeof(*addr)) < 0 &&
+							errno != EINPROGRESS) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static bool online_probe_reachable(int fd)
+{
+	socklen_t len = sizeof(int);
+	int err = 0;
+
+	if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+		return false;
+
+	return err == 0 || err == ECONNREFUSED;
+}
+
+/* Blocking check bounded by the probe timeout, used without a monitor */
+static bool online_probe_sync(void)
+{
+	struct pollfd pfd[ONLINE_MAX_PROBES];
+	uint64_t deadline = online_now_ms() + online_probe.timeout_ms;
+	bool online = false;
+	int count = 0;
+	int i;
+
+	for (i = 0; i < online_probe.count; i++) {
+		pfd[count].fd = online_probe_connect(&online_probe.addr[i]);
+		pfd[count].events = POLLOUT;
+		if (pfd[count].fd >= 0)
+			count++;
+	}
+
+	while (count > 0 && !online) {
+		uint64_t now = online_now_ms();
+		int ret;
+
+		if (now >= deadline)
+			break;
+
+		ret = poll(pfd, count, deadline - now);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			break;
+
+		for (i = 0; i < count; i++) {
+			if (!pfd[i].revents)
+				continue;
+
+			online = online_probe_reachable(pfd[i].fd);
+			close(pfd[i].fd);
+			pfd[i--] = pfd[--count];
+			if (online)
+				break;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+		close(pfd[i].fd);
+
+	return online;
+}
+
+static void online_free(watch_online_status_t *status)
+{
+	artik_loop_module *loop = status->loop;
+
+	loop->remove_fd_watch(status->watch_id);
+	close(status->fd);
+	free(status);
+	artik_release_api_module(loop);
+}
+
+static void online_set_status(watch_online_status_t *status, bool online)
+{
+	watch_online_node_t *node;
+	ARTIK_LIST_HANDLE *handles;
+	int count, i;
+	bool notify = status->status_known &&
+				status->current_online_status != online;
+
+	online_cache_update(online);
+	status->current_online_status = online;
+	status->status_known = true;
+
+	if (!notify)
+		return;
+
+	log_dbg("online status changed to %d", online);
+
+	count = artik_list_size(status->root);
+	handles = malloc(count * sizeof(ARTIK_LIST_HANDLE));
+	if (!handles)
+		return;
+
+	node = (watch_online_node_t *)status->root;
+	for (i = 0; node && i < count; i++) {
+		handles[i] = node->node.handle;
+		node = (watch_online_node_t *)node->node.next;
+	}
+
+	/* Watchers may be added or removed from their callback */
+	status->dispatching = true;
+	for (i = 0; i < count && !status->released; i++) {
+		node = (watch_online_node_t *)artik_list_get_by_handle(
+						status->root, handles[i]);
+		if (node)
+			node->config.callback(online, node->config.user_data);
+	}
+	status->dispatching = false;
+	free(handles);
+
+	if (status->released) {
+		online_free(status);
+		watch_online_status = NULL;
+	}
+}
+
+static void online_cancel_probes(watch_online_status_t *status)
+{
+	int i;
+
+	for (i = 0; i < ONLINE_MAX_PROBES; i++) {
+		if (status->probe_fd[i] < 0)
+			continue;
+		status->loop->remove_fd_watch(status->probe_watch_id[i]);
+		close(status->probe_fd[i]);
+		status->probe_fd[i] = -1;
+	}
+
+	if (status->probe_timeout_pending)
+		status->loop->remove_timeout_callback(
+						status->probe_timeout_id);
+	status->probe_timeout_pending = false;
+	status->probes_running = 0;
+}
+
+static int on_online_probe(int fd, enum watch_io io, void *user_data)
+{
+	watch_online_status_t *status = user_data;
+	bool online = online_probe_reachable(fd);
+	int i;
+
+	for (i = 0; i < ONLINE_MAX_PROBES; i++) {
+		if (status->probe_fd[i] == fd)
+			break;
+	}
+
+	if (i == ONLINE_MAX_PROBES)
+		return 0;
+
+	close(fd);
+	status->probe_fd[i] = -1;
+
+	if (online || --status->probes_running == 0) {
+		online_cancel_probes(status);
+		online_set_status(status, online);
+	}
+
+	return 0;
+}
+
+static void on_online_probe_timeout(void *user_data)
+{
+	watch_online_status_t *status = user_data;
+
+	/* The timeout is gone, do not remove it again */
+	status->probe_timeout_pending = false;
+	online_cancel_probes(status);
+	online_set_status(status, false);
+}
+
+static void online_start_probes(watch_online_status_t *status)
+{
+	int i;
+
+	online_cancel_probes(status);
+
+	for (i = 0; i < online_probe.count; i++) {
+		int fd = online_probe_connect(&online_probe.addr[i]);
+
+		if (fd < 0)
+			continue;
+
+		if (status->loop->add_fd_watch(fd, WATCH_IO_OUT | WATCH_IO_ERR |
+				WATCH_IO_HUP, on_online_probe, status,
+				&status->probe_watch_id[i]) != S_OK) {
+			close(fd);
+			continue;
+		}
+
+		status->probe_fd[i] = fd;
+		status->probes_running++;
+	}
+
+	if (!status->probes_running) {
+		online_set_status(status, false);
+		return;
+	}
+
+	if (status->loop->add_timeout_callback(&status->probe_timeout_id,
+			online_probe.timeout_ms, on_online_probe_timeout,
+			status) != S_OK) {
+		online_cancel_probes(status);
+		online_set_status(status, false);
+		return;
+	}
+
+	status->probe_timeout_pending = true;
+}
+
+static void on_online_debounce(void *user_data)
+{
+	watch_online_status_t *status = user_data;
+
+	status->debounce_pending = false;
+
+	if (!online_has_route(&status->links)) {
+		online_cancel_probes(status);
+		online_set_status(status, false);
+		return;
+	}
+
+	online_start_probes(status);
+}
+
+/*
+ * Bursts of netlink events (e.g. link flaps, DHCP reconfiguring the
+ * interface) are coalesced into a single probe once things settle.
+ */
+static void online_schedule_check(watch_online_status_t *status,
+							unsigned int delay)
+{
+	if (status->debounce_pending)
+		status->loop->remove_timeout_callback(status->debounce_id);
+
+	status->debounce_pending = status->loop->add_timeout_callback(
+			&status->debounce_id, delay, on_online_debounce,
+			status) == S_OK;
+}
+
 static int network_connection(int fd, enum watch_io io, void *user_data)
 {
-	int len = 0;
-	unsigned char buf[4096];
+	watch_online_status_t *status = user_data;
+	unsigned char buf[8192];
 	struct iovec iov = { buf, sizeof(buf) };
 	struct sockaddr_nl addr;
 	struct nlmsghdr *hdr = NULL;
-	struct ifinfomsg *infomsg = NULL;
 	struct msghdr msg = { &addr, sizeof(addr), &iov, 1, NULL, 0, 0 };
-	bool check_online_status = false;
-	bool old_online_status = watch_online_status->current_online_status;
-
-	artik_error ret = S_OK;
+	bool changed = false;
+	int len;
 
 	if (io & (WATCH_IO_NVAL | WATCH_IO_HUP | WATCH_IO_ERR)) {
 		log_dbg("%s netlink error", __func__);
 		return 1;
 	}
-	len = recvmsg(fd, &msg, 0);
 
-	for (hdr = (struct nlmsghdr *)buf; len > 0 && NLMSG_OK(hdr, len); hdr =
-							NLMSG_NEXT(hdr, len)) {
+	len = recvmsg(fd, &msg, MSG_DONTWAIT);
+	if (len < 0) {
+		/* Events were lost, start over from a full dump */
+		if (errno == ENOBUFS) {
+			online_dump_links(&status->links);
+			online_schedule_check(status, ONLINE_DEBOUNCE_MS);
+		}
+		return 1;
+	}
+
+	for (hdr = (struct nlmsghdr *)buf; NLMSG_OK(hdr, len);
+						hdr = NLMSG_NEXT(hdr, len)) {
 		if (hdr->nlmsg_type == NLMSG_DONE ||
 						hdr->nlmsg_type == NLMSG_ERROR)
 			break;
 
-		if (hdr->nlmsg_type ==  RTM_NEWLINK ||
-					hdr->nlmsg_type == RTM_DELLINK) {
-			infomsg = (struct ifinfomsg *)NLMSG_DATA(hdr);
-			check_online_status = infomsg->ifi_flags & IFF_UP ?
-				!old_online_status : old_online_status;
-		} else if (hdr->nlmsg_type == RTM_NEWADDR ||
-						hdr->nlmsg_type == RTM_NEWROUTE)
-			check_online_status = !old_online_status;
-
-		else if (hdr->nlmsg_type == RTM_DELADDR ||
-						hdr->nlmsg_type == RTM_DELROUTE)
-			check_online_status = old_online_status;
+		changed |= online_handle_msg(&status->links, hdr);
 	}
 
-	if (check_online_status) {
-		ret = artik_get_online_status(
-				&watch_online_status->current_online_status);
-		if (ret != S_OK)
-			return 1;
-	}
-
-	if (watch_online_status->current_online_status != old_online_status) {
-		watch_online_node_t *node = (watch_online_node_t *)
-						watch_online_status->root;
-		do {
-			node->config.callback(
-				watch_online_status->current_online_status,
-				node->config.user_data);
-			node = (watch_online_node_t *)node->node.next;
-		} while (node);
+	if (!changed)
+		return 1;
 
+	/* Going offline does not need a probe */
+	if (!online_has_route(&status->links) && status->status_known &&
+					!status->current_online_status) {
+		online_cancel_probes(status);
+		return 1;
 	}
 
+	online_schedule_check(status, ONLINE_DEBOUNCE_MS);
+
 	return 1;
 }
 
 static artik_error initialize_watch_online_status(void)
 {
-	artik_error ret = S_OK;
+	watch_online_status_t *status;
 	struct sockaddr_nl addr;
-	artik_loop_module *loop = (artik_loop_module *)
-					artik_request_api_module("loop");
-	watch_online_status = (watch_online_status_t *)
-					malloc(sizeof(watch_online_status_t));
-	if (!watch_online_status)
+	artik_error ret;
+	int i;
+
+	status = (watch_online_status_t *)calloc(1,
+					sizeof(watch_online_status_t));
+	if (!status)
 		return E_NO_MEM;
 
-	watch_online_status->fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC,
+	for (i = 0; i < ONLINE_MAX_PROBES; i++)
+		status->probe_fd[i] = -1;
+
+	if (!online_probe.count)
+		online_probe_defaults();
+
+	status->fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC,
 								NETLINK_ROUTE);
-	if (watch_online_status->fd == -1) {
+	if (status->fd == -1) {
 		log_err("couldn't open NETLINK_ROUTE socket");
-		free(watch_online_status);
-		watch_online_status = NULL;
+		free(status);
 		return E_ACCESS_DENIED;
 	}
 
@@ -379,31 +876,116 @@ static artik_error initialize_watch_online_status(void)
 	addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV4_ROUTE |
 					(1<<(RTNLGRP_ND_USEROPT-1));
 
-	if (bind(watch_online_status->fd, (struct sockaddr *)&addr,
-							sizeof(addr)) != 0) {
+	if (bind(status->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
 		log_err("couldn't bind NETLINK_ROUTE socket");
-		free(watch_online_status);
-		watch_online_status = NULL;
+		close(status->fd);
+		free(status);
 		return E_ACCESS_DENIED;
 	}
 
-	ret = artik_get_online_status(
-				&watch_online_status->current_online_status);
+	/* Subscribe before dumping so that no change is missed */
+	ret = online_dump_links(&status->links);
 	if (ret != S_OK) {
-		log_err("couldn't get initial online status");
-		free(watch_online_status);
-		watch_online_status = NULL;
+		close(status->fd);
+		free(status);
 		return ret;
 	}
 
-	loop->add_fd_watch(watch_online_status->fd,
+	status->loop = (artik_loop_module *)artik_request_api_module("loop");
+	ret = status->loop->add_fd_watch(status->fd,
 		(WATCH_IO_IN | WATCH_IO_ERR | WATCH_IO_HUP |
 		WATCH_IO_NVAL),
 		network_connection,
-		NULL,
-		&(watch_online_status->watch_id));
+		status,
+		&status->watch_id);
+	if (ret != S_OK) {
+		artik_release_api_module(status->loop);
+		close(status->fd);
+		free(status);
+		return ret;
+	}
+
+	/*
+	 * The initial status is not reported to the watchers. Start from
+	 * a recent result if any, and check it in the background.
+	 */
+	if (!online_has_route(&status->links)) {
+		online_set_status(status, false);
+	} else {
+		if (online_cache.valid && online_now_ms() -
+				online_cache.timestamp < ONLINE_CACHE_MS)
+			online_set_status(status, online_cache.online);
+		online_schedule_check(status, 0);
+	}
+
+	watch_online_status = status;
+
+	return S_OK;
+}
+
+artik_error os_network_get_online_status(bool *online_status)
+{
+	online_links links;
+	artik_error ret;
 
-	watch_online_status->root = NULL;
+	/* The monitor keeps the status up to date */
+	if (watch_online_status && watch_online_status->status_known) {
+		*online_status = watch_online_status->current_online_status;
+		return S_OK;
+	}
+
+	if (online_cache.valid &&
+		online_now_ms() - online_cache.timestamp < ONLINE_CACHE_MS) {
+		*online_status = online_cache.online;
+		return S_OK;
+	}
+
+	ret = online_dump_links(&links);
+	if (ret != S_OK)
+		return ret;
+
+	if (!online_probe.count)
+		online_probe_defaults();
+
+	*online_status = online_has_route(&links) && online_probe_sync();
+	online_cache_update(*online_status);
+
+	return S_OK;
+}
+
+artik_error os_network_set_online_status_probe(const char *address,
+				int port, unsigned int timeout_ms)
+{
+	struct sockaddr_in addr;
+
+	if (address) {
+		if (port <= 0 || port > 65535)
+			return E_BAD_ARGS;
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		if (inet_pton(AF_INET, address, &addr.sin_addr) != 1)
+			return E_BAD_ARGS;
+	}
+
+	/* Probes in flight refer to the current addresses */
+	if (watch_online_status)
+		online_cancel_probes(watch_online_status);
+
+	if (address) {
+		online_probe.addr[0] = addr;
+		online_probe.count = 1;
+	} else {
+		online_probe_defaults();
+	}
+
+	online_probe.timeout_ms = timeout_ms ? timeout_ms :
+						ONLINE_PROBE_TIMEOUT_MS;
+	online_cache.valid = false;
+
+	if (watch_online_status)
+		online_schedule_check(watch_online_status, 0);
 
 	return S_OK;
 }
@@ -413,6 +995,7 @@ artik_error os_network_add_watch_online_status(
 				watch_online_status_callback app_callback,
 				void *user_data)
 {
+	watch_online_node_t *node;
 	artik_error ret = S_OK;
 
 	if (!watch_online_status) {
@@ -420,22 +1003,21 @@ artik_error os_network_add_watch_online_status(
 
 		if (ret != S_OK)
 			return ret;
+	} else if (watch_online_status->released) {
+		/* The last watcher was removed from a callback */
+		watch_online_status->released = false;
+		online_schedule_check(watch_online_status, 0);
 	}
 
-	watch_online_node_t *node = (watch_online_node_t *)
-		artik_list_add(&(watch_online_status->root), 0,
-						sizeof(watch_online_node_t));
-
+	node = (watch_online_node_t *)artik_list_add(
+			&(watch_online_status->root), 0,
+			sizeof(watch_online_node_t));
 	if (!node)
 		return E_NO_MEM;
 
 	node->config.callback = app_callback;
 	node->config.user_data = user_data;
 
-	if (ret != S_OK)
-		artik_list_delete_node(&(watch_online_status->root),
-							(artik_list *)node);
-
 	*handle = (watch_online_status_handle)node->node.handle;
 
 	return ret;
@@ -444,170 +1026,107 @@ artik_error os_network_add_watch_online_status(
 artik_error os_network_remove_watch_online_status(
 					watch_online_status_handle handle)
 {
-	if (!watch_online_status)
-		return E_NOT_INITIALIZED;
-
-	artik_list_delete_handle(&(watch_online_status->root),
-						(ARTIK_LIST_HANDLE)handle);
-	if (artik_list_size(watch_online_status->root) == 0) {
-		artik_loop_module *loop = (artik_loop_module *)
-					artik_request_api_module("loop");
-		loop->remove_fd_watch(watch_online_status->watch_id);
-		close(watch_online_status->fd);
-		free(watch_online_status);
-		watch_online_status = NULL;
-		artik_release_api_module(loop);
-	}
-
-	return S_OK;
-}
+	watch_online_status_t *status = watch_online_status;
 
-static void on_dhcp_client_renew_callback(void *user_data)
-{
-	artik_network_dhcp_client_handle *handle =
-				(artik_network_dhcp_client_handle *)user_data;
+	if (!status)
+		return E_NOT_INITIALIZED;
 
-	dhcp_handle_client *dhcp_client = (dhcp_handle_client *)
-		artik_list_get_by_handle(requested_node,
-						(ARTIK_LIST_HANDLE) * handle);
+	artik_list_delete_handle(&(status->root), (ARTIK_LIST_HANDLE)handle);
+	if (artik_list_size(status->root) > 0)
+		return S_OK;
 
-	struct in_addr addr;
+	if (status->debounce_pending)
+		status->loop->remove_timeout_callback(status->debounce_id);
+	status->debounce_pending = false;
+	online_cancel_probes(status);
 
-	if (!dhcp_client) {
-		log_err("No dhcp_client");
-		return;
+	if (status->dispatching) {
+		status->released = true;
+		return S_OK;
 	}
 
-	if (dhcp_client_renew(handle, dhcp_client->interface) != OK) {
-		log_err("Failed to renew IP address in callback");
+	online_free(status);
+	watch_online_status = NULL;
 
-		/* Set IP address to 0.0.0.0 */
-		addr.s_addr = INADDR_ANY;
-		if (set_ipv4addr(dhcp_client->interface, &addr) == ERROR) {
-			log_err("Set IPv4 address failed: %s", strerror(errno));
-			return;
-		}
-
-		artik_loop_module *loop = (artik_loop_module *)
-					artik_request_api_module("loop");
-
-		loop->quit();
-	}
+	return S_OK;
 }
 
-static int dhcp_client_renew(artik_network_dhcp_client_handle *handle,
-		const char *interface)
+static int dhcp_client_configure(const char *interface,
+		const struct dhcpc_state *ds)
 {
-	int ret = OK;
-	struct in_addr addr;
-
-	if (!*handle) {
-		log_err("DHCP Client open failed");
-		ret = ERROR;
-		goto exit;
-	} else {
-		struct dhcpc_state ds;
-		dhcp_handle_client *dhcp_client = (dhcp_handle_client *)
-			artik_list_get_by_handle(requested_node,
-						(ARTIK_LIST_HANDLE) * handle);
-
-		log_dbg("Renewing IP address");
-
-		get_ipv4addr(interface, &addr);
-
-		if (dhcpc_request(*handle, &ds, interface, &addr, true)
-								== ERROR) {
-			log_err("DHCP Client request failed");
-			ret = ERROR;
-			goto exit;
-		}
-
-		/* Set IP address */
-		if (set_ipv4addr(interface, &ds.ipaddr) == ERROR) {
-			log_err("Set IPv4 address failed: %s", strerror(errno));
-			ret = ERROR;
-			goto exit;
-		}
+	/* Set IP address */
+	if (set_ipv4addr(interface, &ds->ipaddr) == ERROR) {
+		log_err("Set IPv4 address failed: %s", strerror(errno));
+		return ERROR;
+	}
 
-		/* Set net mask */
-		if (ds.netmask.s_addr != 0) {
-			if (set_ipv4netmask(interface, &ds.netmask) == ERROR) {
-				log_err("Set IPv4 network mask failed: %s",
-							strerror(errno));
-				ret = ERROR;
-				goto exit;
-			}
+	/* Set net mask */
+	if (ds->netmask.s_addr != 0) {
+		if (set_ipv4netmask(interface, &ds->netmask) == ERROR) {
+			log_err("Set IPv4 network mask failed: %s",
+						strerror(errno));
+			return ERROR;
 		}
+	}
 
-		/* Set default router */
-		if (ds.default_router.s_addr != 0) {
-			if (set_dripv4addr(interface, &ds.default_router)
-								== ERROR) {
-				log_err("Set default router address failed: %s",
-							strerror(errno));
-				ret = ERROR;
-				goto exit;
-			}
+	/* Set default router */
+	if (ds->default_router.s_addr != 0) {
+		if (set_dripv4addr(interface, &ds->default_router) == ERROR) {
+			log_err("Set default router address failed: %s",
+						strerror(errno));
+			return ERROR;
 		}
+	}
 
-		/* Set DNS address */
-		if (ds.dnsaddr.s_addr != 0) {
-			if (set_ipv4dnsaddr(&ds.dnsaddr, false) == ERROR) {
-				log_err("Set DNS adress failed: %s",
-							strerror(errno));
-				ret = ERROR;
-				goto exit;
-			}
+	/* Set DNS address */
+	if (ds->dnsaddr.s_addr != 0) {
+		if (set_ipv4dnsaddr(&ds->dnsaddr, false) == ERROR) {
+			log_err("Set DNS adress failed: %s", strerror(errno));
+			return ERROR;
 		}
+	}
 
-		/* Set route with gateway */
-		if (set_defaultroute(interface, &ds.default_router, true)
+	/* Set route with gateway, it is already there after a renewal */
+	if (ds->default_router.s_addr != 0 &&
+		set_defaultroute(interface, &ds->default_router, true)
 					== ERROR && errno != ROUTE_EXISTS) {
-			log_err("Set default route with GW failed: %s",
-							strerror(errno));
-			ret = ERROR;
-			goto exit;
-		}
+		log_err("Set default route with GW failed: %s",
+						strerror(errno));
+		return ERROR;
+	}
 
-		/*
-		 * Add timeout callback for renewing IP address before the lease
-		 * expires
-		 */
-		ret = dhcp_client->loop_module->remove_timeout_callback(
-						dhcp_client->renew_cbk_id);
+	log_dbg("IP: %s", inet_ntoa(ds->ipaddr));
 
-		if (ret != S_OK) {
-			log_err("Failed to remove callback for renewing IP addr"
-									);
-			return ret;
-		}
-
-		ret = dhcp_client->loop_module->add_timeout_callback(
-						&dhcp_client->renew_cbk_id,
-						(ds.lease_time-(30))*1000,
-						on_dhcp_client_renew_callback,
-						handle);
+	return OK;
+}
 
-		if (ret != S_OK) {
-			log_err("Failed to start callback for renewing IP addr"
-									);
-			return ret;
-		}
+/*
+ * Called from the loop by the DHCP client state machine each time a lease
+ * is acquired, extended or lost.
+ */
+static void on_dhcp_client_event(void *handle, enum dhcpc_event event,
+		const struct dhcpc_state *ds, void *user_data)
+{
+	const char *interface = (const char *)user_data;
+	struct in_addr addr;
 
-		log_dbg("IP: %s", inet_ntoa(ds.ipaddr));
+	if (event == DHCPC_EVENT_BOUND) {
+		if (dhcp_client_configure(interface, ds) != OK)
+			log_err("Failed to configure %s", interface);
+		return;
 	}
 
+	log_err("Lease of %s lost, getting a new one", interface);
 
-exit:
-	return ret;
+	/* Set IP address to 0.0.0.0 */
+	addr.s_addr = INADDR_ANY;
+	if (set_ipv4addr(interface, &addr) == ERROR)
+		log_err("Set IPv4 address failed: %s", strerror(errno));
 }
 
-
 artik_error os_dhcp_client_start(artik_network_dhcp_client_handle *handle,
 		artik_network_interface_t interface)
 {
-	artik_error ret = S_OK;
-	uint8_t mac[IFHWADDRLEN];
 	const char *_interface = interface == ARTIK_WIFI ? "wlan0" : "eth0";
 	struct in_addr addr;
 	dhcp_handle_client *dhcp_client = NULL;
@@ -620,112 +1139,40 @@ artik_error os_dhcp_client_start(artik_network_dhcp_client_handle *handle,
 		return E_NETWORK_ERROR;
 	}
 
-	/* Set the default route to 0.0.0.0 */
+	/* Set the IP address to 0.0.0.0 until a lease is acquired */
 	addr.s_addr = INADDR_ANY;
-	if (set_defaultroute(_interface, &addr, false) == ERROR) {
-		log_err("Set default route failed: %s", strerror(errno));
-		return E_NETWORK_ERROR;
-	}
-
-	/* Get the MAC address */
-	if (getmacaddr(_interface, mac) == ERROR) {
-		log_err("Get MAC address failed : %s", strerror(errno));
+	if (set_ipv4addr(_interface, &addr) == ERROR) {
+		log_err("Set IPv4 address failed: %s", strerror(errno));
 		return E_NETWORK_ERROR;
 	}
 
-	/* Set up the DHCPC modules */
-	*handle = (artik_network_dhcp_client_handle)dhcpc_open(&mac,
-								IFHWADDRLEN);
+	/*
+	 * Set up the DHCPC modules, the lease is acquired and renewed in the
+	 * background from the loop.
+	 */
+	*handle = (artik_network_dhcp_client_handle)dhcpc_open(_interface,
+				on_dhcp_client_event, (void *)_interface);
 
 	if (!*handle) {
 		log_err("DHCP Client open failed");
-		ret = E_NETWORK_ERROR;
-	} else {
-		struct dhcpc_state ds;
-
-
-		log_dbg("Getting IP address");
-
-		if (dhcpc_request(*handle, &ds, _interface, NULL, false)
-								== ERROR) {
-			log_err("DHCP Client request failed");
-			return E_NETWORK_ERROR;
-		}
-
-		dhcp_client = (dhcp_handle_client *)artik_list_add(
-				&requested_node, 0, sizeof(dhcp_handle_client));
-
-		if (!dhcp_client)
-			return E_NO_MEM;
-
-		dhcp_client->node.handle = (ARTIK_LIST_HANDLE)*handle;
-		dhcp_client->loop_module = (artik_loop_module *)
-					artik_request_api_module("loop");
-		dhcp_client->interface = interface ==
-						ARTIK_WIFI ? "wlan0" : "eth0";
-
-		/* Set IP address */
-		if (set_ipv4addr(_interface, &ds.ipaddr) == ERROR) {
-			log_err("Set IPv4 address failed: %s", strerror(errno));
-			return E_NETWORK_ERROR;
-		}
-
-		/* Set net mask */
-		if (ds.netmask.s_addr != 0) {
-			if (set_ipv4netmask(_interface, &ds.netmask) == ERROR) {
-				log_err("Set IPv4 network mask failed: %s",
-					strerror(errno));
-				return E_NETWORK_ERROR;
-			}
-		}
-
-		/* Set default router */
-		if (ds.default_router.s_addr != 0) {
-			if (set_dripv4addr(_interface, &ds.default_router)
-								== ERROR) {
-				log_err("Set default router address failed: %s",
-					strerror(errno));
-				return E_NETWORK_ERROR;
-			}
-		}
+		return E_NETWORK_ERROR;
+	}
 
-		/* Set DNS address */
-		if (ds.dnsaddr.s_addr != 0) {
-			if (set_ipv4dnsaddr(&ds.dnsaddr, false) == ERROR) {
-				log_err("Set DNS adress failed: %s",
-					strerror(errno));
-				return E_NETWORK_ERROR;
-			}
-		}
+	dhcp_client = (dhcp_handle_client *)artik_list_add(
+			&requested_node, 0, sizeof(dhcp_handle_client));
 
-		/* Set route with gateway */
-		if (set_defaultroute(_interface, &ds.default_router, true)
-								== ERROR) {
-			log_err("Set default route with GW failed: %s",
-				strerror(errno));
-			return E_NETWORK_ERROR;
-		}
+	if (!dhcp_client) {
+		dhcpc_close(*handle);
+		*handle = NULL;
+		return E_NO_MEM;
+	}
 
-		/*
-		 * Add timeout callback for renewing IP address before the lease
-		 * expires
-		 */
-		ret = dhcp_client->loop_module->add_timeout_callback(
-						&dhcp_client->renew_cbk_id,
-						(ds.lease_time-(30))*1000,
-						on_dhcp_client_renew_callback,
-						(void *)handle);
-
-		if (ret != S_OK) {
-			log_err("Failed to start callback for renewing IP addr"
-									);
-			return ret;
-		}
+	dhcp_client->node.handle = (ARTIK_LIST_HANDLE)*handle;
+	dhcp_client->interface = _interface;
 
-		log_dbg("IP: %s", inet_ntoa(ds.ipaddr));
-	}
+	log_dbg("Getting IP address");
 
-	return ret;
+	return S_OK;
 }
 
 artik_error os_dhcp_client_stop(artik_network_dhcp_client_handle handle)
@@ -742,6 +1189,8 @@ artik_error os_dhcp_client_stop(artik_network_dhcp_client_handle handle)
 
 	if (handle) {
 		dhcpc_close(handle);
+		artik_list_delete_handle(&requested_node,
+					(ARTIK_LIST_HANDLE)handle);
 		log_dbg("DHCP Client stopped");
 	} else {
 		log_err("Handle NULL");
@@ -856,6 +1305,8 @@ artik_error os_dhcp_server_stop(artik_network_dhcp_server_handle handle)
 		return E_NETWORK_ERROR;
 	}
 
+	dhcpd_stop();
+
 	/* Delete all routes from interface if they exist */
 	if (del_allroutes_interface(dhcp_server->interface) == ERROR) {
 		log_err("Delete all routes from interface %s failed: %s",
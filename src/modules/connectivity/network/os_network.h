@@ -32,6 +32,9 @@ artik_error os_network_add_watch_online_status(
 		watch_online_status_callback app_callback, void *user_data);
 artik_error os_network_remove_watch_online_status(
 		watch_online_status_handle handle);
+artik_error os_network_get_online_status(bool *online_status);
+artik_error os_network_set_online_status_probe(const char *address,
+		int port, unsigned int timeout_ms);
 artik_error os_dhcp_client_start(artik_network_dhcp_client_handle *handle,
 		artik_network_interface_t interface);
 artik_error os_dhcp_client_stop(artik_network_dhcp_client_handle handle);
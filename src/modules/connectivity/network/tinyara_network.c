@@ -131,6 +131,29 @@ artik_error os_dhcp_server_stop(artik_network_dhcp_server_handle handle)
 	return S_OK;
 }
 
+artik_error os_network_get_online_status(bool *online_status)
+{
+	artik_network_ip current_ip;
+	artik_error ret = artik_get_current_public_ip(&current_ip);
+
+	if (ret == S_OK) {
+		*online_status = true;
+	} else if (ret == E_HTTP_ERROR) {
+		*online_status = false;
+		ret = S_OK;
+	}
+
+	return ret;
+}
+
+artik_error os_network_set_online_status_probe(const char *address,
+				int port, unsigned int timeout_ms)
+{
+	log_dbg("");
+
+	return E_NOT_SUPPORTED;
+}
+
 artik_error os_network_add_watch_online_status(
 				watch_online_status_handle * handle,
 				watch_online_status_callback app_callback,
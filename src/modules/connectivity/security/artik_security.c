@@ -36,6 +36,25 @@ static artik_error verify_signature_init(artik_security_handle *handle,
 static artik_error verify_signature_update(artik_security_handle handle,
 		unsigned char *data, unsigned int data_len);
 static artik_error verify_signature_final(artik_security_handle handle);
+static artik_error verify_signature_file(const char *path,
+		const char *signature_pem, const char *root_ca,
+		const artik_time *signing_time_in, artik_time *signing_time_out,
+		verify_progress_callback progress, void *user_data);
+static artik_error verify_signature_file_async(const char *path,
+		const char *signature_pem, const char *root_ca,
+		const artik_time *signing_time_in, artik_time *signing_time_out,
+		verify_progress_callback progress, verify_done_callback done,
+		void *user_data);
+static artik_error hash_buffer(unsigned int types, const unsigned char *data,
+		unsigned long long len, artik_hash_result *result);
+static artik_error hash_fd(unsigned int types, int fd,
+		artik_hash_result *result);
+static artik_error hash_file(unsigned int types, const char *path,
+		artik_hash_result *result);
+static artik_error hash_files(unsigned int types, const char * const *paths,
+		int count, int num_threads, artik_hash_result *results,
+		artik_error *errors);
+static artik_error clear_cache(artik_security_handle handle);
 
 const artik_security_module security_module = {
 	request,
@@ -47,7 +66,14 @@ const artik_security_module security_module = {
 	get_certificate_sn,
 	verify_signature_init,
 	verify_signature_update,
-	verify_signature_final
+	verify_signature_final,
+	verify_signature_file,
+	verify_signature_file_async,
+	hash_buffer,
+	hash_fd,
+	hash_file,
+	hash_files,
+	clear_cache
 };
 
 artik_error request(artik_security_handle *handle)
@@ -106,3 +132,71 @@ artik_error verify_signature_final(artik_security_handle handle)
 {
 	return os_verify_signature_final(handle);
 }
+
+artik_error verify_signature_file(const char *path,
+		const char *signature_pem, const char *root_ca,
+		const artik_time *signing_time_in, artik_time *signing_time_out,
+		verify_progress_callback progress, void *user_data)
+{
+	if (!path || !signature_pem || !root_ca)
+		return E_BAD_ARGS;
+
+	return os_verify_signature_file(path, signature_pem, root_ca,
+			signing_time_in, signing_time_out, progress, user_data);
+}
+
+artik_error verify_signature_file_async(const char *path,
+		const char *signature_pem, const char *root_ca,
+		const artik_time *signing_time_in, artik_time *signing_time_out,
+		verify_progress_callback progress, verify_done_callback done,
+		void *user_data)
+{
+	if (!path || !signature_pem || !root_ca || !done)
+		return E_BAD_ARGS;
+
+	return os_verify_signature_file_async(path, signature_pem, root_ca,
+			signing_time_in, signing_time_out, progress, done,
+			user_data);
+}
+
+artik_error hash_buffer(unsigned int types, const unsigned char *data,
+		unsigned long long len, artik_hash_result *result)
+{
+	if (!types || (!data && len) || !result)
+		return E_BAD_ARGS;
+
+	return os_hash_buffer(types, data, len, result);
+}
+
+artik_error hash_fd(unsigned int types, int fd, artik_hash_result *result)
+{
+	if (!types || fd < 0 || !result)
+		return E_BAD_ARGS;
+
+	return os_hash_fd(types, fd, result);
+}
+
+artik_error hash_file(unsigned int types, const char *path,
+		artik_hash_result *result)
+{
+	if (!types || !path || !result)
+		return E_BAD_ARGS;
+
+	return os_hash_file(types, path, result);
+}
+
+artik_error hash_files(unsigned int types, const char * const *paths,
+		int count, int num_threads, artik_hash_result *results,
+		artik_error *errors)
+{
+	if (!types || !paths || count <= 0 || num_threads < 0 || !results)
+		return E_BAD_ARGS;
+
+	return os_hash_files(types, paths, count, num_threads, results,
+			errors);
+}
+
+artik_error clear_cache(artik_security_handle handle)
+{
+	return os_security_clear_cache(handle);
+}
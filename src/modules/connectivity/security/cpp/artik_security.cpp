@@ -53,3 +53,49 @@ artik_error artik::Security::get_certificate_sn(unsigned char *sn,
     return E_NOT_INITIALIZED;
   return m_module->get_certificate_sn(m_handle, sn, len);
 }
+
+artik_error artik::Security::verify_signature_file(const char *path,
+    const char *signature_pem, const char *root_ca,
+    const artik_time *signing_time_in, artik_time *signing_time_out,
+    verify_progress_callback progress, void *user_data) {
+  return m_module->verify_signature_file(path, signature_pem, root_ca,
+      signing_time_in, signing_time_out, progress, user_data);
+}
+
+artik_error artik::Security::verify_signature_file_async(const char *path,
+    const char *signature_pem, const char *root_ca,
+    const artik_time *signing_time_in, artik_time *signing_time_out,
+    verify_progress_callback progress, verify_done_callback done,
+    void *user_data) {
+  return m_module->verify_signature_file_async(path, signature_pem, root_ca,
+      signing_time_in, signing_time_out, progress, done, user_data);
+}
+
+artik_error artik::Security::hash_buffer(unsigned int types,
+    const unsigned char *data, unsigned long long len,
+    artik_hash_result *result) {
+  return m_module->hash_buffer(types, data, len, result);
+}
+
+artik_error artik::Security::hash_fd(unsigned int types, int fd,
+    artik_hash_result *result) {
+  return m_module->hash_fd(types, fd, result);
+}
+
+artik_error artik::Security::hash_file(unsigned int types, const char *path,
+    artik_hash_result *result) {
+  return m_module->hash_file(types, path, result);
+}
+
+artik_error artik::Security::hash_files(unsigned int types,
+    const char * const *paths, int count, int num_threads,
+    artik_hash_result *results, artik_error *errors) {
+  return m_module->hash_files(types, paths, count, num_threads, results,
+      errors);
+}
+
+artik_error artik::Security::clear_cache() {
+  if (!m_handle)
+    return E_NOT_INITIALIZED;
+  return m_module->clear_cache(m_handle);
+}
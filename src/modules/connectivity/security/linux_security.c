@@ -17,7 +17,18 @@
  */
 
 
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __ARM_FEATURE_CRC32
+#include <arm_acle.h>
+#endif
 #include <openssl/engine.h>
 #include <openssl/pem.h>
 #include <openssl/rand.h>
@@ -28,12 +39,27 @@
 #include <artik_security.h>
 #include <artik_list.h>
 #include <artik_log.h>
+#include <artik_loop.h>
 #include "os_security.h"
 
 #define ARTIK_SE_ENGINE_NAME  "artiksee"
 #define COOKIE_SECURITY       "SEC"
 #define COOKIE_SIGVERIF       "SIG"
 
+/* Amount of mapped data hashed between two progress reports */
+#define VERIFY_FILE_CHUNK     (4 * 1024 * 1024)
+
+/* Random bytes fetched from the engine at once, served to small requests */
+#define RANDOM_POOL_SIZE      4096
+#define RANDOM_POOL_MAX_REQ   256
+
+/* Data fed to all the digests before moving on, small enough for the cache */
+#define HASH_BLOCK            (64 * 1024)
+#define HASH_READ_SIZE        (1024 * 1024)
+#define HASH_NUM_MD           3
+#define HASH_TYPES            (ARTIK_HASH_SHA1 | ARTIK_HASH_SHA256 | \
+			       ARTIK_HASH_SHA512 | ARTIK_HASH_CRC32)
+
 struct cert_params {
 	const char *cert_id;
 	X509 *cert;
@@ -54,10 +80,132 @@ typedef struct {
 	EVP_MD_CTX *md_ctx;
 } verify_node;
 
-static bool openssl_global_init = false;
+typedef struct {
+	verify_node node;
+	artik_loop_module *loop;
+	int fd;
+	off_t size;
+	verify_progress_callback progress;
+	verify_done_callback done;
+	void *user_data;
+	artik_error result;
+} verify_file_job;
+
+typedef struct {
+	unsigned int types;
+	EVP_MD_CTX *md_ctx[HASH_NUM_MD];
+	uint32_t crc32;
+} hash_ctx;
+
+typedef struct {
+	unsigned int types;
+	const char * const *paths;
+	artik_hash_result *results;
+	artik_error *errors;
+	int count;
+	int next;
+	artik_error ret;
+} hash_files_job;
+
+static pthread_once_t openssl_global_once = PTHREAD_ONCE_INIT;
 static artik_list *requested_node = NULL;
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static pthread_mutex_t *openssl_locks = NULL;
+#endif
+
+/* Engine shared by all the security handles */
+static ENGINE *se_engine = NULL;
+static int se_engine_refs = 0;
+static pthread_mutex_t se_engine_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t se_atfork_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Certificate material read from the SE. Outlives the engine, which HTTP and
+ * websocket connections load and unload each time. Dropped by an explicit
+ * clear_cache() call, e.g. after the SE was reprovisioned, and whenever the
+ * SE fails, as it may come back reset with another content.
+ */
+static struct {
+	char *cert;
+	char *key;
+	unsigned char sn[ARTIK_CERT_SN_MAXLEN];
+	unsigned int sn_len;
+	pthread_mutex_t lock;
+} se_cache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static struct {
+	unsigned char buf[RANDOM_POOL_SIZE];
+	int avail;
+	pthread_mutex_t lock;
+} random_pool = { .lock = PTHREAD_MUTEX_INITIALIZER };
 static artik_list *verify_nodes = NULL;
 
+/*
+ * Store built from the last root CA used, firmware images are usually all
+ * verified against the same one.
+ */
+static char *ca_cache_pem = NULL;
+static X509_STORE *ca_cache_store = NULL;
+static pthread_mutex_t ca_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static void openssl_lock(int mode, int n, const char *file, int line)
+{
+	if (mode & CRYPTO_LOCK)
+		pthread_mutex_lock(&openssl_locks[n]);
+	else
+		pthread_mutex_unlock(&openssl_locks[n]);
+}
+
+/*
+ * OpenSSL before 1.1 is only thread safe once the application provides
+ * locks, and digests, signature checks and the SE engine run on worker
+ * threads. The default thread id, the address of errno, is per thread
+ * with glibc. Run at load time, before any worker can start.
+ */
+__attribute__((constructor)) static void openssl_threads_init(void)
+{
+	int i;
+
+	/* Keep the locks of an application that set up its own */
+	if (CRYPTO_get_locking_callback())
+		return;
+
+	openssl_locks = malloc(CRYPTO_num_locks() * sizeof(pthread_mutex_t));
+	if (!openssl_locks)
+		return;
+
+	for (i = 0; i < CRYPTO_num_locks(); i++)
+		pthread_mutex_init(&openssl_locks[i], NULL);
+
+	CRYPTO_set_locking_callback(openssl_lock);
+}
+
+/* OpenSSL must not call into the library once it is unloaded */
+__attribute__((destructor)) static void openssl_threads_cleanup(void)
+{
+	int i;
+
+	if (!openssl_locks)
+		return;
+
+	if (CRYPTO_get_locking_callback() == openssl_lock)
+		CRYPTO_set_locking_callback(NULL);
+
+	for (i = 0; i < CRYPTO_num_locks(); i++)
+		pthread_mutex_destroy(&openssl_locks[i]);
+	free(openssl_locks);
+	openssl_locks = NULL;
+}
+#endif
+
+static void openssl_global_init(void)
+{
+	CRYPTO_malloc_init();
+	OpenSSL_add_all_algorithms();
+}
+
 static void free_all(EC_KEY *ec_key, BIGNUM *x, BIGNUM *y,
 		     EC_POINT *ec_point, BN_CTX *ctx)
 {
@@ -188,16 +336,64 @@ static bool convert_asn1_time(ASN1_TYPE *in, artik_time *out)
 	return true;
 }
 
-artik_error os_security_request(artik_security_handle *handle)
+static void random_pool_flush(void)
+{
+	memset(random_pool.buf, 0, sizeof(random_pool.buf));
+	random_pool.avail = 0;
+}
+
+/* Must be called with se_cache.lock held */
+static void se_cache_drop(void)
+{
+	free(se_cache.cert);
+	free(se_cache.key);
+	se_cache.cert = NULL;
+	se_cache.key = NULL;
+	se_cache.sn_len = 0;
+}
+
+static void se_cache_clear(void)
+{
+	pthread_mutex_lock(&se_cache.lock);
+	se_cache_drop();
+	pthread_mutex_unlock(&se_cache.lock);
+}
+
+static void random_pool_prepare(void)
+{
+	pthread_mutex_lock(&random_pool.lock);
+}
+
+static void random_pool_parent(void)
+{
+	pthread_mutex_unlock(&random_pool.lock);
+}
+
+/* Parent and child must never serve the same bytes */
+static void random_pool_child(void)
+{
+	random_pool_flush();
+	pthread_mutex_unlock(&random_pool.lock);
+}
+
+static void se_register_atfork(void)
+{
+	pthread_atfork(random_pool_prepare, random_pool_parent,
+			random_pool_child);
+}
+
+static ENGINE *se_engine_get(void)
 {
 	ENGINE *engine = NULL;
-	security_node *node = (security_node *) artik_list_add(&requested_node,
-						0, sizeof(security_node));
 
-	if (!node)
-		return E_NO_MEM;
-	node->node.handle = (ARTIK_LIST_HANDLE) node;
-	*handle = (artik_security_handle)node;
+	pthread_once(&se_atfork_once, se_register_atfork);
+	pthread_mutex_lock(&se_engine_lock);
+
+	if (se_engine) {
+		se_engine_refs++;
+		engine = se_engine;
+		goto exit;
+	}
 
 	/* First try to load and init the OpenSSL SE engine */
 	ENGINE_load_builtin_engines();
@@ -205,14 +401,73 @@ artik_error os_security_request(artik_security_handle *handle)
 	if (!engine || !ENGINE_init(engine)) {
 		if (engine)
 			ENGINE_free(engine);
-		artik_list_delete_node(&requested_node,
-							(artik_list *)node);
-		return E_ACCESS_DENIED;
+		engine = NULL;
+		goto exit;
 	}
+
 	if (!ENGINE_set_default(engine, ENGINE_METHOD_RAND |
 					ENGINE_METHOD_ECDSA)) {
 		ENGINE_finish(engine);
 		ENGINE_free(engine);
+		engine = NULL;
+		goto exit;
+	}
+
+	se_engine = engine;
+	se_engine_refs = 1;
+
+exit:
+	pthread_mutex_unlock(&se_engine_lock);
+
+	if (!engine)
+		se_cache_clear();
+
+	return engine;
+}
+
+static void se_engine_put(void)
+{
+	pthread_mutex_lock(&se_engine_lock);
+
+	if (--se_engine_refs > 0) {
+		pthread_mutex_unlock(&se_engine_lock);
+		return;
+	}
+
+	/*
+	 * Only unregister what the engine provided, global OpenSSL state
+	 * may still be in use by other parts of the process.
+	 */
+	ENGINE_unregister_ciphers(se_engine);
+	ENGINE_unregister_digests(se_engine);
+	ENGINE_unregister_ECDSA(se_engine);
+	ENGINE_unregister_ECDH(se_engine);
+	ENGINE_unregister_pkey_meths(se_engine);
+	ENGINE_unregister_RAND(se_engine);
+	ENGINE_finish(se_engine);
+	ENGINE_free(se_engine);
+	se_engine = NULL;
+
+	pthread_mutex_lock(&random_pool.lock);
+	random_pool_flush();
+	pthread_mutex_unlock(&random_pool.lock);
+
+	pthread_mutex_unlock(&se_engine_lock);
+}
+
+artik_error os_security_request(artik_security_handle *handle)
+{
+	ENGINE *engine = NULL;
+	security_node *node = (security_node *) artik_list_add(&requested_node,
+						0, sizeof(security_node));
+
+	if (!node)
+		return E_NO_MEM;
+	node->node.handle = (ARTIK_LIST_HANDLE) node;
+	*handle = (artik_security_handle)node;
+
+	engine = se_engine_get();
+	if (!engine) {
 		artik_list_delete_node(&requested_node, (artik_list *)node);
 		return E_ACCESS_DENIED;
 	}
@@ -233,47 +488,43 @@ artik_error os_security_release(artik_security_handle handle)
 	if (!node || strncmp(node->cookie, COOKIE_SECURITY, sizeof(node->cookie)))
 		return E_BAD_ARGS;
 
-	/* Unload the engine and clean up */
-	if (node->engine) {
-		/* Code is not obvious, taken from Oleg's sdrclient lib */
-		OBJ_cleanup();
-		EVP_cleanup();
-		ENGINE_unregister_ciphers(node->engine);
-		ENGINE_unregister_digests(node->engine);
-		ENGINE_unregister_ECDSA(node->engine);
-		ENGINE_unregister_ECDH(node->engine);
-		ENGINE_unregister_pkey_meths(node->engine);
-		ENGINE_unregister_RAND(node->engine);
-		ENGINE_remove(node->engine);
-		ENGINE_cleanup();
-		ENGINE_finish(node->engine);
-		ENGINE_free(node->engine);
-	}
+	if (node->engine)
+		se_engine_put();
 
 	artik_list_delete_node(&requested_node, (artik_list *)node);
 
 	return S_OK;
 }
 
-artik_error os_security_get_certificate(artik_security_handle handle,
-					char **cert)
+static security_node *get_security_node(artik_security_handle handle)
 {
 	security_node *node = (security_node *)
 		artik_list_get_by_handle(requested_node,
 						(ARTIK_LIST_HANDLE) handle);
+
+	if (!node || !node->engine ||
+			strncmp(node->cookie, COOKIE_SECURITY, sizeof(node->cookie)))
+		return NULL;
+
+	return node;
+}
+
+static char *se_load_certificate(ENGINE *engine)
+{
 	struct cert_params params;
 	BIO *b64 = NULL;
 	BUF_MEM *bptr = NULL;
-
-	if (!node || !node->engine || !cert || *cert ||
-			strncmp(node->cookie, COOKIE_SECURITY, sizeof(node->cookie)))
-		return E_BAD_ARGS;
+	char *cert = NULL;
 
 	memset(&params, 0, sizeof(params));
 	params.cert_id = "ARTIK/0";
 
 	/* Get the certificate from the SE */
-	ENGINE_ctrl_cmd(node->engine, "LOAD_CERT_CTRL", 0, &params, NULL, 0);
+	ENGINE_ctrl_cmd(engine, "LOAD_CERT_CTRL", 0, &params, NULL, 0);
+	if (!params.cert) {
+		log_dbg("Failed to load the certificate from the SE");
+		return NULL;
+	}
 
 	/* Convert the X509 cert into a string */
 	b64 = BIO_new(BIO_s_mem());
@@ -282,25 +533,18 @@ artik_error os_security_get_certificate(artik_security_handle handle,
 	BIO_get_mem_ptr(b64, &bptr);
 
 	/* Allocate memory for the certificate string */
-	*cert = (char *)malloc(bptr->length);
-	if (!(*cert)) {
-		BIO_free(b64);
-		return E_NO_MEM;
-	}
+	cert = (char *)malloc(bptr->length);
+	if (cert)
+		BIO_read(b64, (void *)cert, bptr->length);
 
-	/* Copy the cert content into the string */
-	BIO_read(b64, (void *)(*cert), bptr->length);
 	BIO_free(b64);
+	X509_free(params.cert);
 
-	return S_OK;
+	return cert;
 }
 
-artik_error os_security_get_key_from_cert(artik_security_handle handle,
-					  const char *cert, char **key)
+static artik_error derive_key_from_cert(const char *cert, char **key)
 {
-	security_node *node = (security_node *)
-		artik_list_get_by_handle(requested_node,
-					(ARTIK_LIST_HANDLE) handle);
 	artik_error ret = S_OK;
 	X509 *x509_cert = NULL;
 	BIO *b64 = NULL;
@@ -310,10 +554,6 @@ artik_error os_security_get_key_from_cert(artik_security_handle handle,
 	BUF_MEM *bptr = NULL;
 	unsigned char *ec_bits = NULL;
 
-	if (!node || !node->engine || !cert || !key || *key ||
-			strncmp(node->cookie, COOKIE_SECURITY, sizeof(node->cookie)))
-		return E_BAD_ARGS;
-
 	/* Convert certificate string into a BIO */
 	b64 = BIO_new(BIO_s_mem());
 	if (!b64)
@@ -322,12 +562,10 @@ artik_error os_security_get_key_from_cert(artik_security_handle handle,
 
 	/* Extract X509 cert from the BIO */
 	x509_cert = PEM_read_bio_X509(b64, NULL, NULL, NULL);
-	if (!x509_cert) {
-		ret = E_BAD_ARGS;
-		goto exit;
-	}
-	if (b64)
-		BIO_free(b64);
+	BIO_free(b64);
+	b64 = NULL;
+	if (!x509_cert)
+		return E_BAD_ARGS;
 
 	/* Get EC KEY out of the certificate */
 	bits_len = x509_cert->cert_info->key->public_key->length;
@@ -356,6 +594,8 @@ artik_error os_security_get_key_from_cert(artik_security_handle handle,
 	BIO_read(b64, (void *)(*key), bptr->length);
 
 exit:
+	if (ec_key)
+		EC_KEY_free(ec_key);
 	if (x509_cert)
 		X509_free(x509_cert);
 	if (b64)
@@ -363,6 +603,62 @@ exit:
 	return ret;
 }
 
+artik_error os_security_get_certificate(artik_security_handle handle,
+					char **cert)
+{
+	security_node *node = get_security_node(handle);
+	artik_error ret = S_OK;
+
+	if (!node || !cert || *cert)
+		return E_BAD_ARGS;
+
+	pthread_mutex_lock(&se_cache.lock);
+
+	if (!se_cache.cert)
+		se_cache.cert = se_load_certificate(node->engine);
+
+	if (!se_cache.cert) {
+		/* Also forget the serial number of what the SE used to hold */
+		se_cache_drop();
+		ret = E_ACCESS_DENIED;
+	} else if (!(*cert = strdup(se_cache.cert)))
+		ret = E_NO_MEM;
+
+	pthread_mutex_unlock(&se_cache.lock);
+
+	return ret;
+}
+
+artik_error os_security_get_key_from_cert(artik_security_handle handle,
+					  const char *cert, char **key)
+{
+	security_node *node = get_security_node(handle);
+	artik_error ret = S_OK;
+	bool se_cert;
+
+	if (!node || !cert || !key || *key)
+		return E_BAD_ARGS;
+
+	pthread_mutex_lock(&se_cache.lock);
+
+	/* Only the key of the SE certificate is worth keeping */
+	se_cert = se_cache.cert && !strcmp(cert, se_cache.cert);
+	if (se_cert && se_cache.key) {
+		*key = strdup(se_cache.key);
+		ret = *key ? S_OK : E_NO_MEM;
+		goto exit;
+	}
+
+	ret = derive_key_from_cert(cert, key);
+	if (ret == S_OK && se_cert)
+		se_cache.key = strdup(*key);
+
+exit:
+	pthread_mutex_unlock(&se_cache.lock);
+
+	return ret;
+}
+
 artik_error os_security_get_root_ca(artik_security_handle handle,
 					char **root_ca)
 {
@@ -375,15 +671,42 @@ artik_error os_get_random_bytes(artik_security_handle handle,
 	security_node *node = (security_node *)
 		artik_list_get_by_handle(requested_node,
 						(ARTIK_LIST_HANDLE) handle);
+	artik_error ret = S_OK;
 
-	if (!node || !node->engine || !rand ||
+	if (!node || !node->engine || !rand || len <= 0 ||
 			strncmp(node->cookie, COOKIE_SECURITY, sizeof(node->cookie)))
 		return E_BAD_ARGS;
 
-	if (!RAND_bytes(rand, len))
+	if (len > RANDOM_POOL_MAX_REQ) {
+		if (RAND_bytes(rand, len) == 1)
+			return S_OK;
+		se_cache_clear();
 		return E_BAD_ARGS;
+	}
 
-	return S_OK;
+	pthread_mutex_lock(&random_pool.lock);
+
+	if (random_pool.avail < len) {
+		if (RAND_bytes(random_pool.buf, RANDOM_POOL_SIZE) != 1) {
+			random_pool_flush();
+			ret = E_BAD_ARGS;
+			goto exit;
+		}
+		random_pool.avail = RANDOM_POOL_SIZE;
+	}
+
+	/* Served bytes are wiped so that they are never given out again */
+	random_pool.avail -= len;
+	memcpy(rand, random_pool.buf + random_pool.avail, len);
+	memset(random_pool.buf + random_pool.avail, 0, len);
+
+exit:
+	pthread_mutex_unlock(&random_pool.lock);
+
+	if (ret != S_OK)
+		se_cache_clear();
+
+	return ret;
 }
 
 artik_error os_get_certificate_sn(artik_security_handle handle,
@@ -399,6 +722,19 @@ artik_error os_get_certificate_sn(artik_security_handle handle,
 	if (!sn || !len || (*len == 0))
 		return E_BAD_ARGS;
 
+	pthread_mutex_lock(&se_cache.lock);
+	if (se_cache.sn_len) {
+		if (se_cache.sn_len > *len) {
+			ret = E_BAD_ARGS;
+		} else {
+			memcpy(sn, se_cache.sn, se_cache.sn_len);
+			*len = se_cache.sn_len;
+		}
+		pthread_mutex_unlock(&se_cache.lock);
+		return ret;
+	}
+	pthread_mutex_unlock(&se_cache.lock);
+
 	ret = os_security_get_certificate(handle, &cert);
 	if (ret != S_OK)
 		return ret;
@@ -428,6 +764,13 @@ artik_error os_get_certificate_sn(artik_security_handle handle,
 	}
 
 	*len = BN_bn2bin(serialBN, sn);
+
+	if (*len <= sizeof(se_cache.sn)) {
+		pthread_mutex_lock(&se_cache.lock);
+		memcpy(se_cache.sn, sn, *len);
+		se_cache.sn_len = *len;
+		pthread_mutex_unlock(&se_cache.lock);
+	}
 exit:
 	if (serialBN)
 		BN_free(serialBN);
@@ -440,83 +783,146 @@ exit:
 	return ret;
 }
 
-artik_error os_verify_signature_init(artik_security_handle *handle,
-		const char *signature_pem, const char *root_ca,
-		const artik_time *signing_time_in, artik_time *signing_time_out)
+artik_error os_security_clear_cache(artik_security_handle handle)
 {
-	verify_node *node = NULL;
-	BIO *sigbio = NULL;
-	BIO *cabio = NULL;
-	X509 *ca_cert = NULL;
-	X509_STORE_CTX store_ctx;
-	X509_STORE *store = NULL;
-	artik_error ret = S_OK;
+	if (!get_security_node(handle))
+		return E_BAD_ARGS;
 
-	STACK_OF(PKCS7_SIGNER_INFO) * sinfos = NULL;
+	se_cache_clear();
 
-	if (!handle || !signature_pem || !root_ca)
-		return E_BAD_ARGS;
+	return S_OK;
+}
 
-	node = (verify_node *)artik_list_add(&verify_nodes, 0, sizeof(verify_node));
-	if (!node)
-		return E_NO_MEM;
+/* Must be called with ca_cache_lock held */
+static X509_STORE *get_ca_store(const char *root_ca)
+{
+	X509_STORE *store = NULL;
+	X509 *ca_cert = NULL;
+	BIO *cabio = NULL;
+	char *pem = NULL;
 
-	/* Do OpenSSL one-time global initialization stuff */
-	if (!openssl_global_init) {
-		CRYPTO_malloc_init();
-		OpenSSL_add_all_algorithms();
-		openssl_global_init = true;
-	}
+	if (ca_cache_pem && !strcmp(ca_cache_pem, root_ca))
+		return ca_cache_store;
 
 	/* Parse root CA */
 	cabio = BIO_new(BIO_s_mem());
 	if (!cabio) {
 		log_dbg("Failed to create bio for root CA");
-		ret = E_NO_MEM;
-		goto exit;
+		return NULL;
 	}
 
 	BIO_write(cabio, root_ca, strlen(root_ca));
 	ca_cert = PEM_read_bio_X509_AUX(cabio, NULL, 0, NULL);
+	BIO_free(cabio);
 	if (!ca_cert) {
 		log_dbg("Failed to parse bio for root CA certificate");
-		ret = E_SECURITY_INVALID_X509;
-		goto exit;
+		return NULL;
 	}
 
-	/* Parse PKCS7 signature */
-	sigbio = BIO_new(BIO_s_mem());
-	if (!sigbio) {
-		log_dbg("Failed to create bio for PKCS7 signature");
-		ret = E_NO_MEM;
-		goto exit;
+	pem = strdup(root_ca);
+	store = X509_STORE_new();
+	if (!pem || !store || !X509_STORE_add_cert(store, ca_cert)) {
+		log_dbg("Failed to create root CA store");
+		free(pem);
+		if (store)
+			X509_STORE_free(store);
+		X509_free(ca_cert);
+		return NULL;
 	}
 
-	BIO_write(sigbio, signature_pem, strlen(signature_pem));
-	node->p7 = PEM_read_bio_PKCS7(sigbio, NULL, 0, NULL);
-	if (!node->p7) {
-		log_dbg("Could not parse PKCS7 signature form PEM");
-		ret = E_SECURITY_INVALID_PKCS7;
-		goto exit;
-	}
+	/* The store holds its own reference */
+	X509_free(ca_cert);
 
-	/* Perform some checkng on the PKCS7 signature */
-	if (!PKCS7_type_is_signed(node->p7)) {
-		log_dbg("Wrong type of PKCS7, should be signed");
-		ret = E_SECURITY_INVALID_PKCS7;
+	if (ca_cache_store)
+		X509_STORE_free(ca_cache_store);
+	free(ca_cache_pem);
+	ca_cache_pem = pem;
+	ca_cache_store = store;
+
+	return store;
+}
+
+static artik_error verify_signer_cert(verify_node *node, const char *root_ca)
+{
+	X509_STORE_CTX store_ctx;
+	X509_STORE *store = NULL;
+	artik_error ret = S_OK;
+
+	pthread_mutex_lock(&ca_cache_lock);
+
+	store = get_ca_store(root_ca);
+	if (!store) {
+		ret = E_SECURITY_INVALID_X509;
 		goto exit;
 	}
 
-	sinfos = PKCS7_get_signer_info(node->p7);
-	if (!sinfos || !sk_PKCS7_SIGNER_INFO_num(sinfos)) {
-		log_dbg("No signers found in the PKCS7 structure");
-		ret = E_SECURITY_INVALID_PKCS7;
+	if (!X509_STORE_CTX_init(&store_ctx, store, node->signer_cert,
+				node->p7->d.sign->cert)) {
+		log_dbg("Failed to initialize verification context");
+		ret = E_SECURITY_CA_VERIF_FAILED;
 		goto exit;
 	}
 
-	if (sk_PKCS7_SIGNER_INFO_num(sinfos) > 1) {
-		log_err("Only verification for one signer is supported");
-		ret = E_NOT_SUPPORTED;
+	X509_STORE_CTX_set_purpose(&store_ctx, X509_PURPOSE_CRL_SIGN);
+	if (X509_verify_cert(&store_ctx) <= 0) {
+		log_dbg("Signer certificate verification failed (err=%d)",
+				X509_STORE_CTX_get_error(&store_ctx));
+		ret = E_SECURITY_CA_VERIF_FAILED;
+	}
+
+	X509_STORE_CTX_cleanup(&store_ctx);
+
+exit:
+	pthread_mutex_unlock(&ca_cache_lock);
+
+	return ret;
+}
+
+static artik_error verify_node_init(verify_node *node,
+		const char *signature_pem, const char *root_ca,
+		const artik_time *signing_time_in, artik_time *signing_time_out)
+{
+	BIO *sigbio = NULL;
+	artik_error ret = S_OK;
+
+	STACK_OF(PKCS7_SIGNER_INFO) * sinfos = NULL;
+
+	/* Do OpenSSL one-time global initialization stuff */
+	pthread_once(&openssl_global_once, openssl_global_init);
+
+	/* Parse PKCS7 signature */
+	sigbio = BIO_new(BIO_s_mem());
+	if (!sigbio) {
+		log_dbg("Failed to create bio for PKCS7 signature");
+		ret = E_NO_MEM;
+		goto exit;
+	}
+
+	BIO_write(sigbio, signature_pem, strlen(signature_pem));
+	node->p7 = PEM_read_bio_PKCS7(sigbio, NULL, 0, NULL);
+	if (!node->p7) {
+		log_dbg("Could not parse PKCS7 signature form PEM");
+		ret = E_SECURITY_INVALID_PKCS7;
+		goto exit;
+	}
+
+	/* Perform some checkng on the PKCS7 signature */
+	if (!PKCS7_type_is_signed(node->p7)) {
+		log_dbg("Wrong type of PKCS7, should be signed");
+		ret = E_SECURITY_INVALID_PKCS7;
+		goto exit;
+	}
+
+	sinfos = PKCS7_get_signer_info(node->p7);
+	if (!sinfos || !sk_PKCS7_SIGNER_INFO_num(sinfos)) {
+		log_dbg("No signers found in the PKCS7 structure");
+		ret = E_SECURITY_INVALID_PKCS7;
+		goto exit;
+	}
+
+	if (sk_PKCS7_SIGNER_INFO_num(sinfos) > 1) {
+		log_err("Only verification for one signer is supported");
+		ret = E_NOT_SUPPORTED;
 		goto exit;
 	}
 
@@ -532,27 +938,9 @@ artik_error os_verify_signature_init(artik_security_handle *handle,
 		goto exit;
 	}
 
-	store = X509_STORE_new();
-	X509_STORE_add_cert(store, ca_cert);
-	if (!X509_STORE_CTX_init(&store_ctx, store, node->signer_cert,
-				node->p7->d.sign->cert)) {
-		log_dbg("Failed to initialize verification context");
-		ret = E_SECURITY_CA_VERIF_FAILED;
-		goto exit;
-	}
-
-	X509_STORE_CTX_set_purpose(&store_ctx, X509_PURPOSE_CRL_SIGN);
-	if (X509_verify_cert(&store_ctx) <= 0) {
-		log_dbg("Signer certificate verification failed (err=%d)",
-				X509_STORE_CTX_get_error(&store_ctx));
-		X509_STORE_CTX_cleanup(&store_ctx);
-		X509_STORE_free(store);
-		ret = E_SECURITY_CA_VERIF_FAILED;
+	ret = verify_signer_cert(node, root_ca);
+	if (ret != S_OK)
 		goto exit;
-	}
-
-	X509_STORE_CTX_cleanup(&store_ctx);
-	X509_STORE_free(store);
 
 	/* Verify signer attributes */
 	if (!node->signer->auth_attr ||
@@ -589,9 +977,11 @@ artik_error os_verify_signature_init(artik_security_handle *handle,
 		if (signing_time_in) {
 			artik_time_module *time =
 				(artik_time_module *)artik_request_api_module("time");
+			int cmp = time->compare_dates(&pkcs7_signing_time,
+					signing_time_in);
 
-			if (time->compare_dates(&pkcs7_signing_time,
-					signing_time_in) == -1) {
+			artik_release_api_module(time);
+			if (cmp == -1) {
 				log_dbg("Signing time happened before current signing time");
 				ret = E_SECURITY_SIGNING_TIME_ROLLBACK;
 				goto exit;
@@ -613,47 +1003,25 @@ artik_error os_verify_signature_init(artik_security_handle *handle,
 			NULL)) {
 		log_dbg("Failed to initialize digest context");
 		EVP_MD_CTX_destroy(node->md_ctx);
+		node->md_ctx = NULL;
 		ret = E_BAD_ARGS;
 		goto exit;
 	}
 
-	strncpy(node->cookie, COOKIE_SIGVERIF, sizeof(node->cookie));
-	node->node.handle = (ARTIK_LIST_HANDLE) node;
-	*handle = (artik_security_handle)node;
-
 exit:
-	if (cabio)
-		BIO_free(cabio);
 	if (sigbio)
 		BIO_free(sigbio);
-	if (ca_cert)
-		X509_free(ca_cert);
-
-	if (ret != S_OK)
-		artik_list_delete_node(&verify_nodes, (artik_list *)node);
-
-	return ret;
-}
-
-artik_error os_verify_signature_update(artik_security_handle handle,
-		unsigned char *data, unsigned int data_len)
-{
-	verify_node *node = (verify_node *)artik_list_get_by_handle(verify_nodes,
-		(ARTIK_LIST_HANDLE)handle);
-
-	if (!node || !data || !data_len ||
-			strncmp(node->cookie, COOKIE_SIGVERIF, sizeof(node->cookie)))
-		return E_BAD_ARGS;
 
-	if (!EVP_DigestUpdate(node->md_ctx, data, data_len)) {
-		log_dbg("Failed to update data for digest computation");
-		return E_BAD_ARGS;
+	if (ret != S_OK && node->p7) {
+		PKCS7_free(node->p7);
+		node->p7 = NULL;
 	}
 
-	return S_OK;
+	return ret;
 }
 
-artik_error os_verify_signature_final(artik_security_handle handle)
+/* Check the digest and the signature, then release the node resources */
+static artik_error verify_node_final(verify_node *node)
 {
 	artik_error ret = S_OK;
 	ASN1_OCTET_STRING *data_digest = NULL;
@@ -661,11 +1029,6 @@ artik_error os_verify_signature_final(artik_security_handle handle)
 	unsigned char md_dat[EVP_MAX_MD_SIZE], *abuf = NULL;
 	unsigned int md_len = 0;
 	int alen = 0;
-	verify_node *node = (verify_node *)artik_list_get_by_handle(verify_nodes,
-		(ARTIK_LIST_HANDLE)handle);
-
-	if (!node || strncmp(node->cookie, COOKIE_SIGVERIF, sizeof(node->cookie)))
-		return E_BAD_ARGS;
 
 	if (!EVP_DigestFinal_ex(node->md_ctx, md_dat, &md_len)) {
 		log_dbg("Failed to finalize digest computation");
@@ -736,7 +1099,601 @@ exit:
 		EVP_PKEY_free(pkey);
 	PKCS7_free(node->p7);
 	EVP_MD_CTX_destroy(node->md_ctx);
+
+	return ret;
+}
+
+/*
+ * Hash the file straight from its mapping. Pages are read ahead one chunk
+ * in advance and dropped once hashed, so that the resident memory stays
+ * around two chunks whatever the size of the image.
+ */
+static artik_error verify_node_hash_file(verify_node *node, int fd, off_t size,
+		verify_progress_callback progress, void *user_data)
+{
+	unsigned char *map;
+	off_t done = 0;
+	artik_error ret = S_OK;
+
+	if (!size)
+		return S_OK;
+
+	map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		log_dbg("Failed to map the signed data (err=%d)", errno);
+		return E_ACCESS_DENIED;
+	}
+
+	madvise(map, size, MADV_SEQUENTIAL);
+
+	while (done < size) {
+		size_t len = (size - done > VERIFY_FILE_CHUNK) ?
+				VERIFY_FILE_CHUNK : (size_t)(size - done);
+
+		if (done + len < size)
+			madvise(map + done + len, (size - done - len >
+				VERIFY_FILE_CHUNK) ? VERIFY_FILE_CHUNK :
+				(size_t)(size - done - len), MADV_WILLNEED);
+
+		if (!EVP_DigestUpdate(node->md_ctx, map + done, len)) {
+			log_dbg("Failed to update data for digest computation");
+			ret = E_BAD_ARGS;
+			break;
+		}
+
+		madvise(map + done, len, MADV_DONTNEED);
+		done += len;
+
+		if (progress)
+			progress(done, size, user_data);
+	}
+
+	munmap(map, size);
+
+	return ret;
+}
+
+static artik_error open_signed_file(const char *path, int *fd, off_t *size)
+{
+	struct stat st;
+
+	*fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (*fd < 0) {
+		log_dbg("Failed to open %s (err=%d)", path, errno);
+		return E_ACCESS_DENIED;
+	}
+
+	if (fstat(*fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+		log_dbg("%s is not a regular file", path);
+		close(*fd);
+		return E_BAD_ARGS;
+	}
+
+	*size = st.st_size;
+
+	return S_OK;
+}
+
+artik_error os_verify_signature_init(artik_security_handle *handle,
+		const char *signature_pem, const char *root_ca,
+		const artik_time *signing_time_in, artik_time *signing_time_out)
+{
+	verify_node *node = NULL;
+	artik_error ret = S_OK;
+
+	if (!handle || !signature_pem || !root_ca)
+		return E_BAD_ARGS;
+
+	node = (verify_node *)artik_list_add(&verify_nodes, 0, sizeof(verify_node));
+	if (!node)
+		return E_NO_MEM;
+
+	ret = verify_node_init(node, signature_pem, root_ca, signing_time_in,
+			signing_time_out);
+	if (ret != S_OK) {
+		artik_list_delete_node(&verify_nodes, (artik_list *)node);
+		return ret;
+	}
+
+	strncpy(node->cookie, COOKIE_SIGVERIF, sizeof(node->cookie));
+	node->node.handle = (ARTIK_LIST_HANDLE) node;
+	*handle = (artik_security_handle)node;
+
+	return S_OK;
+}
+
+artik_error os_verify_signature_update(artik_security_handle handle,
+		unsigned char *data, unsigned int data_len)
+{
+	verify_node *node = (verify_node *)artik_list_get_by_handle(verify_nodes,
+		(ARTIK_LIST_HANDLE)handle);
+
+	if (!node || !data || !data_len ||
+			strncmp(node->cookie, COOKIE_SIGVERIF, sizeof(node->cookie)))
+		return E_BAD_ARGS;
+
+	if (!EVP_DigestUpdate(node->md_ctx, data, data_len)) {
+		log_dbg("Failed to update data for digest computation");
+		return E_BAD_ARGS;
+	}
+
+	return S_OK;
+}
+
+artik_error os_verify_signature_final(artik_security_handle handle)
+{
+	artik_error ret = S_OK;
+	verify_node *node = (verify_node *)artik_list_get_by_handle(verify_nodes,
+		(ARTIK_LIST_HANDLE)handle);
+
+	if (!node || strncmp(node->cookie, COOKIE_SIGVERIF, sizeof(node->cookie)))
+		return E_BAD_ARGS;
+
+	ret = verify_node_final(node);
 	artik_list_delete_node(&verify_nodes, (artik_list *)node);
 
 	return ret;
 }
+
+artik_error os_verify_signature_file(const char *path,
+		const char *signature_pem, const char *root_ca,
+		const artik_time *signing_time_in, artik_time *signing_time_out,
+		verify_progress_callback progress, void *user_data)
+{
+	verify_node node;
+	artik_error ret = S_OK;
+	off_t size = 0;
+	int fd = -1;
+
+	ret = open_signed_file(path, &fd, &size);
+	if (ret != S_OK)
+		return ret;
+
+	memset(&node, 0, sizeof(node));
+	ret = verify_node_init(&node, signature_pem, root_ca, signing_time_in,
+			signing_time_out);
+	if (ret != S_OK) {
+		close(fd);
+		return ret;
+	}
+
+	ret = verify_node_hash_file(&node, fd, size, progress, user_data);
+	close(fd);
+
+	if (ret != S_OK) {
+		PKCS7_free(node.p7);
+		EVP_MD_CTX_destroy(node.md_ctx);
+		return ret;
+	}
+
+	return verify_node_final(&node);
+}
+
+static void verify_file_work(void *user_data)
+{
+	verify_file_job *job = user_data;
+
+	job->result = verify_node_hash_file(&job->node, job->fd, job->size,
+			job->progress, job->user_data);
+	if (job->result != S_OK) {
+		PKCS7_free(job->node.p7);
+		EVP_MD_CTX_destroy(job->node.md_ctx);
+		return;
+	}
+
+	job->result = verify_node_final(&job->node);
+}
+
+static void verify_file_done(void *user_data)
+{
+	verify_file_job *job = user_data;
+
+	close(job->fd);
+	job->done(job->result, job->user_data);
+	artik_release_api_module(job->loop);
+	free(job);
+}
+
+artik_error os_verify_signature_file_async(const char *path,
+		const char *signature_pem, const char *root_ca,
+		const artik_time *signing_time_in, artik_time *signing_time_out,
+		verify_progress_callback progress, verify_done_callback done,
+		void *user_data)
+{
+	verify_file_job *job = NULL;
+	artik_error ret = S_OK;
+
+	job = calloc(1, sizeof(*job));
+	if (!job)
+		return E_NO_MEM;
+
+	job->progress = progress;
+	job->done = done;
+	job->user_data = user_data;
+
+	job->loop = (artik_loop_module *)artik_request_api_module("loop");
+	if (!job->loop) {
+		free(job);
+		return E_NOT_SUPPORTED;
+	}
+
+	ret = open_signed_file(path, &job->fd, &job->size);
+	if (ret != S_OK)
+		goto error;
+
+	/* Certificates and signing time are checked before returning */
+	ret = verify_node_init(&job->node, signature_pem, root_ca,
+			signing_time_in, signing_time_out);
+	if (ret != S_OK) {
+		close(job->fd);
+		goto error;
+	}
+
+	ret = job->loop->submit_work(verify_file_work, verify_file_done, job);
+	if (ret != S_OK) {
+		PKCS7_free(job->node.p7);
+		EVP_MD_CTX_destroy(job->node.md_ctx);
+		close(job->fd);
+		goto error;
+	}
+
+	return S_OK;
+
+error:
+	artik_release_api_module(job->loop);
+	free(job);
+
+	return ret;
+}
+
+static uint32_t crc32_table[8][256];
+static pthread_once_t crc32_once = PTHREAD_ONCE_INIT;
+
+static void crc32_init_table(void)
+{
+	uint32_t crc;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+		crc32_table[0][i] = crc;
+	}
+
+	for (i = 0; i < 256; i++)
+		for (j = 1; j < 8; j++)
+			crc32_table[j][i] = (crc32_table[j - 1][i] >> 8) ^
+				crc32_table[0][crc32_table[j - 1][i] & 0xff];
+}
+
+/* Same polynomial and conventions as zlib's crc32() */
+static uint32_t crc32_update(uint32_t crc, const unsigned char *p, size_t len)
+{
+	crc = ~crc;
+
+#ifdef __ARM_FEATURE_CRC32
+	while (len && ((uintptr_t)p & 7)) {
+		crc = __crc32b(crc, *p++);
+		len--;
+	}
+
+	for (; len >= 8; len -= 8, p += 8)
+		crc = __crc32d(crc, *(const uint64_t *)p);
+
+	while (len--)
+		crc = __crc32b(crc, *p++);
+#else
+	/* Slicing-by-8, processes 8 bytes per iteration (little endian) */
+	while (len && ((uintptr_t)p & 3)) {
+		crc = crc32_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+		len--;
+	}
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	for (; len >= 8; len -= 8, p += 8) {
+		uint32_t lo = *(const uint32_t *)p ^ crc;
+		uint32_t hi = *(const uint32_t *)(p + 4);
+
+		crc = crc32_table[7][lo & 0xff] ^
+			crc32_table[6][(lo >> 8) & 0xff] ^
+			crc32_table[5][(lo >> 16) & 0xff] ^
+			crc32_table[4][lo >> 24] ^
+			crc32_table[3][hi & 0xff] ^
+			crc32_table[2][(hi >> 8) & 0xff] ^
+			crc32_table[1][(hi >> 16) & 0xff] ^
+			crc32_table[0][hi >> 24];
+	}
+#endif
+
+	while (len--)
+		crc = crc32_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+#endif
+
+	return ~crc;
+}
+
+static const EVP_MD *hash_get_md(int i)
+{
+	switch (i) {
+	case 0:
+		return EVP_sha1();
+	case 1:
+		return EVP_sha256();
+	default:
+		return EVP_sha512();
+	}
+}
+
+static void hash_ctx_cleanup(hash_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < HASH_NUM_MD; i++)
+		if (ctx->md_ctx[i])
+			EVP_MD_CTX_destroy(ctx->md_ctx[i]);
+}
+
+static artik_error hash_ctx_init(hash_ctx *ctx, unsigned int types)
+{
+	int i;
+
+	if (types & ~HASH_TYPES)
+		return E_BAD_ARGS;
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->types = types;
+
+	if (types & ARTIK_HASH_CRC32)
+		pthread_once(&crc32_once, crc32_init_table);
+
+	for (i = 0; i < HASH_NUM_MD; i++) {
+		if (!(types & (1 << i)))
+			continue;
+
+		ctx->md_ctx[i] = EVP_MD_CTX_create();
+		if (!ctx->md_ctx[i] ||
+			!EVP_DigestInit_ex(ctx->md_ctx[i], hash_get_md(i), NULL)) {
+			log_dbg("Failed to initialize digest context");
+			hash_ctx_cleanup(ctx);
+			return E_NO_MEM;
+		}
+	}
+
+	return S_OK;
+}
+
+/*
+ * All the digests are fed with the same block before moving on to the next
+ * one, the data is read from memory once and hashed from the cache.
+ */
+static artik_error hash_ctx_update(hash_ctx *ctx, const unsigned char *data,
+		size_t len)
+{
+	while (len) {
+		size_t block = len > HASH_BLOCK ? HASH_BLOCK : len;
+		int i;
+
+		for (i = 0; i < HASH_NUM_MD; i++) {
+			if (ctx->md_ctx[i] &&
+				!EVP_DigestUpdate(ctx->md_ctx[i], data, block))
+				return E_BAD_ARGS;
+		}
+
+		if (ctx->types & ARTIK_HASH_CRC32)
+			ctx->crc32 = crc32_update(ctx->crc32, data, block);
+
+		data += block;
+		len -= block;
+	}
+
+	return S_OK;
+}
+
+static artik_error hash_ctx_final(hash_ctx *ctx, artik_hash_result *result)
+{
+	unsigned char *out[HASH_NUM_MD] = {
+		result->sha1, result->sha256, result->sha512
+	};
+	artik_error ret = S_OK;
+	int i;
+
+	memset(result, 0, sizeof(*result));
+	result->types = ctx->types;
+	result->crc32 = ctx->crc32;
+
+	for (i = 0; i < HASH_NUM_MD; i++) {
+		if (ctx->md_ctx[i] &&
+			!EVP_DigestFinal_ex(ctx->md_ctx[i], out[i], NULL))
+			ret = E_BAD_ARGS;
+	}
+
+	hash_ctx_cleanup(ctx);
+
+	return ret;
+}
+
+static artik_error hash_ctx_update_fd(hash_ctx *ctx, int fd)
+{
+	unsigned char *buf;
+	struct stat st;
+	artik_error ret = S_OK;
+	ssize_t len;
+
+	/* Map regular files read from their beginning */
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+					lseek(fd, 0, SEEK_CUR) == 0) {
+		off_t size = st.st_size;
+		unsigned char *map;
+		off_t done;
+
+		map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			madvise(map, size, MADV_SEQUENTIAL);
+
+			for (done = 0; done < size && ret == S_OK;
+						done += VERIFY_FILE_CHUNK) {
+				size_t chunk = (size - done > VERIFY_FILE_CHUNK) ?
+					VERIFY_FILE_CHUNK : (size_t)(size - done);
+
+				ret = hash_ctx_update(ctx, map + done, chunk);
+				madvise(map + done, chunk, MADV_DONTNEED);
+			}
+
+			munmap(map, size);
+			if (ret == S_OK)
+				lseek(fd, size, SEEK_SET);
+
+			return ret;
+		}
+	}
+
+	/* Pipes, sockets and everything which cannot be mapped */
+	buf = malloc(HASH_READ_SIZE);
+	if (!buf)
+		return E_NO_MEM;
+
+	while ((len = read(fd, buf, HASH_READ_SIZE)) != 0) {
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			log_dbg("Failed to read data to hash (err=%d)", errno);
+			ret = E_ACCESS_DENIED;
+			break;
+		}
+
+		ret = hash_ctx_update(ctx, buf, len);
+		if (ret != S_OK)
+			break;
+	}
+
+	free(buf);
+
+	return ret;
+}
+
+artik_error os_hash_buffer(unsigned int types, const unsigned char *data,
+		unsigned long long len, artik_hash_result *result)
+{
+	hash_ctx ctx;
+	artik_error ret;
+
+	ret = hash_ctx_init(&ctx, types);
+	if (ret != S_OK)
+		return ret;
+
+	ret = hash_ctx_update(&ctx, data, len);
+	if (ret != S_OK) {
+		hash_ctx_cleanup(&ctx);
+		return ret;
+	}
+
+	return hash_ctx_final(&ctx, result);
+}
+
+artik_error os_hash_fd(unsigned int types, int fd, artik_hash_result *result)
+{
+	hash_ctx ctx;
+	artik_error ret;
+
+	ret = hash_ctx_init(&ctx, types);
+	if (ret != S_OK)
+		return ret;
+
+	ret = hash_ctx_update_fd(&ctx, fd);
+	if (ret != S_OK) {
+		hash_ctx_cleanup(&ctx);
+		return ret;
+	}
+
+	return hash_ctx_final(&ctx, result);
+}
+
+artik_error os_hash_file(unsigned int types, const char *path,
+		artik_hash_result *result)
+{
+	artik_error ret;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		log_dbg("Failed to open %s (err=%d)", path, errno);
+		return E_ACCESS_DENIED;
+	}
+
+	ret = os_hash_fd(types, fd, result);
+	close(fd);
+
+	return ret;
+}
+
+static void *hash_files_worker(void *user_data)
+{
+	hash_files_job *job = user_data;
+	artik_error ret;
+	int i;
+
+	while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+								job->count) {
+		ret = os_hash_file(job->types, job->paths[i], &job->results[i]);
+		if (job->errors)
+			job->errors[i] = ret;
+		if (ret != S_OK) {
+			artik_error expected = S_OK;
+
+			__atomic_compare_exchange_n(&job->ret, &expected, ret,
+				false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+		}
+	}
+
+	return NULL;
+}
+
+artik_error os_hash_files(unsigned int types, const char * const *paths,
+		int count, int num_threads, artik_hash_result *results,
+		artik_error *errors)
+{
+	hash_files_job job;
+	pthread_t *threads;
+	int started = 0;
+	int i;
+
+	if (types & ~HASH_TYPES)
+		return E_BAD_ARGS;
+
+	if (!num_threads)
+		num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_threads > count)
+		num_threads = count;
+	if (num_threads < 1)
+		num_threads = 1;
+
+	memset(&job, 0, sizeof(job));
+	job.types = types;
+	job.paths = paths;
+	job.results = results;
+	job.errors = errors;
+	job.count = count;
+
+	threads = calloc(num_threads, sizeof(pthread_t));
+	if (!threads)
+		return E_NO_MEM;
+
+	/* The calling thread is part of the pool */
+	for (i = 1; i < num_threads; i++) {
+		if (pthread_create(&threads[started], NULL, hash_files_worker,
+								&job))
+			break;
+		started++;
+	}
+
+	hash_files_worker(&job);
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+
+	return job.ret;
+}
+
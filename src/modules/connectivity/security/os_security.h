@@ -39,5 +39,23 @@ artik_error os_verify_signature_init(artik_security_handle *handle,
 artik_error os_verify_signature_update(artik_security_handle handle,
 		unsigned char *data, unsigned int data_len);
 artik_error os_verify_signature_final(artik_security_handle handle);
+artik_error os_verify_signature_file(const char *path,
+		const char *signature_pem, const char *root_ca,
+		const artik_time *signing_time_in, artik_time *signing_time_out,
+		verify_progress_callback progress, void *user_data);
+artik_error os_verify_signature_file_async(const char *path,
+		const char *signature_pem, const char *root_ca,
+		const artik_time *signing_time_in, artik_time *signing_time_out,
+		verify_progress_callback progress, verify_done_callback done,
+		void *user_data);
+artik_error os_hash_buffer(unsigned int types, const unsigned char *data,
+		unsigned long long len, artik_hash_result *result);
+artik_error os_hash_fd(unsigned int types, int fd, artik_hash_result *result);
+artik_error os_hash_file(unsigned int types, const char *path,
+		artik_hash_result *result);
+artik_error os_hash_files(unsigned int types, const char * const *paths,
+		int count, int num_threads, artik_hash_result *results,
+		artik_error *errors);
+artik_error os_security_clear_cache(artik_security_handle handle);
 
 #endif  /* __OS_SECURITY_H__ */
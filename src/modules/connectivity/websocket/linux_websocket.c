@@ -146,15 +146,16 @@ void lws_cleanup(artik_websocket_config *config)
 	artik_loop_module *loop = (artik_loop_module *)
 					artik_request_api_module("loop");
 
-	loop->remove_fd_watch(
+	loop->remove_fd_watch_from_loop(config->loop,
 			ARTIK_WEBSOCKET_INTERFACE->data[FD_CLOSE].watch_id);
-	loop->remove_fd_watch(
+	loop->remove_fd_watch_from_loop(config->loop,
 			ARTIK_WEBSOCKET_INTERFACE->data[FD_CONNECT].watch_id);
-	loop->remove_fd_watch(
+	loop->remove_fd_watch_from_loop(config->loop,
 			ARTIK_WEBSOCKET_INTERFACE->data[FD_RECEIVE].watch_id);
-	loop->remove_fd_watch(
+	loop->remove_fd_watch_from_loop(config->loop,
 			ARTIK_WEBSOCKET_INTERFACE->data[FD_ERROR].watch_id);
-	loop->remove_idle_callback(ARTIK_WEBSOCKET_INTERFACE->loop_process_id);
+	loop->remove_idle_callback_from_loop(config->loop,
+			ARTIK_WEBSOCKET_INTERFACE->loop_process_id);
 	artik_release_api_module(loop);
 
 	/* Destroy context in libwebsockets API */
@@ -975,7 +976,8 @@ artik_error os_websocket_open_stream(artik_websocket_config *config)
 
 	SSL_CTX_set_ex_data(interface->ssl_ctx, 0, (void *)wsi);
 
-	loop->add_idle_callback(&interface->loop_process_id,
+	loop->add_idle_callback_to_loop(config->loop,
+				&interface->loop_process_id,
 				os_websocket_process_stream, (void *)interface);
 
 	config->private_data = (void *)interface;
@@ -1092,7 +1094,8 @@ artik_error os_websocket_set_connection_callback(artik_websocket_config *config,
 	data[FD_ERROR].callback = callback;
 	data[FD_ERROR].user_data = user_data;
 
-	ret = loop->add_fd_watch(fds->fdset[FD_CLOSE], WATCH_IO_IN,
+	ret = loop->add_fd_watch_to_loop(config->loop, fds->fdset[FD_CLOSE],
+			WATCH_IO_IN,
 			os_websocket_close_callback, (void *)data,
 			&data[FD_CLOSE].watch_id);
 
@@ -1101,7 +1104,8 @@ artik_error os_websocket_set_connection_callback(artik_websocket_config *config,
 		goto exit;
 	}
 
-	ret = loop->add_fd_watch(fds->fdset[FD_CONNECT], WATCH_IO_IN,
+	ret = loop->add_fd_watch_to_loop(config->loop, fds->fdset[FD_CONNECT],
+			WATCH_IO_IN,
 			os_websocket_connection_callback, (void *)data,
 			&data[FD_CONNECT].watch_id);
 
@@ -1110,7 +1114,8 @@ artik_error os_websocket_set_connection_callback(artik_websocket_config *config,
 		goto exit;
 	}
 
-	ret = loop->add_fd_watch(fds->fdset[FD_ERROR], WATCH_IO_IN,
+	ret = loop->add_fd_watch_to_loop(config->loop, fds->fdset[FD_ERROR],
+			WATCH_IO_IN,
 			os_websocket_error_callback, (void *)data,
 			&data[FD_ERROR].watch_id);
 
@@ -1163,7 +1168,8 @@ artik_error os_websocket_set_receive_callback(artik_websocket_config *config,
 	data[FD_RECEIVE].callback = callback;
 	data[FD_RECEIVE].user_data = user_data;
 
-	ret = loop->add_fd_watch(fds->fdset[FD_RECEIVE], WATCH_IO_IN,
+	ret = loop->add_fd_watch_to_loop(config->loop, fds->fdset[FD_RECEIVE],
+			WATCH_IO_IN,
 			os_websocket_receive_callback, (void *)config,
 			&data[FD_RECEIVE].watch_id);
 	if (ret != S_OK) {
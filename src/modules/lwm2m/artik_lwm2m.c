@@ -52,6 +52,10 @@ static artik_error serialize_tlv_int(int *data, int size,
 		unsigned char **buffer, int *lenbuffer);
 static artik_error serialize_tlv_string(char **data, int size,
 		unsigned char **buffer, int *lenbuffer);
+static artik_error client_write_resources(artik_lwm2m_handle handle,
+		artik_lwm2m_resource_t *resources, int count);
+static artik_error client_read_resources(artik_lwm2m_handle handle,
+		artik_lwm2m_resource_t *resources, int count);
 
 const artik_lwm2m_module lwm2m_module = {
 	client_connect,
@@ -65,7 +69,9 @@ const artik_lwm2m_module lwm2m_module = {
 	create_connectivity_monitoring_object,
 	free_object,
 	serialize_tlv_int,
-	serialize_tlv_string
+	serialize_tlv_string,
+	client_write_resources,
+	client_read_resources
 };
 
 artik_error client_connect(artik_lwm2m_handle *handle,
@@ -152,3 +158,21 @@ artik_error serialize_tlv_string(char **data, int size, unsigned char **buffer,
 {
 	return os_serialize_tlv_string(data, size, buffer, lenbuffer);
 }
+
+artik_error client_write_resources(artik_lwm2m_handle handle,
+		artik_lwm2m_resource_t *resources, int count)
+{
+	if (!resources || count <= 0)
+		return E_BAD_ARGS;
+
+	return os_lwm2m_client_write_resources(handle, resources, count);
+}
+
+artik_error client_read_resources(artik_lwm2m_handle handle,
+		artik_lwm2m_resource_t *resources, int count)
+{
+	if (!resources || count <= 0)
+		return E_BAD_ARGS;
+
+	return os_lwm2m_client_read_resources(handle, resources, count);
+}
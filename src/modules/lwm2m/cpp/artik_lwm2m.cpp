@@ -48,6 +48,18 @@ artik_error artik::Lwm2m::client_read_resource(const char *uri,
       length);
 }
 
+artik_error artik::Lwm2m::client_write_resources(
+    artik_lwm2m_resource_t *resources, int count) {
+  return this->m_module->client_write_resources(this->m_handle, resources,
+      count);
+}
+
+artik_error artik::Lwm2m::client_read_resources(
+    artik_lwm2m_resource_t *resources, int count) {
+  return this->m_module->client_read_resources(this->m_handle, resources,
+      count);
+}
+
 artik_error artik::Lwm2m::set_callback(artik_lwm2m_event_t event,
     artik_lwm2m_callback user_callback, void *user_data) {
   return this->m_module->set_callback(this->m_handle, event, user_callback,
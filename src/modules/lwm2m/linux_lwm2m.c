@@ -16,6 +16,15 @@
  *
  */
 
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+
 #include <artik_module.h>
 #include <artik_platform.h>
 #include <artik_loop.h>
@@ -26,15 +35,33 @@
 #include "os_lwm2m.h"
 #include "lwm2mclient.h"
 
+/* Delay before the first service, leaves time to set the callbacks */
+#define LWM2M_SERVICE_FIRST_MSEC		100
+#define LWM2M_SERVICE_MIN_MSEC			10
+#define LWM2M_SERVICE_POLL_MSEC			1
+#define LWM2M_SERVICE_POLL_FALLBACK_MSEC	100
+
 typedef struct {
 	artik_list node;
 
 	artik_lwm2m_config config;
 	client_handle_t *client;
+	int client_socket;
 	artik_lwm2m_callback callbacks[ARTIK_LWM2M_EVENT_COUNT];
 	void *callbacks_params[ARTIK_LWM2M_EVENT_COUNT];
-	int service_cbk_id;
+	int timer_fd;
+	int timer_watch_id;
+	int socket_fd;
+	int socket_watch_id;
 	artik_loop_module *loop_module;
+
+	/* Resources changed since the last dispatch, see on_resource_changed */
+	pthread_mutex_t changes_lock;
+	char **changes;
+	int changes_count;
+	int changes_size;
+	int changes_idle_id;
+	bool changes_pending;
 } lwm2m_node;
 
 typedef struct {
@@ -46,36 +73,244 @@ typedef struct {
 
 static artik_list *nodes = NULL;
 
-static void on_lwm2m_service_callback(void *user_data)
+/* Returns the number of datagram sockets open in the process, -1 on error */
+static int lwm2m_list_udp_sockets(int **fds)
+{
+	DIR *dir;
+	struct dirent *entry;
+	socklen_t len;
+	int *list = NULL, *tmp;
+	int count = 0, size = 0;
+	int fd, type;
+	char *end;
+
+	dir = opendir("/proc/self/fd");
+	if (!dir)
+		return -1;
+
+	while ((entry = readdir(dir)) != NULL) {
+		fd = strtol(entry->d_name, &end, 10);
+		if (end == entry->d_name || *end || fd == dirfd(dir))
+			continue;
+
+		len = sizeof(type);
+		if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) < 0 ||
+				type != SOCK_DGRAM)
+			continue;
+
+		if (count == size) {
+			size = size ? size * 2 : 16;
+			tmp = realloc(list, size * sizeof(int));
+			if (!tmp) {
+				free(list);
+				closedir(dir);
+				return -1;
+			}
+			list = tmp;
+		}
+		list[count++] = fd;
+	}
+
+	closedir(dir);
+	*fds = list;
+
+	return count;
+}
+
+/*
+ * wakaama-client has no accessor for the UDP socket it talks to the server
+ * over. It creates it in lwm2m_client_start() and keeps it until
+ * lwm2m_client_stop(), so look for the only datagram socket that appeared
+ * during the call. Returns -1, and the client is polled, when there is no
+ * single candidate, e.g. another thread opened one at the same time.
+ */
+static int lwm2m_find_client_socket(const int *before, int before_count)
+{
+	int *after = NULL;
+	int count, i, j;
+	int sock = -1;
+
+	count = lwm2m_list_udp_sockets(&after);
+
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < before_count; j++)
+			if (after[i] == before[j])
+				break;
+		if (j < before_count)
+			continue;
+
+		if (sock >= 0) {
+			sock = -1;
+			break;
+		}
+		sock = after[i];
+	}
+
+	free(after);
+
+	return sock;
+}
+
+static int on_lwm2m_socket_callback(int fd, enum watch_io io,
+							void *user_data);
+static int on_lwm2m_timer_callback(int fd, enum watch_io io,
+							void *user_data);
+
+static artik_error lwm2m_arm_timer(lwm2m_node *node, unsigned int msec)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = msec / 1000;
+	its.it_value.tv_nsec = (msec % 1000) * 1000000;
+
+	if (timerfd_settime(node->timer_fd, 0, &its, NULL) < 0) {
+		log_err("Failed to arm LWM2M service timer (%d)", errno);
+		return E_LWM2M_ERROR;
+	}
+
+	return S_OK;
+}
+
+/*
+ * Service the client as soon as the loop is idle, so notifications for
+ * resources written in a row are sent together in the next step.
+ */
+static void lwm2m_kick(lwm2m_node *node)
+{
+	struct itimerspec its;
+
+	if (node->timer_fd < 0)
+		return;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_nsec = 1;
+	timerfd_settime(node->timer_fd, 0, &its, NULL);
+}
+
+static artik_error lwm2m_start_servicing(lwm2m_node *node)
 {
-	lwm2m_node *node = (lwm2m_node *)user_data;
 	artik_error ret;
+
+	node->socket_fd = -1;
+	node->timer_fd = timerfd_create(CLOCK_MONOTONIC,
+					TFD_NONBLOCK | TFD_CLOEXEC);
+	if (node->timer_fd < 0) {
+		log_err("Failed to create LWM2M service timer (%d)", errno);
+		return E_LWM2M_ERROR;
+	}
+
+	ret = node->loop_module->add_fd_watch(node->timer_fd, WATCH_IO_IN,
+			on_lwm2m_timer_callback, (void *)node,
+			&node->timer_watch_id);
+	if (ret != S_OK) {
+		close(node->timer_fd);
+		node->timer_fd = -1;
+		return ret;
+	}
+
+	return lwm2m_arm_timer(node, LWM2M_SERVICE_FIRST_MSEC);
+}
+
+static void lwm2m_stop_servicing(lwm2m_node *node)
+{
+	if (node->socket_fd >= 0) {
+		node->loop_module->remove_fd_watch(node->socket_watch_id);
+		node->socket_fd = -1;
+	}
+
+	if (node->timer_fd >= 0) {
+		node->loop_module->remove_fd_watch(node->timer_watch_id);
+		close(node->timer_fd);
+		node->timer_fd = -1;
+	}
+}
+
+/* Watches the client socket once the first service has run */
+static void lwm2m_update_socket_watch(lwm2m_node *node)
+{
+	int sock = node->client_socket;
+
+	if (sock == node->socket_fd)
+		return;
+
+	if (node->socket_fd >= 0)
+		node->loop_module->remove_fd_watch(node->socket_watch_id);
+
+	node->socket_fd = -1;
+	if (sock < 0)
+		return;
+
+	if (node->loop_module->add_fd_watch(sock, WATCH_IO_IN,
+			on_lwm2m_socket_callback, (void *)node,
+			&node->socket_watch_id) != S_OK) {
+		log_err("Failed to watch LWM2M socket, polling instead");
+		return;
+	}
+
+	node->socket_fd = sock;
+}
+
+static void lwm2m_service(lwm2m_node *node)
+{
+	unsigned int msec;
 	int timeout;
 
 	log_dbg("");
 
-	timeout = lwm2m_client_service(node->client, 1);
+	timeout = lwm2m_client_service(node->client, LWM2M_SERVICE_POLL_MSEC);
 	if (timeout < LWM2M_CLIENT_OK) {
-		if (node->callbacks[ARTIK_LWM2M_EVENT_ERROR]) {
-			artik_error err = (timeout == LWM2M_CLIENT_QUIT) ?
-						E_INTERRUPTED : E_LWM2M_ERROR;
-			node->callbacks[ARTIK_LWM2M_EVENT_ERROR]((void *)(intptr_t)err,
+		artik_error err = (timeout == LWM2M_CLIENT_QUIT) ?
+					E_INTERRUPTED : E_LWM2M_ERROR;
+
+		lwm2m_stop_servicing(node);
+		/* The callback may disconnect and free the node */
+		if (node->callbacks[ARTIK_LWM2M_EVENT_ERROR])
+			node->callbacks[ARTIK_LWM2M_EVENT_ERROR](
+					(void *)(intptr_t)err,
 					node->callbacks_params[
 						ARTIK_LWM2M_EVENT_ERROR]);
-		}
-	} else {
-		/* Set next timeout callback */
-		node->loop_module->remove_timeout_callback(
-							node->service_cbk_id);
-		ret = node->loop_module->add_timeout_callback(
-				&node->service_cbk_id, timeout*1000,
-				on_lwm2m_service_callback, (void *)node);
-		if (ret != S_OK) {
-			log_err("Failed to start timeout callback for\n"
-				"LWM2M servicing");
-			os_lwm2m_client_disconnect(node->client);
-		}
+		return;
 	}
+
+	lwm2m_update_socket_watch(node);
+
+	/*
+	 * Incoming packets are handled as soon as the socket is readable,
+	 * the timer only has to cover retransmissions and registration
+	 * updates. Without a socket to watch, keep polling.
+	 */
+	msec = timeout * 1000;
+	if (msec < LWM2M_SERVICE_MIN_MSEC)
+		msec = LWM2M_SERVICE_MIN_MSEC;
+	if (node->socket_fd < 0 && msec > LWM2M_SERVICE_POLL_FALLBACK_MSEC)
+		msec = LWM2M_SERVICE_POLL_FALLBACK_MSEC;
+
+	if (lwm2m_arm_timer(node, msec) != S_OK)
+		lwm2m_stop_servicing(node);
+}
+
+static int on_lwm2m_socket_callback(int fd, enum watch_io io,
+							void *user_data)
+{
+	lwm2m_service((lwm2m_node *)user_data);
+
+	/* The watch is removed by lwm2m_stop_servicing() if needed */
+	return 1;
+}
+
+static int on_lwm2m_timer_callback(int fd, enum watch_io io,
+							void *user_data)
+{
+	uint64_t expirations;
+
+	if (read(fd, &expirations, sizeof(expirations)) < 0 &&
+							errno == EAGAIN)
+		return 1;
+
+	lwm2m_service((lwm2m_node *)user_data);
+
+	return 1;
 }
 
 static int on_idle_callback(void *user_data)
@@ -164,27 +399,127 @@ static void on_exec_firmware_update(void *user_data, void *extra)
 	}
 }
 
+static void lwm2m_free_changes(char **changes, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		free(changes[i]);
+	free(changes);
+}
+
+static int on_changes_idle_callback(void *user_data)
+{
+	lwm2m_node *node = (lwm2m_node *)user_data;
+	artik_lwm2m_callback changed, list_changed;
+	void *changed_data, *list_data;
+	artik_lwm2m_resources_t list;
+	char **changes;
+	int count;
+	int i;
+
+	pthread_mutex_lock(&node->changes_lock);
+	changes = node->changes;
+	count = node->changes_count;
+	node->changes = NULL;
+	node->changes_count = 0;
+	node->changes_size = 0;
+	node->changes_pending = false;
+	pthread_mutex_unlock(&node->changes_lock);
+
+	log_dbg("%d resources changed", count);
+
+	/* The node may be released by any of the callbacks */
+	changed = node->callbacks[ARTIK_LWM2M_EVENT_RESOURCE_CHANGED];
+	changed_data = node->callbacks_params[
+					ARTIK_LWM2M_EVENT_RESOURCE_CHANGED];
+	list_changed = node->callbacks[ARTIK_LWM2M_EVENT_RESOURCES_CHANGED];
+	list_data = node->callbacks_params[
+					ARTIK_LWM2M_EVENT_RESOURCES_CHANGED];
+
+	if (list_changed) {
+		list.count = count;
+		list.resources = calloc(count, sizeof(artik_lwm2m_resource_t));
+		if (list.resources) {
+			for (i = 0; i < count; i++)
+				list.resources[i].uri = changes[i];
+			list_changed(&list, list_data);
+			free(list.resources);
+		} else {
+			log_err("Not enough memory to report changes");
+		}
+	}
+
+	if (changed) {
+		for (i = 0; i < count; i++) {
+			if (!artik_list_get_by_handle(nodes,
+					(ARTIK_LIST_HANDLE)user_data))
+				break;
+			/* Ownership of the URI goes to the callback */
+			changed(changes[i], changed_data);
+			changes[i] = NULL;
+		}
+	}
+
+	lwm2m_free_changes(changes, count);
+
+	return 0;
+}
+
+/*
+ * Changes are queued and reported from a single idle callback, so that a
+ * burst of writes from the server ends up in one dispatch to the
+ * application. A resource changed several times is reported once.
+ */
 static void on_resource_changed(void *user_data, void *extra)
 {
 	lwm2m_node *node = (lwm2m_node *)user_data;
 	lwm2m_resource_t *res = (lwm2m_resource_t *)extra;
+	int i;
 
 	log_dbg("uri: %s", res->uri);
 
+	if (!node->callbacks[ARTIK_LWM2M_EVENT_RESOURCE_CHANGED] &&
+			!node->callbacks[ARTIK_LWM2M_EVENT_RESOURCES_CHANGED])
+		return;
+
+	pthread_mutex_lock(&node->changes_lock);
+
+	for (i = 0; i < node->changes_count; i++) {
+		if (!strcmp(node->changes[i], res->uri))
+			goto exit;
+	}
+
+	if (node->changes_count == node->changes_size) {
+		int size = node->changes_size ? node->changes_size * 2 : 16;
+		char **changes = realloc(node->changes, size * sizeof(char *));
+
+		if (!changes) {
+			log_err("Not enough memory to queue resource change");
+			goto exit;
+		}
+
+		node->changes = changes;
+		node->changes_size = size;
+	}
+
+	node->changes[node->changes_count] = strdup(res->uri);
+	if (!node->changes[node->changes_count])
+		goto exit;
+	node->changes_count++;
+
 	/* Call from the main loop in case we are called from Wakaama's rx
 	 * thread. This avoid confusion to higher level callers
 	 * (such as node.js addon) which rely on their callbacks being called
 	 * from the same thread context
 	 */
-	if (node->callbacks[ARTIK_LWM2M_EVENT_RESOURCE_CHANGED]) {
-		lwm2m_idle_params *params = malloc(sizeof(lwm2m_idle_params));
+	if (!node->changes_pending &&
+		node->loop_module->add_idle_callback(&node->changes_idle_id,
+			on_changes_idle_callback, (void *)node) == S_OK)
+		node->changes_pending = true;
 
-		params->node = node;
-		params->extra = (void *)strndup(res->uri, strlen(res->uri));
-		params->event = ARTIK_LWM2M_EVENT_RESOURCE_CHANGED;
-		node->loop_module->add_idle_callback(&params->id,
-					on_idle_callback, (void *)params);
-	}
+exit:
+	pthread_mutex_unlock(&node->changes_lock);
 }
 
 artik_error os_lwm2m_client_connect(artik_lwm2m_handle *handle,
@@ -194,6 +529,8 @@ artik_error os_lwm2m_client_connect(artik_lwm2m_handle *handle,
 	object_container_t objects;
 	object_security_server_t server;
 	artik_error ret = S_OK;
+	int *before = NULL;
+	int before_count;
 	int i;
 
 	log_dbg("");
@@ -207,6 +544,7 @@ artik_error os_lwm2m_client_connect(artik_lwm2m_handle *handle,
 
 	node->loop_module =  (artik_loop_module *)
 					artik_request_api_module("loop");
+	pthread_mutex_init(&node->changes_lock, NULL);
 
 	/* Fill up server object based on passed config */
 	memset(&server, 0, sizeof(server));
@@ -250,18 +588,23 @@ artik_error os_lwm2m_client_connect(artik_lwm2m_handle *handle,
 	}
 
 	/* Configure and start the client */
+	before_count = lwm2m_list_udp_sockets(&before);
 	node->client = lwm2m_client_start(&objects);
+	node->client_socket = (node->client && before_count >= 0) ?
+		lwm2m_find_client_socket(before, before_count) : -1;
+	free(before);
 	if (!node->client) {
+		pthread_mutex_destroy(&node->changes_lock);
+		artik_release_api_module(node->loop_module);
 		artik_list_delete_node(&nodes, (artik_list *)node);
 		return E_LWM2M_ERROR;
 	}
 
-	/* Start timeout callback to service the LWM2M library */
-	ret = node->loop_module->add_timeout_callback(&node->service_cbk_id,
-			100, on_lwm2m_service_callback, (void *)node);
+	/* Service the LWM2M library on socket activity and protocol timeouts */
+	ret = lwm2m_start_servicing(node);
 	if (ret != S_OK) {
-		log_err("Failed to start timeout callback for LWM2M servicing");
-		os_lwm2m_client_disconnect(node->client);
+		log_err("Failed to start LWM2M servicing");
+		os_lwm2m_client_disconnect((artik_lwm2m_handle)node);
 		goto exit;
 	}
 
@@ -281,24 +624,26 @@ artik_error os_lwm2m_client_disconnect(artik_lwm2m_handle handle)
 	if (!node)
 		return E_BAD_ARGS;
 
+	lwm2m_stop_servicing(node);
 	lwm2m_client_stop(node->client);
+
+	if (node->changes_pending)
+		node->loop_module->remove_idle_callback(node->changes_idle_id);
+	lwm2m_free_changes(node->changes, node->changes_count);
+	pthread_mutex_destroy(&node->changes_lock);
+
 	artik_release_api_module(node->loop_module);
 	artik_list_delete_node(&nodes, (artik_list *)node);
 
 	return S_OK;
 }
 
-artik_error os_lwm2m_client_write_resource(artik_lwm2m_handle handle,
-		const char *uri, unsigned char *buffer, int length)
+static artik_error lwm2m_write_one(lwm2m_node *node, const char *uri,
+		unsigned char *buffer, int length)
 {
-	lwm2m_node *node = (lwm2m_node *)artik_list_get_by_handle(nodes,
-				(ARTIK_LIST_HANDLE) handle);
 	lwm2m_resource_t res;
-	artik_error ret = S_OK;
 
-	log_dbg("");
-
-	if (!node || !uri)
+	if (!uri)
 		return E_BAD_ARGS;
 
 	strncpy(res.uri, uri, LWM2M_MAX_URI_LEN);
@@ -307,25 +652,19 @@ artik_error os_lwm2m_client_write_resource(artik_lwm2m_handle handle,
 
 	if (lwm2m_write_resource(node->client, &res) != LWM2M_CLIENT_OK) {
 		log_err("Failed to write resource %s", res.uri);
-		ret = E_LWM2M_ERROR;
-		goto exit;
+		return E_LWM2M_ERROR;
 	}
 
-exit:
-	return ret;
+	return S_OK;
 }
 
-artik_error os_lwm2m_client_read_resource(artik_lwm2m_handle handle,
-		const char *uri, unsigned char *buffer, int *length)
+static artik_error lwm2m_read_one(lwm2m_node *node, const char *uri,
+		unsigned char *buffer, int *length)
 {
-	lwm2m_node *node = (lwm2m_node *)artik_list_get_by_handle(nodes,
-					(ARTIK_LIST_HANDLE) handle);
 	lwm2m_resource_t res;
 	artik_error ret = S_OK;
 
-	log_dbg("");
-
-	if (!node || !uri || !buffer || (*length == 0))
+	if (!uri || !buffer || (*length == 0))
 		return E_BAD_ARGS;
 
 	memset(&res, 0, sizeof(res));
@@ -352,6 +691,97 @@ exit:
 	return ret;
 }
 
+artik_error os_lwm2m_client_write_resource(artik_lwm2m_handle handle,
+		const char *uri, unsigned char *buffer, int length)
+{
+	lwm2m_node *node = (lwm2m_node *)artik_list_get_by_handle(nodes,
+				(ARTIK_LIST_HANDLE) handle);
+	artik_error ret;
+
+	log_dbg("");
+
+	if (!node)
+		return E_BAD_ARGS;
+
+	ret = lwm2m_write_one(node, uri, buffer, length);
+	if (ret == S_OK)
+		lwm2m_kick(node);
+
+	return ret;
+}
+
+artik_error os_lwm2m_client_read_resource(artik_lwm2m_handle handle,
+		const char *uri, unsigned char *buffer, int *length)
+{
+	lwm2m_node *node = (lwm2m_node *)artik_list_get_by_handle(nodes,
+					(ARTIK_LIST_HANDLE) handle);
+
+	log_dbg("");
+
+	if (!node)
+		return E_BAD_ARGS;
+
+	return lwm2m_read_one(node, uri, buffer, length);
+}
+
+artik_error os_lwm2m_client_write_resources(artik_lwm2m_handle handle,
+		artik_lwm2m_resource_t *resources, int count)
+{
+	lwm2m_node *node = (lwm2m_node *)artik_list_get_by_handle(nodes,
+				(ARTIK_LIST_HANDLE) handle);
+	artik_error ret = S_OK;
+	int written = 0;
+	int i;
+
+	log_dbg("%d resources", count);
+
+	if (!node)
+		return E_BAD_ARGS;
+
+	for (i = 0; i < count; i++) {
+		artik_error err = lwm2m_write_one(node, resources[i].uri,
+				resources[i].buffer, resources[i].length);
+
+		if (err == S_OK)
+			written++;
+		else if (ret == S_OK)
+			ret = err;
+	}
+
+	/* Observers get the new values in a single step */
+	if (written)
+		lwm2m_kick(node);
+
+	return ret;
+}
+
+artik_error os_lwm2m_client_read_resources(artik_lwm2m_handle handle,
+		artik_lwm2m_resource_t *resources, int count)
+{
+	lwm2m_node *node = (lwm2m_node *)artik_list_get_by_handle(nodes,
+				(ARTIK_LIST_HANDLE) handle);
+	artik_error ret = S_OK;
+	int i;
+
+	log_dbg("%d resources", count);
+
+	if (!node)
+		return E_BAD_ARGS;
+
+	for (i = 0; i < count; i++) {
+		artik_error err = lwm2m_read_one(node, resources[i].uri,
+				resources[i].buffer, &resources[i].length);
+
+		if (err != S_OK) {
+			resources[i].length = 0;
+			if (ret == S_OK)
+				ret = err;
+		}
+	}
+
+	return ret;
+}
+
 artik_error os_lwm2m_set_callback(artik_lwm2m_handle handle,
 		artik_lwm2m_event_t event,
 		artik_lwm2m_callback user_callback, void *user_data)
@@ -378,7 +808,8 @@ artik_error os_lwm2m_set_callback(artik_lwm2m_handle handle,
 		lwm2m_register_callback(node->client, LWM2M_EXE_FIRMWARE_UPDATE,
 				on_exec_firmware_update,
 				(void *)node);
-	} else if (ARTIK_LWM2M_EVENT_RESOURCE_CHANGED) {
+	} else if (event == ARTIK_LWM2M_EVENT_RESOURCE_CHANGED ||
+			event == ARTIK_LWM2M_EVENT_RESOURCES_CHANGED) {
 		lwm2m_register_callback(node->client,
 				LWM2M_NOTIFY_RESOURCE_CHANGED,
 				on_resource_changed,
@@ -410,7 +841,8 @@ artik_error os_lwm2m_unset_callback(artik_lwm2m_handle handle,
 						LWM2M_EXE_DEVICE_REBOOT);
 		lwm2m_unregister_callback(node->client,
 						LWM2M_EXE_FIRMWARE_UPDATE);
-	} else if (ARTIK_LWM2M_EVENT_RESOURCE_CHANGED)
+	} else if (!node->callbacks[ARTIK_LWM2M_EVENT_RESOURCE_CHANGED] &&
+		!node->callbacks[ARTIK_LWM2M_EVENT_RESOURCES_CHANGED])
 		lwm2m_unregister_callback(node->client,
 						LWM2M_NOTIFY_RESOURCE_CHANGED);
 
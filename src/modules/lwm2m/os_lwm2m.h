@@ -32,6 +32,12 @@ artik_error os_lwm2m_client_write_resource(artik_lwm2m_handle handle,
 artik_error os_lwm2m_client_read_resource(artik_lwm2m_handle handle,
 		const char *uri, unsigned char *buffer, int *length);
 
+artik_error os_lwm2m_client_write_resources(artik_lwm2m_handle handle,
+		artik_lwm2m_resource_t *resources, int count);
+
+artik_error os_lwm2m_client_read_resources(artik_lwm2m_handle handle,
+		artik_lwm2m_resource_t *resources, int count);
+
 artik_error os_lwm2m_set_callback(artik_lwm2m_handle handle,
 		artik_lwm2m_event_t event, artik_lwm2m_callback user_callback,
 		void *user_data);
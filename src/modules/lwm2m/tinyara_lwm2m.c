@@ -40,6 +40,12 @@ typedef struct {
 	bool quit;
 	pthread_t thread_id;
 	pthread_mutex_t mutex;
+
+	/* Changes reported at the end of the current service cycle */
+	pthread_mutex_t changes_lock;
+	artik_lwm2m_resource_t *changes;
+	int changes_count;
+	int changes_size;
 } lwm2m_node;
 
 typedef struct {
@@ -51,6 +57,61 @@ typedef struct {
 
 static artik_list *nodes = NULL;
 
+static void _lwm2m_free_changes(artik_lwm2m_resource_t *changes, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		free(changes[i].uri);
+		free(changes[i].buffer);
+	}
+}
+
+/*
+ * The queue is taken out under the lock, so that the changes queued
+ * while the callback runs go to the next report.
+ */
+static void _lwm2m_flush_changes(lwm2m_node *node)
+{
+	artik_lwm2m_resources_t list;
+	artik_lwm2m_resource_t *changes;
+	int count, size;
+
+	pthread_mutex_lock(&node->changes_lock);
+	changes = node->changes;
+	count = node->changes_count;
+	size = node->changes_size;
+	if (count) {
+		node->changes = NULL;
+		node->changes_count = 0;
+		node->changes_size = 0;
+	}
+	pthread_mutex_unlock(&node->changes_lock);
+
+	if (!count)
+		return;
+
+	if (node->callbacks[ARTIK_LWM2M_EVENT_RESOURCES_CHANGED]) {
+		list.resources = changes;
+		list.count = count;
+		node->callbacks[ARTIK_LWM2M_EVENT_RESOURCES_CHANGED](&list,
+			node->callbacks_params[
+				ARTIK_LWM2M_EVENT_RESOURCES_CHANGED]);
+	}
+
+	_lwm2m_free_changes(changes, count);
+
+	/* Give the array back for the next cycle unless a new one was made */
+	pthread_mutex_lock(&node->changes_lock);
+	if (!node->changes) {
+		node->changes = changes;
+		node->changes_size = size;
+		changes = NULL;
+	}
+	pthread_mutex_unlock(&node->changes_lock);
+	free(changes);
+}
+
 static void *_lwm2m_service_thread(void *user_data)
 {
 	lwm2m_node *node = (lwm2m_node *)user_data;
@@ -59,6 +120,7 @@ static void *_lwm2m_service_thread(void *user_data)
 	log_dbg("");
 	while (!node->quit) {
 		timeout = lwm2m_client_service(node->client, 100);
+		_lwm2m_flush_changes(node);
 		if (timeout < LWM2M_CLIENT_OK) {
 			if (node->callbacks[ARTIK_LWM2M_EVENT_ERROR]) {
 				artik_error err = (timeout == LWM2M_CLIENT_QUIT)
@@ -75,6 +137,13 @@ static void *_lwm2m_service_thread(void *user_data)
 	}
 
 	lwm2m_client_stop(node->client);
+	pthread_mutex_lock(&node->changes_lock);
+	_lwm2m_free_changes(node->changes, node->changes_count);
+	free(node->changes);
+	node->changes = NULL;
+	node->changes_count = 0;
+	node->changes_size = 0;
+	pthread_mutex_unlock(&node->changes_lock);
 	pthread_exit(0);
 }
 
@@ -151,6 +220,70 @@ static void on_exec_firmware_update(void *user_data, void *extra)
 	}
 }
 
+/*
+ * The changes are reported at once by _lwm2m_flush_changes() once the
+ * library has been serviced. A resource changed several times only gets
+ * its latest value reported. This may run on the service thread or on an
+ * application thread writing a resource with node->mutex held, hence the
+ * separate changes_lock.
+ */
+static void _lwm2m_queue_change(lwm2m_node *node, lwm2m_resource_t *res)
+{
+	artik_lwm2m_resource_t *change = NULL;
+	unsigned char *buffer = NULL;
+	int i;
+
+	if (res->length > 0) {
+		buffer = malloc(res->length);
+		if (!buffer)
+			return;
+		memcpy(buffer, res->buffer, res->length);
+	}
+
+	pthread_mutex_lock(&node->changes_lock);
+
+	for (i = 0; i < node->changes_count; i++) {
+		if (!strcmp(node->changes[i].uri, res->uri)) {
+			change = &node->changes[i];
+			break;
+		}
+	}
+
+	if (change) {
+		free(change->buffer);
+		change->buffer = buffer;
+		change->length = res->length;
+		goto exit;
+	}
+
+	if (node->changes_count == node->changes_size) {
+		int size = node->changes_size ? node->changes_size * 2 : 8;
+		artik_lwm2m_resource_t *changes = realloc(node->changes,
+				size * sizeof(artik_lwm2m_resource_t));
+
+		if (!changes) {
+			free(buffer);
+			goto exit;
+		}
+
+		node->changes = changes;
+		node->changes_size = size;
+	}
+
+	change = &node->changes[node->changes_count];
+	change->uri = strdup(res->uri);
+	if (!change->uri) {
+		free(buffer);
+		goto exit;
+	}
+	change->buffer = buffer;
+	change->length = res->length;
+	node->changes_count++;
+
+exit:
+	pthread_mutex_unlock(&node->changes_lock);
+}
+
 static void on_resource_changed(void *user_data, void *extra)
 {
 	lwm2m_node *node = (lwm2m_node *)user_data;
@@ -158,6 +291,9 @@ static void on_resource_changed(void *user_data, void *extra)
 
 	log_dbg("uri: %s", res->uri);
 
+	if (node->callbacks[ARTIK_LWM2M_EVENT_RESOURCES_CHANGED])
+		_lwm2m_queue_change(node, res);
+
 	if (node->callbacks[ARTIK_LWM2M_EVENT_RESOURCE_CHANGED]) {
 		lwm2m_event_params *params = malloc(sizeof(lwm2m_event_params));
 		artik_lwm2m_resource_t resource;
@@ -253,9 +389,17 @@ artik_error os_lwm2m_client_connect(artik_lwm2m_handle *handle,
 		artik_list_delete_node(&nodes, (artik_list *)node);
 		return E_LWM2M_ERROR;
 	}
+	if (pthread_mutex_init(&node->changes_lock, NULL) != 0) {
+		log_err("Failed to initialize lwm2m mutex");
+		pthread_mutex_destroy(&node->mutex);
+		os_lwm2m_client_disconnect(node->client);
+		artik_list_delete_node(&nodes, (artik_list *)node);
+		return E_LWM2M_ERROR;
+	}
 	if (pthread_attr_init(&thread_attr) != 0) {
 		log_err("Failed to initialize lwm2m thread attribute.");
 		pthread_mutex_destroy(&node->mutex);
+		pthread_mutex_destroy(&node->changes_lock);
 		os_lwm2m_client_disconnect(node);
 		artik_list_delete_node(&nodes, (artik_list *)node);
 		return E_LWM2M_ERROR;
@@ -263,6 +407,7 @@ artik_error os_lwm2m_client_connect(artik_lwm2m_handle *handle,
 	if (pthread_attr_setstacksize(&thread_attr, 8*1024) != 0) {
 		log_err("Failed to set lwm2m thread stack size.");
 		pthread_mutex_destroy(&node->mutex);
+		pthread_mutex_destroy(&node->changes_lock);
 		pthread_attr_destroy(&thread_attr);
 		os_lwm2m_client_disconnect(node);
 		artik_list_delete_node(&nodes, (artik_list *)node);
@@ -272,6 +417,7 @@ artik_error os_lwm2m_client_connect(artik_lwm2m_handle *handle,
 					_lwm2m_service_thread, node) != 0) {
 		log_err("Failed to create lwm2m thread");
 		pthread_mutex_destroy(&node->mutex);
+		pthread_mutex_destroy(&node->changes_lock);
 		pthread_attr_destroy(&thread_attr);
 		os_lwm2m_client_disconnect(node);
 		artik_list_delete_node(&nodes, (artik_list *)node);
@@ -302,6 +448,7 @@ artik_error os_lwm2m_client_disconnect(artik_lwm2m_handle handle)
 	node->quit = 1;
 	pthread_mutex_unlock(&node->mutex);
 	pthread_join(node->thread_id, NULL);
+	pthread_mutex_destroy(&node->changes_lock);
 	artik_list_delete_node(&nodes, (artik_list *)node);
 
 	return S_OK;
@@ -379,6 +526,98 @@ exit:
 	return ret;
 }
 
+artik_error os_lwm2m_client_write_resources(artik_lwm2m_handle handle,
+		artik_lwm2m_resource_t *resources, int count)
+{
+	lwm2m_node *node = (lwm2m_node *)artik_list_get_by_handle(nodes,
+						(ARTIK_LIST_HANDLE) handle);
+	lwm2m_resource_t res;
+	artik_error ret = S_OK;
+	int i;
+
+	log_dbg("%d resources", count);
+
+	if (!node)
+		return E_BAD_ARGS;
+
+	pthread_mutex_lock(&node->mutex);
+
+	for (i = 0; i < count; i++) {
+		if (!resources[i].uri) {
+			ret = (ret == S_OK) ? E_BAD_ARGS : ret;
+			continue;
+		}
+
+		strncpy(res.uri, resources[i].uri, LWM2M_MAX_URI_LEN);
+		res.length = resources[i].length;
+		res.buffer = resources[i].buffer;
+
+		if (lwm2m_write_resource(node->client, &res) !=
+							LWM2M_CLIENT_OK) {
+			log_err("Failed to write resource %s", res.uri);
+			ret = (ret == S_OK) ? E_LWM2M_ERROR : ret;
+		}
+	}
+
+	pthread_mutex_unlock(&node->mutex);
+
+	return ret;
+}
+
+artik_error os_lwm2m_client_read_resources(artik_lwm2m_handle handle,
+		artik_lwm2m_resource_t *resources, int count)
+{
+	lwm2m_node *node = (lwm2m_node *)artik_list_get_by_handle(nodes,
+						(ARTIK_LIST_HANDLE) handle);
+	lwm2m_resource_t res;
+	artik_error ret = S_OK;
+	artik_error err;
+	int i;
+
+	log_dbg("%d resources", count);
+
+	if (!node)
+		return E_BAD_ARGS;
+
+	pthread_mutex_lock(&node->mutex);
+
+	for (i = 0; i < count; i++) {
+		err = S_OK;
+
+		if (!resources[i].uri || !resources[i].buffer ||
+						resources[i].length <= 0) {
+			err = E_BAD_ARGS;
+			goto next;
+		}
+
+		memset(&res, 0, sizeof(res));
+		strncpy(res.uri, resources[i].uri, LWM2M_MAX_URI_LEN);
+
+		if (lwm2m_read_resource(node->client, &res)) {
+			log_err("Failed to read resource %s", res.uri);
+			err = E_LWM2M_ERROR;
+		} else if (res.length > resources[i].length) {
+			log_err("Buffer is too small");
+			err = E_NO_MEM;
+		} else {
+			resources[i].length = res.length;
+			memcpy(resources[i].buffer, res.buffer, res.length);
+		}
+
+		if (res.buffer)
+			free(res.buffer);
+next:
+		if (err != S_OK) {
+			resources[i].length = 0;
+			ret = (ret == S_OK) ? err : ret;
+		}
+	}
+
+	pthread_mutex_unlock(&node->mutex);
+
+	return ret;
+}
+
 artik_error os_lwm2m_set_callback(artik_lwm2m_handle handle,
 		artik_lwm2m_event_t event,
 		artik_lwm2m_callback user_callback, void *user_data)
@@ -407,7 +646,8 @@ artik_error os_lwm2m_set_callback(artik_lwm2m_handle handle,
 				on_exec_firmware_update,
 				(void *)node);
 		pthread_mutex_unlock(&node->mutex);
-	} else if (ARTIK_LWM2M_EVENT_RESOURCE_CHANGED) {
+	} else if (event == ARTIK_LWM2M_EVENT_RESOURCE_CHANGED ||
+			event == ARTIK_LWM2M_EVENT_RESOURCES_CHANGED) {
 		pthread_mutex_lock(&node->mutex);
 		lwm2m_register_callback(node->client,
 				LWM2M_NOTIFY_RESOURCE_CHANGED,
@@ -443,7 +683,8 @@ artik_error os_lwm2m_unset_callback(artik_lwm2m_handle handle,
 		lwm2m_unregister_callback(node->client,
 				LWM2M_EXE_FIRMWARE_UPDATE);
 		pthread_mutex_unlock(&node->mutex);
-	} else if (ARTIK_LWM2M_EVENT_RESOURCE_CHANGED) {
+	} else if (!node->callbacks[ARTIK_LWM2M_EVENT_RESOURCE_CHANGED] &&
+		!node->callbacks[ARTIK_LWM2M_EVENT_RESOURCES_CHANGED]) {
 		pthread_mutex_lock(&node->mutex);
 		lwm2m_unregister_callback(node->client,
 				LWM2M_NOTIFY_RESOURCE_CHANGED);
@@ -395,7 +395,8 @@ void mqtt_destroy_client(artik_mqtt_handle handle_client)
 	if (client) {
 		/* Modify reference fr code structure replace glib begin */
 		/* glib_remove_socket_source(client); */
-		client->loop->remove_fd_watch(client->watch_id);
+		client->loop->remove_fd_watch_from_loop(client->config->loop,
+							client->watch_id);
 		/* Modify reference fr code structure replace glib end */
 		mosquitto_destroy((struct mosquitto *) client->mosq);
 		mosquitto_lib_cleanup();
@@ -629,7 +630,7 @@ int mqtt_connect(artik_mqtt_handle handle_client, const char *host, int port)
 		return -MQTT_ERROR_LIB;
 	}
 
-	client->loop->add_fd_watch(socket_fd,
+	client->loop->add_fd_watch_to_loop(client->config->loop, socket_fd,
 			WATCH_IO_IN | WATCH_IO_ERR | WATCH_IO_HUP |
 			WATCH_IO_NVAL,
 			loop_handler, client, &client->watch_id);
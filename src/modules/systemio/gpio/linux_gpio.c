@@ -308,8 +308,8 @@ artik_error os_gpio_set_change_callback(artik_gpio_config *config,
 		goto exit;
 	}
 
-	ret = data->loop->add_fd_watch(data->fd, WATCH_IO_ERR | WATCH_IO_HUP |
-								WATCH_IO_NVAL,
+	ret = data->loop->add_fd_watch_to_loop(config->loop, data->fd,
+			WATCH_IO_ERR | WATCH_IO_HUP | WATCH_IO_NVAL,
 			os_gpio_change_callback, (void *)data, &data->watch_id);
 	if (ret != S_OK) {
 		log_err("Failed to set fd watch callback");
@@ -341,7 +341,8 @@ void os_gpio_unset_change_callback(artik_gpio_config *config)
 		close(data->fd);
 
 		if (data->loop) {
-			data->loop->remove_fd_watch(data->watch_id);
+			data->loop->remove_fd_watch_from_loop(config->loop,
+							data->watch_id);
 			artik_release_api_module(loop);
 		}
 		memset(data, 0, sizeof(*data));
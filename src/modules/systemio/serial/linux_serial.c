@@ -251,8 +251,8 @@ artik_error os_serial_set_received_callback(artik_serial_config *config,
 		goto exit;
 	}
 
-	ret = data->loop->add_fd_watch(data->fd, WATCH_IO_ERR | WATCH_IO_IN |
-			WATCH_IO_HUP | WATCH_IO_NVAL,
+	ret = data->loop->add_fd_watch_to_loop(config->loop, data->fd,
+			WATCH_IO_ERR | WATCH_IO_IN | WATCH_IO_HUP | WATCH_IO_NVAL,
 			os_serial_change_callback, (void *)data,
 			&data->watch_id);
 	if (ret != S_OK) {
@@ -279,7 +279,8 @@ artik_error os_serial_unset_received_callback(artik_serial_config *config)
 
 	if (data->fd) {
 		if (data->loop) {
-			data->loop->remove_fd_watch(data->watch_id);
+			data->loop->remove_fd_watch_from_loop(config->loop,
+							data->watch_id);
 			artik_release_api_module(loop);
 		}
 		memset(data, 0, sizeof(*data));
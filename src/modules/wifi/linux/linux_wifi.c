@@ -37,6 +37,20 @@
 static bool wifi_initialized = false;
 static bool wifi_connected = false;
 static artik_wifi_mode_t wifi_mode = ARTIK_WIFI_MODE_NONE;
+static artik_wifi_callback connect_callback;
+static void *connect_user_data;
+
+static void on_wifi_connect(void *result, void *user_data)
+{
+	artik_wifi_connection_info *info = result;
+
+	/* The network could not be set up, let the user try again */
+	if (info->error != S_OK)
+		wifi_connected = false;
+
+	if (connect_callback)
+		connect_callback(result, connect_user_data);
+}
 
 artik_error os_wifi_disconnect(void)
 {
@@ -85,6 +99,7 @@ artik_error os_wifi_init(artik_wifi_mode_t mode)
 	if (ret != WIFI_SUCCESS)
 		return E_WIFI_ERROR;
 
+	wifi_set_connect_callback(on_wifi_connect, NULL);
 	wifi_initialized = true;
 
 	wifi_mode = mode;
@@ -206,14 +221,17 @@ artik_error os_wifi_get_scan_result(artik_wifi_ap **aps, int *num_aps)
 	if (ret != WIFI_SUCCESS)
 		return E_WIFI_ERROR;
 
-	if (!bssinfo || !bssinfo->bss_count)
+	if (!bssinfo->bss_count) {
+		wifi_free_bssinfo(bssinfo);
 		return E_WIFI_ERROR;
+	}
 
-	*num_aps = bssinfo->bss_count;
 	result = malloc(bssinfo->bss_count * sizeof(artik_wifi_ap));
-
-	if (!result)
+	if (!result) {
+		wifi_free_bssinfo(bssinfo);
 		return E_NO_MEM;
+	}
+	*num_aps = bssinfo->bss_count;
 
 	for (i = 0; i < bssinfo->bss_count; i++) {
 		snprintf(result[i].name, MAX_AP_NAME_LEN, "%s",
@@ -259,10 +277,7 @@ artik_error os_wifi_get_scan_result(artik_wifi_ap **aps, int *num_aps)
 		}
 	}
 
-	if (bssinfo) {
-		free(bssinfo);
-		bssinfo = NULL;
-	}
+	wifi_free_bssinfo(bssinfo);
 
 	*aps = result;
 
@@ -292,7 +307,9 @@ artik_error os_wifi_connect(const char *ssid, const char *password,
 artik_error os_wifi_set_connect_callback(artik_wifi_callback user_callback,
 					void *user_data)
 {
-	wifi_set_connect_callback(user_callback, user_data);
+	connect_callback = user_callback;
+	connect_user_data = user_data;
+	wifi_set_connect_callback(on_wifi_connect, NULL);
 
 	return S_OK;
 }
@@ -307,7 +324,8 @@ artik_error os_wifi_set_scan_result_callback(artik_wifi_callback user_callback,
 
 artik_error os_wifi_unset_connect_callback(void)
 {
-	wifi_unset_connect_callback();
+	connect_callback = NULL;
+	connect_user_data = NULL;
 
 	return S_OK;
 }
@@ -41,18 +41,52 @@ static pthread_mutex_t mutex;
 static struct wpa_ctrl *ctrl_conn;
 static const char *ctrl_ifname;
 
-static int _wifi_get_bss_count(char *bsslist, size_t len)
-{
-	int bss_count = 0;
-	int idx = 0;
-
-	while ((size_t)idx++ < len) {
-		if (bsslist[idx] == '\n')
-			bss_count++;
-	}
+#define WIFI_REPLY_SIZE		4096
+#define WIFI_BSS_TABLE_MIN	16
+/* Only the fields of wifi_scan_bss, with a delimiter after each BSS */
+#define WIFI_BSS_MASK		(WPA_BSS_MASK_ID | WPA_BSS_MASK_BSSID | \
+				 WPA_BSS_MASK_FREQ | WPA_BSS_MASK_LEVEL | \
+				 WPA_BSS_MASK_FLAGS | WPA_BSS_MASK_SSID | \
+				 WPA_BSS_MASK_DELIM)
+
+struct wifi_bss_entry {
+	unsigned int id;
+	wifi_scan_bss bss;
+};
 
-	return bss_count - 1;
-}
+/*
+ * Scan results cached in wpa_supplicant BSS id order. BSS-REMOVED events
+ * are applied directly, BSS-ADDED and SCAN-RESULTS mark the table stale
+ * until the next "BSS RANGE=" fetch.
+ */
+static struct {
+	struct wifi_bss_entry *entries;
+	int count;
+	int size;
+	int stale;
+	unsigned int generation;
+	int fetching;
+	unsigned int fetch_next;
+	unsigned int fetch_generation;
+} bss_table;
+
+enum wifi_connect_step {
+	WIFI_CONNECT_LIST_NETWORKS,
+	WIFI_CONNECT_ADD_NETWORK,
+	WIFI_CONNECT_SET_SSID,
+	WIFI_CONNECT_SET_KEY,
+	WIFI_CONNECT_SELECT_NETWORK,
+	WIFI_CONNECT_SAVE_CONFIG,
+	WIFI_CONNECT_DONE
+};
+
+struct wifi_connect_req {
+	enum wifi_connect_step step;
+	int netid;
+	int save_profile;
+	char ssid[SSID_LENGTH + 1];
+	char psk[PASSPHRASE_MAX_LEN + 1];
+};
 
 void wifi_set_scan_result_callback(wifi_scan_result_callback callback,
 					void *user_data)
@@ -115,129 +149,316 @@ int wifi_scan_request(void)
 	return ret;
 }
 
-static void _atomac(char *str_mac, macaddr *mac)
+/* Bounded lookup, the flags are parsed in place and not nul terminated */
+static int _wifi_flag_has(const char *flags, size_t len, const char *token)
 {
-	int i = 0;
-	char *pos = str_mac;
+	size_t tlen = os_strlen(token);
 
-	mac[i] = strtol(strtok(pos, ":"), NULL, 16);
+	for (; len >= tlen; flags++, len--) {
+		if (!os_memcmp(flags, token, tlen))
+			return 1;
+	}
 
-	for (i = 1; i < MAC_ADDR_FIELD; i++)
-		mac[i] = strtol(strtok(NULL, ":"), NULL, 16);
+	return 0;
 }
 
-static int _wifi_set_security_mode(char *chflag, wifi_scan_bss *bss)
+static void _wifi_set_security_mode(const char *flags, size_t len,
+					wifi_scan_bss *bss)
 {
-	int ret = WIFI_ERROR;
-	char *start = NULL, *end = NULL;
-	char *strflag = NULL;
-	int len = 0;
-
-
-	start = chflag;
-	while (*chflag != '\t')
-		chflag++;
-	end = chflag;
-
-	len = (end - start) + 1;
-	strflag = os_malloc(len);
-	os_memset(strflag, 0, len);
-
-	os_strlcpy(strflag, start, len - 1);
-
 	/* authentication flags */
-	if (os_strstr(strflag, "WPA2"))	{
-		if (os_strstr(strflag, "PSK"))
+	if (_wifi_flag_has(flags, len, "WPA2")) {
+		if (_wifi_flag_has(flags, len, "PSK"))
 			bss->auth = WIFI_SECURITY_MODE_AUTH_WPA2_PSK;
-		else if (os_strstr(strflag, "EAP"))
+		else if (_wifi_flag_has(flags, len, "EAP"))
 			bss->auth = WIFI_SECURITY_MODE_AUTH_WPA2_EAP;
-	} else if (os_strstr(strflag, "WPA")) {
-		if (os_strstr(strflag, "PSK"))
+	} else if (_wifi_flag_has(flags, len, "WPA")) {
+		if (_wifi_flag_has(flags, len, "PSK"))
 			bss->auth = WIFI_SECURITY_MODE_AUTH_WPA_PSK;
-		else if (os_strstr(strflag, "EAP"))
+		else if (_wifi_flag_has(flags, len, "EAP"))
 			bss->auth = WIFI_SECURITY_MODE_AUTH_WPA_EAP;
 	} else
 		bss->auth = WIFI_SECURITY_MODE_AUTH_OPEN;
 
 	/* encryption flags */
-	if (os_strstr(strflag, "CCMP"))
+	if (_wifi_flag_has(flags, len, "CCMP"))
 		bss->encrypt = WIFI_SECURITY_MODE_ENCRYPT_CCMP;
-	else if (os_strstr(strflag, "TKIP"))
+	else if (_wifi_flag_has(flags, len, "TKIP"))
 		bss->encrypt = WIFI_SECURITY_MODE_ENCRYPT_TKIP;
-	else if (os_strstr(strflag, "WEP"))
+	else if (_wifi_flag_has(flags, len, "WEP"))
 		bss->encrypt = WIFI_SECURITY_MODE_ENCRYPT_WEP;
 
 	/* WPS flags */
-	if (os_strstr(strflag, "WPS"))
+	if (_wifi_flag_has(flags, len, "WPS"))
 		bss->wps = WIFI_SECURITY_MODE_WPS_ON;
+}
 
-	os_free(strflag);
-	return ret;
+/* Index of the first cached BSS whose id is not below id */
+static int _wifi_bss_lower_bound(unsigned int id)
+{
+	int lo = 0, hi = bss_table.count;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (bss_table.entries[mid].id < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
 }
 
-int wifi_get_scan_result(wifi_scan_bssinfo **bssinfo)
+static void _wifi_bss_remove(int from, int to)
 {
-	int ret = WIFI_ERROR;
-	char *pos, *securityflag;
-	size_t len = 8192;
-	char buf[8192];
-	wifi_scan_bss *bss = NULL;
-	int eol;
-	int i;
+	if (to <= from)
+		return;
 
-	if (*bssinfo)
+	os_memmove(&bss_table.entries[from], &bss_table.entries[to],
+		(bss_table.count - to) * sizeof(struct wifi_bss_entry));
+	bss_table.count -= to - from;
+}
+
+/*
+ * Store entry at idx, where the fetch currently stands. Cached entries
+ * it skips over are no longer known to wpa_supplicant. Returns the index
+ * the fetch moves on to.
+ */
+static int _wifi_bss_store(int idx, const struct wifi_bss_entry *entry)
+{
+	int end = idx;
+
+	while (end < bss_table.count && bss_table.entries[end].id < entry->id)
+		end++;
+	_wifi_bss_remove(idx, end);
+
+	if (idx < bss_table.count && bss_table.entries[idx].id == entry->id) {
+		bss_table.entries[idx] = *entry;
+		return idx + 1;
+	}
+
+	if (bss_table.count == bss_table.size) {
+		int size = bss_table.size ? bss_table.size * 2 :
+							WIFI_BSS_TABLE_MIN;
+		struct wifi_bss_entry *entries;
+
+		entries = os_realloc_array(bss_table.entries, size,
+						sizeof(*entries));
+		if (!entries) {
+			log_err("Failed to grow the BSS table");
+			return idx;
+		}
+		bss_table.entries = entries;
+		bss_table.size = size;
+	}
+
+	os_memmove(&bss_table.entries[idx + 1], &bss_table.entries[idx],
+		(bss_table.count - idx) * sizeof(struct wifi_bss_entry));
+	bss_table.entries[idx] = *entry;
+	bss_table.count++;
+
+	return idx + 1;
+}
+
+/*
+ * Merge the reply to "BSS RANGE=<first>-" into the table, parsing it in
+ * place. wpa_supplicant only returns whole entries and ends the last BSS
+ * it knows with "####" instead of "====". Returns 1 with the id to go on
+ * from in next when the reply was cut short, 0 once the table is complete.
+ */
+static int _wifi_bss_merge(unsigned int first, const char *reply, size_t len,
+				unsigned int *next)
+{
+	const char *pos = reply;
+	const char *end = reply + len;
+	const char *eol;
+	struct wifi_bss_entry entry;
+	int idx = _wifi_bss_lower_bound(first);
+	int has_entry = 0;
+	int more = 0;
+
+	os_memset(&entry, 0, sizeof(entry));
+
+	for (; pos < end && (eol = memchr(pos, '\n', end - pos));
+							pos = eol + 1) {
+		if (str_starts(pos, "====") || str_starts(pos, "####")) {
+			if (!has_entry)
+				continue;
+
+			idx = _wifi_bss_store(idx, &entry);
+			*next = entry.id + 1;
+			more = (*pos == '=');
+
+			os_memset(&entry, 0, sizeof(entry));
+			has_entry = 0;
+		} else if (str_starts(pos, "id=")) {
+			entry.id = strtoul(pos + 3, NULL, 10);
+			has_entry = 1;
+		} else if (str_starts(pos, "bssid=")) {
+			hwaddr_aton(pos + 6, entry.bss.bssid);
+		} else if (str_starts(pos, "freq=")) {
+			entry.bss.freq = atoi(pos + 5);
+		} else if (str_starts(pos, "level=")) {
+			entry.bss.rssi = atoi(pos + 6);
+		} else if (str_starts(pos, "flags=")) {
+			_wifi_set_security_mode(pos + 6, eol - pos - 6,
+								&entry.bss);
+		} else if (str_starts(pos, "ssid=")) {
+			size_t ssid_len = eol - pos - 5;
+
+			if (ssid_len > SSID_LENGTH - 1)
+				ssid_len = SSID_LENGTH - 1;
+			os_memcpy(entry.bss.ssid, pos + 5, ssid_len);
+		}
+	}
+
+	/* Nothing is left past the last BSS returned */
+	if (!more)
+		bss_table.count = idx;
+
+	return more;
+}
+
+/* Synchronous fetch, for results read before the cache caught up */
+static int _wifi_bss_refresh(void)
+{
+	unsigned int generation = bss_table.generation;
+	unsigned int first = 0;
+	char cmd[64];
+	char *buf;
+	size_t len;
+	int ret;
+
+	buf = os_malloc(WIFI_REPLY_SIZE);
+	if (!buf)
 		return WIFI_ERROR;
 
-	os_memset(buf, 0, len);
+	do {
+		os_snprintf(cmd, sizeof(cmd), "BSS RANGE=%u- MASK=0x%x",
+							first, WIFI_BSS_MASK);
+		len = WIFI_REPLY_SIZE - 1;
+		ret = _wifi_send_cmd(ctrl_conn, cmd, buf, &len);
+		if (ret != WIFI_SUCCESS)
+			break;
+		buf[len] = '\0';
+	} while (_wifi_bss_merge(first, buf, len, &first));
 
-	ret = _wifi_send_cmd(ctrl_conn, "SCAN_RESULTS", buf, &len);
-	if (ret != WIFI_SUCCESS)
-		return ret;
+	os_free(buf);
 
+	if (ret == WIFI_SUCCESS && generation == bss_table.generation)
+		bss_table.stale = 0;
 
-	*bssinfo = os_malloc(sizeof(wifi_scan_bssinfo));
-	os_memset(*bssinfo, 0, sizeof(wifi_scan_bssinfo));
+	return ret;
+}
+
+static void _wifi_bss_fetch_reply(int result, const char *reply, size_t len,
+					void *user_data);
+
+static int _wifi_bss_fetch_send(void)
+{
+	char cmd[64];
 
-	pos = buf;
-	(*bssinfo)->bss_count = _wifi_get_bss_count(pos, len);
+	os_snprintf(cmd, sizeof(cmd), "BSS RANGE=%u- MASK=0x%x",
+					bss_table.fetch_next, WIFI_BSS_MASK);
 
-	pos = os_strstr(pos, "\n");
+	return wpa_cli_request_async(cmd, _wifi_bss_fetch_reply, NULL);
+}
 
-	if (!pos || !(pos + 1))
-		return WIFI_ERROR_NO_AVAILABLE_NETWORK_LIST;
+static void _wifi_bss_fetch_start(void)
+{
+	bss_table.fetching = 1;
+	bss_table.fetch_next = 0;
+	bss_table.fetch_generation = bss_table.generation;
 
-	pos++;
+	if (_wifi_bss_fetch_send() != WIFI_SUCCESS) {
+		bss_table.fetching = 0;
+		wpa_cli_notify_scan_result(E_WIFI_ERROR);
+	}
+}
 
-	bss = os_malloc((*bssinfo)->bss_count * sizeof(wifi_scan_bss));
-	os_memset(bss, 0, (*bssinfo)->bss_count * sizeof(wifi_scan_bss));
+static void _wifi_bss_fetch_reply(int result, const char *reply, size_t len,
+					void *user_data)
+{
+	if (result == WIFI_SUCCESS && _wifi_bss_merge(bss_table.fetch_next,
+				reply, len, &bss_table.fetch_next)) {
+		result = _wifi_bss_fetch_send();
+		if (result == WIFI_SUCCESS)
+			return;
+	}
 
-	for (i = 0; i < (*bssinfo)->bss_count; i++) {
-		_atomac(strtok(pos, "\t"), bss[i].bssid);
-		pos += 18;
+	bss_table.fetching = 0;
 
-		bss[i].freq = atoi(pos);
-		while (*pos != '\t')
-			pos++;
-		pos++;
+	if (result != WIFI_SUCCESS) {
+		log_err("Failed to fetch the scan results");
+		wpa_cli_notify_scan_result(E_WIFI_ERROR);
+		return;
+	}
 
-		bss[i].rssi = atoi(pos);
-		while (*pos != '\t')
-			pos++;
+	/* Another scan completed meanwhile, go over the table again */
+	if (bss_table.generation != bss_table.fetch_generation) {
+		_wifi_bss_fetch_start();
+		return;
+	}
 
-		pos++;
-		securityflag = pos;
-		_wifi_set_security_mode(securityflag, &(bss[i]));
+	bss_table.stale = 0;
+	wpa_cli_notify_scan_result(S_OK);
+}
 
-		while (*pos != '\t')
-			pos++;
-		pos++;
-		eol = os_strstr(pos, "\n") - pos;
-		if (eol < 0)
-			break;
-		strncpy(bss[i].ssid, pos, eol);
-		bss[i].ssid[eol] = '\0';
-		pos += eol + 1;
+static void _wifi_bss_event(enum wpa_cli_bss_event event, unsigned int id)
+{
+	int idx;
+
+	switch (event) {
+	case WPA_CLI_BSS_REMOVED:
+		idx = _wifi_bss_lower_bound(id);
+		if (idx < bss_table.count && bss_table.entries[idx].id == id)
+			_wifi_bss_remove(idx, idx + 1);
+		break;
+	case WPA_CLI_BSS_ADDED:
+		bss_table.stale = 1;
+		bss_table.generation++;
+		break;
+	case WPA_CLI_SCAN_RESULTS:
+		bss_table.stale = 1;
+		bss_table.generation++;
+		/* Have the results at hand before telling the user */
+		if (get_active_scan() && !bss_table.fetching)
+			_wifi_bss_fetch_start();
+		break;
+	}
+}
+
+int wifi_get_scan_result(wifi_scan_bssinfo **bssinfo)
+{
+	wifi_scan_bss *bss = NULL;
+	int ret;
+	int i;
+
+	if (*bssinfo)
+		return WIFI_ERROR;
+
+	if (bss_table.stale) {
+		ret = _wifi_bss_refresh();
+		if (ret != WIFI_SUCCESS)
+			return ret;
+	}
+
+	if (bss_table.count) {
+		bss = os_malloc(bss_table.count * sizeof(wifi_scan_bss));
+		if (!bss)
+			return WIFI_ERROR;
+
+		for (i = 0; i < bss_table.count; i++)
+			bss[i] = bss_table.entries[i].bss;
 	}
+
+	*bssinfo = os_malloc(sizeof(wifi_scan_bssinfo));
+	if (!*bssinfo) {
+		os_free(bss);
+		return WIFI_ERROR;
+	}
+
+	(*bssinfo)->bss_count = bss_table.count;
 	(*bssinfo)->bss_list = bss;
 
 	return WIFI_SUCCESS;
@@ -259,134 +480,159 @@ freeinfo:
 	os_free(bssinfo);
 }
 
-int wifi_connect(const char *ssid, const char *psk, int save_profile)
+/* Network id of ssid in a LIST_NETWORKS reply, -1 if it is not there */
+static int _wifi_find_network(const char *list, size_t len, const char *ssid)
 {
-	int ret = WIFI_ERROR;
-	char cmd[100];
-	char *buf = NULL;
-	size_t len = 4096;
-	char *pos, *netid_idx;
-	int netid = 0;
-	int netid_len = 0;
-	char strnid[5] = "\0";
-
-	if (!ssid || (os_strlen(ssid) == 0) || (os_strchr(ssid, ' ')))
-		return WIFI_ERROR_CONNECT_INVALID_SSID;
-
-	if (psk && ((os_strlen(psk) < 8) || (os_strchr(psk, ' '))))
-		return WIFI_ERROR_CONNECT_INVALID_PSK;
-
-	buf = os_malloc(len);
-	os_memset(buf, 0, len);
-	os_memset(cmd, 0, 100);
-
-	if (!buf)
-		return WIFI_ERROR;
+	const char *end = list + len;
+	const char *pos, *eol, *tab;
+	size_t ssid_len = os_strlen(ssid);
+
+	/* Skip the header line */
+	pos = memchr(list, '\n', len);
+	if (!pos)
+		return -1;
+
+	for (pos++; pos < end && (eol = memchr(pos, '\n', end - pos));
+							pos = eol + 1) {
+		tab = memchr(pos, '\t', eol - pos);
+		if (!tab)
+			continue;
+
+		tab++;
+		if ((size_t)(eol - tab) > ssid_len &&
+		    tab[ssid_len] == '\t' && !os_memcmp(tab, ssid, ssid_len))
+			return atoi(pos);
+	}
 
+	return -1;
+}
 
-	ret = _wifi_send_cmd(ctrl_conn, "LIST_NETWORKS", buf, &len);
+static int _wifi_connect_send(struct wifi_connect_req *req);
 
-	if (ret != WIFI_SUCCESS) {
-		os_free(buf);
-		return ret;
+static void _wifi_connect_reply(int result, const char *reply, size_t len,
+					void *user_data)
+{
+	struct wifi_connect_req *req = user_data;
+
+	if (result != WIFI_SUCCESS)
+		goto error;
+
+	switch (req->step) {
+	case WIFI_CONNECT_LIST_NETWORKS:
+		/* if SSID exists, reconfigure it. */
+		req->netid = _wifi_find_network(reply, len, req->ssid);
+		req->step = (req->netid < 0) ? WIFI_CONNECT_ADD_NETWORK :
+							WIFI_CONNECT_SET_SSID;
+		break;
+	case WIFI_CONNECT_ADD_NETWORK:
+		if (str_starts(reply, "FAIL"))
+			goto error;
+		req->netid = atoi(reply);
+		req->step = WIFI_CONNECT_SET_SSID;
+		break;
+	case WIFI_CONNECT_SET_SSID:
+	case WIFI_CONNECT_SET_KEY:
+		if (!str_starts(reply, "OK"))
+			goto error;
+		req->step++;
+		break;
+	case WIFI_CONNECT_SELECT_NETWORK:
+		if (!str_starts(reply, "OK"))
+			goto error;
+		req->step = req->save_profile ? WIFI_CONNECT_SAVE_CONFIG :
+							WIFI_CONNECT_DONE;
+		break;
+	case WIFI_CONNECT_SAVE_CONFIG:
+		if (!str_starts(reply, "OK"))
+			goto error;
+		req->step = WIFI_CONNECT_DONE;
+		break;
+	default:
+		goto error;
 	}
 
-	pos = NULL;
-	/* if SSID exists, reconfigure it. */
-	pos = os_strstr(buf, ssid);
-	if (pos) {
-		while (*pos != '\n')
-			--pos;
-		netid_idx = pos + 1;
-
-		while (*pos != '\t') {
-			netid_len++;
-			pos++;
-		}
-
-		strncpy(strnid, netid_idx, netid_len - 1);
-		netid = atoi(strnid);
-	} else {
-		ret = _wifi_send_cmd(ctrl_conn, "ADD_NETWORK", buf, &len);
-		if (ret != WIFI_SUCCESS) {
-			os_free(buf);
-			return ret;
-		}
-
-		netid = atoi(buf);
+	/* The association itself is reported by CTRL-EVENT-CONNECTED */
+	if (req->step == WIFI_CONNECT_DONE) {
+		os_free(req);
+		return;
 	}
 
-	sprintf(cmd, "SET_NETWORK %d ssid \"%s\"", netid, ssid);
-	ret = _wifi_send_cmd(ctrl_conn, cmd, buf, &len);
+	result = _wifi_connect_send(req);
+	if (result == WIFI_SUCCESS)
+		return;
 
-	if (ret != WIFI_SUCCESS) {
-		os_free(buf);
-		return ret;
-	}
+error:
+	log_err("Failed to set up network \"%s\" at step %d: %s", req->ssid,
+		req->step, reply ? reply : "no reply");
+	os_free(req);
+	wpa_cli_notify_connect(false, E_WIFI_ERROR);
+}
 
-	if (!str_starts(buf, "OK")) {
-		log_err("%s: %s", cmd, buf);
-		os_free(buf);
+static int _wifi_connect_send(struct wifi_connect_req *req)
+{
+	char cmd[128];
+
+	switch (req->step) {
+	case WIFI_CONNECT_LIST_NETWORKS:
+		os_strlcpy(cmd, "LIST_NETWORKS", sizeof(cmd));
+		break;
+	case WIFI_CONNECT_ADD_NETWORK:
+		os_strlcpy(cmd, "ADD_NETWORK", sizeof(cmd));
+		break;
+	case WIFI_CONNECT_SET_SSID:
+		os_snprintf(cmd, sizeof(cmd), "SET_NETWORK %d ssid \"%s\"",
+						req->netid, req->ssid);
+		break;
+	case WIFI_CONNECT_SET_KEY:
+		if (req->psk[0])
+			os_snprintf(cmd, sizeof(cmd),
+				"SET_NETWORK %d psk \"%s\"", req->netid,
+				req->psk);
+		else
+			os_snprintf(cmd, sizeof(cmd),
+				"SET_NETWORK %d key_mgmt NONE", req->netid);
+		break;
+	case WIFI_CONNECT_SELECT_NETWORK:
+		os_snprintf(cmd, sizeof(cmd), "SELECT_NETWORK %d", req->netid);
+		break;
+	case WIFI_CONNECT_SAVE_CONFIG:
+		os_strlcpy(cmd, "SAVE_CONFIG", sizeof(cmd));
+		break;
+	default:
 		return WIFI_ERROR;
 	}
 
-	if (psk && os_strlen(psk)) {
-		sprintf(cmd, "SET_NETWORK %d psk \"%s\"", netid, psk);
-		ret = _wifi_send_cmd(ctrl_conn, cmd, buf, &len);
-		if (ret != WIFI_SUCCESS) {
-			os_free(buf);
-			return ret;
-		}
+	return wpa_cli_request_async(cmd, _wifi_connect_reply, req);
+}
 
-		if (!str_starts(buf, "OK")) {
-			log_err("%s: %s", cmd, buf);
-			os_free(buf);
-			return WIFI_ERROR;
-		}
-	} else {
-		os_memset(cmd, 0, 100);
-		sprintf(cmd, "SET_NETWORK %d key_mgmt %s", netid, "NONE");
-		ret = _wifi_send_cmd(ctrl_conn, cmd, buf, &len);
-		if (ret != WIFI_SUCCESS) {
-			os_free(buf);
-			return ret;
-		}
-		if (!str_starts(buf, "OK")) {
-			log_err("%s: %s", cmd, buf);
-			os_free(buf);
-			return WIFI_ERROR;
-		}
-	}
+int wifi_connect(const char *ssid, const char *psk, int save_profile)
+{
+	struct wifi_connect_req *req;
+	int ret;
 
-	os_memset(cmd, 0, 100);
-	sprintf(cmd, "SELECT_NETWORK %d", netid);
-	ret = _wifi_send_cmd(ctrl_conn, cmd, buf, &len);
-	if (ret != WIFI_SUCCESS) {
-		os_free(buf);
-		return ret;
-	}
-	if (!str_starts(buf, "OK")) {
-		log_err("%s: %s", cmd, buf);
-		os_free(buf);
+	if (!ssid || (os_strlen(ssid) == 0) ||
+	    (os_strlen(ssid) > SSID_LENGTH) || (os_strchr(ssid, ' ')))
+		return WIFI_ERROR_CONNECT_INVALID_SSID;
+
+	if (psk && ((os_strlen(psk) < PASSPHRASE_MIN_LEN) ||
+		    (os_strlen(psk) > PASSPHRASE_MAX_LEN) ||
+		    (os_strchr(psk, ' '))))
+		return WIFI_ERROR_CONNECT_INVALID_PSK;
+
+	req = os_zalloc(sizeof(*req));
+	if (!req)
 		return WIFI_ERROR;
-	}
 
-	if (save_profile) {
-		os_memset(cmd, 0, 100);
-		sprintf(cmd, "SAVE_CONFIG");
-		ret = _wifi_send_cmd(ctrl_conn, cmd, buf, &len);
-		if (ret != WIFI_SUCCESS) {
-			os_free(buf);
-			return ret;
-		}
-		if (!str_starts(buf, "OK")) {
-			log_err("%s: %s", cmd, buf);
-			os_free(buf);
-			return WIFI_ERROR;
-		}
-	}
+	os_strlcpy(req->ssid, ssid, sizeof(req->ssid));
+	if (psk)
+		os_strlcpy(req->psk, psk, sizeof(req->psk));
+	req->save_profile = save_profile;
+	req->step = WIFI_CONNECT_LIST_NETWORKS;
 
-	os_free(buf);
+	/* Failures from here on are reported through the connect callback */
+	ret = _wifi_connect_send(req);
+	if (ret != WIFI_SUCCESS)
+		os_free(req);
 
 	return ret;
 }
@@ -434,6 +680,8 @@ int wifi_initialize(void)
 		return WIFI_ERROR_CONNECT_SOCKET;
 
 	set_active_scan(0);
+	bss_table.stale = 1;
+	set_bss_event_callback(_wifi_bss_event);
 
 #ifndef CONFIG_ELOOP_GMAINLOOP
 	pthread_mutex_init(&mutex, NULL);
@@ -453,6 +701,10 @@ void wifi_deinitialize(void)
 	}
 
 	wpa_cli_close_connection();
+	set_bss_event_callback(NULL);
+
+	os_free(bss_table.entries);
+	os_memset(&bss_table, 0, sizeof(bss_table));
 
 #ifndef CONFIG_ELOOP_GMAINLOOP
 	eloop_terminate();
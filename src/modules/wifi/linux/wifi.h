@@ -202,6 +202,9 @@ int wifi_scan_request(void);
  *			when the function succeeds. The memory should be
  *			released by calling wlan_free_bssinfo() after
  *			the pointer is no longer needed.
+ * @remark	Results are served from a cache kept up to date by
+ *		wpa_supplicant events, it is only fetched again when a
+ *		scan completed since the last read.
  * @return	int
  * @see		struct wifi_scan_bssinfo
  * @see		enum wifi_result
@@ -224,6 +227,8 @@ void wifi_free_bssinfo(wifi_scan_bssinfo *bssinfo);
  * @param[in]	psk password of access point. NULL for Open authentication.
  * @param[in]	save_profile a flag to save profile for auto connection after
  *              boot.
+ * @remark	The network is set up asynchronously, a failure past the
+ *		argument checks is reported through the connect callback.
  * @return	int
  * @see		enum wifi_result
  */
@@ -182,10 +182,20 @@ int eloop_init(void)
 #ifdef CONFIG_ELOOP_GMAINLOOP
 int on_watch(int fd, enum watch_io io, void *user_data)
 {
-	struct eloop_sock *item = user_data;
+	struct eloop_sock_table *table = user_data;
+	struct eloop_sock *item = NULL;
+	int i;
 
 	log_dbg("fd:%d, io event: %d", fd, io);
 
+	/* The table moves when sockets are added, look the item up by fd */
+	for (i = 0; i < table->count; i++) {
+		if (table->table[i].sock == fd) {
+			item = &table->table[i];
+			break;
+		}
+	}
+
 	if (item && item->handler)
 		item->handler(item->sock, item->eloop_data, item->user_data);
 	else
@@ -281,7 +291,7 @@ static int eloop_sock_table_add_sock(struct eloop_sock_table *table, int sock,
 	log_dbg("add watch: fd=%d", sock);
 	loop->add_fd_watch(sock, WATCH_IO_IN | WATCH_IO_ERR | WATCH_IO_HUP |
 			WATCH_IO_NVAL, on_watch,
-			tmp+table->count, &tmp[table->count].watch_id);
+			table, &tmp[table->count].watch_id);
 #endif
 
 	tmp[table->count].sock = sock;
@@ -26,19 +26,49 @@
 #include "common.h"
 #include "eloop.h"
 #include "wpa_ctrl.h"
+#include "list.h"
 
 #include <artik_log.h>
 #include <artik_wifi.h>
+#ifdef CONFIG_ELOOP_GMAINLOOP
+#include <artik_module.h>
+#include <artik_loop.h>
+#endif
+
+#define WPA_CLI_REPLY_SIZE	4096
+#define WPA_CLI_CMD_TIMEOUT	10000
 
 static const char *ctrl_iface_dir = "/var/run/wpa_supplicant";
 static const char *client_socket_dir = NULL;
 static int wpa_cli_attached = 0;
 
 static const char *ctrl_ifname;
+static char *ctrl_path;
 static struct wpa_ctrl *ctrl_conn = NULL;
 static struct wpa_ctrl *mon_conn = NULL;
 static int active_scan;
 
+/*
+ * Commands sent with wpa_cli_request_async() go through their own
+ * connection, one at a time since replies carry no identifier.
+ */
+struct wpa_cli_cmd {
+	struct dl_list list;
+	wpa_cli_cmd_callback callback;
+	void *user_data;
+	char cmd[];
+};
+
+static struct wpa_ctrl *cmd_conn = NULL;
+static struct dl_list cmd_queue = DL_LIST_HEAD_INIT(cmd_queue);
+static int cmd_in_flight;
+#ifdef CONFIG_ELOOP_GMAINLOOP
+static artik_loop_module *loop;
+static int cmd_timeout_id;
+#endif
+
+static wpa_cli_bss_callback bss_event_cb;
+
 /**
  * @typedef	wifi_callbacks
  * @brief	a set of wifi callback
@@ -62,6 +92,11 @@ void set_active_scan(const int n)
 	active_scan = n;
 }
 
+int get_active_scan(void)
+{
+	return active_scan;
+}
+
 void set_ctrl_ifname(const char *ifname)
 {
 	ctrl_ifname = ifname;
@@ -83,8 +118,37 @@ void set_connect_callback(
 	wifi_cb.connect_user_data = user_data;
 }
 
+void set_bss_event_callback(wpa_cli_bss_callback callback)
+{
+	bss_event_cb = callback;
+}
+
+void wpa_cli_notify_scan_result(artik_error err)
+{
+	if (!active_scan)
+		return;
+
+	active_scan = 0;
+	if (wifi_cb.scan_result_callback)
+		wifi_cb.scan_result_callback(&err,
+			wifi_cb.scan_result_user_data);
+}
+
+void wpa_cli_notify_connect(bool connected, artik_error err)
+{
+	artik_wifi_connection_info info;
+
+	if (!wifi_cb.connect_callback)
+		return;
+
+	info.connected = connected;
+	info.error = err;
+	wifi_cb.connect_callback((void *)&info, wifi_cb.connect_user_data);
+}
+
 
 static void wpa_cli_mon_receive(int sock, void *eloop_ctx, void *sock_ctx);
+static void wpa_cli_cmd_receive(int sock, void *eloop_ctx, void *sock_ctx);
 
 void wpa_cli_terminate(int sig, void *ctx)
 {
@@ -93,6 +157,181 @@ void wpa_cli_terminate(int sig, void *ctx)
 #endif
 }
 
+/* Pop the head of the queue and hand its reply over */
+static void wpa_cli_cmd_complete(int result, const char *reply, size_t len)
+{
+	struct wpa_cli_cmd *cmd;
+
+	cmd = dl_list_first(&cmd_queue, struct wpa_cli_cmd, list);
+	if (!cmd)
+		return;
+
+	dl_list_del(&cmd->list);
+	cmd_in_flight = 0;
+#ifdef CONFIG_ELOOP_GMAINLOOP
+	if (cmd_timeout_id) {
+		loop->remove_timeout_callback(cmd_timeout_id);
+		cmd_timeout_id = 0;
+	}
+#endif
+
+	if (cmd->callback)
+		cmd->callback(result, reply, len, cmd->user_data);
+	os_free(cmd);
+}
+
+static void wpa_cli_cmd_close(void)
+{
+	if (!cmd_conn)
+		return;
+
+	eloop_unregister_read_sock(wpa_ctrl_get_fd(cmd_conn));
+	wpa_ctrl_close(cmd_conn);
+	cmd_conn = NULL;
+}
+
+static int wpa_cli_cmd_open(void)
+{
+	cmd_conn = wpa_ctrl_open2(ctrl_path, client_socket_dir);
+	if (!cmd_conn)
+		return -1;
+
+	if (eloop_register_read_sock(wpa_ctrl_get_fd(cmd_conn),
+					wpa_cli_cmd_receive, NULL, NULL)) {
+		wpa_ctrl_close(cmd_conn);
+		cmd_conn = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_ELOOP_GMAINLOOP
+static void wpa_cli_cmd_send(void);
+
+static void wpa_cli_cmd_timeout(void *user_data)
+{
+	cmd_timeout_id = 0;
+
+	/*
+	 * A late reply would be taken for the answer to the next command,
+	 * start over on a fresh socket.
+	 */
+	log_err("No reply from wpa_supplicant, reopening the connection");
+	wpa_cli_cmd_close();
+	if (wpa_cli_cmd_open() < 0)
+		log_err("Failed to reopen the command connection");
+
+	wpa_cli_cmd_complete(WIFI_ERROR_WPA_CMD_REQ_FAIL, NULL, 0);
+	wpa_cli_cmd_send();
+}
+
+static void wpa_cli_cmd_send(void)
+{
+	struct wpa_cli_cmd *cmd;
+
+	while (!cmd_in_flight && !dl_list_empty(&cmd_queue)) {
+		cmd = dl_list_first(&cmd_queue, struct wpa_cli_cmd, list);
+
+		if (!cmd_conn) {
+			wpa_cli_cmd_complete(WIFI_ERROR_NO_CONTROL_HANDLE,
+						NULL, 0);
+			continue;
+		}
+
+		if (send(wpa_ctrl_get_fd(cmd_conn), cmd->cmd,
+			 os_strlen(cmd->cmd), MSG_DONTWAIT) < 0) {
+			log_err("Failed to send command: %s", strerror(errno));
+			wpa_cli_cmd_complete(WIFI_ERROR_WPA_CMD_REQ_FAIL,
+						NULL, 0);
+			continue;
+		}
+
+		cmd_in_flight = 1;
+		loop->add_timeout_callback(&cmd_timeout_id,
+				WPA_CLI_CMD_TIMEOUT, wpa_cli_cmd_timeout, NULL);
+	}
+}
+
+static void wpa_cli_cmd_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	static char reply[WPA_CLI_REPLY_SIZE];
+	ssize_t len;
+
+	len = recv(sock, reply, sizeof(reply) - 1, MSG_DONTWAIT);
+	if (len < 0) {
+		if (errno == EAGAIN || errno == EINTR)
+			return;
+		log_err("Command connection failed: %s", strerror(errno));
+		wpa_cli_cmd_complete(WIFI_ERROR_WPA_CMD_REQ_FAIL, NULL, 0);
+		wpa_cli_cmd_send();
+		return;
+	}
+
+	if (!cmd_in_flight) {
+		log_dbg("Dropping unexpected reply");
+		return;
+	}
+
+	reply[len] = '\0';
+	wpa_cli_cmd_complete(WIFI_SUCCESS, reply, len);
+	wpa_cli_cmd_send();
+}
+
+int wpa_cli_request_async(const char *cmd, wpa_cli_cmd_callback callback,
+				void *user_data)
+{
+	struct wpa_cli_cmd *item;
+	size_t len;
+
+	if (!cmd_conn)
+		return WIFI_ERROR_NO_CONTROL_HANDLE;
+
+	len = os_strlen(cmd) + 1;
+	item = os_malloc(sizeof(*item) + len);
+	if (!item)
+		return WIFI_ERROR;
+
+	item->callback = callback;
+	item->user_data = user_data;
+	os_memcpy(item->cmd, cmd, len);
+	dl_list_add_tail(&cmd_queue, &item->list);
+
+	wpa_cli_cmd_send();
+
+	return WIFI_SUCCESS;
+}
+#else
+static void wpa_cli_cmd_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+}
+
+int wpa_cli_request_async(const char *cmd, wpa_cli_cmd_callback callback,
+				void *user_data)
+{
+	char reply[WPA_CLI_REPLY_SIZE];
+	unsigned int len = sizeof(reply) - 1;
+	int ret = WIFI_SUCCESS;
+
+	if (!cmd_conn)
+		return WIFI_ERROR_NO_CONTROL_HANDLE;
+
+	/* There is no main loop to wait on, answer right away */
+	if (wpa_ctrl_request(cmd_conn, cmd, os_strlen(cmd), reply, &len,
+				NULL) < 0) {
+		ret = WIFI_ERROR_WPA_CMD_REQ_FAIL;
+		len = 0;
+	}
+	reply[len] = '\0';
+
+	if (callback)
+		callback(ret, ret == WIFI_SUCCESS ? reply : NULL, len,
+				user_data);
+
+	return WIFI_SUCCESS;
+}
+#endif
+
 void wpa_cli_close_connection(void)
 {
 	if (!ctrl_conn)
@@ -109,6 +348,22 @@ void wpa_cli_close_connection(void)
 		wpa_ctrl_close(mon_conn);
 		mon_conn = NULL;
 	}
+
+	wpa_cli_cmd_close();
+	/* Whatever is still queued will never get an answer */
+	while (!dl_list_empty(&cmd_queue)) {
+		cmd_in_flight = 0;
+		wpa_cli_cmd_complete(WIFI_ERROR_NO_CONTROL_HANDLE, NULL, 0);
+	}
+
+#ifdef CONFIG_ELOOP_GMAINLOOP
+	if (loop) {
+		artik_release_api_module(loop);
+		loop = NULL;
+	}
+#endif
+	os_free(ctrl_path);
+	ctrl_path = NULL;
 }
 
 int str_starts(const char *src, const char *match)
@@ -126,39 +381,34 @@ log_dbg("event: %s", event);
 
 	start++;
 	/*
-	 * Skip BSS added/removed events since they can be relatively frequent
-	 * and are likely of not much use for an interactive user.
+	 * BSS added/removed events are frequent, they only keep the scan
+	 * result cache up to date and are not reported to the user.
 	 */
-	if (str_starts(start, WPA_EVENT_BSS_ADDED) ||
-	    str_starts(start, WPA_EVENT_BSS_REMOVED))
+	if (str_starts(start, WPA_EVENT_BSS_ADDED)) {
+		if (bss_event_cb)
+			bss_event_cb(WPA_CLI_BSS_ADDED,
+				atoi(start + os_strlen(WPA_EVENT_BSS_ADDED)));
 		return 0;
+	}
+	if (str_starts(start, WPA_EVENT_BSS_REMOVED)) {
+		if (bss_event_cb)
+			bss_event_cb(WPA_CLI_BSS_REMOVED,
+				atoi(start + os_strlen(WPA_EVENT_BSS_REMOVED)));
+		return 0;
+	}
 
-	if (active_scan && str_starts(start, WPA_EVENT_SCAN_RESULTS)) {
-		active_scan = 0;
-		if (wifi_cb.scan_result_callback) {
-			artik_error err = S_OK;
-
-			wifi_cb.scan_result_callback(&err,
-				wifi_cb.scan_result_user_data);
-		}
+	if (str_starts(start, WPA_EVENT_SCAN_RESULTS)) {
+		/* The cache owner reports the results once it has them */
+		if (bss_event_cb)
+			bss_event_cb(WPA_CLI_SCAN_RESULTS, 0);
+		else
+			wpa_cli_notify_scan_result(S_OK);
+	} else if (str_starts(start, WPA_EVENT_SCAN_FAILED)) {
+		wpa_cli_notify_scan_result(E_WIFI_ERROR);
 	} else if (str_starts(start, WPA_EVENT_CONNECTED)) {
-		if (wifi_cb.connect_callback) {
-			artik_wifi_connection_info info;
-
-			info.connected = true;
-			info.error = S_OK;
-			wifi_cb.connect_callback((void *)&info,
-				wifi_cb.connect_user_data);
-		}
+		wpa_cli_notify_connect(true, S_OK);
 	} else if (str_starts(start, WPA_EVENT_DISCONNECTED)) {
-		if (wifi_cb.connect_callback) {
-			artik_wifi_connection_info info;
-
-			info.connected = false;
-			info.error = S_OK;
-			wifi_cb.connect_callback((void *)&info,
-				wifi_cb.connect_user_data);
-		}
+		wpa_cli_notify_connect(false, S_OK);
 	}
 	return 1;
 }
@@ -220,12 +470,16 @@ int wpa_cli_open_connection(const char *ifname, int attach)
 		os_free(cfile);
 		return -1;
 	}
+	ctrl_path = cfile;
+
+#ifdef CONFIG_ELOOP_GMAINLOOP
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+#endif
 
 	if (attach)
 		mon_conn = wpa_ctrl_open2(cfile, client_socket_dir);
 	else
 		mon_conn = NULL;
-	os_free(cfile);
 
 	if (mon_conn) {
 		if (wpa_ctrl_attach(mon_conn) == 0) {
@@ -238,6 +492,12 @@ int wpa_cli_open_connection(const char *ifname, int attach)
 			wpa_cli_close_connection();
 			return -1;
 		}
+
+		if (wpa_cli_cmd_open() < 0) {
+			log_err("Failed to open the command connection.");
+			wpa_cli_close_connection();
+			return -1;
+		}
 	}
 
 	return 0;
@@ -264,6 +524,10 @@ static void wpa_cli_recv_pending(struct wpa_ctrl *ctrl, int action_monitor)
 
 			check_event(buf);
 
+			/* The callbacks may have closed the connection */
+			if (ctrl != mon_conn)
+				return;
+
 			if (check_terminating(buf) > 0)
 				return;
 		} else {
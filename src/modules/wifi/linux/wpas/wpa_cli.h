@@ -17,12 +17,33 @@
 #ifndef WPA_CLI_H
 #define WPA_CLI_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <artik_error.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * result is WIFI_SUCCESS with the nul terminated reply, or an error from
+ * enum wifi_result with a NULL reply if none came back.
+ */
+typedef void (*wpa_cli_cmd_callback)(int result, const char *reply,
+					size_t len, void *user_data);
+
+enum wpa_cli_bss_event {
+	WPA_CLI_BSS_ADDED,
+	WPA_CLI_BSS_REMOVED,
+	WPA_CLI_SCAN_RESULTS
+};
+
+typedef void (*wpa_cli_bss_callback)(enum wpa_cli_bss_event event,
+					unsigned int id);
+
 struct wpa_ctrl *get_ctrl(void);
 void set_active_scan(const int n);
+int get_active_scan(void);
 void set_ctrl_ifname(const char *ifname);
 
 void set_scan_result_callback(
@@ -31,6 +52,12 @@ void set_scan_result_callback(
 void set_connect_callback(
 			wifi_connect_callback callback,
 			void *user_data);
+void set_bss_event_callback(wpa_cli_bss_callback callback);
+void wpa_cli_notify_scan_result(artik_error err);
+void wpa_cli_notify_connect(bool connected, artik_error err);
+
+int wpa_cli_request_async(const char *cmd, wpa_cli_cmd_callback callback,
+				void *user_data);
 
 int wpa_cli_open_connection(const char *ifname, int attach);
 void wpa_cli_close_connection(void);
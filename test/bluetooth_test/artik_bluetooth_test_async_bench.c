@@ -0,0 +1,185 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Measures aggregate gatt_char_read_value_async operations per second
+ * over several connected devices, next to the same reads done with
+ * gatt_char_read_value one after the other. Runs against real devices,
+ * or any BlueZ stand-in exposing the same object tree on the system bus.
+ */
+
+#include <artik_module.h>
+#include <artik_bluetooth.h>
+#include <artik_loop.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BATTERY_LEVEL_SERVICE "0000180f-0000-1000-8000-00805f9b34fb"
+#define CHAR_BATTERY_LEVEL "00002a19-0000-1000-8000-00805f9b34fb"
+#define MAX_DEVICES 20
+
+static artik_bluetooth_module *bt;
+static artik_loop_module *loop;
+static const char *remote_address[MAX_DEVICES];
+static int num_devices;
+static const char *srv_uuid = BATTERY_LEVEL_SERVICE;
+static const char *char_uuid = CHAR_BATTERY_LEVEL;
+static int count = 100;
+static int completed, failed, timed_out;
+static struct timespec start;
+static int ret = -1;
+
+static double elapsed_ms(const struct timespec *from)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - from->tv_sec) * 1000.0 +
+		(now.tv_nsec - from->tv_nsec) / 1000000.0;
+}
+
+static void run_sync(void)
+{
+	unsigned char *b = NULL;
+	int i, d, len = 0, errors = 0;
+	double ms;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++) {
+		for (d = 0; d < num_devices; d++) {
+			if (bt->gatt_char_read_value(remote_address[d], srv_uuid,
+					char_uuid, &b, &len) != S_OK) {
+				errors++;
+				continue;
+			}
+			free(b);
+		}
+	}
+	ms = elapsed_ms(&start);
+
+	fprintf(stdout, "sync:  %d reads (%d failed) in %.1f ms: %.1f ops/sec\n",
+		count * num_devices, errors, ms, count * num_devices * 1000.0 / ms);
+}
+
+static void on_read(artik_error result, const unsigned char *bytes, int len,
+		void *user_data)
+{
+	double ms;
+
+	if (result == E_TIMEOUT)
+		timed_out++;
+	else if (result != S_OK)
+		failed++;
+
+	if (++completed < count * num_devices)
+		return;
+
+	ms = elapsed_ms(&start);
+	fprintf(stdout, "async: %d reads (%d failed, %d timed out) in %.1f ms:"
+		" %.1f ops/sec\n", completed, failed, timed_out, ms,
+		completed * 1000.0 / ms);
+
+	ret = failed + timed_out ? -1 : 0;
+	loop->quit();
+}
+
+static int run_bench(void *user_data)
+{
+	int i, d;
+
+	run_sync();
+
+	/* All reads are queued at once, the module bounds those in flight */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++) {
+		for (d = 0; d < num_devices; d++) {
+			if (bt->gatt_char_read_value_async(remote_address[d],
+					srv_uuid, char_uuid, on_read, NULL) != S_OK) {
+				fprintf(stdout, "%s: no %s/%s\n", remote_address[d],
+					srv_uuid, char_uuid);
+				loop->quit();
+				return 0;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void on_timeout_callback(void *user_data)
+{
+	fprintf(stdout, "timeout, %d reads completed\n", completed);
+	loop->quit();
+}
+
+static int on_signal(void *user_data)
+{
+	loop->quit();
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, id = 0;
+
+	while ((opt = getopt(argc, argv, "t:s:c:n:")) != -1) {
+		switch (opt) {
+		case 't':
+			if (num_devices < MAX_DEVICES)
+				remote_address[num_devices++] = optarg;
+			break;
+		case 's':
+			srv_uuid = optarg;
+			break;
+		case 'c':
+			char_uuid = optarg;
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (num_devices == 0 || count <= 0) {
+		printf("Usage: bluetooth-test-async_bench -t <address>"
+			" [-t <address> ...] [-s <service UUID>]"
+			" [-c <characteristic UUID>] [-n <reads per device>]\n"
+			"Devices must be connected.\n");
+		return -1;
+	}
+
+	bt = (artik_bluetooth_module *)artik_request_api_module("bluetooth");
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+
+	loop->add_idle_callback(&id, run_bench, NULL);
+	loop->add_timeout_callback(&id, 600000, on_timeout_callback, NULL);
+	loop->add_signal_watch(SIGINT, on_signal, NULL, NULL);
+	loop->run();
+
+	artik_release_api_module(bt);
+	artik_release_api_module(loop);
+
+	return ret;
+}
@@ -0,0 +1,176 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Measures gatt_char_read_value calls per second against a connected
+ * device, or any BlueZ stand-in exposing the same object tree on the
+ * system bus.
+ */
+
+#include <artik_module.h>
+#include <artik_bluetooth.h>
+#include <artik_loop.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BATTERY_LEVEL_SERVICE "0000180f-0000-1000-8000-00805f9b34fb"
+#define CHAR_BATTERY_LEVEL "00002a19-0000-1000-8000-00805f9b34fb"
+
+static artik_bluetooth_module *bt;
+static artik_loop_module *loop;
+static const char *remote_address;
+static const char *srv_uuid = BATTERY_LEVEL_SERVICE;
+static const char *char_uuid = CHAR_BATTERY_LEVEL;
+static int count = 1000;
+static int ret = -1;
+static bool done;
+
+static double elapsed_ms(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000.0 +
+		(now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static int run_bench(void *user_data)
+{
+	struct timespec start;
+	unsigned char *b = NULL;
+	int i, len = 0;
+	double ms;
+
+	if (done)
+		return 0;
+	done = true;
+
+	/* First read pays for loading the object cache */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (bt->gatt_char_read_value(remote_address, srv_uuid, char_uuid,
+			&b, &len) != S_OK) {
+		fprintf(stdout, "read %s/%s failed\n", srv_uuid, char_uuid);
+		loop->quit();
+		return 0;
+	}
+	free(b);
+	fprintf(stdout, "first read: %.3f ms\n", elapsed_ms(&start));
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++) {
+		if (bt->gatt_char_read_value(remote_address, srv_uuid,
+				char_uuid, &b, &len) != S_OK) {
+			fprintf(stdout, "read %d failed\n", i);
+			loop->quit();
+			return 0;
+		}
+		free(b);
+	}
+	ms = elapsed_ms(&start);
+
+	fprintf(stdout, "%d reads in %.1f ms: %.1f reads/sec, %.3f ms/read\n",
+		count, ms, count * 1000.0 / ms, ms / count);
+
+	ret = 0;
+	loop->quit();
+	return 0;
+}
+
+static void on_gatt_property(artik_bt_event event, void *data,
+		void *user_data)
+{
+	int id;
+
+	loop->add_idle_callback(&id, run_bench, NULL);
+}
+
+static void on_connect(artik_bt_event event, void *data, void *user_data)
+{
+	if (!(*(bool *)data)) {
+		fprintf(stdout, "failed to connect %s\n", remote_address);
+		loop->quit();
+	}
+}
+
+static void on_timeout_callback(void *user_data)
+{
+	fprintf(stdout, "timeout waiting for %s\n", remote_address);
+	loop->quit();
+}
+
+static int on_signal(void *user_data)
+{
+	loop->quit();
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, id = 0;
+
+	while ((opt = getopt(argc, argv, "t:s:c:n:")) != -1) {
+		switch (opt) {
+		case 't':
+			remote_address = optarg;
+			break;
+		case 's':
+			srv_uuid = optarg;
+			break;
+		case 'c':
+			char_uuid = optarg;
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (remote_address == NULL || count <= 0) {
+		printf("Usage: bluetooth-test-gatt_read_bench -t <address>"
+			" [-s <service UUID>] [-c <characteristic UUID>]"
+			" [-n <reads>]\n");
+		return -1;
+	}
+
+	bt = (artik_bluetooth_module *)artik_request_api_module("bluetooth");
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+
+	bt->set_callback(BT_EVENT_CONNECT, on_connect, NULL);
+	bt->set_callback(BT_EVENT_GATT_PROPERTY, on_gatt_property, NULL);
+
+	if (bt->is_connected(remote_address))
+		loop->add_idle_callback(&id, run_bench, NULL);
+	else
+		bt->connect(remote_address);
+
+	loop->add_timeout_callback(&id, 30000, on_timeout_callback, NULL);
+	loop->add_signal_watch(SIGINT, on_signal, NULL, NULL);
+	loop->run();
+
+	artik_release_api_module(bt);
+	artik_release_api_module(loop);
+
+	return ret;
+}
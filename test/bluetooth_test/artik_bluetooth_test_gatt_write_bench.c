@@ -0,0 +1,210 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Measures gatt_char_write_value throughput against a connected device,
+ * or any BlueZ stand-in exposing the same object tree on the system bus.
+ * Characteristics allowing only write commands go over the AcquireWrite
+ * socket, others over WriteValue.
+ */
+
+#include <artik_module.h>
+#include <artik_bluetooth.h>
+#include <artik_loop.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#define IMMEDIATE_ALERT_SERVICE "00001802-0000-1000-8000-00805f9b34fb"
+#define CHAR_ALERT_LEVEL "00002a06-0000-1000-8000-00805f9b34fb"
+
+static artik_bluetooth_module *bt;
+static artik_loop_module *loop;
+static const char *remote_address;
+static const char *srv_uuid = IMMEDIATE_ALERT_SERVICE;
+static const char *char_uuid = CHAR_ALERT_LEVEL;
+static int count = 1000;
+static int size = 1;
+static int ret = -1;
+static bool done;
+
+static double elapsed_ms(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000.0 +
+		(now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static struct timespec start;
+static unsigned char *value;
+static int written;
+
+static void finish(void)
+{
+	free(value);
+	value = NULL;
+	loop->quit();
+}
+
+/* Writes until the link queue is full, called again once the loop idles */
+static int write_more(void *user_data)
+{
+	artik_error err;
+	double ms;
+
+	for (; written < count; written++) {
+		value[0] = written;
+		err = bt->gatt_char_write_value(remote_address, srv_uuid,
+				char_uuid, value, size);
+		if (err == E_BUSY)
+			return 1;
+		if (err != S_OK) {
+			fprintf(stdout, "write %d failed\n", written);
+			finish();
+			return 0;
+		}
+	}
+	ms = elapsed_ms(&start);
+
+	fprintf(stdout, "%d writes of %d bytes in %.1f ms: %.1f writes/sec,"
+		" %.1f kB/s\n", count, size, ms, count * 1000.0 / ms,
+		(double)count * size / ms);
+
+	ret = 0;
+	finish();
+	return 0;
+}
+
+static int run_bench(void *user_data)
+{
+	int id;
+
+	if (done)
+		return 0;
+	done = true;
+
+	value = calloc(size, sizeof(unsigned char));
+	if (value == NULL) {
+		loop->quit();
+		return 0;
+	}
+
+	/* First write pays for the lookup and acquiring the socket */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (bt->gatt_char_write_value(remote_address, srv_uuid, char_uuid,
+			value, size) != S_OK) {
+		fprintf(stdout, "write %s/%s failed\n", srv_uuid, char_uuid);
+		finish();
+		return 0;
+	}
+	fprintf(stdout, "first write: %.3f ms\n", elapsed_ms(&start));
+
+	/* E_BUSY hands the loop back so the queued values can drain */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	loop->add_idle_callback(&id, write_more, NULL);
+
+	return 0;
+}
+
+static void on_gatt_property(artik_bt_event event, void *data,
+		void *user_data)
+{
+	int id;
+
+	loop->add_idle_callback(&id, run_bench, NULL);
+}
+
+static void on_connect(artik_bt_event event, void *data, void *user_data)
+{
+	if (!(*(bool *)data)) {
+		fprintf(stdout, "failed to connect %s\n", remote_address);
+		loop->quit();
+	}
+}
+
+static void on_timeout_callback(void *user_data)
+{
+	fprintf(stdout, "timeout waiting for %s\n", remote_address);
+	loop->quit();
+}
+
+static int on_signal(void *user_data)
+{
+	loop->quit();
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, id = 0;
+
+	while ((opt = getopt(argc, argv, "t:s:c:n:l:")) != -1) {
+		switch (opt) {
+		case 't':
+			remote_address = optarg;
+			break;
+		case 's':
+			srv_uuid = optarg;
+			break;
+		case 'c':
+			char_uuid = optarg;
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'l':
+			size = atoi(optarg);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (remote_address == NULL || count <= 0 || size <= 0) {
+		printf("Usage: bluetooth-test-gatt_write_bench -t <address>"
+			" [-s <service UUID>] [-c <characteristic UUID>]"
+			" [-n <writes>] [-l <value length>]\n");
+		return -1;
+	}
+
+	bt = (artik_bluetooth_module *)artik_request_api_module("bluetooth");
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+
+	bt->set_callback(BT_EVENT_CONNECT, on_connect, NULL);
+	bt->set_callback(BT_EVENT_GATT_PROPERTY, on_gatt_property, NULL);
+
+	if (bt->is_connected(remote_address))
+		loop->add_idle_callback(&id, run_bench, NULL);
+	else
+		bt->connect(remote_address);
+
+	loop->add_timeout_callback(&id, 30000, on_timeout_callback, NULL);
+	loop->add_signal_watch(SIGINT, on_signal, NULL, NULL);
+	loop->run();
+
+	artik_release_api_module(bt);
+	artik_release_api_module(loop);
+
+	return ret;
+}
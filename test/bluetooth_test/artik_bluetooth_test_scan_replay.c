@@ -0,0 +1,471 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Replays a stream of BlueZ device signals on the system bus and checks
+ * the scan reports raised by set_scan_report: no address twice in a
+ * report, no device failing the filters, and fewer reported devices than
+ * signals. The stream is either a file recorded with -r from a real scan,
+ * or synthesized beacons. Each recorded line holds:
+ *   <ms since start> <object path> <signal name> <parameters>
+ */
+
+#include <artik_module.h>
+#include <artik_bluetooth.h>
+#include <artik_loop.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include <gio/gio.h>
+#pragma GCC diagnostic pop
+
+#define DBUS_IF_OBJECT_MANAGER "org.freedesktop.DBus.ObjectManager"
+#define DBUS_IF_PROPERTIES "org.freedesktop.DBus.Properties"
+#define DBUS_IF_DEVICE1 "org.bluez.Device1"
+#define EDDYSTONE_UUID "0000feaa-0000-1000-8000-00805f9b34fb"
+#define BATTERY_UUID "0000180f-0000-1000-8000-00805f9b34fb"
+#define MAX_FILTERS 16
+
+typedef struct {
+	unsigned int ms;
+	gchar *path;
+	gchar *signal;
+	GVariant *parameters;
+} replay_signal;
+
+static artik_bluetooth_module *bt;
+static artik_loop_module *loop;
+static GDBusConnection *conn;
+static GPtrArray *stream;
+/* Addresses of the devices in the stream */
+static GHashTable *expected;
+static guint next;
+static struct timespec start;
+static FILE *record;
+
+static artik_bt_scan_report_config config = { 500, 0, 2, NULL, 0, NULL, 0 };
+static const char *addresses[MAX_FILTERS];
+static artik_bt_uuid uuids[MAX_FILTERS];
+static int num_beacons = 200;
+static int num_updates = 20;
+
+static int reports, reported, seen, duplicates, filtered_out;
+static int ret = -1;
+
+static unsigned int elapsed_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start.tv_sec) * 1000 +
+		(now.tv_nsec - start.tv_nsec) / 1000000;
+}
+
+static void add_expected(const gchar *path)
+{
+	const gchar *dev = g_strrstr(path, "/dev_");
+	gchar *address;
+
+	if (!dev || strlen(dev + 5) != 17)
+		return;
+
+	address = g_strdup(dev + 5);
+	g_strdelimit(address, "_", ':');
+	g_hash_table_add(expected, address);
+}
+
+static void add_signal(unsigned int ms, const gchar *path,
+		const gchar *signal, GVariant *parameters)
+{
+	replay_signal *s = g_new0(replay_signal, 1);
+
+	s->ms = ms;
+	s->path = g_strdup(path);
+	s->signal = g_strdup(signal);
+	s->parameters = g_variant_ref_sink(parameters);
+	g_ptr_array_add(stream, s);
+
+	if (!g_strcmp0(signal, "InterfacesAdded") &&
+			g_variant_is_of_type(parameters,
+				G_VARIANT_TYPE("(oa{sa{sv}})"))) {
+		const gchar *object;
+
+		g_variant_get_child(parameters, 0, "&o", &object);
+		add_expected(object);
+	} else {
+		add_expected(path);
+	}
+}
+
+static void free_signal(gpointer data)
+{
+	replay_signal *s = (replay_signal *)data;
+
+	g_free(s->path);
+	g_free(s->signal);
+	g_variant_unref(s->parameters);
+	g_free(s);
+}
+
+static int load_stream(const char *file)
+{
+	FILE *fp = fopen(file, "r");
+	char line[4096], path[256], signal[64];
+	unsigned int ms;
+	GVariant *parameters;
+	GError *e = NULL;
+	int n;
+
+	if (!fp) {
+		fprintf(stdout, "Failed to open %s\n", file);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%u %255s %63s %n", &ms, path, signal, &n) != 3)
+			continue;
+
+		parameters = g_variant_parse(NULL, line + n, NULL, NULL, &e);
+		if (!parameters) {
+			fprintf(stdout, "Skipping %s: %s\n", path, e->message);
+			g_clear_error(&e);
+			continue;
+		}
+		add_signal(ms, path, signal, parameters);
+	}
+	fclose(fp);
+
+	return 0;
+}
+
+/*
+ * Beacons are all added at once, then each one advertises a jittering
+ * RSSI and a counter every 50 ms, as a crowded scan would.
+ */
+static void synthesize_stream(void)
+{
+	GVariantBuilder props, ifaces;
+	gchar path[64];
+	int i, u;
+
+	for (i = 0; i < num_beacons; i++) {
+		snprintf(path, sizeof(path),
+			"/org/bluez/hci0/dev_00_11_22_33_%02X_%02X",
+			(i >> 8) & 0xff, i & 0xff);
+
+		g_variant_builder_init(&props, G_VARIANT_TYPE("a{sv}"));
+		g_variant_builder_add(&props, "{sv}", "Address",
+			g_variant_new_string(path + strlen(path) - 17));
+		g_variant_builder_add(&props, "{sv}", "RSSI",
+			g_variant_new_int16(-40 - i % 60));
+		g_variant_builder_add(&props, "{sv}", "UUIDs",
+			g_variant_new_strv((const gchar *[]){
+				i % 2 ? BATTERY_UUID : EDDYSTONE_UUID }, 1));
+		g_variant_builder_init(&ifaces, G_VARIANT_TYPE("a{sa{sv}}"));
+		g_variant_builder_add(&ifaces, "{sa{sv}}", DBUS_IF_DEVICE1, &props);
+		add_signal(0, "/", "InterfacesAdded",
+			g_variant_new("(oa{sa{sv}})", path, &ifaces));
+
+		for (u = 1; u <= num_updates; u++) {
+			g_variant_builder_init(&props, G_VARIANT_TYPE("a{sv}"));
+			g_variant_builder_add(&props, "{sv}", "RSSI",
+				g_variant_new_int16(-40 - i % 60 + rand() % 7 - 3));
+			if (u % 5 == 0)
+				g_variant_builder_add(&props, "{sv}",
+					"ManufacturerData",
+					g_variant_new_parsed("{@q 117: <[byte %y]>}",
+						(guchar)u));
+			add_signal(u * 50, path, "PropertiesChanged",
+				g_variant_new("(sa{sv}as)", DBUS_IF_DEVICE1, &props,
+					NULL));
+		}
+	}
+}
+
+static gint compare_signal(gconstpointer a, gconstpointer b)
+{
+	const replay_signal *sa = *(const replay_signal **)a;
+	const replay_signal *sb = *(const replay_signal **)b;
+
+	return (int)sa->ms - (int)sb->ms;
+}
+
+static void on_quit(void *user_data)
+{
+	/* A scan report that never fires must not pass */
+	ret = (!reports || !reported || !seen || duplicates || filtered_out ||
+		reported >= (int)stream->len) ? -1 : 0;
+
+	fprintf(stdout, "%u signals, %d reports, %d devices reported"
+		" (%d from the stream), %d duplicates,"
+		" %d not matching the filters: %s\n",
+		stream->len, reports, reported, seen, duplicates, filtered_out,
+		ret ? "FAILED" : "OK");
+
+	loop->quit();
+}
+
+static int replay(void *user_data)
+{
+	unsigned int now = elapsed_ms();
+	replay_signal *s;
+	GError *e = NULL;
+	int id;
+
+	for (; next < stream->len; next++) {
+		s = g_ptr_array_index(stream, next);
+		if (s->ms > now)
+			return 1;
+
+		g_dbus_connection_emit_signal(conn, NULL, s->path,
+			g_strcmp0(s->signal, "PropertiesChanged") ?
+				DBUS_IF_OBJECT_MANAGER : DBUS_IF_PROPERTIES,
+			s->signal, s->parameters, &e);
+		if (e) {
+			fprintf(stdout, "Failed to emit %s: %s\n", s->signal,
+				e->message);
+			g_clear_error(&e);
+		}
+	}
+
+	/* Let the last updates be reported */
+	g_dbus_connection_flush_sync(conn, NULL, NULL);
+	loop->add_timeout_callback(&id, config.interval * 2, on_quit, NULL);
+
+	return 0;
+}
+
+static bool matches(const artik_bt_device *device)
+{
+	unsigned int i;
+	int j;
+
+	if (config.rssi && device->rssi < config.rssi)
+		return false;
+
+	for (i = 0; i < config.address_length; i++) {
+		if (!strcasecmp(device->remote_address, addresses[i]))
+			break;
+	}
+	if (config.address_length && i == config.address_length)
+		return false;
+
+	if (!config.uuid_length)
+		return true;
+
+	for (i = 0; i < config.uuid_length; i++) {
+		if (!strcasecmp(device->svc_uuid, uuids[i].uuid))
+			return true;
+		for (j = 0; j < device->uuid_length; j++) {
+			if (!strcasecmp(device->uuid_list[j].uuid, uuids[i].uuid))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static void on_scan_report(artik_bt_event event, void *data, void *user_data)
+{
+	artik_bt_scan_report *report = (artik_bt_scan_report *)data;
+	int i, j;
+
+	reports++;
+	reported += report->num_devices;
+
+	for (i = 0; i < report->num_devices; i++) {
+		for (j = 0; j < i; j++) {
+			if (!strcmp(report->devices[i].remote_address,
+					report->devices[j].remote_address))
+				duplicates++;
+		}
+		if (!matches(&report->devices[i]))
+			filtered_out++;
+		if (g_hash_table_contains(expected,
+				report->devices[i].remote_address))
+			seen++;
+	}
+}
+
+static void on_record(GDBusConnection *connection, const gchar *sender,
+		const gchar *path, const gchar *interface, const gchar *signal,
+		GVariant *parameters, gpointer user_data)
+{
+	gchar *text = g_variant_print(parameters, TRUE);
+
+	fprintf(record, "%u %s %s %s\n", elapsed_ms(), path, signal, text);
+	g_free(text);
+}
+
+static int start_record(const char *file)
+{
+	record = fopen(file, "w");
+	if (!record) {
+		fprintf(stdout, "Failed to open %s\n", file);
+		return -1;
+	}
+
+	g_dbus_connection_signal_subscribe(conn, "org.bluez",
+		DBUS_IF_OBJECT_MANAGER, NULL, NULL, NULL,
+		G_DBUS_SIGNAL_FLAGS_NONE, on_record, NULL, NULL);
+	g_dbus_connection_signal_subscribe(conn, "org.bluez",
+		DBUS_IF_PROPERTIES, "PropertiesChanged", NULL, DBUS_IF_DEVICE1,
+		G_DBUS_SIGNAL_FLAGS_NONE, on_record, NULL, NULL);
+
+	fprintf(stdout, "Recording to %s, press Ctrl-C to stop\n", file);
+	bt->start_scan();
+
+	return 0;
+}
+
+static int on_signal(void *user_data)
+{
+	loop->quit();
+
+	return true;
+}
+
+static void usage(void)
+{
+	printf("Usage: bluetooth-test-scan_replay [-f <recorded file>]"
+		" [-n <beacons>] [-u <updates per beacon>] [-i <report ms>]"
+		" [-R <RSSI threshold>] [-H <RSSI hysteresis>]"
+		" [-a <address> ...] [-U <UUID> ...]\n"
+		"       bluetooth-test-scan_replay -r <file to record>\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *file = NULL, *record_file = NULL;
+	gchar *address;
+	GError *e = NULL;
+	int opt, id;
+
+	while ((opt = getopt(argc, argv, "f:r:n:u:i:R:H:a:U:")) != -1) {
+		switch (opt) {
+		case 'f':
+			file = optarg;
+			break;
+		case 'r':
+			record_file = optarg;
+			break;
+		case 'n':
+			num_beacons = atoi(optarg);
+			break;
+		case 'u':
+			num_updates = atoi(optarg);
+			break;
+		case 'i':
+			config.interval = atoi(optarg);
+			break;
+		case 'R':
+			config.rssi = atoi(optarg);
+			break;
+		case 'H':
+			config.rssi_hysteresis = atoi(optarg);
+			break;
+		case 'a':
+			if (config.address_length < MAX_FILTERS)
+				addresses[config.address_length++] = optarg;
+			break;
+		case 'U':
+			if (config.uuid_length < MAX_FILTERS)
+				uuids[config.uuid_length++].uuid = optarg;
+			break;
+		default:
+			usage();
+			return -1;
+		}
+	}
+
+	if (config.interval == 0 || num_beacons <= 0 || num_updates < 0) {
+		usage();
+		return -1;
+	}
+	config.address_list = addresses;
+	config.uuid_list = uuids;
+
+	/* The module receives the signals of any sender on the bus */
+	address = g_dbus_address_get_for_bus_sync(G_BUS_TYPE_SYSTEM, NULL, &e);
+	if (address)
+		conn = g_dbus_connection_new_for_address_sync(address,
+			G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+			G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+			NULL, NULL, &e);
+	g_free(address);
+	if (!conn) {
+		fprintf(stdout, "Failed to connect to the system bus: %s\n",
+			e->message);
+		g_error_free(e);
+		return -1;
+	}
+
+	bt = (artik_bluetooth_module *)artik_request_api_module("bluetooth");
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+	stream = g_ptr_array_new_with_free_func(free_signal);
+	expected = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	if (record_file) {
+		if (start_record(record_file) < 0)
+			goto exit;
+		ret = 0;
+		loop->add_signal_watch(SIGINT, on_signal, NULL, NULL);
+		loop->run();
+		bt->stop_scan();
+		fclose(record);
+		goto exit;
+	}
+
+	if (file) {
+		if (load_stream(file) < 0)
+			goto exit;
+	} else {
+		synthesize_stream();
+	}
+	g_ptr_array_sort(stream, compare_signal);
+
+	bt->set_callback(BT_EVENT_SCAN_REPORT, on_scan_report, NULL);
+	if (bt->set_scan_report(&config) != S_OK) {
+		fprintf(stdout, "Failed to set the scan report\n");
+		goto exit;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	loop->add_periodic_callback(&id, 10, replay, NULL);
+	loop->add_signal_watch(SIGINT, on_signal, NULL, NULL);
+	loop->run();
+
+	bt->set_scan_report(NULL);
+	bt->unset_callback(BT_EVENT_SCAN_REPORT);
+
+exit:
+	g_ptr_array_free(stream, TRUE);
+	g_hash_table_destroy(expected);
+	g_object_unref(conn);
+	artik_release_api_module(bt);
+	artik_release_api_module(loop);
+
+	return ret;
+}
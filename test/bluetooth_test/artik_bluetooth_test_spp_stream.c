@@ -0,0 +1,230 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Pushes data between two SPP streams opened on the ends of a socketpair,
+ * as they would be on the fd of an RFCOMM connection. The writer keeps
+ * writing until the stream refuses with E_BUSY and resumes on the drain
+ * callback. The reader checks every byte and only consumes whole frames,
+ * leaving partial frames in the ring buffer. No adapter is needed.
+ */
+
+#include <artik_module.h>
+#include <artik_bluetooth.h>
+#include <artik_loop.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/* The reader consumes data by frames of this size */
+#define FRAME_LEN 13
+
+static artik_bluetooth_module *bt;
+static artik_loop_module *loop;
+static artik_bt_spp_stream_handle writer, reader;
+static unsigned long long total = 100ULL * 1024 * 1024;
+static unsigned long long sent, received;
+static unsigned int write_len = 1000;
+static unsigned char *pattern;
+static struct timespec start;
+static int errors = 1;
+
+static unsigned char byte_at(unsigned long long offset)
+{
+	return (offset ^ (offset >> 8) ^ (offset >> 16)) & 0xff;
+}
+
+static void print_stats(const char *name, artik_bt_spp_stream_handle handle)
+{
+	artik_bt_spp_stream_stats stats;
+
+	bt->spp_stream_get_stats(handle, &stats);
+	fprintf(stdout, "%s: rx %llu bytes in %u reads, %u batches;"
+		" tx %llu bytes in %u writes, queue peak %u, %u busy\n",
+		name, (unsigned long long)stats.rx_bytes, stats.rx_reads,
+		stats.rx_batches, (unsigned long long)stats.tx_bytes,
+		stats.tx_writes, stats.tx_queue_peak, stats.tx_busy);
+}
+
+static void pump(void)
+{
+	unsigned int len;
+	artik_error ret;
+
+	while (sent < total) {
+		len = total - sent < write_len ? total - sent : write_len;
+		/* The pattern repeats every 16 MiB */
+		ret = bt->spp_stream_write(writer,
+			pattern + (sent & 0xffffff), len);
+		if (ret == E_BUSY)
+			return;
+		if (ret != S_OK) {
+			fprintf(stdout, "write failed: %s\n", error_msg(ret));
+			loop->quit();
+			return;
+		}
+		sent += len;
+	}
+}
+
+static int on_start(void *user_data)
+{
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pump();
+
+	return 0;
+}
+
+static void on_drain(artik_bt_spp_stream_handle handle, void *user_data)
+{
+	pump();
+}
+
+static unsigned int on_read(artik_bt_spp_stream_handle handle,
+		const unsigned char *data, unsigned int len, void *user_data)
+{
+	unsigned int i;
+
+	if (received + len < total)
+		len -= len % FRAME_LEN;
+
+	for (i = 0; i < len; i++) {
+		if (data[i] != byte_at(received + i)) {
+			fprintf(stdout, "bad byte at offset %llu\n",
+				received + i);
+			loop->quit();
+			return 0;
+		}
+	}
+	received += len;
+
+	if (received == total) {
+		struct timespec now;
+		double s;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		s = (now.tv_sec - start.tv_sec) +
+			(now.tv_nsec - start.tv_nsec) / 1e9;
+		fprintf(stdout, "%llu bytes in %.2f s: %.1f MB/s\n", total, s,
+			total / s / 1e6);
+		print_stats("writer", writer);
+		print_stats("reader", reader);
+
+		/* The reader must see the writer go away */
+		bt->spp_stream_close(writer);
+		writer = NULL;
+	}
+
+	return len;
+}
+
+static void on_close(artik_bt_spp_stream_handle handle, void *user_data)
+{
+	fprintf(stdout, "reader closed after %llu bytes\n", received);
+	errors = received != total;
+	loop->quit();
+}
+
+static void on_timeout(void *user_data)
+{
+	fprintf(stdout, "timeout: %llu bytes sent, %llu received\n", sent,
+		received);
+	loop->quit();
+}
+
+static int on_signal(void *user_data)
+{
+	loop->quit();
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	artik_bt_spp_stream_config writer_config = { 0 };
+	artik_bt_spp_stream_config reader_config = { 0 };
+	unsigned long long i;
+	int fds[2], opt, id;
+
+	while ((opt = getopt(argc, argv, "m:w:")) != -1) {
+		switch (opt) {
+		case 'm':
+			total = strtoull(optarg, NULL, 10) * 1024 * 1024;
+			break;
+		case 'w':
+			write_len = atoi(optarg);
+			break;
+		default:
+			printf("Usage: bluetooth-test-spp_stream [-m <MiB>]"
+				" [-w <bytes per write>]\n");
+			return -1;
+		}
+	}
+
+	if (total == 0 || write_len == 0 || write_len > 0x1000000) {
+		printf("Usage: bluetooth-test-spp_stream [-m <MiB>]"
+			" [-w <bytes per write>]\n");
+		return -1;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+		perror("socketpair");
+		return -1;
+	}
+
+	pattern = malloc(0x1000000 + write_len);
+	for (i = 0; i < 0x1000000 + write_len; i++)
+		pattern[i] = byte_at(i);
+
+	bt = (artik_bluetooth_module *)artik_request_api_module("bluetooth");
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+
+	writer_config.drain_func = on_drain;
+	reader_config.read_func = on_read;
+	reader_config.close_func = on_close;
+
+	if (bt->spp_stream_open(fds[0], &writer_config, &writer) != S_OK ||
+			bt->spp_stream_open(fds[1], &reader_config,
+				&reader) != S_OK) {
+		fprintf(stdout, "Failed to open the streams\n");
+		goto exit;
+	}
+
+	loop->add_idle_callback(&id, on_start, NULL);
+	loop->add_timeout_callback(&id, 120000, on_timeout, NULL);
+	loop->add_signal_watch(SIGINT, on_signal, NULL, NULL);
+	loop->run();
+
+exit:
+	if (writer)
+		bt->spp_stream_close(writer);
+	if (reader)
+		bt->spp_stream_close(reader);
+
+	artik_release_api_module(bt);
+	artik_release_api_module(loop);
+	free(pattern);
+
+	fprintf(stdout, "%s\n", errors ? "FAILED" : "OK");
+
+	return errors ? -1 : 0;
+}
@@ -0,0 +1,172 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Resolves UUID names and round-trips UUIDs through uuid_parse and
+ * uuid_format, checking the results, then measures how long each
+ * operation takes over a million UUIDs. No adapter is needed.
+ */
+
+#include <artik_module.h>
+#include <artik_bluetooth.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static const struct {
+	const char *uuid;
+	const char *name;
+} known[] = {
+	{ "00002a19-0000-1000-8000-00805f9b34fb", "Battery Level" },
+	{ "0000180f-0000-1000-8000-00805f9b34fb", "Battery Service" },
+	{ "0000180F-0000-1000-8000-00805F9B34FB", "Battery Service" },
+	{ "180f", "Battery Service" },
+	{ "00001101", "SerialPort" },
+	{ "00002902-0000-1000-8000-00805f9b34fb",
+		"Client Characteristic Configuration" },
+	{ "0000fffe-0000-1000-8000-00805f9b34fb", "Unknown" },
+	{ "0001180f-0000-1000-8000-00805f9b34fb", "Unknown" },
+	{ "6e400001-b5a3-f393-e0a9-e50e24dcca9e", "Vendor specific" },
+};
+
+static const char *invalid[] = {
+	"", "18", "180g", "0000180f-0000-1000-8000-00805f9b34f",
+	"0000180f-0000-1000-8000-00805f9b34fb0",
+	"0000180f_0000-1000-8000-00805f9b34fb",
+};
+
+static double elapsed_ns(const struct timespec *from)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - from->tv_sec) * 1e9 +
+		(now.tv_nsec - from->tv_nsec);
+}
+
+static int check(artik_bluetooth_module *bt)
+{
+	artik_bt_uuid128 uuid;
+	char str[BT_UUID_STR_LEN];
+	const char *name;
+	unsigned int i;
+	int errors = 0;
+
+	for (i = 0; i < sizeof(known) / sizeof(known[0]); i++) {
+		if (bt->uuid_get_name(known[i].uuid, &name) != S_OK ||
+				strcmp(name, known[i].name)) {
+			fprintf(stdout, "%s: expected %s\n", known[i].uuid,
+				known[i].name);
+			errors++;
+		}
+	}
+
+	for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		if (bt->uuid_parse(invalid[i], &uuid) != E_BAD_ARGS) {
+			fprintf(stdout, "\"%s\" parsed as a UUID\n", invalid[i]);
+			errors++;
+		}
+	}
+
+	/* Every 16-bit UUID comes back as its 128-bit form */
+	for (i = 0; i <= 0xffff; i++) {
+		char short_form[5];
+
+		snprintf(short_form, sizeof(short_form), "%04X", i);
+		if (bt->uuid_parse(short_form, &uuid) != S_OK ||
+				bt->uuid_format(&uuid, str, sizeof(str)) != S_OK ||
+				strtoul(str, NULL, 16) != i ||
+				strcmp(str + 8, "-0000-1000-8000-00805f9b34fb")) {
+			fprintf(stdout, "%s: round trip gave %s\n", short_form,
+				str);
+			errors++;
+			break;
+		}
+	}
+
+	if (bt->uuid_format(&uuid, str, sizeof(str) - 1) != E_BAD_ARGS) {
+		fprintf(stdout, "uuid_format accepted a short buffer\n");
+		errors++;
+	}
+
+	return errors;
+}
+
+static void bench(artik_bluetooth_module *bt, int count)
+{
+	const int n = sizeof(known) / sizeof(known[0]);
+	struct timespec start;
+	artik_bt_uuid128 uuid;
+	char str[BT_UUID_STR_LEN];
+	const char *name;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++)
+		bt->uuid_get_name(known[i % n].uuid, &name);
+	fprintf(stdout, "uuid_get_name: %.1f ns/op\n",
+		elapsed_ns(&start) / count);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++)
+		bt->uuid_parse(known[i % n].uuid, &uuid);
+	fprintf(stdout, "uuid_parse:    %.1f ns/op\n",
+		elapsed_ns(&start) / count);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++)
+		bt->uuid_format(&uuid, str, sizeof(str));
+	fprintf(stdout, "uuid_format:   %.1f ns/op\n",
+		elapsed_ns(&start) / count);
+}
+
+int main(int argc, char *argv[])
+{
+	artik_bluetooth_module *bt;
+	int opt, count = 1000000, errors;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			count = atoi(optarg);
+			break;
+		default:
+			printf("Usage: bluetooth-test-uuid_bench [-n <lookups>]\n");
+			return -1;
+		}
+	}
+
+	if (count <= 0) {
+		printf("Usage: bluetooth-test-uuid_bench [-n <lookups>]\n");
+		return -1;
+	}
+
+	bt = (artik_bluetooth_module *)artik_request_api_module("bluetooth");
+
+	errors = check(bt);
+	if (!errors)
+		bench(bt, count);
+
+	artik_release_api_module(bt);
+
+	fprintf(stdout, "%s\n", errors ? "FAILED" : "OK");
+
+	return errors ? -1 : 0;
+}
@@ -66,6 +66,24 @@ int main(int ac, char **av) {
     } else {
       std::cout << "Unable to generate random bytes." << std::endl;
     }
+
+    artik_hash_result digest;
+    res = security.hash_buffer(ARTIK_HASH_SHA256,
+        reinterpret_cast<const unsigned char *>("abc"), 3, &digest);
+    if (res == S_OK) {
+      std::cout << "SHA-256 of \"abc\": " << std::endl;
+      std::cout << std::setfill('0');
+      for (int i = 0; i < 32; ++i)
+        std::cout << std::setw(2) << std::hex
+            << static_cast<int>(digest.sha256[i]);
+      std::cout << std::endl;
+    } else {
+      std::cout << "Unable to hash a buffer." << std::endl;
+    }
+
+    res = security.clear_cache();
+    if (res != S_OK)
+      std::cout << "Unable to clear the certificate cache." << std::endl;
   } catch (artik::ArtikException &e) {
     std::cout << "[Exception]" << e.what() << std::endl;
   }
@@ -0,0 +1,175 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Benchmark of the logging calls, comparing the synchronous stderr
+ * backend with the asynchronous one, and measuring the cost of a
+ * message filtered out by the log level threshold. Log output goes to
+ * the file given on the command line (/dev/null by default), results
+ * are printed on stdout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <artik_module.h>
+#include <artik_platform.h>
+#include <artik_log.h>
+
+#define LOG_CALLS	100000
+#define FILTERED_CALLS	10000000
+#define RATELIMIT_CALLS	1000
+
+static long latency_ns[LOG_CALLS];
+
+static long now_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static int compare_long(const void *a, const void *b)
+{
+	long la = *(const long *)a;
+	long lb = *(const long *)b;
+
+	return (la > lb) - (la < lb);
+}
+
+static void run_bench(const char *name)
+{
+	long start, end;
+	int i;
+
+	start = now_nsec();
+	for (i = 0; i < LOG_CALLS; i++) {
+		long t = now_nsec();
+
+		/* Not compiled out in release builds unlike log_dbg() */
+		artik_log(LOG_LEVEL_DEBUG, "benchmark message %d of %d from %s",
+							i, LOG_CALLS, name);
+		latency_ns[i] = now_nsec() - t;
+	}
+	end = now_nsec();
+
+	qsort(latency_ns, LOG_CALLS, sizeof(long), compare_long);
+
+	fprintf(stdout, "TEST: %s: %.0f calls/s, latency p50 %ldns"
+		" p99 %ldns max %ldns\n", name,
+		LOG_CALLS / ((end - start) / 1e9),
+		latency_ns[LOG_CALLS / 2], latency_ns[LOG_CALLS * 99 / 100],
+		latency_ns[LOG_CALLS - 1]);
+}
+
+static int evaluated;
+
+static int expensive_arg(void)
+{
+	return ++evaluated;
+}
+
+static artik_error run_filter_bench(void)
+{
+	long start, end;
+	int i;
+
+	log_module.set_level(ARTIK_LOG_MODULE_APP, LOG_LEVEL_ERROR);
+
+	start = now_nsec();
+	for (i = 0; i < FILTERED_CALLS; i++)
+		artik_log(LOG_LEVEL_DEBUG, "filtered %d", expensive_arg());
+	end = now_nsec();
+
+	log_module.set_level(ARTIK_LOG_MODULE_APP, LOG_LEVEL_DEBUG);
+
+	fprintf(stdout, "TEST: filtered: %.2fns per call, %d arguments"
+		" evaluated\n", (double)(end - start) / FILTERED_CALLS,
+		evaluated);
+
+	return evaluated ? E_BAD_ARGS : S_OK;
+}
+
+static artik_error run_ratelimit_test(void)
+{
+	int missed = 0;
+	int printed = 0;
+	int i;
+
+	for (i = 0; i < RATELIMIT_CALLS; i++) {
+		static artik_log_ratelimit_state rl = ARTIK_LOG_RATELIMIT_INIT;
+		int ret = log_module.ratelimit(&rl);
+
+		if (ret < 0)
+			missed++;
+		else
+			printed++;
+	}
+
+	fprintf(stdout, "TEST: ratelimit: %d printed, %d suppressed\n",
+							printed, missed);
+
+	return (printed == ARTIK_LOG_RATELIMIT_BURST) ? S_OK : E_BAD_ARGS;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *output = (argc > 1) ? argv[1] : "/dev/null";
+	artik_error ret;
+	long start;
+
+	if (!freopen(output, "w", stderr)) {
+		fprintf(stdout, "TEST: failed to open %s\n", output);
+		return -1;
+	}
+
+	log_module.set_system(LOG_SYSTEM_STDERR);
+
+	ret = run_filter_bench();
+	if (ret != S_OK) {
+		fprintf(stdout, "TEST: filtered messages were evaluated\n");
+		return -1;
+	}
+
+	ret = run_ratelimit_test();
+	if (ret != S_OK) {
+		fprintf(stdout, "TEST: ratelimit failed\n");
+		return -1;
+	}
+
+	run_bench("sync");
+
+	ret = log_module.set_async(true);
+	if (ret != S_OK) {
+		fprintf(stdout, "TEST: failed to enable async logging (%d)\n",
+									ret);
+		return -1;
+	}
+
+	run_bench("async");
+
+	start = now_nsec();
+	log_module.set_async(false);
+	fprintf(stdout, "TEST: async flush took %ldus\n",
+					(now_nsec() - start) / 1000);
+
+	return 0;
+}
@@ -17,6 +17,9 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <artik_module.h>
 #include <artik_platform.h>
@@ -87,6 +90,345 @@ artik_error test_loop_periodic(void)
 	return ret;
 }
 
+static long now_msec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+#define DRIFT_PERIOD_MSEC	10
+#define DRIFT_WORK_USEC		4000
+#define DRIFT_COUNT		50
+#define DRIFT_MAX_MSEC		(DRIFT_PERIOD_MSEC * DRIFT_COUNT + 50)
+
+static int drift_count;
+
+static int on_drift_callback(void *user_data)
+{
+	artik_loop_module *loop = (artik_loop_module *) user_data;
+
+	/* Busy callback, the next periods must not be pushed back by it */
+	usleep(DRIFT_WORK_USEC);
+
+	if (++drift_count == DRIFT_COUNT) {
+		loop->quit();
+		return 0;
+	}
+
+	return 1;
+}
+
+artik_error test_loop_periodic_drift(void)
+{
+	artik_loop_module *loop = (artik_loop_module *)
+					artik_request_api_module("loop");
+	artik_error ret = S_OK;
+	long start, elapsed;
+	int id = 0;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	start = now_msec();
+	ret = loop->add_periodic_callback(&id, DRIFT_PERIOD_MSEC,
+					on_drift_callback, (void *)loop);
+	if (ret != S_OK)
+		goto exit;
+
+	loop->run();
+	elapsed = now_msec() - start;
+
+	fprintf(stdout, "TEST: %s %d periods of %dms in %ldms\n", __func__,
+		DRIFT_COUNT, DRIFT_PERIOD_MSEC, elapsed);
+
+	if (elapsed > DRIFT_MAX_MSEC)
+		ret = E_TIMEOUT;
+
+exit:
+	fprintf(stdout, "TEST: %s %s\n", __func__, (ret == S_OK) ? "succeeded" :
+								"failed");
+
+	artik_release_api_module(loop);
+
+	return ret;
+}
+
+static void on_main_post(void *user_data)
+{
+	artik_loop_module *loop = (artik_loop_module *) user_data;
+
+	fprintf(stdout, "TEST: %s triggered, exiting loop\n", __func__);
+	loop->quit();
+}
+
+static void on_thread_post(void *user_data)
+{
+	artik_loop_module *loop = (artik_loop_module *) user_data;
+
+	fprintf(stdout, "TEST: %s triggered, posting back\n", __func__);
+	loop->post(NULL, on_main_post, loop);
+}
+
+artik_error test_loop_post(void)
+{
+	artik_loop_module *loop = (artik_loop_module *)
+					artik_request_api_module("loop");
+	artik_loop_handle handle = NULL;
+	artik_error ret = S_OK;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	ret = loop->create_loop(&handle);
+	if (ret != S_OK)
+		goto exit;
+
+	ret = loop->post(handle, on_thread_post, (void *)loop);
+	if (ret != S_OK) {
+		loop->destroy_loop(handle);
+		goto exit;
+	}
+
+	loop->run();
+
+	ret = loop->destroy_loop(handle);
+
+exit:
+	fprintf(stdout, "TEST: %s %s\n", __func__, (ret == S_OK) ? "succeeded" :
+								"failed");
+
+	artik_release_api_module(loop);
+
+	return ret;
+}
+
+#define DESTROY_ROUNDS		200
+
+static artik_loop_handle race_handle;
+static int race_stop;
+static int race_calls;
+
+static void on_race_noop(void *user_data)
+{
+}
+
+/* Uses whatever loop is published while the main thread destroys them */
+static void on_race_work(void *user_data)
+{
+	artik_loop_module *loop = (artik_loop_module *) user_data;
+	artik_loop_handle handle;
+	int id;
+
+	while (!__atomic_load_n(&race_stop, __ATOMIC_ACQUIRE)) {
+		handle = __atomic_load_n(&race_handle, __ATOMIC_ACQUIRE);
+		if (!handle)
+			continue;
+
+		loop->post(handle, on_race_noop, NULL);
+		if (loop->add_timeout_callback_to_loop(handle, &id, 1000,
+					on_race_noop, NULL) == S_OK)
+			loop->remove_timeout_callback_from_loop(handle, id);
+		race_calls++;
+	}
+}
+
+static void on_race_done(void *user_data)
+{
+	artik_loop_module *loop = (artik_loop_module *) user_data;
+
+	loop->quit();
+}
+
+artik_error test_loop_destroy_race(void)
+{
+	artik_loop_module *loop = (artik_loop_module *)
+					artik_request_api_module("loop");
+	artik_loop_handle handle;
+	artik_error ret;
+	int i;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	ret = loop->submit_work(on_race_work, on_race_done, (void *)loop);
+	if (ret != S_OK)
+		goto exit;
+
+	for (i = 0; i < DESTROY_ROUNDS; i++) {
+		ret = loop->create_loop(&handle);
+		if (ret != S_OK)
+			break;
+
+		__atomic_store_n(&race_handle, handle, __ATOMIC_RELEASE);
+		usleep(1000);
+
+		ret = loop->destroy_loop(handle);
+		if (ret != S_OK)
+			break;
+	}
+
+	__atomic_store_n(&race_stop, 1, __ATOMIC_RELEASE);
+	loop->run();
+
+	fprintf(stdout, "TEST: %s %d loops destroyed during %d calls\n",
+		__func__, i, race_calls);
+
+exit:
+	fprintf(stdout, "TEST: %s %s\n", __func__, (ret == S_OK) ? "succeeded" :
+								"failed");
+
+	artik_release_api_module(loop);
+
+	return ret;
+}
+
+#define WORK_JOBS		100
+#define WORK_JOB_MSEC		50
+#define WORK_TICK_MSEC		10
+#define WORK_MAX_LATENCY_MSEC	50
+
+static int work_done;
+static long work_last_tick;
+static long work_max_latency;
+
+static void on_work(void *user_data)
+{
+	/* Emulate a blocking call */
+	usleep(WORK_JOB_MSEC * 1000);
+}
+
+static void on_work_done(void *user_data)
+{
+	artik_loop_module *loop = (artik_loop_module *) user_data;
+
+	if (++work_done == WORK_JOBS)
+		loop->quit();
+}
+
+static int on_work_tick(void *user_data)
+{
+	long now = now_msec();
+	long latency = now - work_last_tick - WORK_TICK_MSEC;
+
+	if (latency > work_max_latency)
+		work_max_latency = latency;
+	work_last_tick = now;
+
+	return 1;
+}
+
+artik_error test_loop_work(void)
+{
+	artik_loop_module *loop = (artik_loop_module *)
+					artik_request_api_module("loop");
+	artik_error ret = S_OK;
+	long start;
+	int id = 0;
+	int i;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	start = now_msec();
+	for (i = 0; i < WORK_JOBS; i++) {
+		ret = loop->submit_work(on_work, on_work_done, (void *)loop);
+		if (ret != S_OK)
+			goto exit;
+	}
+
+	work_last_tick = now_msec();
+	loop->add_periodic_callback(&id, WORK_TICK_MSEC, on_work_tick, NULL);
+	loop->run();
+	loop->remove_periodic_callback(id);
+
+	fprintf(stdout, "TEST: %s %d jobs of %dms in %ldms, max loop latency"
+		" %ldms\n", __func__, WORK_JOBS, WORK_JOB_MSEC,
+		now_msec() - start, work_max_latency);
+
+	if (work_max_latency > WORK_MAX_LATENCY_MSEC)
+		ret = E_TIMEOUT;
+
+exit:
+	fprintf(stdout, "TEST: %s %s\n", __func__, (ret == S_OK) ? "succeeded" :
+								"failed");
+
+	artik_release_api_module(loop);
+
+	return ret;
+}
+
+#define TIMER_COUNT		100000
+#define TIMER_FIRED_COUNT	1000
+#define TIMER_MAX_MSEC		60000
+
+static int timer_ids[TIMER_COUNT];
+static int timers_fired;
+
+static void on_timer_noop(void *user_data)
+{
+}
+
+static void on_timer_fired(void *user_data)
+{
+	artik_loop_module *loop = (artik_loop_module *) user_data;
+
+	if (++timers_fired == TIMER_FIRED_COUNT)
+		loop->quit();
+}
+
+artik_error test_loop_timers(void)
+{
+	artik_loop_module *loop = (artik_loop_module *)
+					artik_request_api_module("loop");
+	artik_error ret = S_OK;
+	long start, added, removed;
+	int i;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	srand(time(NULL));
+
+	start = now_msec();
+	for (i = 0; i < TIMER_COUNT; i++) {
+		ret = loop->add_timeout_callback(&timer_ids[i],
+				rand() % TIMER_MAX_MSEC, on_timer_noop, NULL);
+		if (ret != S_OK)
+			goto exit;
+	}
+	added = now_msec();
+
+	for (i = 0; i < TIMER_COUNT; i++) {
+		ret = loop->remove_timeout_callback(timer_ids[i]);
+		if (ret != S_OK)
+			goto exit;
+	}
+	removed = now_msec();
+
+	fprintf(stdout, "TEST: %s %d timers added in %ldms, removed in %ldms\n",
+		__func__, TIMER_COUNT, added - start, removed - added);
+
+	/* Short timers sharing expiries thanks to the slack */
+	start = now_msec();
+	for (i = 0; i < TIMER_FIRED_COUNT; i++) {
+		ret = loop->add_timeout_with_slack(&timer_ids[i],
+				rand() % 100, 20, on_timer_fired, (void *)loop);
+		if (ret != S_OK)
+			goto exit;
+	}
+
+	loop->run();
+
+	fprintf(stdout, "TEST: %s %d timers fired in %ldms\n", __func__,
+		timers_fired, now_msec() - start);
+
+exit:
+	fprintf(stdout, "TEST: %s %s\n", __func__, (ret == S_OK) ? "succeeded" :
+								"failed");
+
+	artik_release_api_module(loop);
+
+	return ret;
+}
+
 int main(void)
 {
 	artik_error ret = S_OK;
@@ -103,6 +445,26 @@ int main(void)
 		goto exit;
 
 	ret = test_loop_periodic();
+	if (ret != S_OK)
+		goto exit;
+
+	ret = test_loop_periodic_drift();
+	if (ret != S_OK)
+		goto exit;
+
+	ret = test_loop_post();
+	if (ret != S_OK)
+		goto exit;
+
+	ret = test_loop_destroy_race();
+	if (ret != S_OK)
+		goto exit;
+
+	ret = test_loop_work();
+	if (ret != S_OK)
+		goto exit;
+
+	ret = test_loop_timers();
 
 exit:
 	return ((ret == S_OK) ? 0 : -1);
@@ -0,0 +1,499 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Round trip time of server initiated read and write requests. A forked
+ * child plays the LWM2M server: it acknowledges the registration of the
+ * client, then sends confirmable CoAP GET and PUT requests on the device
+ * object one after the other and measures the time until each response.
+ * Local reads and writes are then timed with the per URI and batch APIs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <artik_module.h>
+#include <artik_platform.h>
+#include <artik_loop.h>
+#include <artik_lwm2m.h>
+
+#define SERVER_PORT		15683
+#define SERVER_URI		"coap://127.0.0.1:15683"
+#define RESPONSE_TIMEOUT_MS	2000
+#define MAX_COAP_SIZE		1024
+#define MAX_REQUESTS		10000
+
+#define COAP_TYPE_CON		0
+#define COAP_TYPE_ACK		2
+#define COAP_GET		0x01
+#define COAP_POST		0x02
+#define COAP_PUT		0x03
+#define COAP_CREATED		0x41
+#define COAP_CHANGED		0x44
+#define COAP_CONTENT		0x45
+#define COAP_OPT_LOCATION_PATH	8
+#define COAP_OPT_URI_PATH	11
+#define COAP_OPT_CONTENT_FORMAT	12
+
+#define READ_URI		"3/0/0"
+#define WRITE_URI		"3/0/15"
+#define WRITE_VALUE		"Europe/Paris"
+
+static artik_loop_module *loop;
+static artik_lwm2m_module *lwm2m;
+static int num_requests = 200;
+static int registered;
+static unsigned short next_mid = 1;
+
+struct coap_msg {
+	unsigned char buf[MAX_COAP_SIZE];
+	size_t len;
+	int last_opt;
+};
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void coap_init(struct coap_msg *msg, int type, int code,
+			unsigned short mid, const unsigned char *token,
+			int token_len)
+{
+	msg->buf[0] = 0x40 | (type << 4) | token_len;
+	msg->buf[1] = code;
+	msg->buf[2] = mid >> 8;
+	msg->buf[3] = mid & 0xff;
+	memcpy(&msg->buf[4], token, token_len);
+	msg->len = 4 + token_len;
+	msg->last_opt = 0;
+}
+
+/* Options must be added in increasing order, values below 13 bytes */
+static void coap_add_option(struct coap_msg *msg, int opt,
+				const void *value, int len)
+{
+	msg->buf[msg->len++] = ((opt - msg->last_opt) << 4) | len;
+	memcpy(&msg->buf[msg->len], value, len);
+	msg->len += len;
+	msg->last_opt = opt;
+}
+
+static void coap_add_path(struct coap_msg *msg, int opt, const char *path)
+{
+	char tmp[64];
+	char *save = NULL;
+	char *seg;
+
+	strncpy(tmp, path, sizeof(tmp) - 1);
+	tmp[sizeof(tmp) - 1] = '\0';
+	for (seg = strtok_r(tmp, "/", &save); seg;
+					seg = strtok_r(NULL, "/", &save))
+		coap_add_option(msg, opt, seg, strlen(seg));
+}
+
+static void coap_add_payload(struct coap_msg *msg, const char *payload)
+{
+	msg->buf[msg->len++] = 0xff;
+	memcpy(&msg->buf[msg->len], payload, strlen(payload));
+	msg->len += strlen(payload);
+}
+
+static int coap_parse(const unsigned char *buf, ssize_t len, int *type,
+			int *code, unsigned short *mid, unsigned char *token,
+			int *token_len)
+{
+	if (len < 4 || (buf[0] >> 6) != 1)
+		return -1;
+
+	*type = (buf[0] >> 4) & 0x3;
+	*token_len = buf[0] & 0xf;
+	*code = buf[1];
+	*mid = (buf[2] << 8) | buf[3];
+	if (*token_len > 8 || len < 4 + *token_len)
+		return -1;
+
+	memcpy(token, &buf[4], *token_len);
+
+	return 0;
+}
+
+/*
+ * Receive the next datagram. Requests from the client (registration and
+ * updates) are acknowledged on the spot, responses are returned.
+ */
+static int server_receive(int sock, struct sockaddr_in *peer,
+			unsigned short *mid, unsigned char *token,
+			int *token_len, int timeout_ms)
+{
+	unsigned char buf[MAX_COAP_SIZE];
+	struct pollfd pfd = { .fd = sock, .events = POLLIN };
+	socklen_t peer_len = sizeof(*peer);
+	struct coap_msg reply;
+	int type, code;
+	ssize_t len;
+
+	while (1) {
+		if (poll(&pfd, 1, timeout_ms) <= 0)
+			return -1;
+
+		len = recvfrom(sock, buf, sizeof(buf), 0,
+				(struct sockaddr *)peer, &peer_len);
+		if (len < 0)
+			return -1;
+
+		if (coap_parse(buf, len, &type, &code, mid, token, token_len))
+			continue;
+
+		if (code >= COAP_CREATED)
+			return code;
+
+		if (type != COAP_TYPE_CON)
+			continue;
+
+		/* The first POST is the registration, then come updates */
+		if (code == COAP_POST && !registered) {
+			coap_init(&reply, COAP_TYPE_ACK, COAP_CREATED, *mid,
+					token, *token_len);
+			coap_add_path(&reply, COAP_OPT_LOCATION_PATH, "rd/1");
+		} else {
+			coap_init(&reply, COAP_TYPE_ACK, COAP_CHANGED, *mid,
+					token, *token_len);
+		}
+
+		sendto(sock, reply.buf, reply.len, 0,
+				(struct sockaddr *)peer, sizeof(*peer));
+
+		if (code == COAP_POST && !registered) {
+			registered = 1;
+			return 0;
+		}
+	}
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void print_stats(const char *name, double *samples, int count,
+			int failures)
+{
+	double total = 0;
+	int i;
+
+	if (!count) {
+		fprintf(stdout, "TEST: %s: no response\n", name);
+		return;
+	}
+
+	qsort(samples, count, sizeof(double), compare_double);
+	for (i = 0; i < count; i++)
+		total += samples[i];
+
+	fprintf(stdout, "TEST: %s: %d requests, %d failed, min %.3f ms,"
+		" avg %.3f ms, p99 %.3f ms, max %.3f ms\n", name, count,
+		failures, samples[0], total / count,
+		samples[(count * 99) / 100], samples[count - 1]);
+}
+
+static int run_requests(int sock, struct sockaddr_in *client, int code,
+			const char *uri, double *samples, int *failures)
+{
+	unsigned char token[8] = { 'a', 'r', 't', 'k' };
+	unsigned char rx_token[8];
+	struct sockaddr_in peer;
+	struct coap_msg req;
+	unsigned short mid, rx_mid;
+	unsigned char format = 0;
+	int rx_token_len;
+	int count = 0;
+	int ret;
+	int i;
+
+	*failures = 0;
+	for (i = 0; i < num_requests; i++) {
+		double start;
+
+		mid = next_mid++;
+		memcpy(&token[4], &i, sizeof(i));
+		coap_init(&req, COAP_TYPE_CON, code, mid, token, 8);
+		coap_add_path(&req, COAP_OPT_URI_PATH, uri);
+		if (code == COAP_PUT) {
+			/* Zero length uint, i.e. text/plain */
+			coap_add_option(&req, COAP_OPT_CONTENT_FORMAT,
+						&format, 0);
+			coap_add_payload(&req, WRITE_VALUE);
+		}
+
+		start = now_ms();
+		sendto(sock, req.buf, req.len, 0, (struct sockaddr *)client,
+							sizeof(*client));
+
+		do {
+			ret = server_receive(sock, &peer, &rx_mid, rx_token,
+					&rx_token_len, RESPONSE_TIMEOUT_MS);
+		} while (ret > 0 && rx_mid != mid);
+
+		if (ret < 0) {
+			(*failures)++;
+			continue;
+		}
+
+		samples[count++] = now_ms() - start;
+		if (ret != ((code == COAP_GET) ? COAP_CONTENT : COAP_CHANGED))
+			(*failures)++;
+	}
+
+	return count;
+}
+
+static int lwm2m_server(int sock)
+{
+	static double samples[MAX_REQUESTS];
+	unsigned char token[8];
+	struct sockaddr_in client;
+	unsigned short mid;
+	int token_len;
+	int failures;
+	int count;
+
+	/* Wait for the registration */
+	if (server_receive(sock, &client, &mid, token, &token_len,
+						RESPONSE_TIMEOUT_MS * 5)) {
+		fprintf(stderr, "TEST: client did not register\n");
+		return -1;
+	}
+
+	count = run_requests(sock, &client, COAP_GET, READ_URI, samples,
+								&failures);
+	print_stats("read", samples, count, failures);
+	if (!count)
+		return -1;
+
+	count = run_requests(sock, &client, COAP_PUT, WRITE_URI, samples,
+								&failures);
+	print_stats("write", samples, count, failures);
+	if (!count)
+		return -1;
+
+	return 0;
+}
+
+static int on_server_done(int fd, enum watch_io io, void *user_data)
+{
+	loop->quit();
+
+	return 0;
+}
+
+/*
+ * Compare the per URI API with the batch API on the same set of
+ * resources, after the stand-in server is done.
+ */
+static void test_lwm2m_batch(artik_lwm2m_handle handle)
+{
+	static const char * const uris[] = {
+		ARTIK_LWM2M_URI_DEVICE_POWER_VOLTAGE,
+		ARTIK_LWM2M_URI_DEVICE_POWER_CURRENT,
+		ARTIK_LWM2M_URI_DEVICE_BATT_LEVEL,
+		ARTIK_LWM2M_URI_DEVICE_MEMORY_FREE
+	};
+	static char values[MAX_REQUESTS][16];
+	static unsigned char buffers[MAX_REQUESTS][16];
+	artik_lwm2m_resource_t *res;
+	double start, single, batch;
+	artik_error ret = S_OK;
+	int len;
+	int i;
+
+	res = calloc(num_requests, sizeof(artik_lwm2m_resource_t));
+	if (!res)
+		return;
+
+	for (i = 0; i < num_requests; i++) {
+		snprintf(values[i], sizeof(values[i]), "%d", i % 100);
+		res[i].uri = (char *)uris[i % 4];
+		res[i].buffer = (unsigned char *)values[i];
+		res[i].length = strlen(values[i]);
+	}
+
+	start = now_ms();
+	for (i = 0; i < num_requests && ret == S_OK; i++)
+		ret = lwm2m->client_write_resource(handle, res[i].uri,
+					res[i].buffer, res[i].length);
+	single = now_ms() - start;
+
+	start = now_ms();
+	if (ret == S_OK)
+		ret = lwm2m->client_write_resources(handle, res, num_requests);
+	batch = now_ms() - start;
+
+	fprintf(stdout, "TEST: %d writes: single %.3f ms, batch %.3f ms (%s)\n",
+			num_requests, single, batch, error_msg(ret));
+
+	start = now_ms();
+	for (i = 0; i < num_requests && ret == S_OK; i++) {
+		len = sizeof(buffers[i]);
+		ret = lwm2m->client_read_resource(handle, res[i].uri,
+						buffers[i], &len);
+	}
+	single = now_ms() - start;
+
+	for (i = 0; i < num_requests; i++) {
+		res[i].buffer = buffers[i];
+		res[i].length = sizeof(buffers[i]);
+	}
+
+	start = now_ms();
+	if (ret == S_OK)
+		ret = lwm2m->client_read_resources(handle, res, num_requests);
+	batch = now_ms() - start;
+
+	fprintf(stdout, "TEST: %d reads: single %.3f ms, batch %.3f ms (%s)\n",
+			num_requests, single, batch, error_msg(ret));
+
+	free(res);
+}
+
+static artik_error test_lwm2m_latency(void)
+{
+	artik_lwm2m_handle handle = NULL;
+	artik_lwm2m_config config;
+	struct sockaddr_in addr;
+	artik_error ret = S_OK;
+	int status = -1;
+	int watch_id;
+	int pipefd[2];
+	pid_t pid;
+	int sock;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock < 0)
+		return E_ACCESS_DENIED;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(SERVER_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+							pipe(pipefd) < 0) {
+		close(sock);
+		return E_BUSY;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		close(sock);
+		return E_NO_MEM;
+	}
+
+	if (pid == 0) {
+		close(pipefd[0]);
+		exit(lwm2m_server(sock) ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
+	close(sock);
+	close(pipefd[1]);
+
+	memset(&config, 0, sizeof(config));
+	config.server_id = 123;
+	config.server_uri = SERVER_URI;
+	config.name = "artik-latency-test";
+	config.lifetime = 30;
+	config.objects[ARTIK_LWM2M_OBJECT_DEVICE] =
+		lwm2m->create_device_object("Samsung", "Artik", "1234567890",
+					"1.0", "1.0", "1.0", "HUB", 0,
+					5000, 1500, 100, 1000000, 200000,
+					"Europe/Paris", "+01:00", "U");
+
+	ret = lwm2m->client_connect(&handle, &config);
+	if (ret != S_OK) {
+		kill(pid, SIGTERM);
+		goto exit;
+	}
+
+	/* The pipe is closed when the stand-in server is done */
+	loop->add_fd_watch(pipefd[0], WATCH_IO_IN | WATCH_IO_HUP,
+				on_server_done, NULL, &watch_id);
+	loop->run();
+
+	test_lwm2m_batch(handle);
+	lwm2m->client_disconnect(handle);
+
+exit:
+	waitpid(pid, &status, 0);
+	close(pipefd[0]);
+	lwm2m->free_object(config.objects[ARTIK_LWM2M_OBJECT_DEVICE]);
+
+	if (ret == S_OK && !(WIFEXITED(status) &&
+					WEXITSTATUS(status) == EXIT_SUCCESS))
+		ret = E_LWM2M_ERROR;
+
+	fprintf(stdout, "TEST: %s %s\n", __func__,
+			(ret == S_OK) ? "succeeded" : "failed");
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	artik_error ret;
+
+	if (argc > 1)
+		num_requests = atoi(argv[1]);
+
+	if (num_requests <= 0 || num_requests > MAX_REQUESTS) {
+		fprintf(stdout, "Usage: %s [requests (1-%d)]\n", argv[0],
+								MAX_REQUESTS);
+		return -1;
+	}
+
+	if (!artik_is_module_available(ARTIK_MODULE_LWM2M)) {
+		fprintf(stdout,
+			"TEST: LWM2M module is not available,"\
+			" skipping test...\n");
+		return -1;
+	}
+
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+	lwm2m = (artik_lwm2m_module *)artik_request_api_module("lwm2m");
+
+	ret = test_lwm2m_latency();
+
+	artik_release_api_module(lwm2m);
+	artik_release_api_module(loop);
+
+	return (ret == S_OK) ? 0 : -1;
+}
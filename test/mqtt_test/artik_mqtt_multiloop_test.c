@@ -0,0 +1,226 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Benchmark of independent MQTT clients serviced either from the main
+ * loop only, or from one loop thread per client. Every client subscribes
+ * to its own topic and echoes each received message back to the broker
+ * until it has seen the requested number of messages. Each message costs
+ * a configurable amount of busy work to emulate a slow user callback.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <artik_module.h>
+#include <artik_platform.h>
+#include <artik_loop.h>
+#include <artik_mqtt.h>
+
+#define BROKER_PORT	1883
+#define MAX_CLIENTS	16
+#define PAYLOAD		"artik-multiloop-benchmark"
+
+struct bench_client {
+	artik_mqtt_config config;
+	artik_mqtt_handle handle;
+	char client_id[32];
+	char topic[32];
+	int received;
+};
+
+static artik_mqtt_module *mqtt;
+static artik_loop_module *loop;
+static struct bench_client clients[MAX_CLIENTS];
+static int num_clients = 4;
+static int num_messages = 1000;
+static int work_us = 100;
+static int clients_done;
+
+static void busy_work(int usec)
+{
+	struct timespec start, now;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	} while ((now.tv_sec - start.tv_sec) * 1000000 +
+			(now.tv_nsec - start.tv_nsec) / 1000 < usec);
+}
+
+static void on_client_done(void *user_data)
+{
+	if (++clients_done == num_clients)
+		loop->quit();
+}
+
+static void publish_next(struct bench_client *client)
+{
+	mqtt->publish(client->handle, 0, false, client->topic,
+			strlen(PAYLOAD), PAYLOAD);
+}
+
+static void on_connect(artik_mqtt_config *config, void *user_data,
+			int result)
+{
+	struct bench_client *client = user_data;
+
+	if (result != S_OK) {
+		fprintf(stderr, "TEST: %s failed to connect\n",
+							client->client_id);
+		loop->post(NULL, on_client_done, client);
+		return;
+	}
+
+	mqtt->subscribe(client->handle, 0, client->topic);
+}
+
+static void on_subscribe(artik_mqtt_config *config, void *user_data,
+			int mid, int qos_count, const int *granted_qos)
+{
+	publish_next(user_data);
+}
+
+static void on_message(artik_mqtt_config *config, void *user_data,
+			artik_mqtt_msg *msg)
+{
+	struct bench_client *client = user_data;
+
+	busy_work(work_us);
+
+	if (++client->received == num_messages) {
+		loop->post(NULL, on_client_done, client);
+		return;
+	}
+
+	publish_next(client);
+}
+
+static double run_bench(const char *host, artik_loop_handle *loops,
+							int num_loops)
+{
+	struct timespec start, end;
+	int i;
+
+	clients_done = 0;
+
+	for (i = 0; i < num_clients; i++) {
+		struct bench_client *client = &clients[i];
+
+		memset(client, 0, sizeof(*client));
+		snprintf(client->client_id, sizeof(client->client_id),
+			"multiloop_%d_%d", getpid(), i);
+		snprintf(client->topic, sizeof(client->topic),
+			"artik/multiloop/%d", i);
+		client->config.client_id = client->client_id;
+		client->config.block = true;
+		client->config.keep_alive_time = 60000;
+		client->config.loop = num_loops ? loops[i % num_loops] : NULL;
+
+		mqtt->create_client(&client->handle, &client->config);
+		mqtt->set_connect(client->handle, on_connect, client);
+		mqtt->set_subscribe(client->handle, on_subscribe, client);
+		mqtt->set_message(client->handle, on_message, client);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < num_clients; i++)
+		mqtt->connect(clients[i].handle, host, BROKER_PORT);
+
+	loop->run();
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	/* Stop the loop threads before tearing down their clients */
+	for (i = 0; i < num_loops; i++) {
+		loop->destroy_loop(loops[i]);
+		loops[i] = NULL;
+	}
+
+	for (i = 0; i < num_clients; i++) {
+		mqtt->disconnect(clients[i].handle);
+		mqtt->destroy_client(clients[i].handle);
+	}
+
+	return (end.tv_sec - start.tv_sec) +
+				(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+	artik_loop_handle loops[MAX_CLIENTS];
+	double single, multi;
+	int total;
+	int i;
+
+	if (argc < 2) {
+		printf("Usage: %s <hostname or ip> [clients] [messages]"
+			" [work_us]\n", argv[0]);
+		return 0;
+	}
+
+	if (argc > 2)
+		num_clients = atoi(argv[2]);
+	if (argc > 3)
+		num_messages = atoi(argv[3]);
+	if (argc > 4)
+		work_us = atoi(argv[4]);
+
+	if (num_clients <= 0 || num_clients > MAX_CLIENTS ||
+							num_messages <= 0) {
+		fprintf(stderr, "TEST: invalid arguments\n");
+		return -1;
+	}
+
+	if (!artik_is_module_available(ARTIK_MODULE_MQTT)) {
+		fprintf(stdout,
+			"TEST: MQTT module is not available,"\
+			" skipping test...\n");
+		return -1;
+	}
+
+	mqtt = (artik_mqtt_module *)artik_request_api_module("mqtt");
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+
+	total = num_clients * num_messages;
+
+	single = run_bench(argv[1], loops, 0);
+	fprintf(stdout, "TEST: main loop only: %d msgs in %.3fs (%.0f msg/s)\n",
+					total, single, total / single);
+
+	for (i = 0; i < num_clients; i++) {
+		if (loop->create_loop(&loops[i]) != S_OK) {
+			fprintf(stderr, "TEST: failed to create loop %d\n", i);
+			return -1;
+		}
+	}
+
+	multi = run_bench(argv[1], loops, num_clients);
+	fprintf(stdout, "TEST: %d loops: %d msgs in %.3fs (%.0f msg/s)\n",
+				num_clients, total, multi, total / multi);
+	fprintf(stdout, "TEST: speedup x%.2f\n", single / multi);
+
+	artik_release_api_module(mqtt);
+	artik_release_api_module(loop);
+
+	return 0;
+}
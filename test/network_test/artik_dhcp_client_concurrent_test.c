@@ -0,0 +1,412 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * DHCP clients running at once on "eth0" and "wlan0". Both interfaces are
+ * veth links created in a private network namespace, the other end of
+ * each of them is moved to the namespace of a child process running the
+ * DHCP server of the SDK on its own subnet. The test checks both clients
+ * get a lease without stalling the main loop, and that restarting one of
+ * them gives it back the same address while the other one is untouched.
+ *
+ * The resolver configuration written by the clients goes to a temporary
+ * file bind mounted over /etc/resolv.conf in a private mount namespace.
+ *
+ * Needs CAP_NET_ADMIN and CAP_SYS_ADMIN, run it as root or under
+ * "unshare -rn".
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <artik_module.h>
+#include <artik_loop.h>
+#include <artik_network.h>
+
+#define NUM_LINKS	2
+#define NETMASK		"255.255.255.0"
+#define NUM_LEASES	16
+#define TICK_MS		10
+#define POLL_MS		20
+#define MAX_TICK_GAP	100
+#define BIND_TIMEOUT	5000
+#define TEST_TIMEOUT	20000
+
+struct test_link {
+	const char *name;
+	const char *peer;
+	artik_network_interface_t interface;
+	const char *server_addr;
+	const char *start_addr;
+	pid_t server;
+	artik_network_dhcp_client_handle client;
+	struct in_addr addr;
+	uint64_t bound_at;
+};
+
+static struct test_link links[NUM_LINKS] = {
+	{ "eth0", "seth0", ARTIK_ETHERNET, "192.168.90.1", "192.168.90.10" },
+	{ "wlan0", "swlan0", ARTIK_WIFI, "192.168.91.1", "192.168.91.10" },
+};
+
+static artik_loop_module *loop;
+static artik_network_module *network;
+
+static uint64_t start_ms;
+static uint64_t last_tick;
+static uint64_t max_tick_gap;
+static int tick_id;
+static int poll_id;
+static bool restarted;
+static struct in_addr restart_addr;
+static int failures;
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void check(bool condition, const char *what)
+{
+	fprintf(stdout, "TEST: %s: %s\n", what, condition ? "ok" : "FAILED");
+	if (!condition)
+		failures++;
+}
+
+/* True once the link holds an address from the subnet of its server */
+static bool link_address(struct test_link *link, struct in_addr *addr)
+{
+	struct ifreq req;
+	in_addr_t mask = inet_addr(NETMASK);
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	int ret;
+
+	if (fd < 0)
+		return false;
+
+	memset(&req, 0, sizeof(req));
+	strncpy(req.ifr_name, link->name, IFNAMSIZ - 1);
+	ret = ioctl(fd, SIOCGIFADDR, &req);
+	close(fd);
+	if (ret < 0)
+		return false;
+
+	*addr = ((struct sockaddr_in *)&req.ifr_addr)->sin_addr;
+
+	return (addr->s_addr & mask) ==
+				(inet_addr(link->server_addr) & mask);
+}
+
+static void on_tick(void *user_data)
+{
+	uint64_t now = now_ms();
+
+	if (last_tick && now - last_tick > max_tick_gap)
+		max_tick_gap = now - last_tick;
+	last_tick = now;
+
+	loop->add_timeout_callback(&tick_id, TICK_MS, on_tick, NULL);
+}
+
+static void on_poll(void *user_data)
+{
+	uint64_t now = now_ms() - start_ms;
+	bool all_bound = true;
+	int i;
+
+	for (i = 0; i < NUM_LINKS; i++) {
+		struct test_link *link = &links[i];
+
+		if (!link->bound_at && link_address(link, &link->addr)) {
+			link->bound_at = now;
+			fprintf(stdout, "TEST: %4llu ms: %s got %s\n",
+				(unsigned long long)now, link->name,
+				inet_ntoa(link->addr));
+		}
+
+		if (!link->bound_at)
+			all_bound = false;
+	}
+
+	/* Restart the first client while the other one keeps its lease */
+	if (all_bound && !restarted) {
+		restarted = true;
+		network->dhcp_client_stop(links[0].client);
+		if (network->dhcp_client_start(&links[0].client,
+					links[0].interface) != S_OK) {
+			check(false, "client restarted");
+			loop->quit();
+			return;
+		}
+	} else if (restarted && link_address(&links[0], &restart_addr)) {
+		fprintf(stdout, "TEST: %4llu ms: %s got %s again\n",
+				(unsigned long long)now, links[0].name,
+				inet_ntoa(restart_addr));
+		loop->quit();
+		return;
+	}
+
+	loop->add_timeout_callback(&poll_id, POLL_MS, on_poll, NULL);
+}
+
+static void on_test_timeout(void *user_data)
+{
+	fprintf(stdout, "TEST: timed out\n");
+	loop->quit();
+}
+
+static int server_main(struct test_link *link, int to_server, int to_parent)
+{
+	artik_network_dhcp_server_config config;
+	artik_network_dhcp_server_handle handle;
+	char cmd[128];
+	char c;
+
+	if (unshare(CLONE_NEWNET) < 0 || write(to_parent, "N", 1) != 1)
+		return -1;
+
+	/* Wait for the link, it takes the name of the client side one */
+
+	snprintf(cmd, sizeof(cmd), "ip link set lo up && ip link set %s"
+			" name %s && ip link set %s up", link->peer,
+			link->name, link->name);
+	if (read(to_server, &c, 1) != 1 || system(cmd))
+		return -1;
+
+	memset(&config, 0, sizeof(config));
+	config.interface = link->interface;
+	strncpy(config.ip_addr.address, link->server_addr, MAX_IP_ADDRESS_LEN);
+	strncpy(config.netmask.address, NETMASK, MAX_IP_ADDRESS_LEN);
+	strncpy(config.gw_addr.address, link->server_addr, MAX_IP_ADDRESS_LEN);
+	strncpy(config.dns_addr[0].address, link->server_addr,
+							MAX_IP_ADDRESS_LEN);
+	strncpy(config.start_addr.address, link->start_addr,
+							MAX_IP_ADDRESS_LEN);
+	config.num_leases = NUM_LEASES;
+
+	if (network->dhcp_server_start(&handle, &config) != S_OK ||
+		write(to_parent, "S", 1) != 1)
+		return -1;
+
+	/* Serve until killed by the parent */
+
+	loop->run();
+
+	return 0;
+}
+
+static int start_server(struct test_link *link)
+{
+	int to_server[2];
+	int to_parent[2];
+	char cmd[128];
+	char c = 0;
+	int ret = -1;
+
+	if (pipe(to_server) < 0)
+		return -1;
+	if (pipe(to_parent) < 0) {
+		close(to_server[0]);
+		close(to_server[1]);
+		return -1;
+	}
+
+	link->server = fork();
+	if (link->server == 0) {
+		close(to_server[1]);
+		close(to_parent[0]);
+		_exit(server_main(link, to_server[0], to_parent[1]) ? 1 : 0);
+	}
+
+	close(to_server[0]);
+	close(to_parent[1]);
+
+	/* Move the server end of the link to the namespace of the child */
+
+	snprintf(cmd, sizeof(cmd), "ip link set %s netns %d", link->peer,
+								link->server);
+	if (link->server > 0 && read(to_parent[0], &c, 1) == 1 &&
+		!system(cmd) && write(to_server[1], "G", 1) == 1 &&
+		read(to_parent[0], &c, 1) == 1 && c == 'S')
+		ret = 0;
+
+	close(to_server[1]);
+	close(to_parent[0]);
+
+	return ret;
+}
+
+static void stop_servers(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_LINKS; i++) {
+		if (links[i].server <= 0)
+			continue;
+		kill(links[i].server, SIGKILL);
+		waitpid(links[i].server, NULL, 0);
+		links[i].server = 0;
+	}
+}
+
+static artik_error test_dhcp_client_concurrent(void)
+{
+	struct in_addr addr;
+	artik_error ret = S_OK;
+	int timeout_id;
+	int i;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	for (i = 0; i < NUM_LINKS; i++) {
+		if (start_server(&links[i]) < 0) {
+			fprintf(stdout, "TEST: failed to start the server on"
+						" %s\n", links[i].name);
+			stop_servers();
+			return E_NETWORK_ERROR;
+		}
+	}
+
+	start_ms = now_ms();
+
+	for (i = 0; i < NUM_LINKS; i++) {
+		ret = network->dhcp_client_start(&links[i].client,
+							links[i].interface);
+		if (ret != S_OK) {
+			fprintf(stdout, "TEST: failed to start the client on"
+						" %s\n", links[i].name);
+			while (--i >= 0)
+				network->dhcp_client_stop(links[i].client);
+			stop_servers();
+			return ret;
+		}
+	}
+
+	loop->add_timeout_callback(&tick_id, TICK_MS, on_tick, NULL);
+	loop->add_timeout_callback(&poll_id, POLL_MS, on_poll, NULL);
+	loop->add_timeout_callback(&timeout_id, TEST_TIMEOUT, on_test_timeout,
+									NULL);
+	loop->run();
+
+	loop->remove_timeout_callback(tick_id);
+	loop->remove_timeout_callback(poll_id);
+	loop->remove_timeout_callback(timeout_id);
+
+	for (i = 0; i < NUM_LINKS; i++) {
+		check(links[i].bound_at && links[i].bound_at < BIND_TIMEOUT,
+						"lease acquired in time");
+	}
+
+	check(restart_addr.s_addr == links[0].addr.s_addr,
+					"same address after a restart");
+	check(link_address(&links[1], &addr) &&
+				addr.s_addr == links[1].addr.s_addr,
+					"other interface untouched");
+
+	fprintf(stdout, "TEST: longest main loop stall %llu ms\n",
+				(unsigned long long)max_tick_gap);
+	check(max_tick_gap < MAX_TICK_GAP, "main loop not blocked");
+
+	for (i = 0; i < NUM_LINKS; i++)
+		network->dhcp_client_stop(links[i].client);
+
+	stop_servers();
+
+	ret = failures ? E_NETWORK_ERROR : S_OK;
+	fprintf(stdout, "TEST: %s %s\n", __func__,
+				(ret == S_OK) ? "succeeded" : "failed");
+
+	return ret;
+}
+
+static int setup_namespace(void)
+{
+	char resolv[] = "/tmp/artik-dhcpc-resolv.XXXXXX";
+	int fd;
+
+	if (unshare(CLONE_NEWNET | CLONE_NEWNS) < 0) {
+		fprintf(stdout, "TEST: cannot create a network namespace (%s),"
+			" run as root or under \"unshare -rn\"\n",
+			strerror(errno));
+		return -1;
+	}
+
+	/* Keep the clients away from the resolver of the host */
+
+	fd = mkstemp(resolv);
+	if (fd < 0)
+		return -1;
+	close(fd);
+
+	if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) < 0 ||
+		mount(resolv, "/etc/resolv.conf", NULL, MS_BIND, NULL) < 0) {
+		fprintf(stdout, "TEST: cannot bind mount /etc/resolv.conf"
+					" (%s)\n", strerror(errno));
+		unlink(resolv);
+		return -1;
+	}
+	unlink(resolv);
+
+	return system("ip link set lo up && "
+		"ip link add eth0 type veth peer name seth0 && "
+		"ip link add wlan0 type veth peer name swlan0 && "
+		"ip link set eth0 up && ip link set wlan0 up");
+}
+
+int main(int argc, char *argv[])
+{
+	artik_error ret;
+
+	if (!artik_is_module_available(ARTIK_MODULE_NETWORK)) {
+		fprintf(stdout,
+			"TEST: NETWORK module is not available,"\
+			" skipping test...\n");
+		return -1;
+	}
+
+	if (setup_namespace())
+		return -1;
+
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+	network = (artik_network_module *)artik_request_api_module("network");
+
+	ret = test_dhcp_client_concurrent();
+
+	artik_release_api_module(network);
+	artik_release_api_module(loop);
+
+	return (ret == S_OK) ? 0 : -1;
+}
@@ -0,0 +1,467 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Load test of the DHCP server. The server runs on "eth0" in a private
+ * network namespace, the other end of the veth pair lives in a second
+ * namespace where a client process replays DISCOVER/REQUEST exchanges
+ * for a set of MAC addresses. Each client must always get the same
+ * address, including after the server was restarted.
+ *
+ * Needs CAP_NET_ADMIN and CAP_SYS_ADMIN, run it as root or under
+ * "unshare -rn".
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <netpacket/packet.h>
+#include <net/ethernet.h>
+#include <arpa/inet.h>
+
+#include <artik_module.h>
+#include <artik_loop.h>
+#include <artik_network.h>
+
+#define SERVER_ADDR	"192.168.77.1"
+#define START_ADDR	"192.168.77.10"
+#define CLIENT_IFACE	"dhcpc0"
+#define SPARE_LEASES	16
+#define REPLY_TIMEOUT	5
+
+#define DHCPDISCOVER	1
+#define DHCPOFFER	2
+#define DHCPREQUEST	3
+#define DHCPACK		5
+
+struct dhcp_msg {
+	uint8_t op;
+	uint8_t htype;
+	uint8_t hlen;
+	uint8_t hops;
+	uint32_t xid;
+	uint16_t secs;
+	uint16_t flags;
+	uint32_t ciaddr;
+	uint32_t yiaddr;
+	uint32_t siaddr;
+	uint32_t giaddr;
+	uint8_t chaddr[16];
+	uint8_t sname[64];
+	uint8_t file[128];
+	uint8_t options[312];
+};
+
+static artik_loop_module *loop;
+static artik_network_module *network;
+static artik_network_dhcp_server_handle server;
+static artik_network_dhcp_server_config config;
+static int to_client[2];
+static int to_parent[2];
+
+static int num_clients = 200;
+static int num_exchanges = 5000;
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Replies are unicast to the offered address and the MAC address of the
+ * client, like a real DHCP client they are received from a packet socket.
+ */
+static int client_sockets(int *send_fd, int *recv_fd)
+{
+	struct packet_mreq mreq;
+	struct sockaddr_ll ll;
+	struct timeval tv = { REPLY_TIMEOUT, 0 };
+	int one = 1;
+
+	*send_fd = socket(AF_INET, SOCK_DGRAM, 0);
+	*recv_fd = socket(AF_PACKET, SOCK_DGRAM, htons(ETH_P_IP));
+	if (*send_fd < 0 || *recv_fd < 0)
+		return -1;
+
+	setsockopt(*send_fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+	setsockopt(*send_fd, SOL_SOCKET, SO_BINDTODEVICE, CLIENT_IFACE,
+						sizeof(CLIENT_IFACE));
+
+	memset(&ll, 0, sizeof(ll));
+	ll.sll_family = AF_PACKET;
+	ll.sll_protocol = htons(ETH_P_IP);
+	ll.sll_ifindex = if_nametoindex(CLIENT_IFACE);
+	if (bind(*recv_fd, (struct sockaddr *)&ll, sizeof(ll)) < 0)
+		return -1;
+
+	memset(&mreq, 0, sizeof(mreq));
+	mreq.mr_ifindex = ll.sll_ifindex;
+	mreq.mr_type = PACKET_MR_PROMISC;
+	setsockopt(*recv_fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq,
+							sizeof(mreq));
+	setsockopt(*recv_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	return 0;
+}
+
+static int send_msg(int fd, int type, const uint8_t *mac, uint32_t xid,
+			uint32_t reqip, uint32_t serverid)
+{
+	static const uint8_t cookie[4] = { 99, 130, 83, 99 };
+	struct dhcp_msg msg;
+	struct sockaddr_in addr;
+	uint8_t *opt = msg.options;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.op = 1;
+	msg.htype = 1;
+	msg.hlen = 6;
+	msg.xid = xid;
+	msg.flags = htons(0x8000);
+	memcpy(msg.chaddr, mac, 6);
+
+	memcpy(opt, cookie, 4);
+	opt += 4;
+	*opt++ = 53;
+	*opt++ = 1;
+	*opt++ = type;
+	if (reqip) {
+		*opt++ = 50;
+		*opt++ = 4;
+		memcpy(opt, &reqip, 4);
+		opt += 4;
+	}
+	if (serverid) {
+		*opt++ = 54;
+		*opt++ = 4;
+		memcpy(opt, &serverid, 4);
+		opt += 4;
+	}
+	*opt = 255;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(67);
+	addr.sin_addr.s_addr = INADDR_BROADCAST;
+
+	return sendto(fd, &msg, sizeof(msg), 0, (struct sockaddr *)&addr,
+							sizeof(addr));
+}
+
+/* Wait for the reply to xid, return its message type or -1 on timeout */
+static int recv_msg(int fd, uint32_t xid, uint32_t *yiaddr,
+							uint32_t *serverid)
+{
+	uint8_t buf[1500];
+
+	for (;;) {
+		ssize_t len = recv(fd, buf, sizeof(buf), 0);
+		struct iphdr *ip = (struct iphdr *)buf;
+		struct udphdr *udp;
+		struct dhcp_msg *msg;
+		uint8_t *opt, *end;
+		int type = 0;
+
+		if (len < 0)
+			return -1;
+
+		if (len < (ssize_t)sizeof(*ip) || ip->protocol != IPPROTO_UDP)
+			continue;
+
+		udp = (struct udphdr *)(buf + ip->ihl * 4);
+		msg = (struct dhcp_msg *)(udp + 1);
+		end = buf + len;
+		if ((uint8_t *)msg->options + 4 > end ||
+			udp->dest != htons(68) || msg->op != 2 ||
+			msg->xid != xid)
+			continue;
+
+		opt = msg->options + 4;
+
+		while (opt + 2 <= end && *opt != 255) {
+			if (*opt == 0) {
+				opt++;
+				continue;
+			}
+			if (opt[0] == 53)
+				type = opt[2];
+			else if (opt[0] == 54 && opt[1] == 4)
+				memcpy(serverid, &opt[2], 4);
+			opt += opt[1] + 2;
+		}
+
+		*yiaddr = msg->yiaddr;
+		return type;
+	}
+}
+
+/* DISCOVER/OFFER then REQUEST/ACK, return the address or 0 on failure */
+static uint32_t exchange(int send_fd, int recv_fd, int client)
+{
+	uint8_t mac[6] = { 0x02, 0x00, 0x5e, 0x00, client >> 8, client };
+	uint32_t xid = random();
+	uint32_t offered = 0, acked = 0, serverid = 0;
+
+	if (send_msg(send_fd, DHCPDISCOVER, mac, xid, 0, 0) < 0 ||
+		recv_msg(recv_fd, xid, &offered, &serverid) != DHCPOFFER)
+		return 0;
+
+	if (send_msg(send_fd, DHCPREQUEST, mac, xid, offered, serverid) < 0
+		|| recv_msg(recv_fd, xid, &acked, &serverid) != DHCPACK)
+		return 0;
+
+	return acked == offered ? acked : 0;
+}
+
+static int run_clients(void)
+{
+	uint32_t *assigned = calloc(num_clients, sizeof(uint32_t));
+	uint64_t *times = calloc(num_exchanges, sizeof(uint64_t));
+	uint64_t start, total = 0;
+	int errors = 0;
+	int send_fd, recv_fd;
+	int i;
+	char c;
+
+	if (client_sockets(&send_fd, &recv_fd) < 0 || !assigned || !times) {
+		fprintf(stdout, "TEST: failed to set up the client\n");
+		return -1;
+	}
+
+	start = now_us();
+	for (i = 0; i < num_exchanges; i++) {
+		int client = i % num_clients;
+		uint64_t t = now_us();
+		uint32_t addr = exchange(send_fd, recv_fd, client);
+
+		times[i] = now_us() - t;
+		total += times[i];
+
+		if (!addr || (assigned[client] && assigned[client] != addr))
+			errors++;
+		else
+			assigned[client] = addr;
+	}
+
+	qsort(times, num_exchanges, sizeof(uint64_t), compare_u64);
+	fprintf(stdout, "TEST: %d exchanges for %d clients in %.3fs"
+		" (%.0f/s), %d errors\n", num_exchanges, num_clients,
+		(now_us() - start) / 1e6,
+		num_exchanges * 1e6 / (now_us() - start), errors);
+	fprintf(stdout, "TEST: exchange avg %llu us, p99 %llu us,"
+		" max %llu us\n",
+		(unsigned long long)(total / num_exchanges),
+		(unsigned long long)times[num_exchanges * 99 / 100],
+		(unsigned long long)times[num_exchanges - 1]);
+
+	/* Restart the server, clients must get their address back */
+
+	if (write(to_parent[1], "R", 1) != 1 ||
+		read(to_client[0], &c, 1) != 1)
+		return -1;
+
+	for (i = 0; i < num_clients; i++) {
+		if (exchange(send_fd, recv_fd, i) != assigned[i])
+			errors++;
+	}
+
+	fprintf(stdout, "TEST: %d errors after restarting the server\n",
+									errors);
+
+	close(send_fd);
+	close(recv_fd);
+	free(assigned);
+	free(times);
+
+	return errors ? -1 : 0;
+}
+
+static int on_client_request(int fd, enum watch_io io, void *user_data)
+{
+	char c = 0;
+
+	if (read(fd, &c, 1) != 1 || c != 'R') {
+		loop->quit();
+		return 0;
+	}
+
+	if (network->dhcp_server_stop(server) != S_OK ||
+		network->dhcp_server_start(&server, &config) != S_OK) {
+		fprintf(stdout, "TEST: failed to restart the server\n");
+		loop->quit();
+		return 0;
+	}
+
+	if (write(to_client[1], "G", 1) != 1)
+		loop->quit();
+
+	return 1;
+}
+
+static int child_main(void)
+{
+	char c;
+
+	if (unshare(CLONE_NEWNET) < 0 || write(to_parent[1], "N", 1) != 1)
+		return -1;
+
+	/* Wait for the link and the server */
+
+	if (read(to_client[0], &c, 1) != 1 ||
+		system("ip link set lo up && ip link set " CLIENT_IFACE " up"))
+		return -1;
+
+	return run_clients();
+}
+
+static artik_error test_dhcp_server_load(void)
+{
+	char cmd[128];
+	artik_error ret;
+	pid_t pid;
+	int status;
+	int id;
+	char c;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	if (pipe(to_client) < 0 || pipe(to_parent) < 0)
+		return E_NETWORK_ERROR;
+
+	pid = fork();
+	if (pid == 0) {
+		close(to_client[1]);
+		close(to_parent[0]);
+		_exit(child_main() ? 1 : 0);
+	}
+
+	/* The end of the child closes its pipe and stops the loop */
+
+	close(to_client[0]);
+	close(to_parent[1]);
+
+	/* Move the client end of the link to the namespace of the child */
+
+	snprintf(cmd, sizeof(cmd), "ip link set " CLIENT_IFACE " netns %d",
+									pid);
+	if (read(to_parent[0], &c, 1) != 1 || system(cmd)) {
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+		return E_NETWORK_ERROR;
+	}
+
+	ret = network->dhcp_server_start(&server, &config);
+	if (ret != S_OK) {
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+		return ret;
+	}
+
+	if (write(to_client[1], "G", 1) == 1) {
+		loop->add_fd_watch(to_parent[0], WATCH_IO_IN | WATCH_IO_HUP,
+					on_client_request, NULL, &id);
+		loop->run();
+	}
+
+	network->dhcp_server_stop(server);
+
+	waitpid(pid, &status, 0);
+	ret = (WIFEXITED(status) && WEXITSTATUS(status) == 0) ?
+						S_OK : E_NETWORK_ERROR;
+
+	fprintf(stdout, "TEST: %s %s\n", __func__,
+				(ret == S_OK) ? "succeeded" : "failed");
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	artik_error ret;
+
+	if (argc > 1)
+		num_clients = atoi(argv[1]);
+	if (argc > 2)
+		num_exchanges = atoi(argv[2]);
+
+	if (num_clients <= 0 || num_clients > 200 || num_exchanges <= 0) {
+		printf("Usage: %s [clients (max 200)] [exchanges]\n", argv[0]);
+		return 0;
+	}
+
+	if (!artik_is_module_available(ARTIK_MODULE_NETWORK)) {
+		fprintf(stdout,
+			"TEST: NETWORK module is not available,"\
+			" skipping test...\n");
+		return -1;
+	}
+
+	if (unshare(CLONE_NEWNET) < 0) {
+		fprintf(stdout, "TEST: cannot create a network namespace (%s),"
+			" run as root or under \"unshare -rn\"\n",
+			strerror(errno));
+		return -1;
+	}
+
+	if (system("ip link set lo up && ip link add eth0 type veth peer"
+			" name " CLIENT_IFACE " && ip link set eth0 up"))
+		return -1;
+
+	memset(&config, 0, sizeof(config));
+	config.interface = ARTIK_ETHERNET;
+	strncpy(config.ip_addr.address, SERVER_ADDR, MAX_IP_ADDRESS_LEN);
+	strncpy(config.netmask.address, "255.255.255.0", MAX_IP_ADDRESS_LEN);
+	strncpy(config.gw_addr.address, SERVER_ADDR, MAX_IP_ADDRESS_LEN);
+	strncpy(config.dns_addr[0].address, SERVER_ADDR, MAX_IP_ADDRESS_LEN);
+	strncpy(config.start_addr.address, START_ADDR, MAX_IP_ADDRESS_LEN);
+	config.num_leases = num_clients + SPARE_LEASES;
+
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+	network = (artik_network_module *)artik_request_api_module("network");
+
+	ret = test_dhcp_server_load();
+
+	artik_release_api_module(network);
+	artik_release_api_module(loop);
+
+	return (ret == S_OK) ? 0 : -1;
+}
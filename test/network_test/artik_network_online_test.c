@@ -0,0 +1,260 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Online status watch against link flaps. The test moves to a private
+ * network namespace holding a veth pair with a default route through
+ * it, then brings the link down and up, slowly and then in a burst,
+ * while checking the reported status changes and that the main loop
+ * keeps running on time.
+ *
+ * Needs CAP_NET_ADMIN and CAP_SYS_ADMIN, run it as root or under
+ * "unshare -rn".
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <artik_module.h>
+#include <artik_loop.h>
+#include <artik_network.h>
+
+#define LOCAL_ADDR	"10.200.0.1"
+#define PEER_ADDR	"10.200.0.2"
+#define PROBE_PORT	9
+#define PROBE_TIMEOUT	500
+#define TICK_MS		10
+#define MAX_TICK_GAP	100
+#define MAX_EVENTS	64
+
+#define LINK_DOWN	"ip link set veth0 down"
+#define LINK_UP		"ip link set veth0 up && "\
+			"ip route add default via " PEER_ADDR " dev veth0"
+
+static artik_loop_module *loop;
+static artik_network_module *network;
+
+static struct {
+	uint64_t time;
+	bool online;
+} events[MAX_EVENTS];
+static int num_events;
+
+static uint64_t start_ms;
+static uint64_t last_tick;
+static uint64_t max_tick_gap;
+static int tick_id;
+static int failures;
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Run the commands in the background, the loop must not wait for them */
+static void run_async(const char *cmd)
+{
+	pid_t pid = fork();
+
+	if (pid == 0) {
+		execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+		_exit(127);
+	}
+}
+
+static void on_online_status(bool online_status, void *user_data)
+{
+	uint64_t now = now_ms() - start_ms;
+
+	fprintf(stdout, "TEST: %4llu ms: %s\n", (unsigned long long)now,
+				online_status ? "online" : "offline");
+
+	if (num_events < MAX_EVENTS) {
+		events[num_events].time = now;
+		events[num_events].online = online_status;
+		num_events++;
+	}
+}
+
+static void on_tick(void *user_data)
+{
+	uint64_t now = now_ms();
+
+	if (last_tick && now - last_tick > max_tick_gap)
+		max_tick_gap = now - last_tick;
+	last_tick = now;
+
+	loop->add_timeout_callback(&tick_id, TICK_MS, on_tick, NULL);
+}
+
+static void check(bool condition, const char *what)
+{
+	fprintf(stdout, "TEST: %s: %s\n", what, condition ? "ok" : "FAILED");
+	if (!condition)
+		failures++;
+}
+
+/* Count the status changes reported in [from, to[ */
+static int count_events(uint64_t from, uint64_t to, bool *last)
+{
+	int count = 0;
+	int i;
+
+	for (i = 0; i < num_events; i++) {
+		if (events[i].time < from || events[i].time >= to)
+			continue;
+		*last = events[i].online;
+		count++;
+	}
+
+	return count;
+}
+
+static void step_initial(void *user_data)
+{
+	bool online = false;
+
+	network->get_online_status(&online);
+	check(online, "online once the link is configured");
+
+	run_async(LINK_DOWN);
+}
+
+static void step_link_up(void *user_data)
+{
+	run_async(LINK_UP);
+}
+
+static void step_burst(void *user_data)
+{
+	run_async("for i in 1 2 3 4 5 6 7 8 9 10; do " LINK_DOWN "; "
+							LINK_UP "; done");
+}
+
+static void step_quit(void *user_data)
+{
+	loop->quit();
+}
+
+static int setup_namespace(void)
+{
+	if (unshare(CLONE_NEWNET) < 0) {
+		fprintf(stdout, "TEST: cannot create a network namespace (%s),"
+			" run as root or under \"unshare -rn\"\n",
+			strerror(errno));
+		return -1;
+	}
+
+	return system("ip link set lo up && "
+		"ip link add veth0 type veth peer name veth1 && "
+		"ip addr add " LOCAL_ADDR "/24 dev veth0 && "
+		"ip addr add " PEER_ADDR "/24 dev veth1 && "
+		"ip link set veth1 up && " LINK_UP);
+}
+
+static artik_error test_online_link_flaps(void)
+{
+	watch_online_status_handle handle;
+	artik_error ret;
+	bool last = false;
+	int id;
+	int n;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	ret = network->set_online_status_probe(PEER_ADDR, PROBE_PORT,
+							PROBE_TIMEOUT);
+	if (ret != S_OK)
+		return ret;
+
+	start_ms = now_ms();
+	ret = network->add_watch_online_status(&handle, on_online_status,
+									NULL);
+	if (ret != S_OK)
+		return ret;
+
+	loop->add_timeout_callback(&tick_id, TICK_MS, on_tick, NULL);
+	loop->add_timeout_callback(&id, 1500, step_initial, NULL);
+	loop->add_timeout_callback(&id, 3000, step_link_up, NULL);
+	loop->add_timeout_callback(&id, 4500, step_burst, NULL);
+	loop->add_timeout_callback(&id, 7000, step_quit, NULL);
+	loop->run();
+
+	loop->remove_timeout_callback(tick_id);
+	network->remove_watch_online_status(handle);
+
+	n = count_events(1500, 3000, &last);
+	check(n == 1 && !last, "offline after the link went down");
+
+	n = count_events(3000, 4500, &last);
+	check(n == 1 && last, "online after the link came back");
+
+	last = true;
+	n = count_events(4500, 7000, &last);
+	fprintf(stdout, "TEST: %d changes reported for 10 flaps\n", n);
+	check(n <= 2 && last, "burst of flaps coalesced");
+
+	fprintf(stdout, "TEST: longest main loop stall %llu ms\n",
+				(unsigned long long)max_tick_gap);
+	check(max_tick_gap < MAX_TICK_GAP, "main loop not blocked");
+
+	ret = failures ? E_NETWORK_ERROR : S_OK;
+	fprintf(stdout, "TEST: %s %s\n", __func__,
+				(ret == S_OK) ? "succeeded" : "failed");
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	artik_error ret;
+
+	if (!artik_is_module_available(ARTIK_MODULE_NETWORK)) {
+		fprintf(stdout,
+			"TEST: NETWORK module is not available,"\
+			" skipping test...\n");
+		return -1;
+	}
+
+	if (setup_namespace())
+		return -1;
+
+	/* Background commands are not waited for */
+	signal(SIGCHLD, SIG_IGN);
+
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+	network = (artik_network_module *)artik_request_api_module("network");
+
+	ret = test_online_link_flaps();
+
+	artik_release_api_module(network);
+	artik_release_api_module(loop);
+
+	return (ret == S_OK) ? 0 : -1;
+}
@@ -16,13 +16,21 @@
  *
  */
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <artik_module.h>
 #include <artik_security.h>
 
+#define RANDOM_BENCH_CALLS	100000
+#define SETUP_BENCH_CALLS	1000
+#define HASH_BUF_SIZE		(64 * 1024 * 1024)
+#define HASH_NUM_FILES		8
+
 static artik_error test_security_get_serial_number(void)
 {
 	artik_error ret = S_OK;
@@ -118,6 +126,84 @@ exit:
 	return ret;
 }
 
+static double elapsed_sec(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) +
+				(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+ * Security setup done for each connection using the SE, requesting and
+ * releasing a handle as the HTTP and websocket clients do. The first
+ * round reads the SE, the next ones are served from the cache.
+ */
+static artik_error connection_setup(artik_security_module *security)
+{
+	artik_security_handle handle;
+	char *cert = NULL;
+	char *key = NULL;
+	artik_error ret;
+
+	ret = security->request(&handle);
+	if (ret != S_OK)
+		return ret;
+
+	ret = security->get_certificate(handle, &cert);
+	if (ret == S_OK)
+		ret = security->get_key_from_cert(handle, cert, &key);
+
+	security->release(handle);
+	free(cert);
+	free(key);
+
+	return ret;
+}
+
+static artik_error test_security_connection_setup(void)
+{
+	artik_error ret = S_OK;
+	artik_security_module *security = (artik_security_module *)
+					artik_request_api_module("security");
+	artik_security_handle handle;
+	struct timespec start;
+	double cold = 0;
+	int i;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	/* Start from an empty cache */
+	ret = security->request(&handle);
+	if (ret != S_OK)
+		goto exit;
+	security->clear_cache(handle);
+	security->release(handle);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ret = connection_setup(security);
+	cold = elapsed_sec(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < SETUP_BENCH_CALLS && ret == S_OK; i++)
+		ret = connection_setup(security);
+
+	if (ret == S_OK)
+		fprintf(stdout, "SE setup: first %.3fms, cached %.3fms\n",
+			cold * 1000,
+			elapsed_sec(&start) * 1000 / SETUP_BENCH_CALLS);
+
+exit:
+	fprintf(stdout, "TEST: %s %s\n", __func__, (ret == S_OK) ? "succeeded" :
+								"failed");
+
+	artik_release_api_module(security);
+
+	return ret;
+}
+
 static artik_error test_security_random_bytes(void)
 {
 	artik_error ret = S_OK;
@@ -125,6 +211,7 @@ static artik_error test_security_random_bytes(void)
 					artik_request_api_module("security");
 	artik_security_handle handle;
 	unsigned char randbytes[32];
+	struct timespec start;
 	int i = 0;
 
 	fprintf(stdout, "TEST: %s starting\n", __func__);
@@ -149,6 +236,32 @@ static artik_error test_security_random_bytes(void)
 
 	fprintf(stdout, "\n");
 
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < RANDOM_BENCH_CALLS; i++) {
+		ret = security->get_random_bytes(handle, randbytes, 16);
+		if (ret != S_OK) {
+			fprintf(stderr, "Failed to get random bytes (err=%d)\n",
+									ret);
+			goto exit;
+		}
+	}
+	fprintf(stdout, "get_random_bytes(16): %.0f requests/s\n",
+				RANDOM_BENCH_CALLS / elapsed_sec(&start));
+
+	/* Other handles share the engine loaded by the first one */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < RANDOM_BENCH_CALLS / 10; i++) {
+		artik_security_handle other;
+
+		ret = security->request(&other);
+		if (ret != S_OK)
+			goto exit;
+		security->get_random_bytes(other, randbytes, 16);
+		security->release(other);
+	}
+	fprintf(stdout, "request/get_random_bytes/release: %.0f cycles/s\n",
+				RANDOM_BENCH_CALLS / 10 / elapsed_sec(&start));
+
 exit:
 	security->release(handle);
 
@@ -160,9 +273,237 @@ exit:
 	return ret;
 }
 
+#define HASH_ALL_TYPES	(ARTIK_HASH_CRC32 | ARTIK_HASH_SHA1 | \
+			ARTIK_HASH_SHA256 | ARTIK_HASH_SHA512)
+
+/* Known answers, FIPS 180-2 examples and the CRC32 check value */
+static const struct {
+	const char *data;
+	unsigned int crc32;
+	const char *sha1;
+	const char *sha256;
+	const char *sha512;
+} hash_vectors[] = {
+	{
+		"abc", 0x352441c2,
+		"a9993e364706816aba3e25717850c26c9cd0d89d",
+		"ba7816bf8f01cfea414140de5dae2223"
+		"b00361a396177a9cb410ff61f20015ad",
+		"ddaf35a193617abacc417349ae204131"
+		"12e6fa4e89a97ea20a9eeee64b55d39a"
+		"2192992a274fc1a836ba3c23a3feebbd"
+		"454d4423643ce80e2a9ac94fa54ca49f"
+	},
+	{
+		"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+		0x171a3f5f,
+		"84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+		"248d6a61d20638b8e5c026930c3e6039"
+		"a33ce45964ff2167f6ecedd419db06c1",
+		"204a8fc6dda82f0a0ced7beb8e08a416"
+		"57c16ef468b228a8279be331a703c335"
+		"96fd15c13b1b07f9aa1d3bea57789ca0"
+		"31ad85c7a71dd70354ec631238ca3445"
+	},
+	{
+		"123456789", 0xcbf43926,
+		"f7c3bc1d808e04732adf679965ccc34ca7ae3441",
+		"15e2b0d3c33891ebb0f1ef609ec41942"
+		"0c20e320ce94c65fbc8c3312448eb225",
+		"d9e6762dd1c8eaf6d61b3c6192fc408d"
+		"4d6d5f1176d0c29169bc24e71c3f274a"
+		"d27fcd5811b313d681f7e55ec02d73d4"
+		"99c95455b6b5bb503acf574fba8ffe85"
+	}
+};
+
+static bool digest_matches(const unsigned char *digest, const char *hex)
+{
+	char buf[2 * 64 + 1];
+	size_t i;
+
+	for (i = 0; i < strlen(hex) / 2; i++)
+		snprintf(buf + 2 * i, 3, "%02x", digest[i]);
+
+	return !strcmp(buf, hex);
+}
+
+static bool vector_matches(const artik_hash_result *r, unsigned int types,
+				int i)
+{
+	if ((types & ARTIK_HASH_CRC32) && r->crc32 != hash_vectors[i].crc32)
+		return false;
+	if ((types & ARTIK_HASH_SHA1) &&
+			!digest_matches(r->sha1, hash_vectors[i].sha1))
+		return false;
+	if ((types & ARTIK_HASH_SHA256) &&
+			!digest_matches(r->sha256, hash_vectors[i].sha256))
+		return false;
+	if ((types & ARTIK_HASH_SHA512) &&
+			!digest_matches(r->sha512, hash_vectors[i].sha512))
+		return false;
+
+	return true;
+}
+
+static artik_error check_hash_vectors(artik_security_module *security)
+{
+	static const unsigned int types[] = {
+		ARTIK_HASH_CRC32, ARTIK_HASH_SHA1, ARTIK_HASH_SHA256,
+		ARTIK_HASH_SHA512, HASH_ALL_TYPES
+	};
+	artik_hash_result r;
+	artik_error ret;
+	int i, t;
+
+	/* Each digest alone and all of them in a single pass */
+	for (i = 0; i < (int)(sizeof(hash_vectors) /
+					sizeof(hash_vectors[0])); i++) {
+		for (t = 0; t < (int)(sizeof(types) / sizeof(types[0])); t++) {
+			memset(&r, 0, sizeof(r));
+			ret = security->hash_buffer(types[t],
+				(const unsigned char *)hash_vectors[i].data,
+				strlen(hash_vectors[i].data), &r);
+			if (ret != S_OK)
+				return ret;
+
+			if (!vector_matches(&r, types[t], i)) {
+				fprintf(stderr, "Wrong digest of \"%s\""
+					" (types 0x%x)\n",
+					hash_vectors[i].data, types[t]);
+				return E_INVALID_VALUE;
+			}
+		}
+	}
+
+	return S_OK;
+}
+
+static bool same_digests(const artik_hash_result *a,
+				const artik_hash_result *b)
+{
+	return a->crc32 == b->crc32 &&
+		!memcmp(a->sha1, b->sha1, sizeof(a->sha1)) &&
+		!memcmp(a->sha256, b->sha256, sizeof(a->sha256)) &&
+		!memcmp(a->sha512, b->sha512, sizeof(a->sha512));
+}
+
+static artik_error test_security_hash(void)
+{
+	static const struct {
+		const char *name;
+		unsigned int types;
+	} cases[] = {
+		{ "crc32", ARTIK_HASH_CRC32 },
+		{ "sha1", ARTIK_HASH_SHA1 },
+		{ "sha256", ARTIK_HASH_SHA256 },
+		{ "sha512", ARTIK_HASH_SHA512 },
+		{ "all", HASH_ALL_TYPES }
+	};
+	artik_security_module *security = (artik_security_module *)
+					artik_request_api_module("security");
+	artik_hash_result results[HASH_NUM_FILES];
+	char names[HASH_NUM_FILES][32];
+	const char *paths[HASH_NUM_FILES];
+	artik_error errors[HASH_NUM_FILES];
+	artik_hash_result check, expected;
+	artik_error ret = S_OK;
+	struct timespec start;
+	unsigned char *buf;
+	int threads;
+	int i;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	memset(names, 0, sizeof(names));
+
+	ret = check_hash_vectors(security);
+	if (ret != S_OK)
+		goto exit;
+
+	buf = malloc(HASH_BUF_SIZE);
+	if (!buf) {
+		ret = E_NO_MEM;
+		goto exit;
+	}
+
+	for (i = 0; i < HASH_BUF_SIZE; i++)
+		buf[i] = i * 7;
+
+	for (i = 0; i < (int)(sizeof(cases) / sizeof(cases[0])); i++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		ret = security->hash_buffer(cases[i].types, buf, HASH_BUF_SIZE,
+								&check);
+		if (ret != S_OK)
+			break;
+		fprintf(stdout, "hash_buffer(%s): %.1f MB/s\n", cases[i].name,
+			HASH_BUF_SIZE / elapsed_sec(&start) / (1024 * 1024));
+	}
+
+	/* Reference for the files, which hold the first quarter of buf */
+	if (ret == S_OK)
+		ret = security->hash_buffer(HASH_ALL_TYPES, buf,
+				HASH_BUF_SIZE / 4, &expected);
+
+	for (i = 0; i < HASH_NUM_FILES && ret == S_OK; i++) {
+		FILE *fp;
+
+		snprintf(names[i], sizeof(names[i]), "/tmp/hash_test_%d_%d",
+							getpid(), i);
+		paths[i] = names[i];
+		fp = fopen(names[i], "w");
+		if (!fp || fwrite(buf, 1, HASH_BUF_SIZE / 4, fp) !=
+							HASH_BUF_SIZE / 4)
+			ret = E_ACCESS_DENIED;
+		if (fp)
+			fclose(fp);
+	}
+
+	free(buf);
+
+	for (threads = 1; ret == S_OK && threads >= 0; threads--) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		ret = security->hash_files(ARTIK_HASH_SHA256, paths,
+				HASH_NUM_FILES, threads, results, NULL);
+		fprintf(stdout, "hash_files(sha256, %s): %.1f MB/s\n",
+			threads ? "1 thread" : "all CPUs",
+			HASH_NUM_FILES * (HASH_BUF_SIZE / 4) /
+			elapsed_sec(&start) / (1024 * 1024));
+	}
+
+	/* Files must hash to the same digests as the buffer they hold */
+	if (ret == S_OK) {
+		memset(results, 0, sizeof(results));
+		ret = security->hash_files(HASH_ALL_TYPES, paths,
+				HASH_NUM_FILES, 0, results, errors);
+	}
+
+	for (i = 0; i < HASH_NUM_FILES && ret == S_OK; i++) {
+		if (errors[i] != S_OK ||
+				!same_digests(&results[i], &expected)) {
+			fprintf(stderr, "Digests of %s differ from"
+				" hash_buffer\n", paths[i]);
+			ret = E_INVALID_VALUE;
+		}
+	}
+
+	for (i = 0; i < HASH_NUM_FILES; i++)
+		if (names[i][0])
+			unlink(names[i]);
+
+exit:
+	fprintf(stdout, "TEST: %s %s\n", __func__, (ret == S_OK) ? "succeeded" :
+								"failed");
+
+	artik_release_api_module(security);
+
+	return ret;
+}
+
 int main(void)
 {
 	artik_error ret = S_OK;
+	artik_error hash_ret;
 
 	fprintf(stdout, "artik_security_test:\n");
 
@@ -175,6 +516,13 @@ int main(void)
 		goto exit;
 
 	ret = test_security_random_bytes();
+	if (ret != S_OK)
+		goto exit;
+
+	ret = test_security_connection_setup();
 exit:
-	return (ret == S_OK) ? 0 : 1;
+	/* Hashing does not use the SE, test it whatever happened above */
+	hash_ret = test_security_hash();
+
+	return (ret == S_OK && hash_ret == S_OK) ? 0 : 1;
 }
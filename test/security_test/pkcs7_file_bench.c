@@ -0,0 +1,201 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Benchmark of the PKCS7 signature verification of a large image, e.g. a
+ * 256MB firmware. The image is verified by reading it in chunks fed to
+ * verify_signature_update, then through verify_signature_file and its
+ * asynchronous variant. Each run happens in its own process to measure
+ * its peak RSS.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <artik_module.h>
+#include <artik_loop.h>
+#include <artik_security.h>
+
+#define READ_CHUNK	(64 * 1024)
+
+static artik_security_module *security;
+static char *sig_pem;
+static char *ca_pem;
+static const char *image;
+static artik_error async_result;
+
+static char *read_file(const char *filename)
+{
+	struct stat st;
+	char *out;
+	FILE *fp;
+
+	fp = fopen(filename, "r");
+	if (!fp)
+		return NULL;
+
+	if (fstat(fileno(fp), &st) < 0) {
+		fclose(fp);
+		return NULL;
+	}
+
+	out = malloc(st.st_size + 1);
+	if (out)
+		out[fread(out, 1, st.st_size, fp)] = '\0';
+
+	fclose(fp);
+
+	return out;
+}
+
+static artik_error verify_read(void)
+{
+	static unsigned char buf[READ_CHUNK];
+	artik_security_handle handle;
+	artik_error ret;
+	FILE *fp;
+	size_t len;
+
+	fp = fopen(image, "r");
+	if (!fp)
+		return E_ACCESS_DENIED;
+
+	ret = security->verify_signature_init(&handle, sig_pem, ca_pem, NULL,
+									NULL);
+	if (ret != S_OK) {
+		fclose(fp);
+		return ret;
+	}
+
+	while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		ret = security->verify_signature_update(handle, buf, len);
+		if (ret != S_OK)
+			break;
+	}
+	fclose(fp);
+
+	/* Releases the handle */
+	if (ret != S_OK) {
+		security->verify_signature_final(handle);
+		return ret;
+	}
+
+	return security->verify_signature_final(handle);
+}
+
+static artik_error verify_mmap(void)
+{
+	return security->verify_signature_file(image, sig_pem, ca_pem, NULL,
+							NULL, NULL, NULL);
+}
+
+static void on_verified(artik_error result, void *user_data)
+{
+	artik_loop_module *loop = user_data;
+
+	async_result = result;
+	loop->quit();
+}
+
+static artik_error verify_async(void)
+{
+	artik_loop_module *loop;
+	artik_error ret;
+
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+	ret = security->verify_signature_file_async(image, sig_pem, ca_pem,
+					NULL, NULL, NULL, on_verified, loop);
+	if (ret == S_OK) {
+		loop->run();
+		ret = async_result;
+	}
+	artik_release_api_module(loop);
+
+	return ret;
+}
+
+static void run_bench(const char *name, artik_error (*verify)(void),
+							off_t size)
+{
+	struct timespec start, stop;
+	struct rusage usage;
+	double elapsed;
+	int status;
+	pid_t pid;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	pid = fork();
+	if (pid == 0)
+		exit(verify() == S_OK ? 0 : 1);
+
+	if (pid < 0 || wait4(pid, &status, 0, &usage) < 0) {
+		fprintf(stderr, "%s: failed to run\n", name);
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	elapsed = (stop.tv_sec - start.tv_sec) +
+				(stop.tv_nsec - start.tv_nsec) / 1e9;
+
+	fprintf(stdout, "%-8s %s %8.1f MB/s, peak RSS %ld kB\n", name,
+		(WIFEXITED(status) && !WEXITSTATUS(status)) ? "ok    " :
+		"FAILED", size / elapsed / (1024 * 1024), usage.ru_maxrss);
+}
+
+int main(int argc, char **argv)
+{
+	struct stat st;
+
+	if (argc < 4) {
+		printf("Usage: pkcs7-file-bench <signature> <root CA> <signed data>\n");
+		return -1;
+	}
+
+	sig_pem = read_file(argv[1]);
+	ca_pem = read_file(argv[2]);
+	image = argv[3];
+	if (!sig_pem || !ca_pem || stat(image, &st) < 0) {
+		fprintf(stderr, "Failed to read input files\n");
+		return -1;
+	}
+
+	security = (artik_security_module *)artik_request_api_module("security");
+	if (!security) {
+		fprintf(stderr, "Security module is not available\n");
+		return -1;
+	}
+
+	fprintf(stdout, "Verifying %lld MB\n",
+				(long long)st.st_size / (1024 * 1024));
+	run_bench("read", verify_read, st.st_size);
+	run_bench("mmap", verify_mmap, st.st_size);
+	run_bench("async", verify_async, st.st_size);
+
+	artik_release_api_module(security);
+	free(sig_pem);
+	free(ca_pem);
+
+	return 0;
+}
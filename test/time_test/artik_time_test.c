@@ -31,12 +31,27 @@
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/timex.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 #include <artik_module.h>
 #include <artik_loop.h>
 #include <artik_time.h>
 
 #define MAX_SIZE 128
+#define TICK_CALLS 1000000
+#define NTP_SERVERS 3
+#define NUM_ALARMS 100000
+/* Alarms created by a worker thread while the loop dispatches others */
+#define THREAD_ALARMS 10000
+#define NTP_EPOCH 2208988800ULL
+/* Frequency error of the stand-in server in the drift test */
+#define NTP_DRIFT_PPB 100000LL
 
 static int end = 1;
 artik_time_module *time_module_p;
@@ -148,6 +163,502 @@ static artik_error test_time_loopback(void)
 	return ret;
 }
 
+static double bench_ns_per_call(struct timespec *start, struct timespec *stop)
+{
+	return ((stop->tv_sec - start->tv_sec) * 1e9 +
+		(stop->tv_nsec - start->tv_nsec)) / TICK_CALLS;
+}
+
+static artik_error test_time_tick_bench(void)
+{
+	static const char * const names[] = {
+		"monotonic", "monotonic raw", "monotonic coarse"
+	};
+	struct timespec start, stop;
+	artik_nsecond prev, now;
+	int clock;
+	int i;
+
+	fprintf(stdout, "TEST: %s started\n", __func__);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < TICK_CALLS; i++)
+		time_module_p->get_tick();
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	fprintf(stdout, "get_tick: %.1fns per call\n",
+					bench_ns_per_call(&start, &stop));
+
+	for (clock = ARTIK_CLOCK_MONOTONIC;
+			clock <= ARTIK_CLOCK_MONOTONIC_COARSE; clock++) {
+		prev = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < TICK_CALLS; i++) {
+			now = time_module_p->get_monotonic(clock);
+			if (now < prev) {
+				fprintf(stdout, "TEST: %s %s went backwards\n",
+						__func__, names[clock]);
+				return E_INVALID_VALUE;
+			}
+			prev = now;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &stop);
+		fprintf(stdout, "get_monotonic(%s): %.1fns per call\n",
+			names[clock], bench_ns_per_call(&start, &stop));
+	}
+
+	now = time_module_p->get_deadline(100);
+	usleep(50000);
+	if (time_module_p->get_remaining(now) > 50) {
+		fprintf(stdout, "TEST: %s wrong remaining time\n", __func__);
+		return E_INVALID_VALUE;
+	}
+
+	fprintf(stdout, "TEST: %s finished\n", __func__);
+
+	return S_OK;
+}
+
+static void _alarm_callback_count(void *user_data)
+{
+	int *count = user_data;
+
+	if (++(*count) == 2)
+		loop->quit();
+}
+
+static artik_error test_time_alarm_scheduler(void)
+{
+	artik_alarm_handle *handles;
+	artik_alarm_handle cron = NULL;
+	artik_alarm_handle first = NULL, second = NULL;
+	struct timespec start, stop;
+	artik_msecond delay;
+	artik_error ret = S_OK;
+	int count = 0;
+	int i;
+
+	fprintf(stdout, "TEST: %s started\n", __func__);
+
+	handles = calloc(NUM_ALARMS, sizeof(artik_alarm_handle));
+	if (!handles)
+		return E_NO_MEM;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < NUM_ALARMS; i++) {
+		ret = time_module_p->create_alarm_second(ARTIK_TIME_UTC,
+				3600 + rand() % 86400, &handles[i],
+				_alarm_callback_1, NULL);
+		if (ret != S_OK)
+			goto exit;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	fprintf(stdout, "create_alarm_second: %.1fns per alarm\n",
+					bench_ns_per_call(&start, &stop) *
+					TICK_CALLS / NUM_ALARMS);
+
+	/* Two short alarms must fire in order among all the others */
+	time_module_p->create_alarm_second(ARTIK_TIME_UTC, 2, &second,
+				_alarm_callback_count, &count);
+	time_module_p->create_alarm_second(ARTIK_TIME_UTC, 1, &first,
+				_alarm_callback_count, &count);
+
+	ret = time_module_p->create_alarm_cron(ARTIK_TIME_GMT2, "*/5 * * * *",
+				&cron, _alarm_callback_1, NULL);
+	if (ret != S_OK)
+		goto exit;
+
+	time_module_p->get_delay_alarm(cron, &delay);
+	if (delay > 5 * 60) {
+		fprintf(stdout, "TEST: %s wrong cron delay %lu\n", __func__,
+									delay);
+		ret = E_INVALID_VALUE;
+		goto exit;
+	}
+
+	loop->run();
+
+	time_module_p->get_delay_alarm(first, &delay);
+	if (count != 2 || delay != 0) {
+		fprintf(stdout, "TEST: %s short alarms did not fire\n",
+								__func__);
+		ret = E_INVALID_VALUE;
+	}
+
+exit:
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < NUM_ALARMS; i++)
+		if (handles[i])
+			time_module_p->delete_alarm(handles[i]);
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	fprintf(stdout, "delete_alarm: %.1fns per alarm\n",
+					bench_ns_per_call(&start, &stop) *
+					TICK_CALLS / NUM_ALARMS);
+
+	if (first)
+		time_module_p->delete_alarm(first);
+	if (second)
+		time_module_p->delete_alarm(second);
+	if (cron)
+		time_module_p->delete_alarm(cron);
+	free(handles);
+
+	fprintf(stdout, "TEST: %s %s\n", __func__,
+				(ret == S_OK) ? "succeeded" : "failed");
+
+	return ret;
+}
+
+static artik_alarm_handle thread_handles[THREAD_ALARMS];
+static int thread_kept, thread_fired;
+
+static void _alarm_callback_thread(void *user_data)
+{
+	__atomic_add_fetch(&thread_fired, 1, __ATOMIC_RELAXED);
+}
+
+static void on_alarm_work(void *user_data)
+{
+	artik_alarm_handle handle;
+	int i;
+
+	/* Over about two seconds, the first ones go off meanwhile */
+	for (i = 0; i < THREAD_ALARMS; i++) {
+		handle = NULL;
+		if (time_module_p->create_alarm_second(ARTIK_TIME_UTC, 1,
+				&handle, _alarm_callback_thread,
+				NULL) != S_OK)
+			break;
+
+		if (i % 2)
+			time_module_p->delete_alarm(handle);
+		else
+			thread_handles[thread_kept++] = handle;
+		usleep(200);
+	}
+}
+
+static void on_alarm_quit(void *user_data)
+{
+	loop->quit();
+}
+
+static void on_alarm_work_done(void *user_data)
+{
+	int id;
+
+	/* Let the last alarms go off */
+	loop->add_timeout_callback(&id, 2000, on_alarm_quit, NULL);
+}
+
+static artik_error test_time_alarm_threads(void)
+{
+	artik_error ret;
+	int i;
+
+	fprintf(stdout, "TEST: %s started\n", __func__);
+
+	ret = loop->submit_work(on_alarm_work, on_alarm_work_done, NULL);
+	if (ret != S_OK)
+		goto exit;
+
+	loop->run();
+
+	fprintf(stdout, "%d alarms kept, %d went off\n", thread_kept,
+								thread_fired);
+	if (thread_kept != THREAD_ALARMS / 2 || thread_fired != thread_kept)
+		ret = E_INVALID_VALUE;
+
+	for (i = 0; i < thread_kept; i++)
+		time_module_p->delete_alarm(thread_handles[i]);
+
+exit:
+	fprintf(stdout, "TEST: %s %s\n", __func__,
+				(ret == S_OK) ? "succeeded" : "failed");
+
+	return ret;
+}
+
+/*
+ * Stand-in NTP servers on 127.0.0.1, 127.0.0.2, ..., answering with a
+ * clock ahead by offsets_us and running faster by rate_ppb. Their clock
+ * follows CLOCK_MONOTONIC_RAW so that slewing the local clock does not
+ * move it.
+ */
+static void ntp_serve(const int *fds, const long long *offsets_us, int count,
+			long long rate_ppb)
+{
+	struct pollfd pfd[NTP_SERVERS];
+	unsigned char msg[48];
+	struct sockaddr_in from;
+	struct timespec ts;
+	long long base, raw;
+	socklen_t len;
+	int i;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	base = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	raw = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+
+	for (i = 0; i < count; i++) {
+		pfd[i].fd = fds[i];
+		pfd[i].events = POLLIN;
+	}
+
+	while (poll(pfd, count, -1) > 0) {
+		for (i = 0; i < count; i++) {
+			unsigned long long ntp;
+			long long elapsed;
+			uint32_t sec, frac;
+
+			if (!(pfd[i].revents & POLLIN))
+				continue;
+
+			len = sizeof(from);
+			if (recvfrom(fds[i], msg, sizeof(msg), 0,
+				(struct sockaddr *)&from, &len) != sizeof(msg))
+				continue;
+
+			clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+			elapsed = ts.tv_sec * 1000000000LL + ts.tv_nsec - raw;
+			ntp = base + elapsed + elapsed / 1000 * rate_ppb /
+				1000000 + offsets_us[i] * 1000;
+			sec = htonl(ntp / 1000000000 + NTP_EPOCH);
+			frac = htonl(((ntp % 1000000000) << 32) / 1000000000);
+
+			/* Originate is the client transmit timestamp */
+			memcpy(msg + 24, msg + 40, 8);
+			memcpy(msg + 32, &sec, 4);
+			memcpy(msg + 36, &frac, 4);
+			memcpy(msg + 40, &sec, 4);
+			memcpy(msg + 44, &frac, 4);
+			msg[0] = 0x24;
+			msg[1] = 2;
+
+			sendto(fds[i], msg, sizeof(msg), 0,
+				(struct sockaddr *)&from, len);
+		}
+	}
+
+	exit(0);
+}
+
+/* Bind the stand-in servers on a shared port and fork them */
+static pid_t ntp_start_servers(const long long *offsets_us, int count,
+			long long rate_ppb, unsigned short *port)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int fds[NTP_SERVERS];
+	pid_t pid;
+	int i;
+
+	if (count > NTP_SERVERS)
+		return -1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	for (i = 0; i < count; i++) {
+		char ip[16];
+
+		snprintf(ip, sizeof(ip), "127.0.0.%d", i + 1);
+		inet_pton(AF_INET, ip, &addr.sin_addr);
+		fds[i] = socket(AF_INET, SOCK_DGRAM, 0);
+		if (fds[i] < 0 || bind(fds[i], (struct sockaddr *)&addr,
+							sizeof(addr)) < 0) {
+			fprintf(stdout, "TEST: failed to bind %s\n", ip);
+			return -1;
+		}
+		/* All the servers share the first ephemeral port */
+		if (!i)
+			getsockname(fds[0], (struct sockaddr *)&addr, &len);
+	}
+
+	pid = fork();
+	if (pid == 0)
+		ntp_serve(fds, offsets_us, count, rate_ppb);
+
+	for (i = 0; i < count; i++)
+		close(fds[i]);
+
+	*port = ntohs(addr.sin_port);
+
+	return pid;
+}
+
+static void _ntp_callback(artik_error result, const artik_ntp_result *info,
+			void *user_data)
+{
+	artik_error *ret = user_data;
+
+	if (result != S_OK) {
+		fprintf(stdout, "TEST: NTP sync failed (%s)\n",
+							error_msg(result));
+		*ret = result;
+	} else {
+		fprintf(stdout, "offset %lldus, delay %lluus, %d samples\n",
+			info->offset_usec, info->delay_usec,
+			info->num_samples);
+		if (info->num_samples != 2 || info->offset_usec < 45000 ||
+						info->offset_usec > 57000)
+			*ret = E_INVALID_VALUE;
+		else
+			*ret = S_OK;
+	}
+
+	loop->quit();
+}
+
+static artik_error test_time_ntp_client(void)
+{
+	static const char * const servers[NTP_SERVERS] = {
+		"127.0.0.1", "127.0.0.2", "127.0.0.3"
+	};
+	/* The last server is an outlier */
+	static const long long offsets_us[NTP_SERVERS] = {
+		50000, 52000, 5000000
+	};
+	artik_ntp_config config;
+	artik_ntp_handle handle;
+	artik_error ret = E_BUSY;
+	pid_t pid;
+
+	fprintf(stdout, "TEST: %s started\n", __func__);
+
+	memset(&config, 0, sizeof(config));
+	pid = ntp_start_servers(offsets_us, NTP_SERVERS, 0, &config.port);
+	if (pid < 0)
+		return E_BUSY;
+
+	config.servers = servers;
+	config.num_servers = NTP_SERVERS;
+	config.timeout = 1000;
+
+	if (time_module_p->start_ntp_sync(&handle, &config, _ntp_callback,
+							&ret) == S_OK) {
+		loop->run();
+		time_module_p->stop_ntp_sync(handle);
+	}
+
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+
+	fprintf(stdout, "TEST: %s %s\n", __func__,
+					(ret == S_OK) ? "succeeded" : "failed");
+
+	return ret;
+}
+
+struct ntp_drift_test {
+	int rounds;
+	long long offset_usec;
+	artik_error ret;
+};
+
+static void _ntp_drift_callback(artik_error result,
+			const artik_ntp_result *info, void *user_data)
+{
+	struct ntp_drift_test *test = user_data;
+
+	if (result != S_OK) {
+		fprintf(stdout, "TEST: NTP sync failed (%s)\n",
+							error_msg(result));
+		test->ret = result;
+		loop->quit();
+		return;
+	}
+
+	fprintf(stdout, "offset %lldus, drift %lldppb\n", info->offset_usec,
+							info->drift_ppb);
+	test->offset_usec += info->offset_usec;
+	if (++test->rounds < 2)
+		return;
+
+	/*
+	 * The first offset was slewed, the second one is the drift. A few
+	 * tens of microseconds of jitter on 3s give a wide margin.
+	 */
+	if (info->drift_ppb < NTP_DRIFT_PPB / 2 ||
+				info->drift_ppb > NTP_DRIFT_PPB * 3 / 2)
+		test->ret = E_INVALID_VALUE;
+	else
+		test->ret = S_OK;
+
+	loop->quit();
+}
+
+/*
+ * Two rounds against a server 1ms ahead and running fast. The client
+ * slews the first offset away, the drift comes from the second one.
+ */
+static artik_error test_time_ntp_drift(void)
+{
+	static const char * const servers[] = { "127.0.0.1" };
+	static const long long offsets_us[] = { 1000 };
+	struct ntp_drift_test test = { 0, 0, E_BUSY };
+	artik_ntp_config config;
+	artik_ntp_handle handle;
+	struct timeval delta, left;
+	struct timex tx;
+	long freq;
+	pid_t pid;
+
+	fprintf(stdout, "TEST: %s started\n", __func__);
+
+	/* The clock only slews as root */
+	memset(&tx, 0, sizeof(tx));
+	if (geteuid() || adjtimex(&tx) < 0) {
+		fprintf(stdout, "TEST: %s skipped, needs root\n", __func__);
+		return S_OK;
+	}
+
+	/* Run at the nominal frequency so the servers do not drift away */
+	freq = tx.freq;
+	tx.modes = ADJ_FREQUENCY;
+	tx.freq = 0;
+	adjtimex(&tx);
+
+	memset(&config, 0, sizeof(config));
+	pid = ntp_start_servers(offsets_us, 1, NTP_DRIFT_PPB, &config.port);
+	if (pid < 0)
+		return E_BUSY;
+
+	config.servers = servers;
+	config.num_servers = 1;
+	config.timeout = 1000;
+	/* Long enough for the 1ms slew to complete */
+	config.period = 3000;
+	config.adjust_clock = true;
+
+	if (time_module_p->start_ntp_sync(&handle, &config,
+				_ntp_drift_callback, &test) == S_OK) {
+		loop->run();
+		time_module_p->stop_ntp_sync(handle);
+	}
+
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+
+	/* Undo the slews, minus what is left of the last one */
+	memset(&delta, 0, sizeof(delta));
+	if (adjtime(&delta, &left) == 0) {
+		delta.tv_sec = 0;
+		delta.tv_usec = left.tv_sec * 1000000LL + left.tv_usec -
+							test.offset_usec;
+		adjtime(&delta, NULL);
+	}
+	/* And the frequency correction */
+	memset(&tx, 0, sizeof(tx));
+	tx.modes = ADJ_FREQUENCY;
+	tx.freq = freq;
+	adjtimex(&tx);
+
+	fprintf(stdout, "TEST: %s %s\n", __func__,
+				(test.ret == S_OK) ? "succeeded" : "failed");
+
+	return test.ret;
+}
+
 artik_error test_time_sync_ntp(void)
 {
 	artik_error ret;
@@ -179,10 +690,30 @@ int main(void)
 
 	time_module_p = (artik_time_module *)artik_request_api_module("time");
 
+	ret = test_time_tick_bench();
+	if (ret != S_OK)
+		goto exit;
+
 	ret = test_time_loopback();
 	if (ret != S_OK)
 		goto exit;
 
+	ret = test_time_alarm_scheduler();
+	if (ret != S_OK)
+		goto exit;
+
+	ret = test_time_alarm_threads();
+	if (ret != S_OK)
+		goto exit;
+
+	ret = test_time_ntp_client();
+	if (ret != S_OK)
+		goto exit;
+
+	ret = test_time_ntp_drift();
+	if (ret != S_OK)
+		goto exit;
+
 	ret = test_time_sync_ntp();
 
 exit:
@@ -0,0 +1,604 @@
+/*
+ *
+ * Copyright 2017 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ */
+
+/*
+ * Wi-Fi station mode against a stub wpa_supplicant control socket. The
+ * test mounts a private /var/run holding the stub socket, then checks
+ * that a dense scan comes back whole, that the cached results follow
+ * BSS added/removed events, and that a slow network setup does not hold
+ * the main loop.
+ *
+ * Needs CAP_SYS_ADMIN, run it as root or under "unshare -rm".
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/mount.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <artik_module.h>
+#include <artik_loop.h>
+#include <artik_wifi.h>
+
+#define CTRL_DIR	"/var/run/wpa_supplicant"
+#define CTRL_PATH	CTRL_DIR "/wlan0"
+#define REPLY_SIZE	4096
+#define MAX_BSS		256
+#define MAX_EVENTS	512
+#define DENSE_COUNT	200
+#define TICK_MS		10
+#define MAX_TICK_GAP	100
+#define BSS_REMOVED	"<2>CTRL-EVENT-BSS-REMOVED "
+
+/* Counters shared with the stub process */
+struct stub_stats {
+	int bss_requests;
+	int add_network;
+	int save_config;
+};
+
+static struct stub_stats *stats;
+
+/*
+ * Stub wpa_supplicant, serving the control socket from a child process.
+ */
+static struct {
+	unsigned int id;
+	int present;
+	int level;
+	char ssid[33];
+} bss[MAX_BSS];
+static unsigned int num_bss;
+
+static struct {
+	uint64_t at;
+	char text[64];
+} pending[MAX_EVENTS];
+static int num_pending;
+
+static struct sockaddr_un monitor;
+static socklen_t monitor_len;
+static int scan_round;
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Queue an unsolicited event, keeping the queue in time order */
+static void stub_event(unsigned int delay, const char *fmt, ...)
+{
+	uint64_t at = now_ms() + delay;
+	va_list ap;
+	int i;
+
+	if (num_pending == MAX_EVENTS)
+		return;
+
+	for (i = num_pending; i > 0 && pending[i - 1].at > at; i--)
+		;
+	memmove(&pending[i + 1], &pending[i],
+			(num_pending - i) * sizeof(pending[0]));
+	num_pending++;
+
+	pending[i].at = at;
+	va_start(ap, fmt);
+	vsnprintf(pending[i].text, sizeof(pending[i].text), fmt, ap);
+	va_end(ap);
+}
+
+static void stub_add_bss(unsigned int delay, int level)
+{
+	unsigned int i = num_bss++;
+
+	bss[i].id = i;
+	bss[i].present = 1;
+	bss[i].level = level;
+	snprintf(bss[i].ssid, sizeof(bss[i].ssid), "dense-network-%03u", i);
+	stub_event(delay, "<2>CTRL-EVENT-BSS-ADDED %u 02:00:00:00:%02x:%02x",
+						i, i >> 8, i & 0xff);
+}
+
+/* The BSS goes away once the event is sent */
+static void stub_remove_bss(unsigned int delay, unsigned int i)
+{
+	stub_event(delay, BSS_REMOVED "%u 02:00:00:00:%02x:%02x", i, i >> 8,
+								i & 0xff);
+}
+
+/*
+ * First scan finds DENSE_COUNT networks, the second one loses 20 of them,
+ * finds 10 new ones and sees the others weaker. Some time after that one
+ * more expires on its own.
+ */
+static void stub_scan(void)
+{
+	unsigned int i;
+
+	stub_event(0, "<2>CTRL-EVENT-SCAN-STARTED ");
+
+	if (scan_round++ == 0) {
+		for (i = 0; i < DENSE_COUNT; i++)
+			stub_add_bss(50, -40 - (i % 50));
+	} else {
+		for (i = 10; i < 30; i++)
+			stub_remove_bss(50, i);
+		for (i = 0; i < num_bss; i++)
+			bss[i].level -= 5;
+		for (i = 0; i < 10; i++)
+			stub_add_bss(50, -70);
+		stub_remove_bss(1000, 0);
+	}
+
+	stub_event(100, "<2>CTRL-EVENT-SCAN-RESULTS ");
+}
+
+static int stub_last_present(void)
+{
+	int i;
+
+	for (i = num_bss - 1; i >= 0; i--)
+		if (bss[i].present)
+			return i;
+
+	return -1;
+}
+
+/* Whole entries only, the last BSS known ends with "####" */
+static size_t stub_bss_range(unsigned int first, char *reply)
+{
+	int last = stub_last_present();
+	size_t len = 0;
+	unsigned int i;
+
+	for (i = first; i < num_bss; i++) {
+		char entry[256];
+		int n;
+
+		if (!bss[i].present)
+			continue;
+
+		n = snprintf(entry, sizeof(entry),
+			"id=%u\nbssid=02:00:00:00:%02x:%02x\nfreq=%d\n"
+			"level=%d\nflags=%s\nssid=%s\n%s\n", i, i >> 8,
+			i & 0xff, (i % 2) ? 5180 : 2437, bss[i].level,
+			(i % 3) ? "[WPA2-PSK-CCMP][WPS][ESS]" : "[ESS]",
+			bss[i].ssid, ((int)i == last) ? "####" : "====");
+		if (len + n >= REPLY_SIZE)
+			break;
+
+		memcpy(reply + len, entry, n);
+		len += n;
+	}
+
+	return len;
+}
+
+static size_t stub_command(const char *cmd, char *reply)
+{
+	if (!strcmp(cmd, "ATTACH") || !strcmp(cmd, "DETACH"))
+		return sprintf(reply, "OK\n");
+
+	if (!strcmp(cmd, "SCAN")) {
+		stub_scan();
+		return sprintf(reply, "OK\n");
+	}
+
+	if (!strncmp(cmd, "BSS RANGE=", 10)) {
+		stats->bss_requests++;
+		return stub_bss_range(atoi(cmd + 10), reply);
+	}
+
+	if (!strcmp(cmd, "LIST_NETWORKS"))
+		return sprintf(reply, "network id / ssid / bssid / flags\n"
+			"0\tdense-network-0050\tany\t[DISABLED]\n"
+			"1\tdense-network-005\tany\t[DISABLED]\n");
+
+	if (!strcmp(cmd, "ADD_NETWORK")) {
+		stats->add_network++;
+		return sprintf(reply, "2\n");
+	}
+
+	if (!strncmp(cmd, "SET_NETWORK", 11)) {
+		if (strstr(cmd, "rejected"))
+			return sprintf(reply, "FAIL\n");
+		/* A busy supplicant takes its time */
+		usleep(300 * 1000);
+		return sprintf(reply, "OK\n");
+	}
+
+	if (!strncmp(cmd, "SELECT_NETWORK", 14)) {
+		stub_event(100, "<3>CTRL-EVENT-CONNECTED - Connection to "
+						"02:00:00:00:00:05 completed");
+		return sprintf(reply, "OK\n");
+	}
+
+	if (!strcmp(cmd, "SAVE_CONFIG")) {
+		stats->save_config++;
+		usleep(500 * 1000);
+		return sprintf(reply, "OK\n");
+	}
+
+	if (!strcmp(cmd, "DISCONNECT")) {
+		stub_event(10, "<3>CTRL-EVENT-DISCONNECTED "
+			"bssid=02:00:00:00:00:05 reason=3 "
+			"locally_generated=1");
+		return sprintf(reply, "OK\n");
+	}
+
+	return sprintf(reply, "UNKNOWN COMMAND\n");
+}
+
+static void stub_run(int sock)
+{
+	static char reply[REPLY_SIZE];
+	char cmd[512];
+
+	for (;;) {
+		struct pollfd pfd = { .fd = sock, .events = POLLIN };
+		struct sockaddr_un from;
+		socklen_t from_len = sizeof(from);
+		uint64_t now = now_ms();
+		int timeout = -1;
+		ssize_t len;
+
+		/* Events go out in order, past due ones first */
+		while (num_pending && pending[0].at <= now) {
+			if (!strncmp(pending[0].text, BSS_REMOVED,
+						strlen(BSS_REMOVED)))
+				bss[atoi(pending[0].text +
+					strlen(BSS_REMOVED))].present = 0;
+			if (monitor_len)
+				sendto(sock, pending[0].text,
+					strlen(pending[0].text), 0,
+					(struct sockaddr *)&monitor,
+					monitor_len);
+			num_pending--;
+			memmove(&pending[0], &pending[1],
+					num_pending * sizeof(pending[0]));
+		}
+		if (num_pending)
+			timeout = pending[0].at - now;
+
+		if (poll(&pfd, 1, timeout) <= 0)
+			continue;
+
+		len = recvfrom(sock, cmd, sizeof(cmd) - 1, 0,
+				(struct sockaddr *)&from, &from_len);
+		if (len <= 0)
+			continue;
+		cmd[len] = '\0';
+
+		if (!strcmp(cmd, "ATTACH")) {
+			monitor = from;
+			monitor_len = from_len;
+		}
+
+		len = stub_command(cmd, reply);
+		sendto(sock, reply, len, 0, (struct sockaddr *)&from,
+								from_len);
+	}
+}
+
+static pid_t start_stub(void)
+{
+	struct sockaddr_un addr;
+	pid_t pid;
+	int sock;
+
+	sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (sock < 0)
+		return -1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, CTRL_PATH, sizeof(addr.sun_path) - 1);
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(sock);
+		return -1;
+	}
+
+	pid = fork();
+	if (pid == 0) {
+		stub_run(sock);
+		_exit(0);
+	}
+	close(sock);
+
+	return pid;
+}
+
+static int setup_namespace(void)
+{
+	if (unshare(CLONE_NEWNS) < 0 ||
+	    mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) < 0 ||
+	    mount("tmpfs", "/var/run", "tmpfs", 0, NULL) < 0 ||
+	    mkdir(CTRL_DIR, 0755) < 0) {
+		fprintf(stdout, "TEST: cannot set up a private %s (%s),"
+			" run as root or under \"unshare -rm\"\n", CTRL_DIR,
+			strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Test steps, chained from the callbacks.
+ */
+static artik_loop_module *loop;
+static artik_wifi_module *wifi;
+
+static uint64_t last_tick;
+static uint64_t max_tick_gap;
+static int tick_id;
+static int failures;
+static int requests_at_results;
+static int scan_count;
+static int connect_count;
+
+static void on_tick(void *user_data)
+{
+	uint64_t now = now_ms();
+
+	if (last_tick && now - last_tick > max_tick_gap)
+		max_tick_gap = now - last_tick;
+	last_tick = now;
+
+	loop->add_timeout_callback(&tick_id, TICK_MS, on_tick, NULL);
+}
+
+static void check(bool condition, const char *what)
+{
+	fprintf(stdout, "TEST: %s: %s\n", what, condition ? "ok" : "FAILED");
+	if (!condition)
+		failures++;
+}
+
+static void step_quit(void *user_data)
+{
+	loop->quit();
+}
+
+static int get_results(artik_wifi_ap **aps)
+{
+	int count = 0;
+
+	*aps = NULL;
+	if (wifi->get_scan_result(aps, &count) != S_OK)
+		return -1;
+
+	return count;
+}
+
+static int find_ap(artik_wifi_ap *aps, int count, const char *name)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		if (!strcmp(aps[i].name, name))
+			return i;
+
+	return -1;
+}
+
+static void step_connect_rejected(void *user_data)
+{
+	check(wifi->connect("rejected", NULL, false) == S_OK,
+						"rejected network accepted");
+}
+
+static void step_connect(void *user_data)
+{
+	uint64_t start = now_ms();
+	artik_error ret;
+
+	ret = wifi->connect("dense-network-005", "passphrase", true);
+	check(ret == S_OK, "connect accepted after a failed one");
+	check(now_ms() - start < MAX_TICK_GAP / 2,
+						"connect returned right away");
+}
+
+static void on_connect(void *result, void *user_data)
+{
+	artik_wifi_connection_info *info = result;
+	int id;
+
+	fprintf(stdout, "TEST: connected=%d err=%d\n", info->connected,
+								info->error);
+
+	switch (connect_count++) {
+	case 0:
+		check(!info->connected && info->error == E_WIFI_ERROR,
+						"failed setup reported");
+		loop->add_timeout_callback(&id, 100, step_connect, NULL);
+		break;
+	case 1:
+		check(info->connected && info->error == S_OK,
+						"connected to the network");
+		check(stats->add_network == 1, "existing profile reused");
+		check(stats->save_config == 1, "profile saved");
+		wifi->disconnect();
+		break;
+	case 2:
+		check(!info->connected, "disconnected");
+		loop->add_timeout_callback(&id, 100, step_quit, NULL);
+		break;
+	}
+}
+
+static void step_expired(void *user_data)
+{
+	artik_wifi_ap *aps;
+	int requests = stats->bss_requests;
+	int count;
+	int id;
+
+	count = get_results(&aps);
+	check(count == DENSE_COUNT - 11, "expired network dropped");
+	check(find_ap(aps, count, "dense-network-000") < 0,
+						"expired network not listed");
+	check(stats->bss_requests == requests, "removal applied in place");
+	free(aps);
+
+	loop->add_timeout_callback(&id, 10, step_connect_rejected, NULL);
+}
+
+static void step_rescan(void *user_data)
+{
+	check(wifi->scan_request() == S_OK, "second scan requested");
+}
+
+static void on_scan_result(void *result, void *user_data)
+{
+	artik_error err = *((artik_error *)result);
+	artik_wifi_ap *aps;
+	int requests = stats->bss_requests;
+	int count;
+	int i;
+	int id;
+
+	fprintf(stdout, "TEST: scan results (err=%d) after %d fetches\n",
+				err, requests - requests_at_results);
+	requests_at_results = requests;
+	check(err == S_OK, "scan succeeded");
+
+	count = get_results(&aps);
+	check(stats->bss_requests == requests, "results read from the cache");
+
+	if (scan_count++ == 0) {
+		check(count == DENSE_COUNT, "dense scan complete");
+		i = find_ap(aps, count, "dense-network-199");
+		check(i >= 0 && aps[i].frequency == 5180 &&
+			aps[i].signal_level == -89 &&
+			aps[i].encryption_flags == WIFI_ENCRYPTION_WPA2 &&
+			!strcmp(aps[i].bssid, "2:0:0:0:0:c7"),
+			"entry parsed");
+		free(aps);
+		loop->add_timeout_callback(&id, 10, step_rescan, NULL);
+		return;
+	}
+
+	check(count == DENSE_COUNT - 10, "results follow the second scan");
+	check(find_ap(aps, count, "dense-network-015") < 0,
+						"lost network removed");
+	check(find_ap(aps, count, "dense-network-209") >= 0,
+						"new network added");
+	i = find_ap(aps, count, "dense-network-100");
+	check(i >= 0 && aps[i].signal_level == -45, "signal level updated");
+	free(aps);
+
+	loop->add_timeout_callback(&id, 1500, step_expired, NULL);
+}
+
+static artik_error test_wifi_events(void)
+{
+	artik_error ret;
+	int id;
+
+	fprintf(stdout, "TEST: %s starting\n", __func__);
+
+	ret = wifi->init(ARTIK_WIFI_MODE_STATION);
+	if (ret != S_OK)
+		return ret;
+
+	wifi->set_scan_result_callback(on_scan_result, NULL);
+	wifi->set_connect_callback(on_connect, NULL);
+
+	ret = wifi->scan_request();
+	if (ret != S_OK) {
+		wifi->deinit();
+		return ret;
+	}
+
+	loop->add_timeout_callback(&tick_id, TICK_MS, on_tick, NULL);
+	loop->add_timeout_callback(&id, 10000, step_quit, NULL);
+	loop->run();
+	loop->remove_timeout_callback(tick_id);
+
+	wifi->deinit();
+
+	check(scan_count == 2 && connect_count == 3, "all steps ran");
+
+	fprintf(stdout, "TEST: longest main loop stall %llu ms\n",
+				(unsigned long long)max_tick_gap);
+	check(max_tick_gap < MAX_TICK_GAP, "main loop not blocked");
+
+	ret = failures ? E_WIFI_ERROR : S_OK;
+	fprintf(stdout, "TEST: %s %s\n", __func__,
+				(ret == S_OK) ? "succeeded" : "failed");
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	artik_error ret;
+	pid_t stub;
+
+	if (!artik_is_module_available(ARTIK_MODULE_WIFI)) {
+		fprintf(stdout,
+			"TEST: Wifi module is not available,"\
+			" skipping test...\n");
+		return -1;
+	}
+
+	if (setup_namespace())
+		return -1;
+
+	stats = mmap(NULL, sizeof(*stats), PROT_READ | PROT_WRITE,
+					MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (stats == MAP_FAILED)
+		return -1;
+
+	stub = start_stub();
+	if (stub < 0) {
+		fprintf(stdout, "TEST: cannot start the stub wpa_supplicant\n");
+		return -1;
+	}
+
+	loop = (artik_loop_module *)artik_request_api_module("loop");
+	wifi = (artik_wifi_module *)artik_request_api_module("wifi");
+
+	ret = test_wifi_events();
+
+	artik_release_api_module(wifi);
+	artik_release_api_module(loop);
+
+	kill(stub, SIGTERM);
+	waitpid(stub, NULL, 0);
+
+	return (ret == S_OK) ? 0 : -1;
+}